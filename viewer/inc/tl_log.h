@@ -11,14 +11,60 @@
 
 
 #include <stdio.h>
+#include <stdint.h>
+
+/* Severity levels, a message is kept when its level <= g_tl_log_level */
+#define TL_LOG_ERR		(0)
+#define TL_LOG_WARN		(1)
+#define TL_LOG_INFO		(2)
+#define TL_LOG_DBG		(3)
+
+#define TL_LOG_QUEUE_LEN	(1024)	/* Messages waiting for the flush thread (power of 2) */
+#define TL_LOG_MSG_LEN		(240)	/* Longer messages are truncated */
+#define TL_LOG_RATE_BURST	(5)		/* Messages per call site and window ... */
+#define TL_LOG_RATE_WINDOW_MS	(1000)	/* ... before the rest of the window is suppressed */
+
+/* Rate limit state of one call site */
+typedef struct {
+	uint64_t	window_ns;	/* start of the current window */
+	uint32_t	cnt;		/* messages in the current window */
+	uint32_t	suppressed;	/* messages dropped in the current window */
+} tl_log_site;
+
+extern volatile int g_tl_log_level;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void tl_log_init(int level);
+void tl_log_term(void);
+void tl_log_write(tl_log_site *site, int level, const char *func, int line, const char *fmt, ...)
+	__attribute__((format(printf, 5, 6)));
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Enqueue a message for the flush thread; never blocks the caller */
+#define TL_LOG(level, fmt, ...)	do { \
+		static tl_log_site tl_log_site_; \
+		if ((level) <= g_tl_log_level) { \
+			tl_log_write(&tl_log_site_, (level), __func__, __LINE__, fmt, ## __VA_ARGS__); \
+		} \
+	} while (0)
+
+/* Debug log */
+#define TL_LGD(fmt, ...)	TL_LOG(TL_LOG_DBG, fmt, ## __VA_ARGS__)
 
 /* Information log */
-#define TL_LGI(fmt, ...)
-//#define TL_LGI(fmt, ...)	(fprintf(stderr, "[%s:%d] \n" fmt, __func__, __LINE__, ## __VA_ARGS__))
+#define TL_LGI(fmt, ...)	TL_LOG(TL_LOG_INFO, fmt, ## __VA_ARGS__)
+
+/* Warning log */
+#define TL_LGW(fmt, ...)	TL_LOG(TL_LOG_WARN, fmt, ## __VA_ARGS__)
 
 /* Error log */
-//#define TL_LGE(fmt, ...)
-#define TL_LGE(fmt, ...)	(fprintf(stderr, "[%s:%d] \n" fmt, __func__, __LINE__, ## __VA_ARGS__))
+#define TL_LGE(fmt, ...)	TL_LOG(TL_LOG_ERR, fmt, ## __VA_ARGS__)
 
 
 #endif	/* H_TL_LOG */
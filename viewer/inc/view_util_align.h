@@ -0,0 +1,64 @@
+//******************************************************************************
+//! \file       view_util_align.h
+//! \brief      Alignment Of Mixed Resolution Depth And IR Planes Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_ALIGN_H_
+#define _VIEW_UTIL_ALIGN_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_cam.h"
+#include "view_util_jbu.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define ALIGN_DZ_MIN        (30)    //!< Depth Neighbours Closer Than This (mm) Are On The Same Surface...
+#define ALIGN_DZ_SHIFT      (5)     //!< ...Plus depth / 2^n (About 3%), Like The Blob Connectivity.
+#define ALIGN_IR_MAX        (4095)  //!< IR Value Shown White In The IR Colored Point Cloud (12 Bit Sensor).
+
+//! Depth And IR Of One Device On A Common Grid, The Size Of The Larger Plane.
+typedef struct _align_t {
+	int32_t w;              //!< Grid Width.
+	int32_t h;              //!< Grid Height.
+	uint16_t *depth_buf;    //!< w x h Upsampled Depth, Only When Depth Is The Smaller Plane.
+	uint16_t *ir_buf;       //!< w x h Upsampled IR, Only When IR Is The Smaller Plane.
+	uint8_t *gray_buf;      //!< w x h IR Brightness.
+	const uint16_t *depth;  //!< Depth In mm On The Grid Of The Last alignApply(), 0 = Invalid.
+	const uint8_t *gray;    //!< IR Brightness On The Grid Of The Last alignApply(), NULL = No IR.
+	uint8_t lut[ALIGN_IR_MAX + 1];  //!< IR To Brightness, Square Root Curve.
+	jbu_t jbu;              //!< IR Guided Upsampling Of The Depth, Used In Place Of The Edge Aware One When Enabled.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	double ms_sum;
+	double ms_max;
+} align_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int alignInit(align_t *al, int32_t dw, int32_t dh, int32_t iw, int32_t ih, float jbu_sigma);
+void alignTerm(align_t *al);
+
+//! \brief  Bring Depth And IR Onto The Grid, DEPTH_UP / IR_UP Select The 2x Kernels Of The Image Kind.
+template <bool DEPTH_UP, bool IR_UP>
+int alignApply(align_t *al, const uint16_t *depth, const uint16_t *ir);
+
+void alignConvert(const uint16_t *depth, int32_t w, int32_t h, const cam_intr_t *cam, int16_t *xyz);
+void alignReport(align_t *al, const char *name);
+
+
+#endif  // _VIEW_UTIL_ALIGN_H_
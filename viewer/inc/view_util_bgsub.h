@@ -0,0 +1,63 @@
+//******************************************************************************
+//! \file       view_util_bgsub.h
+//! \brief      Background Depth Model And Foreground Extraction Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_BGSUB_H_
+#define _VIEW_UTIL_BGSUB_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define BGSUB_LEARN_FRAMES  (64)    //!< Frames Learned Before Foreground Is Extracted.
+#define BGSUB_SHIFT         (6)     //!< Learning Rate 1/2^n Once Learned (Only Background Pixels).
+#define BGSUB_SIGMA_K2      (9)     //!< Foreground Beyond (3 Sigma)^2 Of The Pixel.
+#define BGSUB_VAR_MIN       (225)   //!< Variance Floor (15 mm Sigma), Keeps Quiet Pixels From Flickering.
+#define BGSUB_PATH_LEN      (256)
+
+//! Background Model Of One Device.
+typedef struct _bgsub_t {
+	bool enable;            //!< Run On Every Frame.
+	int32_t w;              //!< Depth Image Width.
+	int32_t h;              //!< Depth Image Height.
+	uint16_t *mean;         //!< w x h, Running Mean Depth, 0 = Never Seen A Return.
+	uint16_t *var;          //!< w x h, Running Variance In mm^2, Saturates At 255^2.
+	uint16_t *fg_depth;     //!< w x h, Depth Of Foreground Pixels, 0 Elsewhere.
+	uint8_t *mask;          //!< w x h, 1 = Foreground.
+	uint32_t learned;       //!< Frames Learned, Capped At BGSUB_LEARN_FRAMES.
+	uint32_t tag;           //!< Model Identity (e.g. Ranging Mode), Files With Another Tag Are Not Loaded.
+	char path[BGSUB_PATH_LEN];  //!< Model File, Loaded On Init And Saved On Term.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	int32_t fg_cnt;         //!< Foreground Pixels In The Last Frame.
+	double ms_sum;
+	double ms_max;
+} bgsub_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int bgsubInit(bgsub_t *bg, int32_t w, int32_t h, uint32_t tag, const char *path);
+void bgsubTerm(bgsub_t *bg);
+bool bgsubReady(const bgsub_t *bg);
+int bgsubUpdate(bgsub_t *bg, const uint16_t *depth);
+int bgsubLoad(bgsub_t *bg);
+int bgsubSave(bgsub_t *bg);
+void bgsubReport(bgsub_t *bg, const char *name);
+
+
+#endif  // _VIEW_UTIL_BGSUB_H_
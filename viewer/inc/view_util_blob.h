@@ -0,0 +1,76 @@
+//******************************************************************************
+//! \file       view_util_blob.h
+//! \brief      Connected Component (Blob) Extraction Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_BLOB_H_
+#define _VIEW_UTIL_BLOB_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define BLOB_MAX            (256)   //!< Components Of At Least min_cnt Pixels Labeled Per Frame, Further Ones Are Not Measured.
+#define BLOB_DZ_MIN         (30)    //!< Neighbours Closer Than This In Depth (mm) Are Connected...
+#define BLOB_DZ_SHIFT       (5)     //!< ...Plus depth / 2^n (About 3%), Noise Grows With Distance.
+
+//! One Connected Component.
+typedef struct _blob_t {
+	int32_t id;             //!< Value Of Its Pixels In The Label Image.
+	int32_t cnt;            //!< Pixels.
+	float cx;               //!< Centroid In mm.
+	float cy;
+	float cz;
+	int16_t min[3];         //!< Axis Aligned Bounding Box In mm (x/y/z).
+	int16_t max[3];
+	int16_t u0;             //!< Bounding Rectangle In The Image.
+	int16_t v0;
+	int16_t u1;
+	int16_t v1;
+} blob_t;
+
+//! Extractor State Of One Device.
+typedef struct _blob_ext_t {
+	bool enable;            //!< Run On Every Frame.
+	int32_t min_cnt;        //!< Smaller Components Are Not Reported.
+	int32_t w;              //!< Depth Image Width.
+	int32_t h;              //!< Depth Image Height.
+	int32_t *parent;        //!< w x h Union-Find Forest Over Pixel Indices, -1 = No Depth.
+	int32_t *label;         //!< w x h Component Id Of Each Pixel, -1 = None.
+	int32_t *roots;         //!< Roots Found By Each Strip, Stored At The Strip's First Pixel.
+	int32_t *blob_id;       //!< Component Id Of Each Final Root, -1 = Too Small. Pixel Count Of Each Root Before.
+	struct _blob_acc_t *acc;    //!< Per Strip Statistics.
+
+	blob_t blob[BLOB_MAX];  //!< Components Of The Last Frame With At Least min_cnt Pixels.
+	int32_t blob_cnt;
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	int32_t comp_cnt;       //!< Components In The Last Frame (Any Size).
+	uint32_t overflow;      //!< Frames With More Than BLOB_MAX Components Of At Least min_cnt Pixels.
+	double ms_sum;
+	double ms_max;
+} blob_ext_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int blobInit(blob_ext_t *ext, int32_t w, int32_t h, int32_t min_cnt);
+void blobTerm(blob_ext_t *ext);
+int blobExtract(blob_ext_t *ext, const uint16_t *depth, const uint8_t *skip, const int16_t *xyz);
+void blobReport(blob_ext_t *ext, const char *name);
+
+
+#endif  // _VIEW_UTIL_BLOB_H_
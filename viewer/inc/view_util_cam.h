@@ -0,0 +1,50 @@
+//******************************************************************************
+//! \file       view_util_cam.h
+//! \brief      Pinhole Camera Intrinsics Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_CAM_H_
+#define _VIEW_UTIL_CAM_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+//! Pinhole Intrinsics Of One Image Resolution, Pixel Centers At Integer Coordinates.
+typedef struct _cam_intr_t {
+	float fx;           //!< Focal Length In Pixels.
+	float fy;
+	float cx;           //!< Optical Axis In Pixels.
+	float cy;
+} cam_intr_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+//! \brief  Intrinsics Of The Image Scaled Down By 2^level.
+static inline cam_intr_t camScale(const cam_intr_t *cam, int32_t level)
+{
+	float s = 1.0f / (float)(1 << level);
+	cam_intr_t out;
+
+	//! Pixel u Of The Smaller Image Covers Pixels 2^level * u ... 2^level * (u + 1) - 1.
+	out.fx = cam->fx * s;
+	out.fy = cam->fy * s;
+	out.cx = (cam->cx + 0.5f) * s - 0.5f;
+	out.cy = (cam->cy + 0.5f) * s - 0.5f;
+
+	return out;
+}
+
+
+#endif  // _VIEW_UTIL_CAM_H_
@@ -0,0 +1,73 @@
+//******************************************************************************
+//! \file       view_util_dash.h
+//! \brief      Composited 2D Image Window Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_DASH_H_
+#define _VIEW_UTIL_DASH_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_meta.h"
+
+namespace cv {
+class Mat;
+}
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define DASH_REFRESH_MS     (33)        //!< Default Repaint Interval Of The Window.
+#define DASH_STALE_MS       (1000)      //!< Images Not Posted For This Long Leave The Window.
+
+//! Images Tiled Side By Side, Left To Right.
+typedef enum {
+	DASH_DEPTH = 0,     //!< Color Depth Image (8 Bit BGR).
+	DASH_IR,            //!< IR Image (16 Bit).
+	DASH_BG,            //!< BG Image (16 Bit).
+	DASH_TILE_NUM
+} dash_tile_e;
+
+//! Window State, Owned By The UI Thread Except For The Posted Images.
+typedef struct _dash_t {
+	bool enable;            //!< The UI Thread Runs.
+	int refresh_ms;         //!< Repaint Interval.
+	int gamma[DASH_TILE_NUM];   //!< Gamma x 10 Of Each Image, Set By The Window's Trackbars.
+	cv::Mat *buf;           //!< 3 Buffers Per Tile: Posting (Capture Thread), Latest, Shown (UI Thread).
+	frame_meta_t meta[DASH_TILE_NUM * 3];   //!< Capture Record Of Each Buffer, Exchanged With It.
+	cv::Mat *canvas;        //!< Composited Window Image, Reused While The Layout Stays.
+	pthread_t thread;       //!< UI Thread.
+	bool thread_created;
+
+	pthread_mutex_t lock;   //!< Guards The Flags And The Statistics Below.
+	bool fresh[DASH_TILE_NUM];  //!< Latest Buffer Holds An Image Not Shown Yet.
+	volatile bool exit;     //!< Stop The UI Thread.
+	uint64_t report_ns;     //!< Time Of The Last Report.
+	uint32_t frames;        //!< Repaints With A New Image Since The Last Report.
+	uint32_t posted;        //!< Images Posted Since The Last Report.
+	double ms_sum;
+	double ms_max;
+	latency_t latency;      //!< Capture To Shown.
+} dash_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int dashInit(dash_t *dash, int refresh_ms);
+void dashTerm(dash_t *dash);
+void dashPost(dash_t *dash, int tile, const cv::Mat &img, const frame_meta_t *meta);
+void dashReport(dash_t *dash);
+
+
+#endif  // _VIEW_UTIL_DASH_H_
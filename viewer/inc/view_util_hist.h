@@ -0,0 +1,59 @@
+//******************************************************************************
+//! \file       view_util_hist.h
+//! \brief      Depth Histogram And Automatic Color Range Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_HIST_H_
+#define _VIEW_UTIL_HIST_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define HIST_SHIFT          (4)     //!< Bin Width 2^n mm.
+#define HIST_BINS           (65536 >> HIST_SHIFT)
+#define HIST_DECAY_SHIFT    (2)     //!< Older Frames Fade By 1/2^n Per Frame.
+#define HIST_HYST_MIN       (50)    //!< The Range Follows Once An End Moves By More Than This (mm)...
+#define HIST_HYST_RATIO     (0.10)  //!< ...Or This Share Of The Current Range, Whichever Is Larger.
+#define HIST_SPAN_MIN       (200)   //!< Narrowest Color Range In mm.
+
+//! Histogram State Of The Displayed Device.
+typedef struct _depth_hist_t {
+	bool enable;            //!< Run On Every Displayed Frame.
+	float lo_pct;           //!< Percentile Mapped To The Near End Of The Colors.
+	float hi_pct;           //!< Percentile Mapped To The Far End.
+	uint32_t *sub;          //!< 4 Interleaved Histograms Of The Current Frame.
+	uint32_t *bins;         //!< Decayed Histogram Over Recent Frames.
+	bool valid;             //!< lo/hi Are Set.
+	uint32_t lo;            //!< Color Range In Use, mm.
+	uint32_t hi;
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	uint32_t rebuild;       //!< Range Changes Since The Last Report.
+	double ms_sum;
+	double ms_max;
+} depth_hist_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int histInit(depth_hist_t *hist, float lo_pct, float hi_pct);
+void histTerm(depth_hist_t *hist);
+bool histUpdate(depth_hist_t *hist, const uint16_t *depth, int32_t n);
+void histReport(depth_hist_t *hist, const char *name);
+
+
+#endif  // _VIEW_UTIL_HIST_H_
@@ -0,0 +1,75 @@
+//******************************************************************************
+//! \file       view_util_icp.h
+//! \brief      Frame To Frame Point-To-Plane ICP Odometry Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_ICP_H_
+#define _VIEW_UTIL_ICP_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_cam.h"
+#include "view_util_meta.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define ICP_LEVELS          (3)     //!< Pyramid Levels: 1/2, 1/4 And 1/8 Of The Point Cloud Grid.
+#define ICP_SUMS            (28)    //!< Upper Triangle Of [J e]^T [J e], 6 Jacobian Entries And The Residual.
+
+//! One Pyramid Level Of Two Frames, The Newest And The Previous One Take Turns.
+typedef struct _icp_level_t {
+	int32_t w;              //!< Grid Width.
+	int32_t h;              //!< Grid Height.
+	cam_intr_t cam;         //!< Intrinsics At This Resolution.
+	float *vtx[2];          //!< w x h x 3 Points In m, z = 0 = None.
+	float *nrm[2];          //!< w x h x 3 Unit Normals Towards The Camera, 0/0/0 = None.
+} icp_level_t;
+
+//! Odometry State Of One Device.
+typedef struct _icp_t {
+	bool enable;            //!< Run On Every Frame.
+	int32_t w;              //!< Point Cloud Grid Width.
+	int32_t h;              //!< Point Cloud Grid Height.
+	icp_level_t lvl[ICP_LEVELS];
+	int32_t cur;            //!< Index Of The Newest Frame In vtx/nrm.
+	bool has_ref;           //!< The Other Index Holds The Previous Frame.
+	bool tracked;           //!< The Previous Frame Got Its Pose From ICP (delta Is A Motion Guess).
+	double *band;           //!< Per Row Band Of Level 0: ICP_SUMS Sums And The Pair Count.
+	float *pair;            //!< Per Row Band: 7 Rows Of w Jacobian Entries And Residuals.
+	double pose[12];        //!< Camera To World Of The Newest Frame, 3x4 Row Major, t In m.
+	double delta[12];       //!< Newest Camera To Previous Camera.
+	FILE *fp;               //!< Pose Of Every Frame, TUM Trajectory Format, NULL = Not Written.
+
+	pthread_mutex_t lock;   //!< Guards pose And The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	uint32_t lost;          //!< Frames Without An ICP Pose (Too Few Pairs Or No Solution).
+	uint32_t iter_sum;      //!< Iterations Over All Levels.
+	double pair_sum;        //!< Share Of Valid Points Paired At Level 0.
+	double step_sum;        //!< Translation Between Frames In mm.
+	double ms_sum;
+	double ms_max;
+} icp_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int icpInit(icp_t *icp, int32_t w, int32_t h, const cam_intr_t *cam, bool enable, const char *path);
+void icpTerm(icp_t *icp);
+int icpTrack(icp_t *icp, const int16_t *xyz, const frame_meta_t *meta);
+void icpReport(icp_t *icp, const char *name);
+
+
+#endif  // _VIEW_UTIL_ICP_H_
@@ -0,0 +1,50 @@
+//******************************************************************************
+//! \file       view_util_jbu.h
+//! \brief      IR Guided Joint Bilateral Depth Upsampling Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_JBU_H_
+#define _VIEW_UTIL_JBU_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define JBU_SIGMA_IR        (64.0f) //!< Default Range Sigma In IR Units.
+#define JBU_SIGMA_MAX       (65535.0f)  //!< Largest Range Sigma, The 16 Bit IR Range.
+#define JBU_SIGMA_S         (1.0f)  //!< Spatial Sigma In Depth Pixels.
+#define JBU_TAPS            (9)     //!< 3 x 3 Depth Pixels Around The Nearest One.
+#define JBU_LUT_SIZE        (64)    //!< Range Weights Of IR Differences >> shift, The Last One Is 0.
+#define JBU_MIN_WT          (32)    //!< Outputs With Less Total Weight (Of 255 Per Tap) Stay Invalid.
+
+//! Upsampler Of One Grid Size, Weights Are Built Once.
+typedef struct _jbu_t {
+	bool enable;            //!< Range Sigma Given.
+	int32_t w;              //!< Output (IR) Width, The Depth Is Half Of It.
+	int32_t h;              //!< Output (IR) Height.
+	int32_t shift;          //!< IR Difference >> shift Indexes lut.
+	uint16_t ws[4][JBU_TAPS];   //!< Spatial Weights Of Each Output Phase (dy * 2 + dx), Of 255.
+	uint8_t lut[JBU_LUT_SIZE];  //!< Range Weights, Of 255.
+	uint16_t *guide;        //!< (w / 2) x (h / 2) IR Reduced To The Depth Grid.
+} jbu_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int jbuInit(jbu_t *jbu, int32_t w, int32_t h, float sigma_ir);
+void jbuTerm(jbu_t *jbu);
+int jbuApply(jbu_t *jbu, const uint16_t *depth, const uint16_t *ir, uint16_t *out);
+
+
+#endif  // _VIEW_UTIL_JBU_H_
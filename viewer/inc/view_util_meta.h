@@ -0,0 +1,54 @@
+//******************************************************************************
+//! \file       view_util_meta.h
+//! \brief      Per-Frame Capture Record And Latency Statistics Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_META_H_
+#define _VIEW_UTIL_META_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define META_SEQ_NONE       (0xFFFFFFFFU)   //!< Sequence Number Of No Frame.
+
+//! Capture Record Of One Image, Handed Along With It To Every Consumer.
+typedef struct _frame_meta_t {
+	uint32_t seq;           //!< Sequence Number Of The Device, From 0, Gaps Only Through drop_gap.
+	uint64_t cap_ns;        //!< CLOCK_MONOTONIC Time TL_capture() Returned The Image In Nano Sec.
+	uint8_t mode_idx;       //!< Ranging Mode Reported With The Image.
+	int32_t temp;           //!< Sensor Temperature x 100 Degree C.
+	uint32_t drop_gap;      //!< Images Lost (TL_NOTIFY_NO_BUFFER) Since The Previous One.
+} frame_meta_t;
+
+//! Capture To Consumer Latency, Updated By One Thread And Reported By Another.
+typedef struct _latency_t {
+	pthread_mutex_t lock;
+	uint32_t cnt;           //!< Frames Since The Last Report.
+	double ms_sum;
+	double ms_max;
+	uint32_t gaps;          //!< Frames Lost Or Skipped Before Reaching The Consumer.
+	uint32_t last_seq;      //!< Sequence Number Of The Previous Frame.
+} latency_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+void latencyInit(latency_t *lat);
+void latencyAdd(latency_t *lat, const frame_meta_t *meta, uint64_t ns);
+void latencyReport(latency_t *lat, const char *name);
+
+
+#endif  // _VIEW_UTIL_META_H_
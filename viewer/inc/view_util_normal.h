@@ -0,0 +1,55 @@
+//******************************************************************************
+//! \file       view_util_normal.h
+//! \brief      Integral Image Normal Estimation Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_NORMAL_H_
+#define _VIEW_UTIL_NORMAL_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define NORMAL_RADIUS_MAX   (12)    //!< Largest Window Radius, Keeps Window Sums Within 32 Bits.
+#define NORMAL_DZ_RATIO     (0.02)  //!< Depth Step Per Pixel (Relative To z) Treated As An Edge.
+#define NORMAL_GRAZING_COS  (0.17)  //!< Facing Below This (About 80 Degrees) Counts As Grazing.
+
+//! Estimator State Of One Device.
+typedef struct _normal_est_t {
+	bool enable;            //!< Run On Every Frame.
+	int32_t radius;         //!< Half Size Of The Averaging Window In Pixels.
+	int32_t w;              //!< Point Cloud Grid Width.
+	int32_t h;              //!< Point Cloud Grid Height.
+	uint32_t *integ;        //!< (w + 1) x (h + 1) Integral Image Of x/y/z/Count, Modulo 2^32.
+	int8_t *normal;         //!< w x h x 3, Unit Normal * 127 Towards The Camera, 0/0/0 = None.
+	uint8_t *facing;        //!< w x h, Cosine Between Normal And View Ray * 255, 0 = No Normal.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	int32_t valid_cnt;      //!< Points With A Normal In The Last Frame.
+	double ms_sum;
+	double ms_max;
+} normal_est_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int normalInit(normal_est_t *est, int32_t w, int32_t h, int32_t radius);
+void normalTerm(normal_est_t *est);
+int normalCompute(normal_est_t *est, const int16_t *xyz);
+void normalReport(normal_est_t *est, const char *name);
+
+
+#endif  // _VIEW_UTIL_NORMAL_H_
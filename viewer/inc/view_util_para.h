@@ -0,0 +1,38 @@
+//******************************************************************************
+//! \file       view_util_para.h
+//! \brief      Worker Thread Pool Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_PARA_H_
+#define _VIEW_UTIL_PARA_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define PARA_MAX_THREAD     (16)    //!< Maximum Number Of Threads Working On One Job (Caller Included).
+
+//! Job Body, Called For Items [begin, end), begin Is A Multiple Of The Grain.
+typedef void (*para_func_t)(void *ctx, int32_t begin, int32_t end);
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int paraInit(int threads);
+void paraTerm(void);
+int paraThreads(void);
+void paraFor(para_func_t func, void *ctx, int32_t num, int32_t grain);
+
+
+#endif  // _VIEW_UTIL_PARA_H_
@@ -0,0 +1,78 @@
+//******************************************************************************
+//! \file       view_util_plane.h
+//! \brief      RANSAC Plane Detection Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_PLANE_H_
+#define _VIEW_UTIL_PLANE_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define PLANE_ITER          (128)   //!< Hypotheses Per Frame.
+#define PLANE_ITER_WARM     (32)    //!< Hypotheses Per Frame While The Previous Plane Still Holds.
+#define PLANE_HOLD_RATIO    (0.90)  //!< Previous Plane Holds With This Share Of Its Former Support.
+#define PLANE_SAMPLE_MAX    (16384) //!< Points Scored Per Hypothesis (Grid Subsample).
+#define PLANE_SAMPLE_MIN    (256)   //!< Fewer Valid Points Than This Give No Plane.
+#define PLANE_MIN_RATIO     (0.10)  //!< A Plane Needs This Share Of The Valid Points.
+
+//! Plane nx * x + ny * y + nz * z + d = 0, |n| = 1, d >= 0 (Normal Towards The Camera), mm.
+typedef struct _plane_t {
+	float nx;
+	float ny;
+	float nz;
+	float d;
+} plane_t;
+
+//! Detector State Of One Device.
+typedef struct _plane_det_t {
+	bool enable;            //!< Run On Every Frame.
+	float thresh;           //!< Inlier Distance In mm.
+	int32_t w;              //!< Point Cloud Grid Width.
+	int32_t h;              //!< Point Cloud Grid Height.
+	uint8_t *mask;          //!< w x h, 1 = Point On The Plane, All 0 Without A Plane.
+	float *sx;              //!< Scoring Subsample, Structure Of Arrays.
+	float *sy;
+	float *sz;
+	int32_t sample_cnt;     //!< Valid Points In The Subsample.
+	uint32_t seed;          //!< Advanced Every Frame.
+
+	bool found;             //!< plane Is Valid.
+	plane_t plane;          //!< Plane Of The Last Frame.
+	int32_t support;        //!< Subsample Inliers Of plane.
+	int32_t inliers;        //!< Inliers Of plane In The Full Grid.
+	int32_t valid_cnt;      //!< Valid Points In The Full Grid.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	uint32_t found_cnt;     //!< Frames With A Plane.
+	uint32_t warm_cnt;      //!< Frames Where The Previous Plane Held.
+	plane_t last_plane;     //!< plane Of The Last Frame, Copied For The Report.
+	double last_share;      //!< Share Of Valid Points On last_plane.
+	double ms_sum;
+	double ms_max;
+} plane_det_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int planeInit(plane_det_t *det, int32_t w, int32_t h, float thresh);
+void planeTerm(plane_det_t *det);
+int planeDetect(plane_det_t *det, const int16_t *xyz);
+void planeReport(plane_det_t *det, const char *name);
+
+
+#endif  // _VIEW_UTIL_PLANE_H_
@@ -16,20 +16,50 @@
 #include <GL/freeglut.h>
 #include <math.h>
 
+#include "view_util_meta.h"
+#include "view_util_sched.h"
+
 
 //******************************************************************************
 // Definitions
 //******************************************************************************
 #define MAX_PLY_SIZE    (640 * 480 * 2)
+#define MAX_PLY_BOX     (64)    //!< Boxes Drawn Per Frame.
+
+//! Axis Aligned Box In mm, e.g. A Detected Object.
+typedef struct _ptcd_box_t {
+	int16_t min[3];
+	int16_t max[3];
+} ptcd_box_t;
+
+//! One Frame Handed To The Point Cloud View.
+typedef struct _ptcd_frame_t {
+	frame_meta_t meta;      //!< Capture Record, Its Sequence Number Identifies The Frame.
+	const int16_t *xyz;     //!< Organized Point Cloud, w x h Points Of x/y/z In mm.
+	int32_t w;              //!< Grid Width.
+	int32_t h;              //!< Grid Height.
+	int32_t step;           //!< Grid Stride, Only Every step-th Point In x And y Is Taken.
+	const uint8_t *hide;    //!< Optional w x h Mask, Non-Zero Points Are Not Drawn (e.g. Floor Plane).
+	const uint8_t *facing;  //!< Optional w x h Cosine Of Normal And View Ray * 255 (0 = None), For Shading.
+	const uint8_t *gray;    //!< Optional w x h IR Brightness, Colors The Points In Place Of Their Depth ('i' Key).
+	const ptcd_box_t *box;  //!< Optional Boxes Drawn Around Objects.
+	int32_t box_cnt;
+} ptcd_frame_t;
 
 
 //******************************************************************************
 // Functions
 //******************************************************************************
 void makeColorTbl(uint32_t min_val, uint32_t max_val, uint32_t range);
-void update3dData(double ts_ns, int16_t *ply_dat, int32_t ply_cnt);
+void update3dData(const ptcd_frame_t *frame);
 int mainPtCloudView(float fov_y, float z_far, const char *title);
+int mainPtCloudViewOffscreen(float fov_y, float z_far, int w, int h, int frames);
+void setPtCloudSnapshot(const char *prefix);
 void mainPtCloudViewExit(void);
+jitter_t *getPtCloudJitter(void);
+latency_t *getPtCloudLatency(void);
+void reportPtCloudCull(void);
+void setPtCloudRefresh(int ms);
 
 
 #endif  // _VIEW_UTIL_PTCD_H_
@@ -0,0 +1,47 @@
+//******************************************************************************
+//! \file       view_util_pyr.h
+//! \brief      Depth Image Pyramid Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_PYR_H_
+#define _VIEW_UTIL_PYR_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+
+#include "view_util_cam.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define PYR_LEVELS          (4)     //!< Full, 1/2, 1/4 And 1/8 Resolution.
+
+//! Depth Pyramid Of One Device, Rebuilt Every Frame Into The Same Buffers.
+typedef struct _depth_pyr_t {
+	int32_t levels;                 //!< Levels Built, 1 = Only The Input.
+	int32_t w[PYR_LEVELS];          //!< Width Of Each Level.
+	int32_t h[PYR_LEVELS];          //!< Height Of Each Level.
+	cam_intr_t cam[PYR_LEVELS];     //!< Intrinsics Of Each Level.
+	const uint16_t *depth[PYR_LEVELS];  //!< Depth In mm Of Each Level, 0 = Invalid; Level 0 Is The Input.
+	uint16_t *buf[PYR_LEVELS];      //!< Depth Of Levels 1 And Up.
+	int16_t *xyz[PYR_LEVELS];       //!< Points Of Levels 1 And Up, From pyrConvert().
+} depth_pyr_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int pyrInit(depth_pyr_t *pyr, int32_t w, int32_t h, const cam_intr_t *cam, int32_t levels);
+void pyrTerm(depth_pyr_t *pyr);
+int pyrBuild(depth_pyr_t *pyr, const uint16_t *depth);
+const int16_t *pyrConvert(depth_pyr_t *pyr, int32_t level);
+
+
+#endif  // _VIEW_UTIL_PYR_H_
@@ -0,0 +1,71 @@
+//******************************************************************************
+//! \file       view_util_qos.h
+//! \brief      Adaptive Quality Controller Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_QOS_H_
+#define _VIEW_UTIL_QOS_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define QOS_LOAD_HIGH       (0.90)  //!< Degrade When Processing Takes More Than This Share Of The Frame Budget.
+#define QOS_LOAD_LOW        (0.55)  //!< Restore When Processing Takes Less Than This Share Of The Frame Budget.
+#define QOS_LOAD_ALPHA      (0.10)  //!< Smoothing Factor Of The Load Average.
+#define QOS_QUEUE_HIGH      (2)     //!< Degrade When More Frames Than This Wait In A Queue.
+#define QOS_DEGRADE_FRAMES  (5)     //!< Consecutive Overloaded Frames Before Stepping Down.
+#define QOS_RESTORE_FRAMES  (90)    //!< Consecutive Idle Frames Before Stepping Back Up.
+
+//! Quality Levels, Each One Cheaper Than The Previous.
+typedef enum {
+	QOS_LEVEL_FULL = 0,     //!< Every Point, Every Window, Full Render Rate.
+	QOS_LEVEL_DECIMATE,     //!< Every 2nd Point In x And y.
+	QOS_LEVEL_NO_IR_BG,     //!< + Skip IR/BG Display.
+	QOS_LEVEL_LOW_RATE,     //!< + Every 4th Point, Half Render Rate.
+	QOS_LEVEL_NUM
+} qos_level_e;
+
+//! Settings Applied At A Quality Level.
+typedef struct _qos_setting_t {
+	int decimation;     //!< Point Cloud Grid Stride.
+	bool show_ir_bg;    //!< Draw The IR And BG Windows.
+	int refresh_ms;     //!< Point Cloud View Refresh Interval.
+	const char *name;   //!< Description.
+} qos_setting_t;
+
+//! Controller State.
+typedef struct _qos_t {
+	bool enable;            //!< false = Stay At QOS_LEVEL_FULL.
+	double budget_ms;       //!< Frame Budget, i.e. Frame Interval Of The Ranging Mode.
+	double load;            //!< Smoothed Processing Time / Budget.
+	int level;              //!< Current qos_level_e.
+	int over_cnt;           //!< Consecutive Overloaded Frames.
+	int under_cnt;          //!< Consecutive Idle Frames.
+	uint32_t drops;         //!< Dropped Frames In Total (Written By The Pipeline Only).
+	uint32_t drops_rep;     //!< Dropped Frames At The Last Report (Written By The Reporter Only).
+	int queue_depth;        //!< Last Reported Queue Depth.
+	uint32_t transitions;   //!< Number Of Level Changes.
+} qos_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+void qosInit(qos_t *qos, double budget_ms, bool enable);
+bool qosUpdate(qos_t *qos, double proc_ms, uint32_t drops, int queue_depth);
+const qos_setting_t *qosSetting(const qos_t *qos);
+void qosReport(qos_t *qos, const char *name);
+
+
+#endif  // _VIEW_UTIL_QOS_H_
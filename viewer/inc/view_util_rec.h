@@ -0,0 +1,74 @@
+//******************************************************************************
+//! \file       view_util_rec.h
+//! \brief      Background Video Recording Of The Displayed Images Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_REC_H_
+#define _VIEW_UTIL_REC_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_meta.h"
+
+namespace cv {
+class Mat;
+class VideoWriter;
+}
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define REC_QUEUE_LEN       (8)     //!< Frames Waiting For The Encoder, Further Frames Are Dropped.
+
+//! Recorder Of One Image Stream.
+typedef struct _rec_t {
+	bool enable;            //!< Frames Are Queued.
+	char path[256];         //!< Output File, .avi = MJPEG, Else MPEG-4.
+	char name[32];          //!< Name Of The Encoder Thread.
+	double fps;             //!< Frame Rate Stored In The File.
+	cv::Mat *slot;          //!< Queue Of REC_QUEUE_LEN Frames, Reused Once Allocated.
+	frame_meta_t meta[REC_QUEUE_LEN];   //!< Capture Record Of Each Queued Frame.
+	cv::VideoWriter *writer;    //!< Opened With The Size Of The First Frame.
+	FILE *stamp;            //!< path.csv, One Line Of Capture Record Per Encoded Frame.
+	pthread_t thread;       //!< Encoder Thread.
+	bool thread_created;
+
+	pthread_mutex_t lock;   //!< Guards The Queue Positions And The Statistics Below.
+	pthread_cond_t cond;    //!< Signaled When A Frame Is Queued Or On Exit.
+	uint32_t head;          //!< Next Frame To Encode.
+	uint32_t tail;          //!< Next Free Slot.
+	bool exit;              //!< Encode The Queued Frames And Stop.
+	bool failed;            //!< The File Could Not Be Opened.
+	uint64_t report_ns;     //!< Time Of The Last Report.
+	uint32_t written;       //!< Frames Encoded Since The Last Report.
+	uint32_t dropped;       //!< Frames Dropped Since The Last Report.
+	uint32_t written_total;
+	uint32_t dropped_total;
+	double ms_sum;
+	double ms_max;
+	latency_t latency;      //!< Capture To Encoded.
+} rec_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int recInit(rec_t *rec, const char *path, double fps, const char *name);
+void recTerm(rec_t *rec);
+void recPush(rec_t *rec, const cv::Mat &img, const frame_meta_t *meta);
+int recQueued(rec_t *rec);
+void recReport(rec_t *rec);
+
+
+#endif  // _VIEW_UTIL_REC_H_
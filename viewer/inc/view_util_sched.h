@@ -0,0 +1,58 @@
+//******************************************************************************
+//! \file       view_util_sched.h
+//! \brief      Thread Scheduling Utilities Function Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_SCHED_H_
+#define _VIEW_UTIL_SCHED_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+//! Scheduling Setting Of One Thread, Parsed From "policy[:priority[:cpus]]".
+typedef struct _sched_cfg_t {
+	bool valid;         //!< false = Leave The Thread As Created.
+	int policy;         //!< SCHED_OTHER Or SCHED_FIFO.
+	int priority;       //!< 1..99 For SCHED_FIFO, 0 For SCHED_OTHER.
+	bool cpus_valid;    //!< false = Any Core.
+	cpu_set_t cpus;     //!< Cores The Thread May Run On.
+} sched_cfg_t;
+
+//! Frame Interval Statistics, Updated By One Thread And Reported By Another.
+typedef struct _jitter_t {
+	pthread_mutex_t lock;
+	uint64_t last_ns;   //!< Time Stamp Of The Previous Frame.
+	uint32_t cnt;       //!< Number Of Intervals.
+	double mean;        //!< Mean Interval [ms].
+	double m2;          //!< Sum Of Squared Differences From The Mean (Welford).
+	double min;         //!< Minimum Interval [ms].
+	double max;         //!< Maximum Interval [ms].
+} jitter_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int schedParse(const char *spec, sched_cfg_t *cfg);
+int schedApply(pthread_t thread, const sched_cfg_t *cfg, const char *name);
+void schedPrint(pthread_t thread, const char *name);
+
+void jitterInit(jitter_t *jit);
+void jitterTick(jitter_t *jit, uint64_t ns);
+void jitterReport(jitter_t *jit, const char *name);
+
+
+#endif  // _VIEW_UTIL_SCHED_H_
@@ -0,0 +1,75 @@
+//******************************************************************************
+//! \file       view_util_spidx.h
+//! \brief      Hashed Voxel Grid Spatial Index Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_SPIDX_H_
+#define _VIEW_UTIL_SPIDX_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define SPIDX_MIN_NB        (4)     //!< Points With Fewer Neighbours Within The Radius Are Outliers.
+#define SPIDX_NONE          (0xFFFFFFFFU)   //!< Bucket Of A Point Without Depth.
+
+//! One Indexed Point, Points Of A Bucket Are Stored Together.
+typedef struct _spidx_pt_t {
+	int16_t x;              //!< Position In mm.
+	int16_t y;
+	int16_t z;
+	int16_t pad;
+	int32_t idx;            //!< Index In The Point Cloud Grid.
+} spidx_pt_t;
+
+//! Index Of One Device's Point Cloud, Rebuilt Every Frame.
+typedef struct _spidx_t {
+	bool enable;            //!< Run On Every Frame.
+	int32_t w;              //!< Point Cloud Grid Width.
+	int32_t h;              //!< Point Cloud Grid Height.
+	float cell;             //!< Voxel Side In mm, Also The Outlier Test Radius.
+	float inv_cell;
+	uint32_t mask;          //!< Buckets - 1 (Power Of 2).
+	uint32_t *start;        //!< mask + 2 Entries, Points Of Bucket b Are pt[start[b]] .. pt[start[b + 1] - 1].
+	uint32_t *key;          //!< w x h Bucket Of Each Point, Or SPIDX_NONE.
+	uint32_t *scan;         //!< Partial Sums Of The Bucket Counts, One Per Scan Block.
+	spidx_pt_t *pt;         //!< Points Sorted By Bucket.
+	int32_t cnt;            //!< Points In The Index.
+	uint16_t *nb;           //!< w x h Neighbours Within cell (Including The Point), Counted Up To SPIDX_MIN_NB + 1.
+	uint8_t *outlier;       //!< w x h, 1 = Fewer Than SPIDX_MIN_NB Neighbours.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	uint64_t points;        //!< Points Indexed.
+	uint64_t queries;       //!< Outlier Test Queries.
+	uint64_t outliers;      //!< Of Which Outliers.
+	double build_ms_sum;
+	double build_ms_max;
+	double query_ms_sum;
+} spidx_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int spidxInit(spidx_t *idx, int32_t w, int32_t h, float cell);
+void spidxTerm(spidx_t *idx);
+int spidxBuild(spidx_t *idx, const int16_t *xyz);
+void spidxNearest(const spidx_t *idx, const int16_t *q, int32_t n, float max_dist, int32_t *nn, float *dist);
+void spidxRadiusCount(const spidx_t *idx, const int16_t *q, int32_t n, float radius, uint16_t *cnt);
+int spidxOutliers(spidx_t *idx, const int16_t *xyz);
+void spidxReport(spidx_t *idx, const char *name);
+
+
+#endif  // _VIEW_UTIL_SPIDX_H_
@@ -0,0 +1,34 @@
+//******************************************************************************
+//! \file       view_util_time.h
+//! \brief      Time Utilities Function Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_TIME_H_
+#define _VIEW_UTIL_TIME_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <time.h>
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+//! \brief  CLOCK_MONOTONIC Time In Nano Sec.
+static inline uint64_t getMonoNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+#endif  // _VIEW_UTIL_TIME_H_
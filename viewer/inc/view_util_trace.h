@@ -0,0 +1,61 @@
+//******************************************************************************
+//! \file       view_util_trace.h
+//! \brief      Per-Thread Binary Trace Ring Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_TRACE_H_
+#define _VIEW_UTIL_TRACE_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define TRACE_RING_SIZE     (65536)     //!< Events Kept Per Thread (Power Of 2).
+
+//! Traced Pipeline Stages.
+typedef enum {
+	TRACE_CAPTURE = 0,  //!< Waiting For And Receiving An Image (TL_capture).
+	TRACE_PROCESS,      //!< Converting And Preparing An Image.
+	TRACE_BGSUB,        //!< Background Model Update And Foreground Extraction.
+	TRACE_PLANE,        //!< Plane Detection.
+	TRACE_NORMAL,       //!< Normal Estimation.
+	TRACE_BLOB,         //!< Connected Component Extraction.
+	TRACE_RENDER,       //!< Drawing The Point Cloud Scene.
+	TRACE_DISPLAY,      //!< Presenting A Frame (imshow/waitKey, Buffer Swap).
+	TRACE_ENCODE,       //!< Encoding A Recorded Frame.
+	TRACE_ICP,          //!< ICP Odometry.
+	TRACE_INDEX,        //!< Spatial Index Build And Outlier Test.
+	TRACE_FUSE,         //!< TSDF Integration And Raycast.
+	TRACE_PYRAMID,      //!< Depth Pyramid Build And Conversion.
+	TRACE_ALIGN,        //!< Resampling Of Depth And IR Onto One Grid.
+	TRACE_STAGE_NUM
+} trace_stage_e;
+
+extern volatile bool g_trace_enable;  //!< Recording On/Off.
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+void traceInit(const char *path);
+void traceSetThreadName(const char *name);
+void traceEvent(int stage, char phase);
+int traceDump(void);
+
+//! \brief  Mark The Begin Of A Stage On The Calling Thread.
+#define TRACE_BEGIN(stage)  do { if (g_trace_enable) { traceEvent((stage), 'B'); } } while (0)
+//! \brief  Mark The End Of A Stage On The Calling Thread.
+#define TRACE_END(stage)    do { if (g_trace_enable) { traceEvent((stage), 'E'); } } while (0)
+
+
+#endif  // _VIEW_UTIL_TRACE_H_
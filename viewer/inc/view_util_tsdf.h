@@ -0,0 +1,106 @@
+//******************************************************************************
+//! \file       view_util_tsdf.h
+//! \brief      TSDF Volumetric Fusion Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_TSDF_H_
+#define _VIEW_UTIL_TSDF_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_cam.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define TSDF_BLOCK_SHIFT    (3)
+#define TSDF_BLOCK          (1 << TSDF_BLOCK_SHIFT)     //!< Voxels Per Block Side.
+#define TSDF_BLOCK_VOX      (TSDF_BLOCK * TSDF_BLOCK * TSDF_BLOCK)
+#define TSDF_MEM_MB         (128)   //!< Default Memory Budget Of A Volume.
+
+//! One Voxel: Truncated Signed Distance And Its Weight.
+typedef struct _tsdf_vox_t {
+	int16_t sdf;            //!< Distance / Truncation x 32767, Positive In Front Of The Surface.
+	uint16_t w;             //!< Frames Averaged, 0 = Never Seen.
+} tsdf_vox_t;
+
+//! Hash Table Entry Of A Block.
+typedef struct _tsdf_entry_t {
+	uint64_t key;           //!< Packed Block Coordinates, 0 = Empty.
+	int32_t slot;           //!< Block In The Pool, -1 = None Yet (Pool Full And Nothing To Recycle).
+	uint32_t stamp;         //!< Last Frame That Saw The Block.
+} tsdf_entry_t;
+
+//! Sparse Volume Of One Device.
+typedef struct _tsdf_t {
+	bool enable;            //!< Integrate Every Frame.
+	int32_t w;              //!< Depth Image Width.
+	int32_t h;              //!< Depth Image Height.
+	cam_intr_t cam;         //!< Depth Camera Intrinsics.
+	float voxel;            //!< Voxel Side In mm.
+	float trunc;            //!< Truncation Distance In mm.
+	int32_t max_blocks;     //!< Pool Size, Bounds The Memory.
+	int32_t used;           //!< Blocks Taken From The Pool.
+	int32_t *free_slot;     //!< Recycled Blocks Waiting For New Ones, max_blocks Entries.
+	int32_t free_cnt;
+	uint32_t *age;          //!< max_blocks Stamps, Scratch Of The Recycling.
+	uint32_t mask;          //!< Hash Table Entries - 1 (Power Of 2).
+	tsdf_entry_t *table;    //!< Block Hash, Linear Probing.
+	tsdf_entry_t *spare;    //!< Table Rebuilt Without The Recycled Blocks, Then Swapped.
+	tsdf_vox_t *pool;       //!< max_blocks x TSDF_BLOCK_VOX Voxels.
+	uint32_t *visible;      //!< Table Entries Seen By The Current Frame.
+	uint32_t vis_cnt;
+	uint32_t frame;         //!< Stamp Of The Current Frame, From 1.
+	float pose[12];         //!< Camera To World Of The Current Frame, 3x4 Row Major, t In mm.
+	int16_t *ray;           //!< w x h Surface Of The Last Finished Raycast In Camera Coordinates (mm), z = 0 = None.
+
+	int16_t *ray_done;      //!< Finished Raycast Not Taken By tsdfRaycast() Yet.
+	int16_t *ray_work;      //!< Raycast Being Cast By The Raycast Thread.
+	uint16_t *ray_depth;    //!< Depth Image Of The Raycast Being Cast, Where Rays Start Searching.
+	bool ray_hint;          //!< ray_depth Is Valid.
+	float ray_pose[12];     //!< Pose Of The Raycast Being Cast.
+	int32_t ray_step;       //!< Grid Stride Of The Raycast Being Cast.
+	pthread_t thread;       //!< Raycast Thread.
+	bool thread_created;
+	pthread_mutex_t ray_lock;   //!< Guards The Flags Below.
+	pthread_cond_t ray_cond;    //!< Signaled When A Flag Changes.
+	bool ray_busy;          //!< A Raycast Is Requested Or Being Cast.
+	bool ray_fresh;         //!< ray_done Holds A Raycast.
+	bool casting;           //!< The Raycast Thread Reads The Volume (One Band Of Rows).
+	bool fusing;            //!< tsdfIntegrate() Writes Or Waits To Write The Volume.
+	bool exit;              //!< Stop The Raycast Thread.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Frames Since The Last Report.
+	uint64_t vis_sum;       //!< Blocks Integrated.
+	uint32_t dropped;       //!< Blocks Not Allocated, Pool Or Table Full.
+	uint32_t recycled;      //!< Least Recently Seen Blocks Given To New Ones.
+	uint32_t saturated;     //!< Frames With A Full Pool Of Blocks All Seen By The Previous Frame.
+	double int_ms_sum;
+	double int_ms_max;
+	uint32_t rays;          //!< Raycasts Since The Last Report.
+	double ray_ms_sum;
+} tsdf_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int tsdfInit(tsdf_t *tsdf, int32_t w, int32_t h, const cam_intr_t *cam, float voxel, int32_t mem_mb);
+void tsdfTerm(tsdf_t *tsdf);
+int tsdfIntegrate(tsdf_t *tsdf, const uint16_t *depth, const double *pose);
+int tsdfRaycast(tsdf_t *tsdf, const uint16_t *depth, int32_t step);
+void tsdfReport(tsdf_t *tsdf, const char *name);
+
+
+#endif  // _VIEW_UTIL_TSDF_H_
@@ -0,0 +1,54 @@
+//******************************************************************************
+//! \file       view_util_undist.h
+//! \brief      Lens Undistortion Remap Header File.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+#ifndef _VIEW_UTIL_UNDIST_H_
+#define _VIEW_UTIL_UNDIST_H_
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "view_util_cam.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define UNDIST_PRM_FRAC     (24)    //!< Fraction Bits Of The Fixed Point Distortion Coefficients (Assumed, Not Verified).
+#define UNDIST_WT_BITS      (14)    //!< Bilinear Weights Are Q14, The Four Of A Pixel Sum To 1 << 14.
+
+//! Remap Table Of One Image Size, Built Once.
+typedef struct _undist_t {
+	bool enable;            //!< Lens Has Distortion And Remapping Is Wanted.
+	int32_t w;              //!< Image Width.
+	int32_t h;              //!< Image Height.
+	uint32_t *ofs;          //!< w x h Top-Left Source Pixel Of Each Output Pixel.
+	uint16_t *wt;           //!< 4 Planes Of w x h Weights: Top-Left, Top-Right, Bottom-Left, Bottom-Right.
+	uint16_t *out;          //!< w x h Undistorted Image.
+
+	pthread_mutex_t lock;   //!< Guards The Statistics Below.
+	uint32_t frames;        //!< Images Since The Last Report.
+	double ms_sum;
+	double ms_max;
+} undist_t;
+
+
+//******************************************************************************
+// Functions
+//******************************************************************************
+int undistInit(undist_t *ud, int32_t w, int32_t h, const cam_intr_t *cam, const int64_t prm[4], bool enable);
+void undistTerm(undist_t *ud);
+const uint16_t *undistApply(undist_t *ud, const uint16_t *src);
+void undistReport(undist_t *ud, const char *name);
+
+
+#endif  // _VIEW_UTIL_UNDIST_H_
@@ -0,0 +1,338 @@
+//******************************************************************************
+//! \file       tl_log.cpp
+//! \brief      Asynchronous Log, Callers Only Enqueue And A Background Thread Writes.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "tl_log.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define TL_LOG_POLL_MS      (100)   //!< Flush Thread Wake Up Interval Without Messages.
+
+//! One Queued Message.
+typedef struct _tl_log_slot_t {
+	uint32_t seq;       //!< Vyukov Sequence, Slot Is Free When seq == Enqueue Position.
+	int level;
+	uint64_t ns;        //!< CLOCK_MONOTONIC Time Of The Call.
+	char text[TL_LOG_MSG_LEN];
+} tl_log_slot_t;
+
+static const char g_tl_log_tag[] = { 'E', 'W', 'I', 'D' };
+
+volatile int g_tl_log_level = TL_LOG_INFO;
+
+static tl_log_slot_t g_tl_log_slot[TL_LOG_QUEUE_LEN];
+static uint32_t g_tl_log_enq;       //!< Next Enqueue Position, Shared By All Producers.
+static uint32_t g_tl_log_deq;       //!< Next Dequeue Position, Flush Thread Only.
+static uint32_t g_tl_log_dropped;   //!< Messages Lost Because The Queue Was Full.
+static uint32_t g_tl_log_waiting;   //!< Flush Thread Sleeps And Wants A sem_post.
+static sem_t g_tl_log_sem;
+static pthread_t g_tl_log_thread;
+static volatile bool g_tl_log_started = false;
+static volatile bool g_tl_log_exit = false;
+
+
+//******************************************************************************
+//! \brief        Write One Message To stderr.
+//! \n
+//! \param[in]    level     Severity.
+//! \param[in]    ns        CLOCK_MONOTONIC time of the call.
+//! \param[in]    text      Message.
+//! \return       None.
+//******************************************************************************
+static void tl_log_output(int level, uint64_t ns, const char *text)
+{
+	size_t len = strlen(text);
+
+	fprintf(stderr, "%llu.%06llu %c %s%s",
+			(unsigned long long)(ns / 1000000000ULL), (unsigned long long)((ns / 1000ULL) % 1000000ULL),
+			g_tl_log_tag[level], text, ((len > 0) && (text[len - 1] == '\n')) ? "" : "\n");
+}
+
+
+//******************************************************************************
+//! \brief        Put A Message On The Queue Without Locking.
+//! \n            When The Queue Is Full The Message Is Counted And Dropped.
+//! \param[in]    level     Severity.
+//! \param[in]    ns        CLOCK_MONOTONIC time of the call.
+//! \param[in]    func      Calling function.
+//! \param[in]    line      Calling line.
+//! \param[in]    fmt       printf format.
+//! \param[in]    ap        Arguments.
+//! \return       None.
+//******************************************************************************
+static void tl_log_enqueue(int level, uint64_t ns, const char *func, int line, const char *fmt, va_list ap)
+{
+	tl_log_slot_t *slot;
+	uint32_t pos = __atomic_load_n(&g_tl_log_enq, __ATOMIC_RELAXED);
+	int len;
+
+	for (;;) {
+		slot = &g_tl_log_slot[pos & (TL_LOG_QUEUE_LEN - 1)];
+		int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&g_tl_log_enq, &pos, pos + 1, true,
+											__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else
+		if (diff < 0) {
+			__atomic_fetch_add(&g_tl_log_dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		else {
+			pos = __atomic_load_n(&g_tl_log_enq, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->level = level;
+	slot->ns = ns;
+	len = snprintf(slot->text, sizeof(slot->text), "[%s:%d] ", func, line);
+	if ((len > 0) && (len < (int)sizeof(slot->text))) {
+		vsnprintf(slot->text + len, sizeof(slot->text) - len, fmt, ap);
+	}
+
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	//! \remark - Only Errors Wake A Sleeping Flush Thread (A System Call), Others Wait For Its Poll.
+	if ((level == TL_LOG_ERR) && (__atomic_exchange_n(&g_tl_log_waiting, 0, __ATOMIC_SEQ_CST) != 0)) {
+		sem_post(&g_tl_log_sem);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Enqueue Helper Taking Variadic Arguments.
+//! \n
+//! \param[in]    level     Severity.
+//! \param[in]    ns        CLOCK_MONOTONIC time of the call.
+//! \param[in]    func      Calling function.
+//! \param[in]    line      Calling line.
+//! \param[in]    fmt       printf format.
+//! \return       None.
+//******************************************************************************
+static void tl_log_enqueuef(int level, uint64_t ns, const char *func, int line, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	tl_log_enqueue(level, ns, func, line, fmt, ap);
+	va_end(ap);
+}
+
+
+//******************************************************************************
+//! \brief        Check Whether The Next Message Is Complete.
+//! \n
+//! \param[in]    None.
+//! \return       true      a message can be written
+//******************************************************************************
+static bool tl_log_ready(void)
+{
+	tl_log_slot_t *slot = &g_tl_log_slot[g_tl_log_deq & (TL_LOG_QUEUE_LEN - 1)];
+
+	return (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == g_tl_log_deq + 1);
+}
+
+
+//******************************************************************************
+//! \brief        Write Out Every Queued Message.
+//! \n            Only Called From One Thread At A Time.
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void tl_log_drain(void)
+{
+	static uint32_t dropped_rep = 0;
+	uint32_t dropped;
+	bool written = false;
+
+	while (tl_log_ready()) {
+		tl_log_slot_t *slot = &g_tl_log_slot[g_tl_log_deq & (TL_LOG_QUEUE_LEN - 1)];
+
+		tl_log_output(slot->level, slot->ns, slot->text);
+		written = true;
+
+		__atomic_store_n(&slot->seq, g_tl_log_deq + TL_LOG_QUEUE_LEN, __ATOMIC_RELEASE);
+		g_tl_log_deq++;
+	}
+
+	dropped = __atomic_load_n(&g_tl_log_dropped, __ATOMIC_RELAXED);
+	if (dropped != dropped_rep) {
+		char text[64];
+		snprintf(text, sizeof(text), "[log] %u messages dropped, queue full", dropped - dropped_rep);
+		tl_log_output(TL_LOG_WARN, getMonoNs(), text);
+		dropped_rep = dropped;
+		written = true;
+	}
+
+	if (written) {
+		fflush(stderr);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Flush Thread.
+//! \n
+//! \param[in]    data      Not used.
+//! \return       NULL.
+//******************************************************************************
+static void *tl_log_thread(void *data)
+{
+	(void)data;
+
+	while (!g_tl_log_exit) {
+		struct timespec ts;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += TL_LOG_POLL_MS * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+
+		//! \remark - Announce The Sleep First, Then Look Again So No Message Is Missed.
+		__atomic_store_n(&g_tl_log_waiting, 1, __ATOMIC_SEQ_CST);
+		if (!tl_log_ready() && !g_tl_log_exit) {
+			while ((sem_timedwait(&g_tl_log_sem, &ts) != 0) && (errno == EINTR)) {
+			}
+		}
+		__atomic_store_n(&g_tl_log_waiting, 0, __ATOMIC_SEQ_CST);
+
+		tl_log_drain();
+	}
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Start The Flush Thread.
+//! \n            Messages Logged Before This Are Written Synchronously.
+//! \param[in]    level     Most verbose severity kept (TL_LOG_ERR..TL_LOG_DBG).
+//! \return       None.
+//******************************************************************************
+void tl_log_init(int level)
+{
+	g_tl_log_level = level;
+
+	if (g_tl_log_started) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < TL_LOG_QUEUE_LEN; i++) {
+		g_tl_log_slot[i].seq = i;
+	}
+	g_tl_log_enq = 0;
+	g_tl_log_deq = 0;
+	sem_init(&g_tl_log_sem, 0, 0);
+
+	g_tl_log_exit = false;
+	if (pthread_create(&g_tl_log_thread, NULL, tl_log_thread, NULL) != 0) {
+		sem_destroy(&g_tl_log_sem);
+		return;
+	}
+	g_tl_log_started = true;
+
+	//! \remark - Also Flush When The Application Leaves Through exit().
+	atexit(tl_log_term);
+}
+
+
+//******************************************************************************
+//! \brief        Write Out Pending Messages And Stop The Flush Thread.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+void tl_log_term(void)
+{
+	if (!g_tl_log_started) {
+		return;
+	}
+
+	g_tl_log_exit = true;
+	sem_post(&g_tl_log_sem);
+	pthread_join(g_tl_log_thread, NULL);
+
+	g_tl_log_started = false;
+	tl_log_drain();
+	sem_destroy(&g_tl_log_sem);
+}
+
+
+//******************************************************************************
+//! \brief        Log A Message (Use TL_LGE/TL_LGW/TL_LGI/TL_LGD).
+//! \details      At Most TL_LOG_RATE_BURST Messages Per Call Site Are Kept In A
+//! \n            TL_LOG_RATE_WINDOW_MS Window, The Rest Are Counted And Reported Once.
+//! \param[in]    site      Rate limit state of the call site.
+//! \param[in]    level     Severity.
+//! \param[in]    func      Calling function.
+//! \param[in]    line      Calling line.
+//! \param[in]    fmt       printf format.
+//! \return       None.
+//******************************************************************************
+void tl_log_write(tl_log_site *site, int level, const char *func, int line, const char *fmt, ...)
+{
+	uint64_t ns = getMonoNs();
+	uint64_t window = __atomic_load_n(&site->window_ns, __ATOMIC_RELAXED);
+	va_list ap;
+
+	if ((level < TL_LOG_ERR) || (level > TL_LOG_DBG)) {
+		level = TL_LOG_ERR;
+	}
+
+	//! \remark - The First Caller Past The Window End Opens A New One.
+	if ((ns - window) >= (uint64_t)TL_LOG_RATE_WINDOW_MS * 1000000ULL) {
+		if (__atomic_compare_exchange_n(&site->window_ns, &window, ns, false,
+										__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+
+			__atomic_store_n(&site->cnt, 0, __ATOMIC_RELAXED);
+			if ((suppressed > 0) && g_tl_log_started) {
+				tl_log_enqueuef(level, ns, func, line, "%u similar messages suppressed", suppressed);
+			}
+		}
+	}
+
+	if (__atomic_fetch_add(&site->cnt, 1, __ATOMIC_RELAXED) >= TL_LOG_RATE_BURST) {
+		__atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	va_start(ap, fmt);
+	if (g_tl_log_started) {
+		tl_log_enqueue(level, ns, func, line, fmt, ap);
+	}
+	else {
+		char text[TL_LOG_MSG_LEN];
+		int len = snprintf(text, sizeof(text), "[%s:%d] ", func, line);
+		if ((len > 0) && (len < (int)sizeof(text))) {
+			vsnprintf(text + len, sizeof(text) - len, fmt, ap);
+		}
+		tl_log_output(level, ns, text);
+	}
+	va_end(ap);
+}
@@ -0,0 +1,539 @@
+//******************************************************************************
+//! \file       tl_sim.cpp
+//! \brief      Simulated ToF Library Backend (Replaces libccdtof.so When Built With TL_SIM).
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries.
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <atomic>
+
+#include "tl.h"
+#include "tl_log.h"
+#include "tl_api_enh.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define SIM_VGA_W			(640)
+#define SIM_VGA_H			(480)
+#define SIM_QVGA_W			(320)
+#define SIM_QVGA_H			(240)
+#define SIM_FOCAL_VGA		(520.0)		//!< Focal Length In VGA Pixels.
+#define SIM_CAM_HEIGHT		(900.0)		//!< Height Of The Camera Above The Floor [mm].
+#define SIM_WALL_DIST		(3500.0)	//!< Distance To The Back Wall [mm].
+#define SIM_BALL_RADIUS		(300.0)		//!< Radius Of The Moving Ball [mm].
+#define SIM_TEMP			(4000)		//!< Reported Temperature [x100 degree].
+
+//! Simulated Device (One Per TL_init Call).
+struct stTL_Handle {
+	TL_E_IMAGE_KIND	image_kind;
+	TL_E_MODE		mode;
+	TL_Resolution	resolution;
+	bool			started;
+	std::atomic<bool>	canceled;	//!< Set By TL_cancel() Without The Lock, Also From A Signal Handler.
+	uint32_t		frame_cnt;
+	struct timespec	next;			//!< Absolute Time Of The Next Frame.
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	uint16_t		*depth;			//!< Depth Plane Returned By TL_capture().
+	uint16_t		*ir;			//!< IR Plane Returned By TL_capture().
+	uint16_t		*bg;			//!< BG Plane Returned By TL_capture().
+	uint16_t		*depth_static;	//!< Static Part Of The Scene (Floor And Wall).
+};
+
+static const TL_ModeInfo g_sim_mode[TL_E_MODE_NUM] = {
+	{ TL_E_TRUE, 150, 1500, 1, 30 },
+	{ TL_E_TRUE, 500, 7000, 1, 30 },
+};
+
+
+//******************************************************************************
+//! \brief        Fill An Image Format For The Given Size.
+//! \n
+//! \param[out]   fmt       Image format.
+//! \param[in]    w         Width.
+//! \param[in]    h         Height.
+//! \return       None.
+//******************************************************************************
+static void simSetFormat(TL_ImageFormat *fmt, uint16_t w, uint16_t h)
+{
+	fmt->width = w;
+	fmt->height = h;
+	fmt->stride = w * sizeof(uint16_t);
+	fmt->bit_per_pixel = 16;
+}
+
+
+//******************************************************************************
+//! \brief        Fill The Image Resolution For An Image Kind.
+//! \n
+//! \param[in]    kind      Image kind.
+//! \param[out]   reso      Resolution.
+//! \return       None.
+//******************************************************************************
+static void simSetResolution(TL_E_IMAGE_KIND kind, TL_Resolution *reso)
+{
+	memset(reso, 0, sizeof(*reso));
+
+	switch (kind) {
+		case TL_E_IMAGE_KIND_VGA_DEPTH_QVGA_IR_BG:
+			simSetFormat(&reso->depth, SIM_VGA_W, SIM_VGA_H);
+			simSetFormat(&reso->ir, SIM_QVGA_W, SIM_QVGA_H);
+			simSetFormat(&reso->bg, SIM_QVGA_W, SIM_QVGA_H);
+			break;
+		case TL_E_IMAGE_KIND_QVGA_DEPTH_IR_BG:
+			simSetFormat(&reso->depth, SIM_QVGA_W, SIM_QVGA_H);
+			simSetFormat(&reso->ir, SIM_QVGA_W, SIM_QVGA_H);
+			simSetFormat(&reso->bg, SIM_QVGA_W, SIM_QVGA_H);
+			break;
+		case TL_E_IMAGE_KIND_VGA_DEPTH_IR:
+			simSetFormat(&reso->depth, SIM_VGA_W, SIM_VGA_H);
+			simSetFormat(&reso->ir, SIM_VGA_W, SIM_VGA_H);
+			break;
+		case TL_E_IMAGE_KIND_VGA_IR_QVGA_DEPTH:
+			simSetFormat(&reso->depth, SIM_QVGA_W, SIM_QVGA_H);
+			simSetFormat(&reso->ir, SIM_VGA_W, SIM_VGA_H);
+			break;
+		case TL_E_IMAGE_KIND_VGA_IR_BG:
+		default:
+			simSetFormat(&reso->ir, SIM_VGA_W, SIM_VGA_H);
+			simSetFormat(&reso->bg, SIM_VGA_W, SIM_VGA_H);
+			break;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Render The Static Scene: A Floor Below The Camera And A Back Wall.
+//! \n
+//! \param[out]   depth     Depth plane [mm], 0 = no return.
+//! \param[in]    w         Width.
+//! \param[in]    h         Height.
+//! \return       None.
+//******************************************************************************
+static void simRenderStatic(uint16_t *depth, int w, int h)
+{
+	double f = SIM_FOCAL_VGA * w / SIM_VGA_W;
+	double cy = (h - 1) * 0.5;
+
+	for (int v = 0; v < h; v++) {
+		double ry = (v - cy) / f;
+		for (int u = 0; u < w; u++) {
+			double z = SIM_WALL_DIST;
+
+			//! \remark Rays Pointing Down Hit The Floor Before The Wall.
+			if ((ry > 0) && (SIM_CAM_HEIGHT / ry < z)) {
+				z = SIM_CAM_HEIGHT / ry;
+			}
+			depth[v * w + u] = (uint16_t)z;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Render One Frame: Static Scene Plus A Ball Moving Left And Right.
+//! \n
+//! \param[in]    handle    Simulated device.
+//! \return       None.
+//******************************************************************************
+static void simRenderFrame(TL_Handle *handle)
+{
+	TL_ImageFormat *fmt = &handle->resolution.depth;
+	int w = fmt->width;
+	int h = fmt->height;
+	double f = SIM_FOCAL_VGA * w / SIM_VGA_W;
+	double cx = (w - 1) * 0.5;
+	double cy = (h - 1) * 0.5;
+	double t = handle->frame_cnt / 30.0;
+	double bx = 800.0 * sin(t);
+	double by = SIM_CAM_HEIGHT - SIM_BALL_RADIUS;
+	double bz = 2000.0 + 400.0 * cos(t * 0.7);
+
+	if (handle->depth == NULL) {
+		return;
+	}
+
+	memcpy(handle->depth, handle->depth_static, (size_t)w * h * sizeof(uint16_t));
+
+	//! \remark Only The Ball's Bounding Rectangle Is Ray Traced.
+	int u0 = (int)(cx + f * (bx - SIM_BALL_RADIUS) / bz) - 2;
+	int u1 = (int)(cx + f * (bx + SIM_BALL_RADIUS) / bz) + 2;
+	int v0 = (int)(cy + f * (by - SIM_BALL_RADIUS) / bz) - 2;
+	int v1 = (int)(cy + f * (by + SIM_BALL_RADIUS) / bz) + 2;
+	u0 = (u0 < 0) ? 0 : u0;
+	v0 = (v0 < 0) ? 0 : v0;
+	u1 = (u1 > w) ? w : u1;
+	v1 = (v1 > h) ? h : v1;
+
+	for (int v = v0; v < v1; v++) {
+		for (int u = u0; u < u1; u++) {
+			double dx = (u - cx) / f;
+			double dy = (v - cy) / f;
+			double a = dx * dx + dy * dy + 1.0;
+			double b = dx * bx + dy * by + bz;
+			double c = bx * bx + by * by + bz * bz - SIM_BALL_RADIUS * SIM_BALL_RADIUS;
+			double disc = b * b - a * c;
+
+			if (disc >= 0) {
+				double z = (b - sqrt(disc)) / a;
+				if (z < handle->depth[v * w + u]) {
+					handle->depth[v * w + u] = (uint16_t)z;
+				}
+			}
+		}
+	}
+
+	//! \remark IR Falls Off With Distance, Sampled At The IR Resolution.
+	if (handle->ir != NULL) {
+		int iw = handle->resolution.ir.width;
+		int ih = handle->resolution.ir.height;
+		for (int v = 0; v < ih; v++) {
+			for (int u = 0; u < iw; u++) {
+				uint64_t z = handle->depth[(v * h / ih) * w + (u * w / iw)];
+				handle->ir[v * iw + u] = (z == 0) ? 0 : (uint16_t)(4000000000ULL / (z * z + 1000000ULL));
+			}
+		}
+	}
+
+	if (handle->bg != NULL) {
+		size_t bn = (size_t)handle->resolution.bg.width * handle->resolution.bg.height;
+		for (size_t i = 0; i < bn; i++) {
+			handle->bg[i] = 64;
+		}
+	}
+}
+
+
+//******************************************************************************
+// Functions Of tl.h
+//******************************************************************************
+TL_E_RESULT TL_init(TL_Handle **handle, const TL_Param *param)
+{
+	TL_Handle *h;
+	pthread_condattr_t attr;
+
+	if ((handle == NULL) || (param == NULL) || (param->image_kind >= TL_E_IMAGE_KIND_MAX)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	h = (TL_Handle *)calloc(1, sizeof(TL_Handle));
+	if (h == NULL) {
+		return TL_E_ERR_SYSTEM;
+	}
+
+	h->image_kind = param->image_kind;
+	h->mode = TL_E_MODE_0;
+	simSetResolution(h->image_kind, &h->resolution);
+
+	pthread_mutex_init(&h->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&h->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	size_t dn = (size_t)h->resolution.depth.width * h->resolution.depth.height;
+	size_t in = (size_t)h->resolution.ir.width * h->resolution.ir.height;
+	size_t bn = (size_t)h->resolution.bg.width * h->resolution.bg.height;
+	if (dn > 0) {
+		h->depth = (uint16_t *)malloc(dn * sizeof(uint16_t));
+		h->depth_static = (uint16_t *)malloc(dn * sizeof(uint16_t));
+	}
+	if (in > 0) {
+		h->ir = (uint16_t *)calloc(in, sizeof(uint16_t));
+	}
+	if (bn > 0) {
+		h->bg = (uint16_t *)calloc(bn, sizeof(uint16_t));
+	}
+	if (h->depth_static != NULL) {
+		simRenderStatic(h->depth_static, h->resolution.depth.width, h->resolution.depth.height);
+	}
+
+	*handle = h;
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_term(TL_Handle **handle)
+{
+	TL_Handle *h;
+
+	if ((handle == NULL) || (*handle == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	h = *handle;
+	pthread_cond_destroy(&h->cond);
+	pthread_mutex_destroy(&h->lock);
+	free(h->depth);
+	free(h->depth_static);
+	free(h->ir);
+	free(h->bg);
+	free(h);
+	*handle = NULL;
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_start(TL_Handle *handle)
+{
+	if (handle == NULL) {
+		return TL_E_ERR_PARAM;
+	}
+
+	pthread_mutex_lock(&handle->lock);
+	if (handle->started) {
+		pthread_mutex_unlock(&handle->lock);
+		return TL_E_ERR_STATE;
+	}
+	handle->started = true;
+	handle->canceled.store(false);
+	clock_gettime(CLOCK_MONOTONIC, &handle->next);
+	pthread_mutex_unlock(&handle->lock);
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_stop(TL_Handle *handle)
+{
+	if (handle == NULL) {
+		return TL_E_ERR_PARAM;
+	}
+
+	pthread_mutex_lock(&handle->lock);
+	handle->started = false;
+	pthread_cond_broadcast(&handle->cond);
+	pthread_mutex_unlock(&handle->lock);
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_getProperty(TL_Handle *handle, TL_E_CMD command, void* arg)
+{
+	if ((handle == NULL) || (arg == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	switch (command) {
+		case TL_CMD_DEVICE_INFO:
+		{
+			TL_DeviceInfo *info = (TL_DeviceInfo *)arg;
+			memset(info, 0, sizeof(*info));
+			snprintf(info->mod_name, sizeof(info->mod_name), "SIMULATED");
+			snprintf(info->afe_name, sizeof(info->afe_name), "SIM-AFE");
+			snprintf(info->sns_name, sizeof(info->sns_name), "SIM-SNS");
+			snprintf(info->lns_name, sizeof(info->lns_name), "SIM-LNS");
+			info->mod_type2 = 940;
+			break;
+		}
+		case TL_CMD_FOV:
+		{
+			TL_Fov *fov = (TL_Fov *)arg;
+			fov->focal_length = 156;	// 1.56 mm At 3.0 um Pitch = 520 Pixels.
+			fov->angle_h = (uint16_t)(2.0 * atan(SIM_VGA_W * 0.5 / SIM_FOCAL_VGA) * 18000.0 / M_PI);
+			fov->angle_v = (uint16_t)(2.0 * atan(SIM_VGA_H * 0.5 / SIM_FOCAL_VGA) * 18000.0 / M_PI);
+			break;
+		}
+		case TL_CMD_RESOLUTION:
+			*(TL_Resolution *)arg = handle->resolution;
+			break;
+		case TL_CMD_MODE:
+			*(TL_E_MODE *)arg = handle->mode;
+			break;
+		case TL_CMD_MODE_INFO:
+		{
+			TL_ModeInfoGroup *grp = (TL_ModeInfoGroup *)arg;
+			grp->fbf = TL_E_FALSE;
+			memcpy(grp->mode, g_sim_mode, sizeof(grp->mode));
+			break;
+		}
+		case TL_CMD_LENS_INFO:
+		{
+			TL_LensPrm *lens = (TL_LensPrm *)arg;
+			memset(lens, 0, sizeof(*lens));
+			lens->sns_h = SIM_VGA_W;
+			lens->sns_v = SIM_VGA_H;
+			lens->center_h = SIM_VGA_W / 2;
+			lens->center_v = SIM_VGA_H / 2;
+			lens->pixel_pitch = 300;
+			break;
+		}
+		default:
+			return TL_E_ERR_NOT_SUPPORT;
+	}
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_setProperty(TL_Handle *handle, TL_E_CMD command, void* arg)
+{
+	if ((handle == NULL) || (arg == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	if (command != TL_CMD_MODE) {
+		return TL_E_ERR_NOT_SUPPORT;
+	}
+
+	if (*(TL_E_MODE *)arg >= TL_E_MODE_NUM) {
+		return TL_E_ERR_PARAM;
+	}
+	handle->mode = *(TL_E_MODE *)arg;
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_capture(TL_Handle *handle, uint32_t *notify, TL_Image *image)
+{
+	int rc = 0;
+	long period_ns;
+
+	if ((handle == NULL) || (notify == NULL) || (image == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	//! \remark Wait Until The Next Frame Period, Like The Sensor Would.
+	period_ns = 1000000000L / g_sim_mode[handle->mode].fps;
+
+	pthread_mutex_lock(&handle->lock);
+	if (!handle->started) {
+		pthread_mutex_unlock(&handle->lock);
+		return TL_E_ERR_STATE;
+	}
+
+	handle->next.tv_nsec += period_ns;
+	if (handle->next.tv_nsec >= 1000000000L) {
+		handle->next.tv_sec++;
+		handle->next.tv_nsec -= 1000000000L;
+	}
+
+	while (handle->started && !handle->canceled.load() && (rc == 0)) {
+		rc = pthread_cond_timedwait(&handle->cond, &handle->lock, &handle->next);
+	}
+
+	if (handle->canceled.load() || !handle->started) {
+		handle->canceled.store(false);
+		pthread_mutex_unlock(&handle->lock);
+		return TL_E_ERR_CANCELED;
+	}
+
+	//! \remark A Consumer Slower Than The Frame Rate Drops Frames Like The Real Buffer Queue.
+	*notify = TL_NOTIFY_IMAGE;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t late_ns = (int64_t)(now.tv_sec - handle->next.tv_sec) * 1000000000LL + (now.tv_nsec - handle->next.tv_nsec);
+	if (late_ns > period_ns) {
+		*notify |= TL_NOTIFY_NO_BUFFER;
+		handle->frame_cnt += (uint32_t)(late_ns / period_ns);
+		handle->next = now;
+	}
+	pthread_mutex_unlock(&handle->lock);
+
+	simRenderFrame(handle);
+	handle->frame_cnt++;
+
+	image->depth = handle->depth;
+	image->ir = handle->ir;
+	image->bg = handle->bg;
+	image->mode_idx = (uint8_t)handle->mode;
+	image->temp = SIM_TEMP;
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT TL_cancel(TL_Handle *handle)
+{
+	if (handle == NULL) {
+		return TL_E_ERR_PARAM;
+	}
+
+	//! \remark Only Signal, No Lock, So It Stays Usable From A Signal Handler.
+	handle->canceled.store(true);
+	pthread_cond_broadcast(&handle->cond);
+
+	return TL_E_SUCCESS;
+}
+
+
+//******************************************************************************
+// Functions Of tl_api_enh.h
+//******************************************************************************
+TL_E_RESULT tl_enh_get_info(TL_Handle* handle, TL_EnhInfo *info)
+{
+	if ((handle == NULL) || (info == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	memset(info, 0, sizeof(*info));
+	info->opt_axis_center_h = SIM_VGA_W / 2;
+	info->opt_axis_center_v = SIM_VGA_H / 2;
+	info->sns_h = SIM_VGA_W;
+	info->sns_v = SIM_VGA_H;
+	info->pixel_pitch = 300;
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT tl_enh_init(TL_Handle *handle, const TL_Param *param)
+{
+	if ((handle == NULL) || (param == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT tl_enh_convert_camera_coord(TL_Handle* handle, uint16_t* depth, int16_t** points)
+{
+	if ((handle == NULL) || (depth == NULL) || (points == NULL) || (*points == NULL)) {
+		return TL_E_ERR_PARAM;
+	}
+
+	int w = handle->resolution.depth.width;
+	int h = handle->resolution.depth.height;
+	float inv_f = (float)(SIM_VGA_W / (SIM_FOCAL_VGA * w));
+	float cx = (w - 1) * 0.5f;
+	float cy = (h - 1) * 0.5f;
+	int16_t *p = *points;
+
+	//! \remark Pinhole Back Projection, x/y/z In mm.
+	for (int v = 0; v < h; v++) {
+		float ry = (v - cy) * inv_f;
+		for (int u = 0; u < w; u++) {
+			float z = (float)*depth++;
+			*p++ = (int16_t)((u - cx) * inv_f * z);
+			*p++ = (int16_t)(ry * z);
+			*p++ = (int16_t)((z > 32767.f) ? 32767.f : z);
+		}
+	}
+
+	return TL_E_SUCCESS;
+}
+
+
+TL_E_RESULT tl_enh_term(void)
+{
+	return TL_E_SUCCESS;
+}
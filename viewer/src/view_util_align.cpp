@@ -0,0 +1,449 @@
+//******************************************************************************
+//! \file       view_util_align.cpp
+//! \brief      2x Resampling Of Depth And IR Planes Onto A Common Grid.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_align.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define ALIGN_ROW_GRAIN     (16)    //!< Rows Per Pool Block.
+
+//! Job Context.
+typedef struct _align_job_t {
+	align_t *al;
+	const uint16_t *src;    //!< Smaller Plane, (w / 2) x (h / 2), Or The Grid Sized IR For The Brightness.
+} align_job_t;
+
+//! Job Context Of The Point Conversion.
+typedef struct _align_conv_t {
+	const uint16_t *depth;
+	int32_t w;
+	const cam_intr_t *cam;
+	int16_t *xyz;
+} align_conv_t;
+
+
+//******************************************************************************
+//! \brief        One Upsampled Depth Pixel From Its Four Nearest Source Pixels.
+//! \details      Bilinear Weights 9:3:3:1 Of The Half Pixel Grid, But Only Over The Neighbours On The
+//! \n            Surface Of The Nearest One; Across An Edge It Degrades To Nearest, So No Flying Points.
+//! \param[in]    s         Nearest source pixel.
+//! \param[in]    a         Horizontal neighbour.
+//! \param[in]    b         Vertical neighbour.
+//! \param[in]    c         Diagonal neighbour.
+//! \return       Depth in mm, 0 = invalid.
+//******************************************************************************
+static inline uint16_t alignDepthPix(uint32_t s, uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t tol = ALIGN_DZ_MIN + (s >> ALIGN_DZ_SHIFT);
+	uint32_t sum = 9 * s;
+	uint32_t wt = 9;
+
+	if (s == 0) {
+		return 0;
+	}
+	if ((a != 0) && ((a > s ? a - s : s - a) <= tol)) {
+		sum += 3 * a;
+		wt += 3;
+	}
+	if ((b != 0) && ((b > s ? b - s : s - b) <= tol)) {
+		sum += 3 * b;
+		wt += 3;
+	}
+	if ((c != 0) && ((c > s ? c - s : s - c) <= tol)) {
+		sum += c;
+		wt += 1;
+	}
+
+	return (uint16_t)((sum + (wt >> 1)) / wt);
+}
+
+
+//******************************************************************************
+//! \brief        Upsample Depth 2x, Edge Aware (Pool Job Body).
+//! \n            Source Row v Gives Grid Rows 2v And 2v + 1.
+//! \param[in]    ctx       align_job_t.
+//! \param[in]    begin     First source row.
+//! \param[in]    end       Source row after the last one.
+//! \return       None.
+//******************************************************************************
+static void alignDepthJob(void *ctx, int32_t begin, int32_t end)
+{
+	align_job_t *job = (align_job_t *)ctx;
+	align_t *al = job->al;
+	int32_t sw = al->w / 2;
+	int32_t sh = al->h / 2;
+
+	for (int32_t v = begin; v < end; v++) {
+		const uint16_t *r = job->src + (size_t)v * sw;
+		const uint16_t *ru = job->src + (size_t)((v > 0) ? (v - 1) : v) * sw;
+		const uint16_t *rd = job->src + (size_t)((v < sh - 1) ? (v + 1) : v) * sw;
+		uint16_t *d0 = al->depth_buf + (size_t)(2 * v) * al->w;
+		uint16_t *d1 = d0 + al->w;
+
+		for (int32_t u = 0; u < sw; u++) {
+			int32_t ul = (u > 0) ? (u - 1) : u;
+			int32_t ur = (u < sw - 1) ? (u + 1) : u;
+
+			d0[2 * u] = alignDepthPix(r[u], r[ul], ru[u], ru[ul]);
+			d0[2 * u + 1] = alignDepthPix(r[u], r[ur], ru[u], ru[ur]);
+			d1[2 * u] = alignDepthPix(r[u], r[ul], rd[u], rd[ul]);
+			d1[2 * u + 1] = alignDepthPix(r[u], r[ur], rd[u], rd[ur]);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        3/4 Of a Plus 1/4 Of b, As Two Rounded Averages Like The Vector Code.
+//******************************************************************************
+static inline uint16_t alignMix(uint32_t a, uint32_t b)
+{
+	return (uint16_t)((a + ((a + b + 1) >> 1) + 1) >> 1);
+}
+
+
+//******************************************************************************
+//! \brief        Upsample IR 2x, Bilinear (Pool Job Body).
+//! \details      On The Half Pixel Grid Every Output Is 3/4 Of Its Nearest Source Pixel And 1/4 Of The
+//! \n            Next One, Vertically And Then Horizontally; Borders Repeat The Edge Pixel.
+//! \param[in]    ctx       align_job_t.
+//! \param[in]    begin     First source row.
+//! \param[in]    end       Source row after the last one.
+//! \return       None.
+//******************************************************************************
+static void alignIrJob(void *ctx, int32_t begin, int32_t end)
+{
+	align_job_t *job = (align_job_t *)ctx;
+	align_t *al = job->al;
+	int32_t sw = al->w / 2;
+	int32_t sh = al->h / 2;
+
+	for (int32_t v = begin; v < end; v++) {
+		const uint16_t *r = job->src + (size_t)v * sw;
+		const uint16_t *ru = job->src + (size_t)((v > 0) ? (v - 1) : v) * sw;
+		const uint16_t *rd = job->src + (size_t)((v < sh - 1) ? (v + 1) : v) * sw;
+		uint16_t *d0 = al->ir_buf + (size_t)(2 * v) * al->w;
+		uint16_t *d1 = d0 + al->w;
+		int32_t u = 1;
+
+		//! \remark - Column 0 Has No Left Neighbour, The Vector Loop Starts At 1.
+		d0[0] = alignMix(r[0], ru[0]);
+		d1[0] = alignMix(r[0], rd[0]);
+		d0[1] = alignMix(alignMix(r[0], ru[0]), alignMix(r[1], ru[1]));
+		d1[1] = alignMix(alignMix(r[0], rd[0]), alignMix(r[1], rd[1]));
+
+#if defined(__ARM_NEON)
+		for (; u + 9 <= sw; u += 8) {
+			uint16x8_t c = vld1q_u16(r + u);
+			uint16x8_t cl = vld1q_u16(r + u - 1);
+			uint16x8_t cr = vld1q_u16(r + u + 1);
+			uint16x8_t t = vrhaddq_u16(c, vrhaddq_u16(c, vld1q_u16(ru + u)));
+			uint16x8_t tl = vrhaddq_u16(cl, vrhaddq_u16(cl, vld1q_u16(ru + u - 1)));
+			uint16x8_t tr = vrhaddq_u16(cr, vrhaddq_u16(cr, vld1q_u16(ru + u + 1)));
+			uint16x8_t b = vrhaddq_u16(c, vrhaddq_u16(c, vld1q_u16(rd + u)));
+			uint16x8_t bl = vrhaddq_u16(cl, vrhaddq_u16(cl, vld1q_u16(rd + u - 1)));
+			uint16x8_t br = vrhaddq_u16(cr, vrhaddq_u16(cr, vld1q_u16(rd + u + 1)));
+			uint16x8x2_t o0;
+			uint16x8x2_t o1;
+
+			o0.val[0] = vrhaddq_u16(t, vrhaddq_u16(t, tl));
+			o0.val[1] = vrhaddq_u16(t, vrhaddq_u16(t, tr));
+			o1.val[0] = vrhaddq_u16(b, vrhaddq_u16(b, bl));
+			o1.val[1] = vrhaddq_u16(b, vrhaddq_u16(b, br));
+			vst2q_u16(d0 + 2 * u, o0);
+			vst2q_u16(d1 + 2 * u, o1);
+		}
+#elif defined(__SSE2__)
+		for (; u + 9 <= sw; u += 8) {
+			__m128i c = _mm_loadu_si128((const __m128i *)(r + u));
+			__m128i cl = _mm_loadu_si128((const __m128i *)(r + u - 1));
+			__m128i cr = _mm_loadu_si128((const __m128i *)(r + u + 1));
+			__m128i t = _mm_avg_epu16(c, _mm_avg_epu16(c, _mm_loadu_si128((const __m128i *)(ru + u))));
+			__m128i tl = _mm_avg_epu16(cl, _mm_avg_epu16(cl, _mm_loadu_si128((const __m128i *)(ru + u - 1))));
+			__m128i tr = _mm_avg_epu16(cr, _mm_avg_epu16(cr, _mm_loadu_si128((const __m128i *)(ru + u + 1))));
+			__m128i b = _mm_avg_epu16(c, _mm_avg_epu16(c, _mm_loadu_si128((const __m128i *)(rd + u))));
+			__m128i bl = _mm_avg_epu16(cl, _mm_avg_epu16(cl, _mm_loadu_si128((const __m128i *)(rd + u - 1))));
+			__m128i br = _mm_avg_epu16(cr, _mm_avg_epu16(cr, _mm_loadu_si128((const __m128i *)(rd + u + 1))));
+			__m128i e0 = _mm_avg_epu16(t, _mm_avg_epu16(t, tl));
+			__m128i o0 = _mm_avg_epu16(t, _mm_avg_epu16(t, tr));
+			__m128i e1 = _mm_avg_epu16(b, _mm_avg_epu16(b, bl));
+			__m128i o1 = _mm_avg_epu16(b, _mm_avg_epu16(b, br));
+
+			//! \remark - Even And Odd Columns Interleaved Back Into 16 Outputs.
+			_mm_storeu_si128((__m128i *)(d0 + 2 * u), _mm_unpacklo_epi16(e0, o0));
+			_mm_storeu_si128((__m128i *)(d0 + 2 * u + 8), _mm_unpackhi_epi16(e0, o0));
+			_mm_storeu_si128((__m128i *)(d1 + 2 * u), _mm_unpacklo_epi16(e1, o1));
+			_mm_storeu_si128((__m128i *)(d1 + 2 * u + 8), _mm_unpackhi_epi16(e1, o1));
+		}
+#endif
+
+		for (; u < sw; u++) {
+			int32_t ur = (u < sw - 1) ? (u + 1) : u;
+			uint16_t t = alignMix(r[u], ru[u]);
+			uint16_t b = alignMix(r[u], rd[u]);
+
+			d0[2 * u] = alignMix(t, alignMix(r[u - 1], ru[u - 1]));
+			d0[2 * u + 1] = alignMix(t, alignMix(r[ur], ru[ur]));
+			d1[2 * u] = alignMix(b, alignMix(r[u - 1], rd[u - 1]));
+			d1[2 * u + 1] = alignMix(b, alignMix(r[ur], rd[ur]));
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        IR To Brightness Through The Table (Pool Job Body).
+//! \n
+//! \param[in]    ctx       align_job_t, src Is Grid Sized.
+//! \param[in]    begin     First grid row.
+//! \param[in]    end       Grid row after the last one.
+//! \return       None.
+//******************************************************************************
+static void alignGrayJob(void *ctx, int32_t begin, int32_t end)
+{
+	align_job_t *job = (align_job_t *)ctx;
+	align_t *al = job->al;
+	size_t i0 = (size_t)begin * al->w;
+	size_t i1 = (size_t)end * al->w;
+
+	for (size_t i = i0; i < i1; i++) {
+		uint16_t ir = job->src[i];
+
+		al->gray_buf[i] = al->lut[(ir > ALIGN_IR_MAX) ? ALIGN_IR_MAX : ir];
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Depth To Points (Pool Job Body).
+//! \n
+//! \param[in]    ctx       align_conv_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void alignConvJob(void *ctx, int32_t begin, int32_t end)
+{
+	align_conv_t *job = (align_conv_t *)ctx;
+	const cam_intr_t *cam = job->cam;
+	int32_t w = job->w;
+	float ifx = 1.0f / cam->fx;
+	float ify = 1.0f / cam->fy;
+
+	for (int32_t v = begin; v < end; v++) {
+		const uint16_t *d = job->depth + (size_t)v * w;
+		int16_t *p = job->xyz + (size_t)v * w * 3;
+		float ry = ((float)v - cam->cy) * ify;
+
+		for (int32_t u = 0; u < w; u++, p += 3) {
+			float z = (d[u] > 32767) ? 0.0f : (float)d[u];
+
+			p[0] = (int16_t)(((float)u - cam->cx) * ifx * z);
+			p[1] = (int16_t)(ry * z);
+			p[2] = (int16_t)z;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Prepare The Grid Of A Device.
+//! \details      The Grid Is The Larger Of The Two Planes, The Other One Must Be The Same Size Or Half
+//! \n            Of It In Both Directions. A Missing Plane Has Size 0. Half Size Depth With Full Size IR
+//! \n            Can Be Upsampled Guided By The IR (Joint Bilateral).
+//! \param[out]   al        Alignment.
+//! \param[in]    dw        Depth image width.
+//! \param[in]    dh        Depth image height.
+//! \param[in]    iw        IR image width.
+//! \param[in]    ih        IR image height.
+//! \param[in]    jbu_sigma IR range sigma of the guided depth upsampling, 0 = edge aware only.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int alignInit(align_t *al, int32_t dw, int32_t dh, int32_t iw, int32_t ih, float jbu_sigma)
+{
+	memset(al, 0, sizeof(*al));
+	pthread_mutex_init(&al->lock, NULL);
+
+	al->w = (dw > iw) ? dw : iw;
+	al->h = (dh > ih) ? dh : ih;
+	if ((al->w < 4) || (al->h < 4) ||
+		((dw > 0) && ((al->w != dw) || (al->h != dh)) && ((al->w != 2 * dw) || (al->h != 2 * dh))) ||
+		((iw > 0) && ((al->w != iw) || (al->h != ih)) && ((al->w != 2 * iw) || (al->h != 2 * ih)))) {
+		return -1;
+	}
+
+	size_t n = (size_t)al->w * al->h;
+	al->depth_buf = ((dw > 0) && (dw < al->w)) ? (uint16_t *)calloc(n, sizeof(uint16_t)) : NULL;
+	al->ir_buf = ((iw > 0) && (iw < al->w)) ? (uint16_t *)calloc(n, sizeof(uint16_t)) : NULL;
+	al->gray_buf = (iw > 0) ? (uint8_t *)calloc(n, sizeof(uint8_t)) : NULL;
+	if (((dw > 0) && (dw < al->w) && (al->depth_buf == NULL)) ||
+		((iw > 0) && (iw < al->w) && (al->ir_buf == NULL)) ||
+		((iw > 0) && (al->gray_buf == NULL))) {
+		alignTerm(al);
+		return -1;
+	}
+
+	if ((al->depth_buf != NULL) && (iw == al->w) && (jbuInit(&al->jbu, al->w, al->h, jbu_sigma) != 0)) {
+		alignTerm(al);
+		return -1;
+	}
+
+	//! \remark - The Square Root Lifts Dark IR, Like A Display Gamma Of 0.5.
+	for (int32_t i = 0; i <= ALIGN_IR_MAX; i++) {
+		al->lut[i] = (uint8_t)lround(255.0 * sqrt((double)i / ALIGN_IR_MAX));
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release The Grid Of A Device.
+//! \n
+//! \param[in]    al        Alignment.
+//! \return       None.
+//******************************************************************************
+void alignTerm(align_t *al)
+{
+	free(al->depth_buf);
+	free(al->ir_buf);
+	free(al->gray_buf);
+	jbuTerm(&al->jbu);
+	al->depth_buf = NULL;
+	al->ir_buf = NULL;
+	al->gray_buf = NULL;
+	al->depth = NULL;
+	al->gray = NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Bring Depth And IR Of A Frame Onto The Grid, Rows Run On The Worker Pool.
+//! \details      The Image Kind Fixes Which Plane Is Half Size, So The Kernels Are Chosen At Compile
+//! \n            Time: Edge Aware (Or IR Guided) Upsampling For Depth, Bilinear For IR. The Full Size
+//! \n            Plane Is Referenced, Not Copied.
+//! \param[in]    al        Alignment.
+//! \param[in]    depth     Depth image in mm, 0 = invalid; half size when DEPTH_UP.
+//! \param[in]    ir        IR image, half size when IR_UP; NULL = no IR.
+//! \return       0         success (al->depth and al->gray are set)
+//! \return       -1        no grid for this kind
+//******************************************************************************
+template <bool DEPTH_UP, bool IR_UP>
+int alignApply(align_t *al, const uint16_t *depth, const uint16_t *ir)
+{
+	uint64_t t0 = getMonoNs();
+	align_job_t job;
+
+	if ((DEPTH_UP && (al->depth_buf == NULL)) || (IR_UP && (ir != NULL) && (al->ir_buf == NULL))) {
+		return -1;
+	}
+
+	job.al = al;
+	al->depth = depth;
+	if (DEPTH_UP && (depth != NULL)) {
+		if (IR_UP || (jbuApply(&al->jbu, depth, ir, al->depth_buf) != 0)) {
+			job.src = depth;
+			paraFor(alignDepthJob, &job, al->h / 2, ALIGN_ROW_GRAIN);
+		}
+		al->depth = al->depth_buf;
+	}
+
+	al->gray = NULL;
+	if ((ir != NULL) && (al->gray_buf != NULL)) {
+		job.src = ir;
+		if (IR_UP) {
+			paraFor(alignIrJob, &job, al->h / 2, ALIGN_ROW_GRAIN);
+			job.src = al->ir_buf;
+		}
+		paraFor(alignGrayJob, &job, al->h, ALIGN_ROW_GRAIN);
+		al->gray = al->gray_buf;
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&al->lock);
+	al->frames++;
+	al->ms_sum += ms;
+	if (ms > al->ms_max) {
+		al->ms_max = ms;
+	}
+	pthread_mutex_unlock(&al->lock);
+
+	return 0;
+}
+
+template int alignApply<false, false>(align_t *al, const uint16_t *depth, const uint16_t *ir);
+template int alignApply<false, true>(align_t *al, const uint16_t *depth, const uint16_t *ir);
+template int alignApply<true, false>(align_t *al, const uint16_t *depth, const uint16_t *ir);
+
+
+//******************************************************************************
+//! \brief        Convert A Depth Image To An Organized Point Cloud, Rows Run On The Worker Pool.
+//! \n            Pinhole Model, For Grids The ToF Library Does Not Convert (Upsampled, Reduced).
+//! \param[in]    depth     w x h depth in mm, 0 = invalid.
+//! \param[in]    w         Width.
+//! \param[in]    h         Height.
+//! \param[in]    cam       Intrinsics of this size.
+//! \param[out]   xyz       w x h points x/y/z in mm (z = 0 = invalid).
+//! \return       None.
+//******************************************************************************
+void alignConvert(const uint16_t *depth, int32_t w, int32_t h, const cam_intr_t *cam, int16_t *xyz)
+{
+	align_conv_t job;
+
+	job.depth = depth;
+	job.w = w;
+	job.cam = cam;
+	job.xyz = xyz;
+	paraFor(alignConvJob, &job, h, ALIGN_ROW_GRAIN);
+}
+
+
+//******************************************************************************
+//! \brief        Print Alignment Timing Since The Last Report.
+//! \n
+//! \param[in]    al        Alignment.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void alignReport(align_t *al, const char *name)
+{
+	pthread_mutex_lock(&al->lock);
+
+	if (al->frames > 0) {
+		printf("align %s: %dx%d%s%s%s frames=%u mean=%.2f ms max=%.2f ms\n",
+				name, al->w, al->h, (al->depth_buf != NULL) ? " depth x2" : "", al->jbu.enable ? " (jbu)" : "",
+				(al->ir_buf != NULL) ? " ir x2" : "",
+				al->frames, al->ms_sum / al->frames, al->ms_max);
+	}
+
+	al->frames = 0;
+	al->ms_sum = 0;
+	al->ms_max = 0;
+
+	pthread_mutex_unlock(&al->lock);
+}
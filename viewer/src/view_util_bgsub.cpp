@@ -0,0 +1,488 @@
+//******************************************************************************
+//! \file       view_util_bgsub.cpp
+//! \brief      Per-Pixel Background Depth Model (Running Mean/Variance) And Foreground Mask.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tl_log.h"
+#include "view_util_bgsub.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define BGSUB_ROW_GRAIN     (16)    //!< Rows Per Pool Block.
+#define BGSUB_MAX_H         (2048)  //!< Largest Supported Image Height.
+#define BGSUB_FILE_MAGIC    "TLBG"
+#define BGSUB_FILE_VERSION  (1)
+#define BGSUB_VAR_SAT       (65535 / BGSUB_SIGMA_K2)    //!< Variances Above This Give A Saturated Threshold.
+
+//! Model File Header, Followed By mean[w * h] And var[w * h].
+typedef struct _bgsub_file_t {
+	char magic[4];
+	uint16_t version;
+	uint16_t reserved;
+	int32_t w;
+	int32_t h;
+	uint32_t tag;
+	uint32_t learned;
+} bgsub_file_t;
+
+//! Job Context.
+typedef struct _bgsub_job_t {
+	bgsub_t *bg;
+	const uint16_t *depth;
+	int32_t shift;                  //!< Learning Rate Of This Frame, 1/2^shift.
+	bool detect;                    //!< Model Is Learned, Extract Foreground.
+	int32_t fg[BGSUB_MAX_H / BGSUB_ROW_GRAIN];  //!< Foreground Pixels Per Row Block.
+} bgsub_job_t;
+
+
+//******************************************************************************
+//! \brief        Classify And Learn A Band Of Rows (Pool Job Body).
+//! \details      All Arithmetic Is Unsigned 16 Bits. A Pixel Is Foreground When Its Squared
+//! \n            Distance To The Mean (Clamped At 255 mm) Exceeds K^2 * max(var, floor), Or When
+//! \n            It Has A Return Where The Background Never Had One. Mean And Variance Move
+//! \n            Towards The Sample By ceil(diff / 2^shift), So They Settle Exactly.
+//! \n            Only Background Pixels Are Learned Once The Model Is Ready.
+//! \param[in]    ctx       bgsub_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void bgsubRowJob(void *ctx, int32_t begin, int32_t end)
+{
+	bgsub_job_t *job = (bgsub_job_t *)ctx;
+	bgsub_t *bg = job->bg;
+	int32_t w = bg->w;
+	int32_t s = job->shift;
+	uint16_t rnd = (uint16_t)((1 << s) - 1);
+	int32_t fg_cnt = 0;
+
+	for (int32_t v = begin; v < end; v++) {
+		size_t ofs = (size_t)v * w;
+		const uint16_t *dp = job->depth + ofs;
+		uint16_t *mp = bg->mean + ofs;
+		uint16_t *vp = bg->var + ofs;
+		uint16_t *fp = bg->fg_depth + ofs;
+		uint8_t *kp = bg->mask + ofs;
+		int32_t u = 0;
+		uint16_t lane[8];
+
+#if defined(__ARM_NEON)
+		const uint16x8_t zero = vdupq_n_u16(0);
+		const uint16x8_t c255 = vdupq_n_u16(255);
+		const uint16x8_t vmin = vdupq_n_u16(BGSUB_VAR_MIN);
+		const uint16x8_t vsat = vdupq_n_u16(BGSUB_VAR_SAT);
+		const uint16x8_t k2 = vdupq_n_u16(BGSUB_SIGMA_K2);
+		const uint16x8_t vrnd = vdupq_n_u16(rnd);
+		const int16x8_t sh = vdupq_n_s16((int16_t)-s);
+		const uint16x8_t det = vdupq_n_u16(job->detect ? 0xFFFF : 0);
+		uint16x8_t acc = zero;
+
+		for (; u + 8 <= w; u += 8) {
+			uint16x8_t d = vld1q_u16(dp + u);
+			uint16x8_t m = vld1q_u16(mp + u);
+			uint16x8_t q = vld1q_u16(vp + u);
+			uint16x8_t nod = vceqq_u16(d, zero);
+			uint16x8_t nom = vceqq_u16(m, zero);
+			uint16x8_t up = vqsubq_u16(d, m);
+			uint16x8_t dn = vqsubq_u16(m, d);
+			uint16x8_t adc = vminq_u16(vorrq_u16(up, dn), c255);
+			uint16x8_t sq = vmulq_u16(adc, adc);
+			uint16x8_t thr = vmulq_u16(vminq_u16(vmaxq_u16(q, vmin), vsat), k2);
+			uint16x8_t fg = vandq_u16(det, vbicq_u16(vorrq_u16(nom, vcgtq_u16(sq, thr)), nod));
+			uint16x8_t upd = vmvnq_u16(vorrq_u16(nod, fg));
+
+			uint16x8_t mn = vsubq_u16(vaddq_u16(m, vshlq_u16(vqaddq_u16(up, vrnd), sh)), vshlq_u16(vqaddq_u16(dn, vrnd), sh));
+			uint16x8_t qn = vsubq_u16(vaddq_u16(q, vshlq_u16(vqaddq_u16(vqsubq_u16(sq, q), vrnd), sh)),
+										vshlq_u16(vqaddq_u16(vqsubq_u16(q, sq), vrnd), sh));
+			mn = vbslq_u16(nom, d, mn);
+			qn = vbicq_u16(qn, nom);
+
+			vst1q_u16(mp + u, vbslq_u16(upd, mn, m));
+			vst1q_u16(vp + u, vbslq_u16(upd, qn, q));
+			vst1q_u16(fp + u, vandq_u16(fg, d));
+			uint16x8_t one = vshrq_n_u16(fg, 15);
+			vst1_u8(kp + u, vmovn_u16(one));
+			acc = vaddq_u16(acc, one);
+		}
+		vst1q_u16(lane, acc);
+#elif defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i ones = _mm_set1_epi16(-1);
+		const __m128i c255 = _mm_set1_epi16(255);
+		const __m128i vmin = _mm_set1_epi16(BGSUB_VAR_MIN);
+		const __m128i vsat = _mm_set1_epi16(BGSUB_VAR_SAT);
+		const __m128i k2 = _mm_set1_epi16(BGSUB_SIGMA_K2);
+		const __m128i vrnd = _mm_set1_epi16((short)rnd);
+		const __m128i sh = _mm_cvtsi32_si128(s);
+		const __m128i det = job->detect ? ones : zero;
+		const __m128i bit = _mm_set1_epi8(1);
+		__m128i acc = zero;
+
+		for (; u + 8 <= w; u += 8) {
+			__m128i d = _mm_loadu_si128((const __m128i *)(dp + u));
+			__m128i m = _mm_loadu_si128((const __m128i *)(mp + u));
+			__m128i q = _mm_loadu_si128((const __m128i *)(vp + u));
+			__m128i nod = _mm_cmpeq_epi16(d, zero);
+			__m128i nom = _mm_cmpeq_epi16(m, zero);
+			__m128i up = _mm_subs_epu16(d, m);
+			__m128i dn = _mm_subs_epu16(m, d);
+			__m128i ad = _mm_or_si128(up, dn);
+			__m128i adc = _mm_sub_epi16(ad, _mm_subs_epu16(ad, c255));     // min(ad, 255)
+			__m128i sq = _mm_mullo_epi16(adc, adc);
+			__m128i qk = _mm_add_epi16(_mm_subs_epu16(q, vmin), vmin);     // max(q, floor)
+			qk = _mm_sub_epi16(qk, _mm_subs_epu16(qk, vsat));               // min(qk, sat)
+			__m128i thr = _mm_mullo_epi16(qk, k2);
+			__m128i gt = _mm_xor_si128(_mm_cmpeq_epi16(_mm_subs_epu16(sq, thr), zero), ones);
+			__m128i fg = _mm_and_si128(det, _mm_andnot_si128(nod, _mm_or_si128(nom, gt)));
+			__m128i upd = _mm_xor_si128(_mm_or_si128(nod, fg), ones);
+
+			__m128i mn = _mm_sub_epi16(_mm_add_epi16(m, _mm_srl_epi16(_mm_adds_epu16(up, vrnd), sh)),
+										_mm_srl_epi16(_mm_adds_epu16(dn, vrnd), sh));
+			__m128i qn = _mm_sub_epi16(_mm_add_epi16(q, _mm_srl_epi16(_mm_adds_epu16(_mm_subs_epu16(sq, q), vrnd), sh)),
+										_mm_srl_epi16(_mm_adds_epu16(_mm_subs_epu16(q, sq), vrnd), sh));
+			mn = _mm_or_si128(_mm_and_si128(nom, d), _mm_andnot_si128(nom, mn));
+			qn = _mm_andnot_si128(nom, qn);
+
+			_mm_storeu_si128((__m128i *)(mp + u), _mm_or_si128(_mm_and_si128(upd, mn), _mm_andnot_si128(upd, m)));
+			_mm_storeu_si128((__m128i *)(vp + u), _mm_or_si128(_mm_and_si128(upd, qn), _mm_andnot_si128(upd, q)));
+			_mm_storeu_si128((__m128i *)(fp + u), _mm_and_si128(fg, d));
+			_mm_storel_epi64((__m128i *)(kp + u), _mm_and_si128(_mm_packs_epi16(fg, fg), bit));
+			acc = _mm_sub_epi16(acc, fg);
+		}
+		_mm_storeu_si128((__m128i *)lane, acc);
+#else
+		memset(lane, 0, sizeof(lane));
+#endif
+		for (int k = 0; k < 8; k++) {
+			fg_cnt += lane[k];
+		}
+
+		//! \remark - Scalar Tail, Same Arithmetic As The Vector Loop.
+		for (; u < w; u++) {
+			uint16_t d = dp[u];
+			uint16_t m = mp[u];
+			uint16_t q = vp[u];
+			uint16_t up = (d > m) ? (uint16_t)(d - m) : 0;
+			uint16_t dn = (m > d) ? (uint16_t)(m - d) : 0;
+			uint16_t adc = ((up | dn) > 255) ? 255 : (up | dn);
+			uint16_t sq = (uint16_t)(adc * adc);
+			uint16_t qk = (q < BGSUB_VAR_MIN) ? BGSUB_VAR_MIN : ((q > BGSUB_VAR_SAT) ? BGSUB_VAR_SAT : q);
+			bool fg = job->detect && (d != 0) && ((m == 0) || (sq > qk * BGSUB_SIGMA_K2));
+
+			fp[u] = fg ? d : 0;
+			kp[u] = fg ? 1 : 0;
+			fg_cnt += fg ? 1 : 0;
+			if (fg || (d == 0)) {
+				continue;
+			}
+
+			if (m == 0) {
+				mp[u] = d;
+				vp[u] = 0;
+				continue;
+			}
+
+			uint16_t qup = (sq > q) ? (uint16_t)(sq - q) : 0;
+			uint16_t qdn = (q > sq) ? (uint16_t)(q - sq) : 0;
+			mp[u] = (uint16_t)(m + ((up + rnd > 0xFFFF ? 0xFFFF : up + rnd) >> s) - ((dn + rnd > 0xFFFF ? 0xFFFF : dn + rnd) >> s));
+			vp[u] = (uint16_t)(q + ((qup + rnd > 0xFFFF ? 0xFFFF : qup + rnd) >> s) - ((qdn + rnd > 0xFFFF ? 0xFFFF : qdn + rnd) >> s));
+		}
+	}
+
+	job->fg[begin / BGSUB_ROW_GRAIN] = fg_cnt;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare A Background Model For A Depth Image Size.
+//! \details      An Existing Model File Of The Same Size And Tag Is Loaded (Warm Restart).
+//! \param[out]   bg        Model.
+//! \param[in]    w         Image width.
+//! \param[in]    h         Image height.
+//! \param[in]    tag       Model identity, e.g. the ranging mode.
+//! \param[in]    path      Model file, NULL = disabled.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int bgsubInit(bgsub_t *bg, int32_t w, int32_t h, uint32_t tag, const char *path)
+{
+	size_t n = (size_t)w * h;
+
+	memset(bg, 0, sizeof(*bg));
+	pthread_mutex_init(&bg->lock, NULL);
+
+	if ((w <= 0) || (h <= 0) || (h > BGSUB_MAX_H)) {
+		return -1;
+	}
+
+	bg->w = w;
+	bg->h = h;
+	bg->tag = tag;
+	bg->enable = (path != NULL);
+
+	if (!bg->enable) {
+		return 0;
+	}
+
+	snprintf(bg->path, sizeof(bg->path), "%s", path);
+
+	bg->mean = (uint16_t *)calloc(n, sizeof(uint16_t));
+	bg->var = (uint16_t *)calloc(n, sizeof(uint16_t));
+	bg->fg_depth = (uint16_t *)calloc(n, sizeof(uint16_t));
+	bg->mask = (uint8_t *)calloc(n, 1);
+	if ((bg->mean == NULL) || (bg->var == NULL) || (bg->fg_depth == NULL) || (bg->mask == NULL)) {
+		bgsubTerm(bg);
+		return -1;
+	}
+
+	(void) bgsubLoad(bg);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release A Background Model.
+//! \n
+//! \param[in]    bg        Model.
+//! \return       None.
+//******************************************************************************
+void bgsubTerm(bgsub_t *bg)
+{
+	free(bg->mean);
+	free(bg->var);
+	free(bg->fg_depth);
+	free(bg->mask);
+	bg->mean = NULL;
+	bg->var = NULL;
+	bg->fg_depth = NULL;
+	bg->mask = NULL;
+	bg->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Model Is Learned And Foreground Is Extracted.
+//! \n
+//! \param[in]    bg        Model.
+//! \return       true      bg->fg_depth and bg->mask hold the last frame's foreground
+//******************************************************************************
+bool bgsubReady(const bgsub_t *bg)
+{
+	return bg->enable && (bg->learned >= BGSUB_LEARN_FRAMES);
+}
+
+
+//******************************************************************************
+//! \brief        Extract The Foreground Of A Frame And Update The Model.
+//! \details      While Learning Every Return Updates The Model With A Rate Of 1/(frames + 1)
+//! \n            (As A Power Of 2) And No Foreground Is Extracted.
+//! \param[in]    bg        Model.
+//! \param[in]    depth     Depth image (w x h, 0 = no return).
+//! \return       0         success
+//! \return       -1        disabled
+//******************************************************************************
+int bgsubUpdate(bgsub_t *bg, const uint16_t *depth)
+{
+	uint64_t t0 = getMonoNs();
+	bgsub_job_t job;
+	int32_t fg = 0;
+
+	if (!bg->enable || (depth == NULL)) {
+		return -1;
+	}
+
+	job.bg = bg;
+	job.depth = depth;
+	job.detect = bgsubReady(bg);
+	job.shift = 0;
+	while ((job.shift < BGSUB_SHIFT) && ((2U << job.shift) <= bg->learned + 1)) {
+		job.shift++;
+	}
+
+	paraFor(bgsubRowJob, &job, bg->h, BGSUB_ROW_GRAIN);
+
+	for (int32_t b = 0; b < (bg->h + BGSUB_ROW_GRAIN - 1) / BGSUB_ROW_GRAIN; b++) {
+		fg += job.fg[b];
+	}
+
+	if (bg->learned < BGSUB_LEARN_FRAMES) {
+		bg->learned++;
+		if (bg->learned == BGSUB_LEARN_FRAMES) {
+			TL_LGI("bgsub: background learned (%d frames)", BGSUB_LEARN_FRAMES);
+		}
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&bg->lock);
+	bg->frames++;
+	bg->fg_cnt = fg;
+	bg->ms_sum += ms;
+	if (ms > bg->ms_max) {
+		bg->ms_max = ms;
+	}
+	pthread_mutex_unlock(&bg->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Load The Model From bg->path.
+//! \n
+//! \param[in]    bg        Model.
+//! \return       0         success, the model is ready
+//! \return       -1        no file, or a file of another size/tag (the model is learned anew)
+//******************************************************************************
+int bgsubLoad(bgsub_t *bg)
+{
+	bgsub_file_t hdr;
+	size_t n = (size_t)bg->w * bg->h;
+	FILE *fp;
+	int ret = -1;
+
+	if (!bg->enable) {
+		return -1;
+	}
+
+	fp = fopen(bg->path, "rb");
+	if (fp == NULL) {
+		TL_LGI("bgsub: no model file %s, learning the background", bg->path);
+		return -1;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, fp) != 1) || (memcmp(hdr.magic, BGSUB_FILE_MAGIC, 4) != 0) ||
+		(hdr.version != BGSUB_FILE_VERSION)) {
+		TL_LGW("bgsub: %s is not a background model", bg->path);
+	}
+	else
+	if ((hdr.w != bg->w) || (hdr.h != bg->h) || (hdr.tag != bg->tag)) {
+		TL_LGW("bgsub: %s is for %dx%d tag %u, not %dx%d tag %u", bg->path,
+				hdr.w, hdr.h, hdr.tag, bg->w, bg->h, bg->tag);
+	}
+	else
+	if ((fread(bg->mean, sizeof(uint16_t), n, fp) != n) || (fread(bg->var, sizeof(uint16_t), n, fp) != n)) {
+		TL_LGW("bgsub: %s is truncated", bg->path);
+	}
+	else {
+		bg->learned = (hdr.learned < BGSUB_LEARN_FRAMES) ? hdr.learned : BGSUB_LEARN_FRAMES;
+		TL_LGI("bgsub: model loaded from %s", bg->path);
+		ret = 0;
+	}
+	fclose(fp);
+
+	if (ret != 0) {
+		memset(bg->mean, 0, n * sizeof(uint16_t));
+		memset(bg->var, 0, n * sizeof(uint16_t));
+		bg->learned = 0;
+	}
+
+	return ret;
+}
+
+
+//******************************************************************************
+//! \brief        Save The Model To bg->path.
+//! \details      Written To A Temporary File And Renamed, So A Crash Leaves The Old Model.
+//! \param[in]    bg        Model.
+//! \return       0         success
+//! \return       -1        not learned yet or write error
+//******************************************************************************
+int bgsubSave(bgsub_t *bg)
+{
+	bgsub_file_t hdr;
+	size_t n = (size_t)bg->w * bg->h;
+	char tmp[BGSUB_PATH_LEN + 8];
+	FILE *fp;
+	bool ok;
+
+	if (!bgsubReady(bg)) {
+		return -1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BGSUB_FILE_MAGIC, 4);
+	hdr.version = BGSUB_FILE_VERSION;
+	hdr.w = bg->w;
+	hdr.h = bg->h;
+	hdr.tag = bg->tag;
+	hdr.learned = bg->learned;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", bg->path);
+	fp = fopen(tmp, "wb");
+	if (fp == NULL) {
+		TL_LGE("bgsub: cannot write %s", tmp);
+		return -1;
+	}
+
+	ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1) &&
+		(fwrite(bg->mean, sizeof(uint16_t), n, fp) == n) &&
+		(fwrite(bg->var, sizeof(uint16_t), n, fp) == n);
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok || (rename(tmp, bg->path) != 0)) {
+		TL_LGE("bgsub: cannot write %s", bg->path);
+		(void) remove(tmp);
+		return -1;
+	}
+
+	TL_LGI("bgsub: model saved to %s", bg->path);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Print Foreground Share And Timing Since The Last Report.
+//! \n
+//! \param[in]    bg        Model.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void bgsubReport(bgsub_t *bg, const char *name)
+{
+	if (!bg->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&bg->lock);
+
+	if (bg->frames > 0) {
+		if (bgsubReady(bg)) {
+			printf("bgsub %s: foreground=%.1f%% time mean=%.2f ms max=%.2f ms\n",
+					name, 100.0 * bg->fg_cnt / ((double)bg->w * bg->h),
+					bg->ms_sum / bg->frames, bg->ms_max);
+		}
+		else {
+			printf("bgsub %s: learning %u/%d frames time mean=%.2f ms max=%.2f ms\n",
+					name, bg->learned, BGSUB_LEARN_FRAMES, bg->ms_sum / bg->frames, bg->ms_max);
+		}
+	}
+
+	bg->frames = 0;
+	bg->ms_sum = 0;
+	bg->ms_max = 0;
+
+	pthread_mutex_unlock(&bg->lock);
+}
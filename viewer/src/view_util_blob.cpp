@@ -0,0 +1,543 @@
+//******************************************************************************
+//! \file       view_util_blob.cpp
+//! \brief      Union-Find Connected Component Labeling Of The Depth Image With 3D Blob Statistics.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "view_util_blob.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define BLOB_STRIP_ROWS     (32)    //!< Rows Per Strip, Strips Are Labeled In Parallel.
+#define BLOB_MAX_H          (2048)  //!< Largest Supported Image Height.
+#define BLOB_MAX_STRIP      (BLOB_MAX_H / BLOB_STRIP_ROWS)
+#define BLOB_REPORT_TOP     (4)     //!< Largest Blobs Printed By blobReport().
+
+//! Statistics Of One Component Within One Strip.
+typedef struct _blob_acc_t {
+	int32_t cnt;
+	int32_t cnt_xyz;        //!< Pixels With A Valid 3D Point.
+	int64_t sx;
+	int64_t sy;
+	int64_t sz;
+	int16_t min[3];
+	int16_t max[3];
+	int16_t u0;
+	int16_t v0;
+	int16_t u1;
+	int16_t v1;
+} blob_acc_t;
+
+//! Job Context.
+typedef struct _blob_job_t {
+	blob_ext_t *ext;
+	const uint16_t *depth;
+	const uint8_t *skip;
+	const int16_t *xyz;
+	int32_t comp_cnt;                       //!< Components With An Id.
+	int32_t root_cnt[BLOB_MAX_STRIP];       //!< Roots Found By Each Strip.
+} blob_job_t;
+
+
+//******************************************************************************
+//! \brief        Root Of A Pixel, Halving The Path On The Way.
+//! \details      parent[i] <= i Always Holds (Roots Are The Smallest Index Of Their Tree).
+//! \param[in]    parent    Forest.
+//! \param[in]    i         Pixel index.
+//! \return       Root index.
+//******************************************************************************
+static inline int32_t blobFind(int32_t *parent, int32_t i)
+{
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+
+//******************************************************************************
+//! \brief        Join The Trees Of Two Roots, The Larger Index Links To The Smaller.
+//! \n
+//! \param[in]    parent    Forest.
+//! \param[in]    a         Root.
+//! \param[in]    b         Root.
+//! \return       Root of the joined tree.
+//******************************************************************************
+static inline int32_t blobUnion(int32_t *parent, int32_t a, int32_t b)
+{
+	if (a < b) {
+		parent[b] = a;
+		return a;
+	}
+	parent[a] = b;
+	return b;
+}
+
+
+//******************************************************************************
+//! \brief        Depth Continuity Between Two Neighbours.
+//! \n
+//! \param[in]    d         Depth of the pixel.
+//! \param[in]    n         Depth of the neighbour.
+//! \return       true      same surface
+//******************************************************************************
+static inline bool blobNear(uint16_t d, uint16_t n)
+{
+	int32_t dz = (int32_t)d - (int32_t)n;
+
+	return ((dz < 0) ? -dz : dz) <= (BLOB_DZ_MIN + (d >> BLOB_DZ_SHIFT));
+}
+
+
+//******************************************************************************
+//! \brief        Label A Strip Of Rows Independently (Pool Job Body, First Pass).
+//! \details      4-Connectivity With Left And Upper Neighbours Inside The Strip, So Strips Share
+//! \n            No Data. Afterwards Every Pixel Points Directly To Its Strip Root.
+//! \param[in]    ctx       blob_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void blobStripJob(void *ctx, int32_t begin, int32_t end)
+{
+	blob_job_t *job = (blob_job_t *)ctx;
+	blob_ext_t *ext = job->ext;
+	int32_t w = ext->w;
+	int32_t *parent = ext->parent;
+	const uint16_t *depth = job->depth;
+	int32_t first = begin * w;
+	int32_t last = end * w;
+	int32_t *roots = ext->roots + first;
+	int32_t *size = ext->blob_id;
+	int32_t root_cnt = 0;
+
+	for (int32_t v = begin; v < end; v++) {
+		int32_t row = v * w;
+
+		for (int32_t u = 0; u < w; u++) {
+			int32_t i = row + u;
+			uint16_t d = depth[i];
+			int32_t a = -1;
+			int32_t b = -1;
+
+			if ((d == 0) || ((job->skip != NULL) && (job->skip[i] != 0))) {
+				parent[i] = -1;
+				continue;
+			}
+
+			if ((u > 0) && (parent[i - 1] >= 0) && blobNear(d, depth[i - 1])) {
+				a = blobFind(parent, i - 1);
+			}
+			if ((v > begin) && (parent[i - w] >= 0) && blobNear(d, depth[i - w])) {
+				b = blobFind(parent, i - w);
+			}
+
+			if ((a < 0) && (b < 0)) {
+				parent[i] = i;
+				roots[root_cnt++] = i;
+			}
+			else
+			if ((a < 0) || (b < 0)) {
+				parent[i] = (a < 0) ? b : a;
+			}
+			else {
+				parent[i] = (a == b) ? a : blobUnion(parent, a, b);
+			}
+		}
+	}
+
+	//! \remark - Since parent[i] < i For Non-Roots, One Ascending Sweep Flattens The Strip And Sizes Its Roots.
+	for (int32_t k = 0; k < root_cnt; k++) {
+		size[roots[k]] = 0;
+	}
+	for (int32_t i = first; i < last; i++) {
+		int32_t p = parent[i];
+		if (p >= 0) {
+			parent[i] = parent[p];
+			size[parent[i]]++;
+		}
+	}
+
+	job->root_cnt[begin / BLOB_STRIP_ROWS] = root_cnt;
+}
+
+
+//******************************************************************************
+//! \brief        Resolve The Component Of Each Pixel Of A Strip And Accumulate Its Statistics (Pool Job Body, Second Pass).
+//! \details      Only Reads The Forest; Each Strip Has Its Own Accumulators.
+//! \param[in]    ctx       blob_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void blobStatJob(void *ctx, int32_t begin, int32_t end)
+{
+	blob_job_t *job = (blob_job_t *)ctx;
+	blob_ext_t *ext = job->ext;
+	int32_t w = ext->w;
+	const int32_t *parent = ext->parent;
+	blob_acc_t *acc = ext->acc + (size_t)(begin / BLOB_STRIP_ROWS) * BLOB_MAX;
+
+	for (int32_t k = 0; k < job->comp_cnt; k++) {
+		memset(&acc[k], 0, sizeof(acc[k]));
+		acc[k].min[0] = acc[k].min[1] = acc[k].min[2] = INT16_MAX;
+		acc[k].max[0] = acc[k].max[1] = acc[k].max[2] = INT16_MIN;
+		acc[k].u0 = acc[k].v0 = INT16_MAX;
+		acc[k].u1 = acc[k].v1 = -1;
+	}
+
+	int32_t last_p = -1;
+	int32_t last_id = -1;
+
+	for (int32_t v = begin; v < end; v++) {
+		int32_t row = v * w;
+		int32_t *label = ext->label + row;
+
+		for (int32_t u = 0; u < w; u++) {
+			int32_t r = parent[row + u];
+
+			if (r < 0) {
+				label[u] = -1;
+				continue;
+			}
+
+			//! \remark - Neighbours Mostly Share Their Strip Root, Chase The Merged Root Only On A Change.
+			if (r != last_p) {
+				last_p = r;
+				while (parent[r] != r) {
+					r = parent[r];
+				}
+				last_id = ext->blob_id[r];
+			}
+
+			int32_t id = last_id;
+			label[u] = id;
+			if (id < 0) {
+				continue;
+			}
+
+			blob_acc_t *a = &acc[id];
+			a->cnt++;
+			if (u < a->u0) {
+				a->u0 = (int16_t)u;
+			}
+			if (u > a->u1) {
+				a->u1 = (int16_t)u;
+			}
+			if (v < a->v0) {
+				a->v0 = (int16_t)v;
+			}
+			a->v1 = (int16_t)v;
+
+			const int16_t *p = job->xyz + (size_t)(row + u) * 3;
+			if (p[2] <= 0) {
+				continue;
+			}
+			a->cnt_xyz++;
+			a->sx += p[0];
+			a->sy += p[1];
+			a->sz += p[2];
+			for (int c = 0; c < 3; c++) {
+				if (p[c] < a->min[c]) {
+					a->min[c] = p[c];
+				}
+				if (p[c] > a->max[c]) {
+					a->max[c] = p[c];
+				}
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Prepare An Extractor For A Depth Image Size.
+//! \n
+//! \param[out]   ext       Extractor.
+//! \param[in]    w         Image width.
+//! \param[in]    h         Image height.
+//! \param[in]    min_cnt   Smallest reported component in pixels, 0 = disabled.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int blobInit(blob_ext_t *ext, int32_t w, int32_t h, int32_t min_cnt)
+{
+	size_t n = (size_t)w * h;
+
+	memset(ext, 0, sizeof(*ext));
+	pthread_mutex_init(&ext->lock, NULL);
+
+	if ((w <= 0) || (h <= 0) || (h > BLOB_MAX_H) || (w > INT16_MAX) || (min_cnt < 0)) {
+		return -1;
+	}
+
+	ext->w = w;
+	ext->h = h;
+	ext->min_cnt = min_cnt;
+	ext->enable = (min_cnt > 0);
+
+	if (!ext->enable) {
+		return 0;
+	}
+
+	ext->parent = (int32_t *)malloc(n * sizeof(int32_t));
+	ext->label = (int32_t *)malloc(n * sizeof(int32_t));
+	ext->roots = (int32_t *)malloc(n * sizeof(int32_t));
+	ext->blob_id = (int32_t *)malloc(n * sizeof(int32_t));
+	ext->acc = (blob_acc_t *)malloc(sizeof(blob_acc_t) * BLOB_MAX * ((h + BLOB_STRIP_ROWS - 1) / BLOB_STRIP_ROWS));
+	if ((ext->parent == NULL) || (ext->label == NULL) || (ext->roots == NULL) ||
+		(ext->blob_id == NULL) || (ext->acc == NULL)) {
+		blobTerm(ext);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release An Extractor.
+//! \n
+//! \param[in]    ext       Extractor.
+//! \return       None.
+//******************************************************************************
+void blobTerm(blob_ext_t *ext)
+{
+	free(ext->parent);
+	free(ext->label);
+	free(ext->roots);
+	free(ext->blob_id);
+	free(ext->acc);
+	ext->parent = NULL;
+	ext->label = NULL;
+	ext->roots = NULL;
+	ext->blob_id = NULL;
+	ext->acc = NULL;
+	ext->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Label The Connected Components Of A Frame And Measure Them In 3D.
+//! \details      1. Strips Of Rows Are Labeled In Parallel (Union-Find, 4-Connectivity, Depth
+//! \n            Continuity). 2. The Rows Where Strips Meet Are Merged Serially. 3. Final Roots
+//! \n            Of At Least min_cnt Pixels Get Ids. 4. Strips Label Their Pixels And Accumulate Statistics In Parallel,
+//! \n            Which Are Summed Per Component.
+//! \param[in]    ext       Extractor.
+//! \param[in]    depth     Depth image (w x h, 0 = no depth), e.g. the foreground.
+//! \param[in]    skip      Optional w x h mask of pixels left out (e.g. plane inliers), or NULL.
+//! \param[in]    xyz       Organized point cloud of the depth image.
+//! \return       0         success, ext->blob and ext->label are set
+//! \return       -1        disabled
+//******************************************************************************
+int blobExtract(blob_ext_t *ext, const uint16_t *depth, const uint8_t *skip, const int16_t *xyz)
+{
+	uint64_t t0 = getMonoNs();
+	blob_job_t job;
+	int32_t w = ext->w;
+	int32_t strip_num = (ext->h + BLOB_STRIP_ROWS - 1) / BLOB_STRIP_ROWS;
+	int32_t *parent = ext->parent;
+	int32_t n = 0;
+	int32_t comp = 0;
+	uint32_t overflow = 0;
+
+	if (!ext->enable || (depth == NULL) || (xyz == NULL)) {
+		return -1;
+	}
+
+	job.ext = ext;
+	job.depth = depth;
+	job.skip = skip;
+	job.xyz = xyz;
+
+	paraFor(blobStripJob, &job, ext->h, BLOB_STRIP_ROWS);
+
+	//! \remark - Merge Across The First Row Of Each Strip.
+	for (int32_t s = 1; s < strip_num; s++) {
+		int32_t row = s * BLOB_STRIP_ROWS * w;
+
+		for (int32_t i = row; i < row + w; i++) {
+			if ((parent[i] >= 0) && (parent[i - w] >= 0) && blobNear(depth[i], depth[i - w])) {
+				int32_t a = blobFind(parent, i);
+				int32_t b = blobFind(parent, i - w);
+				if (a != b) {
+					(void) blobUnion(parent, a, b);
+				}
+			}
+		}
+	}
+
+	//! \remark - Add The Size Of Each Merged Strip Root To Its Final Root, Which Has A Smaller Index.
+	for (int32_t s = 0; s < strip_num; s++) {
+		const int32_t *roots = ext->roots + (size_t)s * BLOB_STRIP_ROWS * w;
+
+		for (int32_t k = 0; k < job.root_cnt[s]; k++) {
+			int32_t r = roots[k];
+			if (parent[r] != r) {
+				ext->blob_id[blobFind(parent, r)] += ext->blob_id[r];
+			}
+		}
+	}
+
+	//! \remark - Roots That Survived The Merge Are The Components, Those Of At Least min_cnt Pixels Are
+	//! \remark - Numbered In Image Order, So Specks Of Noise Cannot Use Up The Ids.
+	for (int32_t s = 0; s < strip_num; s++) {
+		const int32_t *roots = ext->roots + (size_t)s * BLOB_STRIP_ROWS * w;
+
+		for (int32_t k = 0; k < job.root_cnt[s]; k++) {
+			int32_t r = roots[k];
+			if (parent[r] != r) {
+				continue;
+			}
+			comp++;
+			if (ext->blob_id[r] < ext->min_cnt) {
+				ext->blob_id[r] = -1;
+			}
+			else
+			if (n < BLOB_MAX) {
+				ext->blob_id[r] = n++;
+			}
+			else {
+				ext->blob_id[r] = -1;
+				overflow = 1;
+			}
+		}
+	}
+	job.comp_cnt = n;
+
+	paraFor(blobStatJob, &job, ext->h, BLOB_STRIP_ROWS);
+
+	//! \remark - Sum The Strips, Keep Components With 3D Points (Under The Lock For blobReport).
+	pthread_mutex_lock(&ext->lock);
+	ext->blob_cnt = 0;
+	for (int32_t k = 0; k < n; k++) {
+		blob_acc_t sum = ext->acc[k];
+
+		for (int32_t s = 1; s < strip_num; s++) {
+			const blob_acc_t *a = &ext->acc[(size_t)s * BLOB_MAX + k];
+			if (a->cnt == 0) {
+				continue;
+			}
+			sum.cnt += a->cnt;
+			sum.cnt_xyz += a->cnt_xyz;
+			sum.sx += a->sx;
+			sum.sy += a->sy;
+			sum.sz += a->sz;
+			for (int c = 0; c < 3; c++) {
+				if (a->min[c] < sum.min[c]) {
+					sum.min[c] = a->min[c];
+				}
+				if (a->max[c] > sum.max[c]) {
+					sum.max[c] = a->max[c];
+				}
+			}
+			if (a->u0 < sum.u0) {
+				sum.u0 = a->u0;
+			}
+			if (a->u1 > sum.u1) {
+				sum.u1 = a->u1;
+			}
+			if (a->v0 < sum.v0) {
+				sum.v0 = a->v0;
+			}
+			if (a->v1 > sum.v1) {
+				sum.v1 = a->v1;
+			}
+		}
+
+		if (sum.cnt_xyz == 0) {
+			continue;
+		}
+
+		blob_t *b = &ext->blob[ext->blob_cnt++];
+		b->id = k;
+		b->cnt = sum.cnt;
+		b->cx = (float)((double)sum.sx / sum.cnt_xyz);
+		b->cy = (float)((double)sum.sy / sum.cnt_xyz);
+		b->cz = (float)((double)sum.sz / sum.cnt_xyz);
+		memcpy(b->min, sum.min, sizeof(b->min));
+		memcpy(b->max, sum.max, sizeof(b->max));
+		b->u0 = sum.u0;
+		b->v0 = sum.v0;
+		b->u1 = sum.u1;
+		b->v1 = sum.v1;
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	ext->frames++;
+	ext->comp_cnt = comp;
+	ext->overflow += overflow;
+	ext->ms_sum += ms;
+	if (ms > ext->ms_max) {
+		ext->ms_max = ms;
+	}
+	pthread_mutex_unlock(&ext->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Largest Blobs Of The Last Frame And Timing Since The Last Report.
+//! \n
+//! \param[in]    ext       Extractor.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void blobReport(blob_ext_t *ext, const char *name)
+{
+	if (!ext->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&ext->lock);
+
+	if (ext->frames > 0) {
+		printf("blob %s: blobs=%d components=%d overflow=%u time mean=%.2f ms max=%.2f ms\n",
+				name, ext->blob_cnt, ext->comp_cnt, ext->overflow, ext->ms_sum / ext->frames, ext->ms_max);
+		//! \remark - Partial Selection Of The Largest Ones, Ties Keep Image Order.
+		const blob_t *top[BLOB_REPORT_TOP];
+		int32_t top_cnt = 0;
+		for (int32_t k = 0; k < ext->blob_cnt; k++) {
+			const blob_t *b = &ext->blob[k];
+			int32_t j = (top_cnt < BLOB_REPORT_TOP) ? top_cnt++ : BLOB_REPORT_TOP;
+			while ((j > 0) && (top[j - 1]->cnt < b->cnt)) {
+				if (j < BLOB_REPORT_TOP) {
+					top[j] = top[j - 1];
+				}
+				j--;
+			}
+			if (j < BLOB_REPORT_TOP) {
+				top[j] = b;
+			}
+		}
+		for (int32_t k = 0; k < top_cnt; k++) {
+			const blob_t *b = top[k];
+			printf("  #%d pixels=%d centroid=(%.0f, %.0f, %.0f) size=%dx%dx%d mm\n",
+					b->id, b->cnt, b->cx, b->cy, b->cz,
+					b->max[0] - b->min[0], b->max[1] - b->min[1], b->max[2] - b->min[2]);
+		}
+	}
+
+	ext->frames = 0;
+	ext->overflow = 0;
+	ext->ms_sum = 0;
+	ext->ms_max = 0;
+
+	pthread_mutex_unlock(&ext->lock);
+}
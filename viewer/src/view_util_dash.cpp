@@ -0,0 +1,324 @@
+//******************************************************************************
+//! \file       view_util_dash.cpp
+//! \brief      One Window Tiling The Depth, IR And BG Images, Repainted By Its Own Thread.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility>
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "view_util_dash.h"
+#include "view_util_time.h"
+#include "view_util_trace.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define DASH_WINDOW_NAME            "ToF Images"
+#define DASH_TRACKBAR_NAME_IR       "IR Gamma Correction (slider/10)"
+#define DASH_TRACKBAR_NAME_BG       "BG Gamma Correction (slider/10)"
+
+#define DASH_BUF_POST               (0)     //!< Filled By The Capture Thread.
+#define DASH_BUF_LATEST             (1)     //!< Exchanged Under The Lock.
+#define DASH_BUF_SHOWN              (2)     //!< Read By The UI Thread.
+
+
+//******************************************************************************
+//! \brief        Get One Of The Buffers Of A Tile.
+//! \n
+//! \param[in]    dash      Window.
+//! \param[in]    tile      dash_tile_e.
+//! \param[in]    which     DASH_BUF_xxx.
+//! \return       Buffer.
+//******************************************************************************
+static inline cv::Mat &dashBuf(dash_t *dash, int tile, int which)
+{
+	return dash->buf[tile * 3 + which];
+}
+
+
+//******************************************************************************
+//! \brief        Exchange Two Buffers Of A Tile Together With Their Capture Records.
+//! \n
+//! \param[in]    dash      Window.
+//! \param[in]    tile      dash_tile_e.
+//! \param[in]    a         DASH_BUF_xxx.
+//! \param[in]    b         DASH_BUF_xxx.
+//! \return       None.
+//******************************************************************************
+static inline void dashSwap(dash_t *dash, int tile, int a, int b)
+{
+	std::swap(dash->buf[tile * 3 + a], dash->buf[tile * 3 + b]);
+	std::swap(dash->meta[tile * 3 + a], dash->meta[tile * 3 + b]);
+}
+
+
+//******************************************************************************
+//! \brief        Compose The Shown Images Side By Side And Show Them.
+//! \details      Images Are Scaled To The Tallest One By An Integer Factor (QVGA Next To VGA
+//! \n            Is Doubled), 16 Bit Images Are Shown As Their Upper 8 Bits Like imshow() Does.
+//! \param[in]    dash      Window.
+//! \param[in]    show      Tiles to include.
+//! \return       None.
+//******************************************************************************
+static void dashCompose(dash_t *dash, const bool show[DASH_TILE_NUM])
+{
+	cv::Mat &canvas = *dash->canvas;
+	cv::Mat gray;
+	cv::Mat bgr;
+	int height = 0;
+	int width = 0;
+	int x = 0;
+
+	for (int t = 0; t < DASH_TILE_NUM; t++) {
+		if (show[t] && (dashBuf(dash, t, DASH_BUF_SHOWN).rows > height)) {
+			height = dashBuf(dash, t, DASH_BUF_SHOWN).rows;
+		}
+	}
+	for (int t = 0; t < DASH_TILE_NUM; t++) {
+		if (show[t]) {
+			const cv::Mat &img = dashBuf(dash, t, DASH_BUF_SHOWN);
+			width += img.cols * (height / img.rows);
+		}
+	}
+	if ((width == 0) || (height == 0)) {
+		return;
+	}
+
+	//! \remark - Reallocated Only When The Layout Changes.
+	canvas.create(height, width, CV_8UC3);
+	canvas.setTo(cv::Scalar(0, 0, 0));
+
+	for (int t = 0; t < DASH_TILE_NUM; t++) {
+		if (!show[t]) {
+			continue;
+		}
+
+		const cv::Mat &img = dashBuf(dash, t, DASH_BUF_SHOWN);
+		const cv::Mat *src = &img;
+		int scale = height / img.rows;
+
+		if (img.channels() == 1) {
+			img.convertTo(gray, CV_8U, (img.depth() == CV_16U) ? (1.0 / 256) : 1.0);
+			cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+			src = &bgr;
+		}
+
+		cv::Mat roi = canvas(cv::Rect(x, 0, img.cols * scale, img.rows * scale));
+		if (scale > 1) {
+			cv::resize(*src, roi, roi.size(), 0, 0, cv::INTER_NEAREST);
+		}
+		else {
+			src->copyTo(roi);
+		}
+		x += img.cols * scale;
+	}
+
+	cv::imshow(DASH_WINDOW_NAME, canvas);
+}
+
+
+//******************************************************************************
+//! \brief        UI Thread, Owns The Window And Its Trackbars.
+//! \n
+//! \param[in]    data      Window.
+//! \return       NULL
+//******************************************************************************
+static void *dashThread(void *data)
+{
+	dash_t *dash = (dash_t *)data;
+	uint64_t stamp[DASH_TILE_NUM] = { 0 };
+
+	if (g_trace_enable) {
+		traceSetThreadName("dashboard");
+	}
+
+	//! \remark - Created Once, The Trackbars Write dash->gamma Directly.
+	cv::namedWindow(DASH_WINDOW_NAME, cv::WINDOW_AUTOSIZE);
+	cv::createTrackbar(DASH_TRACKBAR_NAME_IR, DASH_WINDOW_NAME, &dash->gamma[DASH_IR], 30);
+	cv::createTrackbar(DASH_TRACKBAR_NAME_BG, DASH_WINDOW_NAME, &dash->gamma[DASH_BG], 30);
+
+	while (!dash->exit) {
+		uint64_t now = getMonoNs();
+		bool show[DASH_TILE_NUM];
+		bool shown[DASH_TILE_NUM] = { false };
+		bool fresh = false;
+
+		//! Take The Latest Image Of Each Tile, Only Buffer Headers Are Exchanged.
+		pthread_mutex_lock(&dash->lock);
+		for (int t = 0; t < DASH_TILE_NUM; t++) {
+			if (dash->fresh[t]) {
+				dashSwap(dash, t, DASH_BUF_LATEST, DASH_BUF_SHOWN);
+				dash->fresh[t] = false;
+				stamp[t] = now;
+				shown[t] = true;
+				fresh = true;
+			}
+		}
+		pthread_mutex_unlock(&dash->lock);
+
+		if (fresh) {
+			TRACE_BEGIN(TRACE_DISPLAY);
+			for (int t = 0; t < DASH_TILE_NUM; t++) {
+				show[t] = (stamp[t] != 0) && ((now - stamp[t]) < (uint64_t)DASH_STALE_MS * 1000000ULL);
+			}
+			dashCompose(dash, show);
+			TRACE_END(TRACE_DISPLAY);
+
+			uint64_t done = getMonoNs();
+			for (int t = 0; t < DASH_TILE_NUM; t++) {
+				if (shown[t]) {
+					latencyAdd(&dash->latency, &dash->meta[t * 3 + DASH_BUF_SHOWN], done);
+				}
+			}
+
+			double ms = (double)(done - now) * 1e-6;
+			pthread_mutex_lock(&dash->lock);
+			dash->frames++;
+			dash->ms_sum += ms;
+			if (ms > dash->ms_max) {
+				dash->ms_max = ms;
+			}
+			pthread_mutex_unlock(&dash->lock);
+		}
+
+		//! \remark - Handles The Window Events And Paces The Repaints.
+		cv::waitKey(dash->refresh_ms);
+	}
+
+	cv::destroyWindow(DASH_WINDOW_NAME);
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare The Window And Start Its UI Thread.
+//! \n
+//! \param[out]   dash          Window.
+//! \param[in]    refresh_ms    Repaint interval, 0 = no window (gamma settings only).
+//! \return       0             success
+//! \return       -1            failed
+//******************************************************************************
+int dashInit(dash_t *dash, int refresh_ms)
+{
+	memset(dash, 0, sizeof(*dash));
+	pthread_mutex_init(&dash->lock, NULL);
+	latencyInit(&dash->latency);
+	dash->gamma[DASH_IR] = 22;  //!< Default Gamma Value Is 2.2.
+	dash->gamma[DASH_BG] = 22;
+
+	if (refresh_ms <= 0) {
+		return 0;
+	}
+
+	dash->refresh_ms = refresh_ms;
+	dash->report_ns = getMonoNs();
+	dash->buf = new cv::Mat[DASH_TILE_NUM * 3];
+	dash->canvas = new cv::Mat;
+
+	if (pthread_create(&dash->thread, NULL, dashThread, dash) != 0) {
+		dashTerm(dash);
+		return -1;
+	}
+	dash->thread_created = true;
+	dash->enable = true;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Stop The UI Thread And Close The Window.
+//! \n
+//! \param[in]    dash      Window.
+//! \return       None.
+//******************************************************************************
+void dashTerm(dash_t *dash)
+{
+	dash->enable = false;
+
+	if (dash->thread_created) {
+		dash->exit = true;
+		pthread_join(dash->thread, NULL);
+		dash->thread_created = false;
+	}
+
+	delete[] dash->buf;
+	delete dash->canvas;
+	dash->buf = NULL;
+	dash->canvas = NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Hand An Image To The Window Without Waiting For The UI Thread.
+//! \details      The Copy Is Made Into A Buffer Only The Caller Uses, Then Exchanged With The
+//! \n            Latest One; An Image Not Shown Before The Next One Arrives Is Replaced.
+//! \param[in]    dash      Window.
+//! \param[in]    tile      dash_tile_e.
+//! \param[in]    img       Image, copied.
+//! \param[in]    meta      Capture record of the image, copied.
+//! \return       None.
+//******************************************************************************
+void dashPost(dash_t *dash, int tile, const cv::Mat &img, const frame_meta_t *meta)
+{
+	if (!dash->enable || (tile < 0) || (tile >= DASH_TILE_NUM)) {
+		return;
+	}
+
+	img.copyTo(dashBuf(dash, tile, DASH_BUF_POST));
+	dash->meta[tile * 3 + DASH_BUF_POST] = *meta;
+
+	pthread_mutex_lock(&dash->lock);
+	dashSwap(dash, tile, DASH_BUF_POST, DASH_BUF_LATEST);
+	dash->fresh[tile] = true;
+	dash->posted++;
+	pthread_mutex_unlock(&dash->lock);
+}
+
+
+//******************************************************************************
+//! \brief        Print The Repaint Rate Of The Window Since The Last Report.
+//! \n
+//! \param[in]    dash      Window.
+//! \return       None.
+//******************************************************************************
+void dashReport(dash_t *dash)
+{
+	uint64_t now = getMonoNs();
+
+	if (!dash->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&dash->lock);
+
+	double sec = (double)(now - dash->report_ns) * 1e-9;
+	printf("dash: %.1f fps (%u images posted) compose mean=%.2f ms max=%.2f ms\n",
+			(sec > 0) ? (dash->frames / sec) : 0.0, dash->posted,
+			(dash->frames > 0) ? (dash->ms_sum / dash->frames) : 0.0, dash->ms_max);
+
+	dash->report_ns = now;
+	dash->frames = 0;
+	dash->posted = 0;
+	dash->ms_sum = 0;
+	dash->ms_max = 0;
+
+	pthread_mutex_unlock(&dash->lock);
+
+	latencyReport(&dash->latency, "dash");
+}
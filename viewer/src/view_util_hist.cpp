@@ -0,0 +1,247 @@
+//******************************************************************************
+//! \file       view_util_hist.cpp
+//! \brief      Per-Frame Depth Histogram With Percentile Based Color Range And Hysteresis.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_hist.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define HIST_SUB            (4)     //!< Interleaved Histograms, Consecutive Pixels Never Hit The Same Counter.
+
+
+//******************************************************************************
+//! \brief        Count 8 Bin Indices Into The Interleaved Histograms.
+//! \n
+//! \param[in]    sub       HIST_SUB histograms of HIST_BINS.
+//! \param[in]    idx       Bin indices.
+//! \return       None.
+//******************************************************************************
+static inline void histCount8(uint32_t *sub, const uint16_t idx[8])
+{
+	sub[0 * HIST_BINS + idx[0]]++;
+	sub[1 * HIST_BINS + idx[1]]++;
+	sub[2 * HIST_BINS + idx[2]]++;
+	sub[3 * HIST_BINS + idx[3]]++;
+	sub[0 * HIST_BINS + idx[4]]++;
+	sub[1 * HIST_BINS + idx[5]]++;
+	sub[2 * HIST_BINS + idx[6]]++;
+	sub[3 * HIST_BINS + idx[7]]++;
+}
+
+
+//******************************************************************************
+//! \brief        Find The Bin Below Which A Share Of The Counts Lies.
+//! \n
+//! \param[in]    bins      Histogram.
+//! \param[in]    target    Count to reach.
+//! \return       Bin index.
+//******************************************************************************
+static int32_t histPercentile(const uint32_t *bins, uint64_t target)
+{
+	uint64_t sum = 0;
+
+	for (int32_t b = 1; b < HIST_BINS; b++) {
+		sum += bins[b];
+		if (sum >= target) {
+			return b;
+		}
+	}
+
+	return HIST_BINS - 1;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare A Histogram.
+//! \n
+//! \param[out]   hist      Histogram.
+//! \param[in]    lo_pct    Percentile of the near end of the colors.
+//! \param[in]    hi_pct    Percentile of the far end, 0 = disabled (fixed range).
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int histInit(depth_hist_t *hist, float lo_pct, float hi_pct)
+{
+	memset(hist, 0, sizeof(*hist));
+	pthread_mutex_init(&hist->lock, NULL);
+
+	hist->enable = (hi_pct > 0);
+	if (!hist->enable) {
+		return 0;
+	}
+
+	if ((lo_pct < 0) || (lo_pct >= hi_pct) || (hi_pct > 100)) {
+		hist->enable = false;
+		return -1;
+	}
+
+	hist->lo_pct = lo_pct;
+	hist->hi_pct = hi_pct;
+	hist->sub = (uint32_t *)calloc((size_t)HIST_SUB * HIST_BINS, sizeof(uint32_t));
+	hist->bins = (uint32_t *)calloc(HIST_BINS, sizeof(uint32_t));
+	if ((hist->sub == NULL) || (hist->bins == NULL)) {
+		histTerm(hist);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release A Histogram.
+//! \n
+//! \param[in]    hist      Histogram.
+//! \return       None.
+//******************************************************************************
+void histTerm(depth_hist_t *hist)
+{
+	free(hist->sub);
+	free(hist->bins);
+	hist->sub = NULL;
+	hist->bins = NULL;
+	hist->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Add A Frame To The Histogram And Move The Color Range If Needed.
+//! \details      Bin Indices Are Computed 8 At A Time And Counted Into 4 Interleaved Histograms,
+//! \n            Which Are Folded Into The Decayed One. The Range Follows The Percentiles Only
+//! \n            When An End Moves Past The Hysteresis, So The Color Table Is Rarely Rebuilt.
+//! \param[in]    hist      Histogram.
+//! \param[in]    depth     Depth image, 0 = no depth.
+//! \param[in]    n         Pixels.
+//! \return       true      hist->lo/hi changed, the color table has to be rebuilt
+//******************************************************************************
+bool histUpdate(depth_hist_t *hist, const uint16_t *depth, int32_t n)
+{
+	uint64_t t0 = getMonoNs();
+	uint32_t *sub = hist->sub;
+	uint64_t total = 0;
+	uint16_t idx[8];
+	int32_t i = 0;
+	bool moved = false;
+
+	if (!hist->enable || (depth == NULL)) {
+		return false;
+	}
+
+	memset(sub, 0, sizeof(uint32_t) * HIST_SUB * HIST_BINS);
+
+#if defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		vst1q_u16(idx, vshrq_n_u16(vld1q_u16(depth + i), HIST_SHIFT));
+		histCount8(sub, idx);
+	}
+#elif defined(__SSE2__)
+	for (; i + 8 <= n; i += 8) {
+		_mm_storeu_si128((__m128i *)idx, _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(depth + i)), HIST_SHIFT));
+		histCount8(sub, idx);
+	}
+#endif
+	for (; i < n; i++) {
+		sub[depth[i] >> HIST_SHIFT]++;
+	}
+
+	//! \remark - Fold And Decay; Bin 0 (No Depth) Is Never Counted.
+	hist->bins[0] = 0;
+	for (int32_t b = 1; b < HIST_BINS; b++) {
+		uint32_t c = sub[b] + sub[HIST_BINS + b] + sub[2 * HIST_BINS + b] + sub[3 * HIST_BINS + b];
+		hist->bins[b] = hist->bins[b] - (hist->bins[b] >> HIST_DECAY_SHIFT) + c;
+		total += hist->bins[b];
+	}
+
+	if (total > 0) {
+		uint32_t lo = (uint32_t)histPercentile(hist->bins, (uint64_t)(total * hist->lo_pct / 100.0)) << HIST_SHIFT;
+		uint32_t hi = ((uint32_t)histPercentile(hist->bins, (uint64_t)(total * hist->hi_pct / 100.0)) + 1) << HIST_SHIFT;
+
+		if (hi - lo < HIST_SPAN_MIN) {
+			uint32_t mid = (lo + hi) / 2;
+			lo = (mid > HIST_SPAN_MIN / 2) ? (mid - HIST_SPAN_MIN / 2) : 0;
+			hi = lo + HIST_SPAN_MIN;
+			//! \remark - Near The Top Bin The Span Grows Downwards, hi Never Passes The 16 Bit Range.
+			if (hi > 65536) {
+				hi = 65536;
+				lo = hi - HIST_SPAN_MIN;
+			}
+		}
+
+		uint32_t thr = (uint32_t)((hist->hi - hist->lo) * HIST_HYST_RATIO);
+		if (thr < HIST_HYST_MIN) {
+			thr = HIST_HYST_MIN;
+		}
+
+		if (!hist->valid ||
+			((lo > hist->lo) ? (lo - hist->lo) : (hist->lo - lo)) > thr ||
+			((hi > hist->hi) ? (hi - hist->hi) : (hist->hi - hi)) > thr) {
+			hist->lo = lo;
+			hist->hi = hi;
+			hist->valid = true;
+			moved = true;
+		}
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&hist->lock);
+	hist->frames++;
+	hist->rebuild += moved ? 1 : 0;
+	hist->ms_sum += ms;
+	if (ms > hist->ms_max) {
+		hist->ms_max = ms;
+	}
+	pthread_mutex_unlock(&hist->lock);
+
+	return moved;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Color Range And Timing Since The Last Report.
+//! \n
+//! \param[in]    hist      Histogram.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void histReport(depth_hist_t *hist, const char *name)
+{
+	if (!hist->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&hist->lock);
+
+	if (hist->frames > 0) {
+		printf("hist %s: range=%u-%u mm (p%.0f-p%.0f) rebuilds=%u time mean=%.2f ms max=%.2f ms\n",
+				name, hist->lo, hist->hi, hist->lo_pct, hist->hi_pct, hist->rebuild,
+				hist->ms_sum / hist->frames, hist->ms_max);
+	}
+
+	hist->frames = 0;
+	hist->rebuild = 0;
+	hist->ms_sum = 0;
+	hist->ms_max = 0;
+
+	pthread_mutex_unlock(&hist->lock);
+}
@@ -0,0 +1,879 @@
+//******************************************************************************
+//! \file       view_util_icp.cpp
+//! \brief      Point-To-Plane ICP With Projective Data Association Over A Depth Pyramid.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tl_log.h"
+#include "view_util_icp.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define ICP_BAND_ROWS       (8)     //!< Rows Per Pool Block, Each Block Sums Into Its Own Band.
+#define ICP_BAND_SIZE       (ICP_SUMS + 1)  //!< Sums And Pair Count Of A Band.
+#define ICP_PAIR_ROWS       (7)     //!< Jacobian Entries And Residual Of A Pair.
+#define ICP_EDGE_RATIO      (0.05f) //!< Neighbours Farther Apart In Depth Than This Share Are Not One Surface.
+#define ICP_NORMAL_COS      (0.85f) //!< Paired Normals Differ By Less Than About 30 Degrees.
+#define ICP_PAIR_MIN        (0.10)  //!< Share Of Valid Points That Must Be Paired At Level 0.
+#define ICP_SRC_STEP        (2)     //!< Level 0 Pairs Every 2nd Point Of Every 2nd Row, Against All Of The Previous Frame.
+#define ICP_STEP_EPS        (1e-4)  //!< Update (rad, m) Below Which A Level Has Converged (0.1 mm).
+
+//! Iterations And Pair Distance (m) Per Level, Finest First; Coarse Levels Catch Larger Motion.
+static const int32_t g_icp_iter[ICP_LEVELS] = { 4, 5, 10 };
+static const float g_icp_dist[ICP_LEVELS] = { 0.05f, 0.10f, 0.15f };
+
+//! Job Context.
+typedef struct _icp_job_t {
+	icp_t *icp;
+	int32_t l;              //!< Pyramid Level.
+	const int16_t *xyz;     //!< Input Grid.
+	float rt[12];           //!< Estimate Of Newest Camera To Previous Camera.
+	float dist2;            //!< Squared Pair Distance.
+} icp_job_t;
+
+
+//******************************************************************************
+//! \brief        Depth Continuity Of Two Points.
+//! \n
+//! \param[in]    z         Depth of the point.
+//! \param[in]    zn        Depth of the neighbour.
+//! \return       true      same surface
+//******************************************************************************
+static inline bool icpNear(float z, float zn)
+{
+	return fabsf(z - zn) <= ICP_EDGE_RATIO * z;
+}
+
+
+//******************************************************************************
+//! \brief        Mean Of The Valid Points Of A 2 x 2 Block That Lie On The Same Surface As Its First Valid One.
+//! \n            Depth Edges Are Not Blurred Into Flying Points.
+//! \param[in]    blk       The 4 points, z <= 0 invalid.
+//! \param[in]    scale     Unit of the points in m.
+//! \param[out]   d         Point in m, 0/0/0 = none.
+//! \return       None.
+//******************************************************************************
+template <typename T>
+static inline void icpMean(const T *const blk[4], float scale, float *d)
+{
+	float z0 = 0.0f;
+	float s[3] = { 0.0f, 0.0f, 0.0f };
+	int32_t n = 0;
+
+	for (int k = 0; k < 4; k++) {
+		if (blk[k][2] <= 0) {
+			continue;
+		}
+		if (n == 0) {
+			z0 = (float)blk[k][2];
+		}
+		else
+		if (!icpNear(z0, (float)blk[k][2])) {
+			continue;
+		}
+		s[0] += blk[k][0];
+		s[1] += blk[k][1];
+		s[2] += blk[k][2];
+		n++;
+	}
+
+	float inv = (n > 0) ? (scale / n) : 0.0f;
+	d[0] = s[0] * inv;
+	d[1] = s[1] * inv;
+	d[2] = s[2] * inv;
+}
+
+
+//******************************************************************************
+//! \brief        Halve The Input Grid Into Level 0, In m (Pool Job Body).
+//! \n
+//! \param[in]    ctx       icp_job_t.
+//! \param[in]    begin     First row of level 0.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void icpConvJob(void *ctx, int32_t begin, int32_t end)
+{
+	icp_job_t *job = (icp_job_t *)ctx;
+	icp_level_t *lv = &job->icp->lvl[0];
+	size_t stride = (size_t)job->icp->w * 3;
+
+	for (int32_t v = begin; v < end; v++) {
+		const int16_t *r0 = job->xyz + (size_t)(2 * v) * stride;
+		const int16_t *r1 = r0 + stride;
+		float *d = lv->vtx[job->icp->cur] + (size_t)v * lv->w * 3;
+
+		for (int32_t u = 0; u < lv->w; u++, r0 += 6, r1 += 6, d += 3) {
+			const int16_t *const blk[4] = { r0, r0 + 3, r1, r1 + 3 };
+			icpMean(blk, 0.001f, d);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Halve A Level Into The Next One (Pool Job Body).
+//! \n
+//! \param[in]    ctx       icp_job_t, l = level to fill.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void icpDownJob(void *ctx, int32_t begin, int32_t end)
+{
+	icp_job_t *job = (icp_job_t *)ctx;
+	const icp_level_t *src = &job->icp->lvl[job->l - 1];
+	icp_level_t *dst = &job->icp->lvl[job->l];
+	int32_t cur = job->icp->cur;
+
+	for (int32_t v = begin; v < end; v++) {
+		const float *r0 = src->vtx[cur] + (size_t)(2 * v) * src->w * 3;
+		const float *r1 = r0 + (size_t)src->w * 3;
+		float *d = dst->vtx[cur] + (size_t)v * dst->w * 3;
+
+		for (int32_t u = 0; u < dst->w; u++, r0 += 6, r1 += 6, d += 3) {
+			const float *const blk[4] = { r0, r0 + 3, r1, r1 + 3 };
+			icpMean(blk, 1.0f, d);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Normals From Central Differences Of A Level (Pool Job Body).
+//! \n            Points On The Border, Next To A Hole Or On A Depth Edge Get None.
+//! \param[in]    ctx       icp_job_t, l = level.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void icpNormalJob(void *ctx, int32_t begin, int32_t end)
+{
+	icp_job_t *job = (icp_job_t *)ctx;
+	icp_level_t *lv = &job->icp->lvl[job->l];
+	int32_t cur = job->icp->cur;
+	int32_t w = lv->w;
+	size_t stride = (size_t)w * 3;
+
+	for (int32_t v = begin; v < end; v++) {
+		const float *p = lv->vtx[cur] + (size_t)v * stride;
+		float *n = lv->nrm[cur] + (size_t)v * stride;
+
+		memset(n, 0, sizeof(float) * stride);
+		if ((v == 0) || (v == lv->h - 1)) {
+			continue;
+		}
+
+		for (int32_t u = 1; u < w - 1; u++) {
+			const float *c = p + u * 3;
+			const float *l = c - 3;
+			const float *r = c + 3;
+			const float *t = c - stride;
+			const float *b = c + stride;
+			float z = c[2];
+
+			if ((z <= 0.0f) || (l[2] <= 0.0f) || (r[2] <= 0.0f) || (t[2] <= 0.0f) || (b[2] <= 0.0f) ||
+				!icpNear(z, l[2]) || !icpNear(z, r[2]) || !icpNear(z, t[2]) || !icpNear(z, b[2])) {
+				continue;
+			}
+
+			float dx[3] = { r[0] - l[0], r[1] - l[1], r[2] - l[2] };
+			float dy[3] = { b[0] - t[0], b[1] - t[1], b[2] - t[2] };
+			float nx = dx[1] * dy[2] - dx[2] * dy[1];
+			float ny = dx[2] * dy[0] - dx[0] * dy[2];
+			float nz = dx[0] * dy[1] - dx[1] * dy[0];
+			float len = sqrtf(nx * nx + ny * ny + nz * nz);
+
+			if (len <= 0.0f) {
+				continue;
+			}
+
+			//! \remark - Towards The Camera, Which Looks From The Origin At The Point.
+			float inv = ((nx * c[0] + ny * c[1] + nz * c[2]) > 0.0f) ? (-1.0f / len) : (1.0f / len);
+			n[u * 3 + 0] = nx * inv;
+			n[u * 3 + 1] = ny * inv;
+			n[u * 3 + 2] = nz * inv;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Add The Outer Products Of A Row Of Pairs To The Sums.
+//! \details      a[i] * a[j] For i <= j Over The 7 Entries Of Each Pair, 4 Pairs At A Time In
+//! \n            Float Lanes; The Lanes Are Added Into The Double Sums Once Per Row.
+//! \param[in]    a         ICP_PAIR_ROWS rows of n entries.
+//! \param[in]    stride    Distance between the rows.
+//! \param[in]    n         Pairs.
+//! \param[out]   sum       ICP_SUMS sums, added to.
+//! \return       None.
+//******************************************************************************
+static void icpAccumulate(const float *a, int32_t stride, int32_t n, double sum[ICP_SUMS])
+{
+	int32_t k = 0;
+	int32_t s;
+
+#if defined(__ARM_NEON)
+	float32x4_t acc[ICP_SUMS];
+	float lane[4];
+
+	for (s = 0; s < ICP_SUMS; s++) {
+		acc[s] = vdupq_n_f32(0.0f);
+	}
+	for (; k + 4 <= n; k += 4) {
+		float32x4_t x[ICP_PAIR_ROWS];
+
+		for (int i = 0; i < ICP_PAIR_ROWS; i++) {
+			x[i] = vld1q_f32(a + (size_t)i * stride + k);
+		}
+		s = 0;
+		for (int i = 0; i < ICP_PAIR_ROWS; i++) {
+			for (int j = i; j < ICP_PAIR_ROWS; j++) {
+				acc[s] = vmlaq_f32(acc[s], x[i], x[j]);
+				s++;
+			}
+		}
+	}
+	for (s = 0; s < ICP_SUMS; s++) {
+		vst1q_f32(lane, acc[s]);
+		sum[s] += (double)lane[0] + lane[1] + lane[2] + lane[3];
+	}
+#elif defined(__SSE2__)
+	__m128 acc[ICP_SUMS];
+	float lane[4];
+
+	for (s = 0; s < ICP_SUMS; s++) {
+		acc[s] = _mm_setzero_ps();
+	}
+	for (; k + 4 <= n; k += 4) {
+		__m128 x[ICP_PAIR_ROWS];
+
+		for (int i = 0; i < ICP_PAIR_ROWS; i++) {
+			x[i] = _mm_loadu_ps(a + (size_t)i * stride + k);
+		}
+		s = 0;
+		for (int i = 0; i < ICP_PAIR_ROWS; i++) {
+			for (int j = i; j < ICP_PAIR_ROWS; j++) {
+				acc[s] = _mm_add_ps(acc[s], _mm_mul_ps(x[i], x[j]));
+				s++;
+			}
+		}
+	}
+	for (s = 0; s < ICP_SUMS; s++) {
+		_mm_storeu_ps(lane, acc[s]);
+		sum[s] += (double)lane[0] + lane[1] + lane[2] + lane[3];
+	}
+#endif
+	for (; k < n; k++) {
+		s = 0;
+		for (int i = 0; i < ICP_PAIR_ROWS; i++) {
+			for (int j = i; j < ICP_PAIR_ROWS; j++) {
+				sum[s] += (double)a[(size_t)i * stride + k] * a[(size_t)j * stride + k];
+				s++;
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Pair The Points Of A Band With The Previous Frame And Sum Their Equations (Pool Job Body).
+//! \details      Projective Association: A Point, Moved By The Estimate, Is Projected Into The
+//! \n            Previous Frame's Grid And Paired With The Point There If Both Are Close And
+//! \n            Their Normals Agree. Residual e = n . (q - r), Jacobian [q x n, n] For A Small
+//! \n            Rotation And Translation Applied After The Estimate.
+//! \param[in]    ctx       icp_job_t, l = level.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void icpPairJob(void *ctx, int32_t begin, int32_t end)
+{
+	icp_job_t *job = (icp_job_t *)ctx;
+	icp_t *icp = job->icp;
+	const icp_level_t *lv = &icp->lvl[job->l];
+	const float *src = lv->vtx[icp->cur];
+	const float *src_n = lv->nrm[icp->cur];
+	const float *ref = lv->vtx[icp->cur ^ 1];
+	const float *ref_n = lv->nrm[icp->cur ^ 1];
+	const float *m = job->rt;
+	int32_t w = lv->w;
+	int32_t stride = icp->lvl[0].w; //!< Pair Rows Are Sized For Level 0.
+	float *pair = icp->pair + (size_t)(begin / ICP_BAND_ROWS) * ICP_PAIR_ROWS * stride;
+	double *band = icp->band + (size_t)(begin / ICP_BAND_ROWS) * ICP_BAND_SIZE;
+	int32_t step = (job->l == 0) ? ICP_SRC_STEP : 1;
+	double cnt = 0;
+
+	memset(band, 0, sizeof(double) * ICP_BAND_SIZE);
+
+	for (int32_t v = (begin + step - 1) / step * step; v < end; v += step) {
+		const float *p = src + (size_t)v * w * 3;
+		const float *pn = src_n + (size_t)v * w * 3;
+		int32_t k = 0;
+
+		for (int32_t u = 0; u < w; u += step, p += 3 * step, pn += 3 * step) {
+			if ((p[2] <= 0.0f) || ((pn[0] == 0.0f) && (pn[1] == 0.0f) && (pn[2] == 0.0f))) {
+				continue;
+			}
+
+			float qx = m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3];
+			float qy = m[4] * p[0] + m[5] * p[1] + m[6] * p[2] + m[7];
+			float qz = m[8] * p[0] + m[9] * p[1] + m[10] * p[2] + m[11];
+			if (qz <= 0.0f) {
+				continue;
+			}
+
+			float iz = 1.0f / qz;
+			float fu = lv->cam.fx * qx * iz + lv->cam.cx + 0.5f;
+			float fv = lv->cam.fy * qy * iz + lv->cam.cy + 0.5f;
+			if ((fu < 0.0f) || (fv < 0.0f) || (fu >= (float)w) || (fv >= (float)lv->h)) {
+				continue;
+			}
+
+			size_t idx = ((size_t)(int32_t)fv * w + (int32_t)fu) * 3;
+			const float *r = ref + idx;
+			const float *n = ref_n + idx;
+			if ((n[0] == 0.0f) && (n[1] == 0.0f) && (n[2] == 0.0f)) {
+				continue;
+			}
+
+			float dx = qx - r[0];
+			float dy = qy - r[1];
+			float dz = qz - r[2];
+			if (dx * dx + dy * dy + dz * dz > job->dist2) {
+				continue;
+			}
+
+			//! \remark - The Point's Own Normal, Rotated Like The Point, Must Face The Same Way.
+			float cn = n[0] * (m[0] * pn[0] + m[1] * pn[1] + m[2] * pn[2]) +
+					n[1] * (m[4] * pn[0] + m[5] * pn[1] + m[6] * pn[2]) +
+					n[2] * (m[8] * pn[0] + m[9] * pn[1] + m[10] * pn[2]);
+			if (cn < ICP_NORMAL_COS) {
+				continue;
+			}
+
+			pair[0 * stride + k] = qy * n[2] - qz * n[1];
+			pair[1 * stride + k] = qz * n[0] - qx * n[2];
+			pair[2 * stride + k] = qx * n[1] - qy * n[0];
+			pair[3 * stride + k] = n[0];
+			pair[4 * stride + k] = n[1];
+			pair[5 * stride + k] = n[2];
+			pair[6 * stride + k] = n[0] * dx + n[1] * dy + n[2] * dz;
+			k++;
+		}
+
+		icpAccumulate(pair, stride, k, band);
+		cnt += k;
+	}
+
+	band[ICP_SUMS] = cnt;
+}
+
+
+//******************************************************************************
+//! \brief        Solve The 6 x 6 Normal Equations A x = b By Cholesky Decomposition.
+//! \n
+//! \param[in]    a         Symmetric matrix, row major, overwritten.
+//! \param[in]    b         Right hand side.
+//! \param[out]   x         Solution.
+//! \return       0         success
+//! \return       -1        not positive definite (degenerate geometry)
+//******************************************************************************
+static int icpSolve(double a[36], const double b[6], double x[6])
+{
+	double y[6];
+
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j <= i; j++) {
+			double s = a[i * 6 + j];
+			for (int k = 0; k < j; k++) {
+				s -= a[i * 6 + k] * a[j * 6 + k];
+			}
+			if (i == j) {
+				if (s <= 1e-12) {
+					return -1;
+				}
+				a[i * 6 + i] = sqrt(s);
+			}
+			else {
+				a[i * 6 + j] = s / a[j * 6 + j];
+			}
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		double s = b[i];
+		for (int k = 0; k < i; k++) {
+			s -= a[i * 6 + k] * y[k];
+		}
+		y[i] = s / a[i * 6 + i];
+	}
+	for (int i = 5; i >= 0; i--) {
+		double s = y[i];
+		for (int k = i + 1; k < 6; k++) {
+			s -= a[k * 6 + i] * x[k];
+		}
+		x[i] = s / a[i * 6 + i];
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Compose Two Rigid Motions, out = a * b (b Applied First).
+//! \n
+//! \param[in]    a         3x4 row major.
+//! \param[in]    b         3x4 row major.
+//! \param[out]   out       3x4 row major, may not alias a or b.
+//! \return       None.
+//******************************************************************************
+static void icpCompose(const double a[12], const double b[12], double out[12])
+{
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			out[i * 4 + j] = a[i * 4 + 0] * b[0 * 4 + j] + a[i * 4 + 1] * b[1 * 4 + j] + a[i * 4 + 2] * b[2 * 4 + j];
+		}
+		out[i * 4 + 3] += a[i * 4 + 3];
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Rigid Motion Of A Rotation Vector And A Translation.
+//! \n
+//! \param[in]    x         Rotation vector (rad) and translation (m).
+//! \param[out]   out       3x4 row major.
+//! \return       None.
+//******************************************************************************
+static void icpExp(const double x[6], double out[12])
+{
+	double th = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	double k[3] = { 0.0, 0.0, 0.0 };
+	double c = cos(th);
+	double s = sin(th);
+
+	if (th > 1e-12) {
+		k[0] = x[0] / th;
+		k[1] = x[1] / th;
+		k[2] = x[2] / th;
+	}
+
+	//! \remark - Rodrigues: R = c I + s [k]x + (1 - c) k k^T.
+	out[0] = c + (1 - c) * k[0] * k[0];
+	out[1] = -s * k[2] + (1 - c) * k[0] * k[1];
+	out[2] = s * k[1] + (1 - c) * k[0] * k[2];
+	out[4] = s * k[2] + (1 - c) * k[1] * k[0];
+	out[5] = c + (1 - c) * k[1] * k[1];
+	out[6] = -s * k[0] + (1 - c) * k[1] * k[2];
+	out[8] = -s * k[1] + (1 - c) * k[2] * k[0];
+	out[9] = s * k[0] + (1 - c) * k[2] * k[1];
+	out[10] = c + (1 - c) * k[2] * k[2];
+	out[3] = x[3];
+	out[7] = x[4];
+	out[11] = x[5];
+}
+
+
+//******************************************************************************
+//! \brief        Identity Motion.
+//! \n
+//! \param[out]   out       3x4 row major.
+//! \return       None.
+//******************************************************************************
+static void icpIdentity(double out[12])
+{
+	memset(out, 0, sizeof(double) * 12);
+	out[0] = 1.0;
+	out[5] = 1.0;
+	out[10] = 1.0;
+}
+
+
+//******************************************************************************
+//! \brief        Unit Quaternion Of A Rotation Matrix.
+//! \n
+//! \param[in]    m         3x4 row major.
+//! \param[out]   q         x, y, z, w.
+//! \return       None.
+//******************************************************************************
+static void icpQuat(const double m[12], double q[4])
+{
+	double tr = m[0] + m[5] + m[10];
+
+	if (tr > 0) {
+		double s = sqrt(tr + 1.0) * 2;
+		q[3] = 0.25 * s;
+		q[0] = (m[9] - m[6]) / s;
+		q[1] = (m[2] - m[8]) / s;
+		q[2] = (m[4] - m[1]) / s;
+	}
+	else
+	if ((m[0] > m[5]) && (m[0] > m[10])) {
+		double s = sqrt(1.0 + m[0] - m[5] - m[10]) * 2;
+		q[3] = (m[9] - m[6]) / s;
+		q[0] = 0.25 * s;
+		q[1] = (m[1] + m[4]) / s;
+		q[2] = (m[2] + m[8]) / s;
+	}
+	else
+	if (m[5] > m[10]) {
+		double s = sqrt(1.0 + m[5] - m[0] - m[10]) * 2;
+		q[3] = (m[2] - m[8]) / s;
+		q[0] = (m[1] + m[4]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (m[6] + m[9]) / s;
+	}
+	else {
+		double s = sqrt(1.0 + m[10] - m[0] - m[5]) * 2;
+		q[3] = (m[4] - m[1]) / s;
+		q[0] = (m[2] + m[8]) / s;
+		q[1] = (m[6] + m[9]) / s;
+		q[2] = 0.25 * s;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Estimate The Motion Between The Newest And The Previous Frame.
+//! \details      Coarse To Fine: Each Level Refines The Estimate Of The Coarser One With A Few
+//! \n            Gauss-Newton Steps; The Pairs Are Searched Again For Every Step.
+//! \param[in]    icp       Odometry.
+//! \param[in,out] rt       Newest camera to previous camera, starts from the guess.
+//! \param[out]   pair_cnt  Pairs of the last step at level 0.
+//! \param[out]   iter      Steps taken over all levels.
+//! \return       0         success
+//! \return       -1        too few pairs or degenerate geometry
+//******************************************************************************
+static int icpAlign(icp_t *icp, double rt[12], double *pair_cnt, uint32_t *iter)
+{
+	icp_job_t job;
+
+	job.icp = icp;
+	*pair_cnt = 0;
+	*iter = 0;
+
+	for (int32_t l = ICP_LEVELS - 1; l >= 0; l--) {
+		const icp_level_t *lv = &icp->lvl[l];
+		int32_t band_num = (lv->h + ICP_BAND_ROWS - 1) / ICP_BAND_ROWS;
+
+		job.l = l;
+		job.dist2 = g_icp_dist[l] * g_icp_dist[l];
+
+		for (int32_t it = 0; it < g_icp_iter[l]; it++) {
+			double sum[ICP_BAND_SIZE] = { 0 };
+			double a[36];
+			double b[6];
+			double x[6];
+			double step[12];
+			double next[12];
+			int32_t s = 0;
+
+			for (int k = 0; k < 12; k++) {
+				job.rt[k] = (float)rt[k];
+			}
+			paraFor(icpPairJob, &job, lv->h, ICP_BAND_ROWS);
+			(*iter)++;
+
+			for (int32_t bnd = 0; bnd < band_num; bnd++) {
+				for (int k = 0; k < ICP_BAND_SIZE; k++) {
+					sum[k] += icp->band[(size_t)bnd * ICP_BAND_SIZE + k];
+				}
+			}
+			if (sum[ICP_SUMS] < 6) {
+				return -1;
+			}
+			*pair_cnt = sum[ICP_SUMS];
+
+			//! \remark - Unpack The Upper Triangle: Rows 0..5 Are J^T J And J^T e, Entry 6-6 Is e^T e.
+			for (int i = 0; i < 7; i++) {
+				for (int j = i; j < 7; j++) {
+					if (j < 6) {
+						a[i * 6 + j] = sum[s];
+						a[j * 6 + i] = sum[s];
+					}
+					else
+					if (i < 6) {
+						b[i] = -sum[s];
+					}
+					s++;
+				}
+			}
+			if (icpSolve(a, b, x) != 0) {
+				return -1;
+			}
+
+			icpExp(x, step);
+			icpCompose(step, rt, next);
+			memcpy(rt, next, sizeof(next));
+
+			if ((x[0] * x[0] + x[1] * x[1] + x[2] * x[2] < ICP_STEP_EPS * ICP_STEP_EPS) &&
+				(x[3] * x[3] + x[4] * x[4] + x[5] * x[5] < ICP_STEP_EPS * ICP_STEP_EPS)) {
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare Odometry For A Point Cloud Grid.
+//! \n
+//! \param[out]   icp       Odometry.
+//! \param[in]    w         Grid width.
+//! \param[in]    h         Grid height.
+//! \param[in]    cam       Intrinsics of the grid.
+//! \param[in]    enable    Run on every frame.
+//! \param[in]    path      File receiving the pose of every frame, NULL = none.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int icpInit(icp_t *icp, int32_t w, int32_t h, const cam_intr_t *cam, bool enable, const char *path)
+{
+	memset(icp, 0, sizeof(*icp));
+	pthread_mutex_init(&icp->lock, NULL);
+	icpIdentity(icp->pose);
+	icpIdentity(icp->delta);
+
+	if ((w <= 0) || (h <= 0) || (cam == NULL)) {
+		return -1;
+	}
+
+	icp->w = w;
+	icp->h = h;
+	icp->enable = enable;
+
+	if (!icp->enable) {
+		return 0;
+	}
+
+	//! \remark - Level 0 Is The Grid Halved, Its 2 x 2 Means Halve The Noise At A Quarter Of The Cost.
+	for (int32_t l = 0; l < ICP_LEVELS; l++) {
+		icp_level_t *lv = &icp->lvl[l];
+		size_t n;
+
+		lv->w = w >> (l + 1);
+		lv->h = h >> (l + 1);
+		lv->cam = camScale(cam, l + 1);
+		n = (size_t)lv->w * lv->h * 3;
+		for (int k = 0; k < 2; k++) {
+			lv->vtx[k] = (float *)calloc(n, sizeof(float));
+			lv->nrm[k] = (float *)calloc(n, sizeof(float));
+			if ((lv->vtx[k] == NULL) || (lv->nrm[k] == NULL)) {
+				icpTerm(icp);
+				return -1;
+			}
+		}
+	}
+
+	int32_t band_num = (icp->lvl[0].h + ICP_BAND_ROWS - 1) / ICP_BAND_ROWS;
+	icp->band = (double *)calloc((size_t)band_num * ICP_BAND_SIZE, sizeof(double));
+	icp->pair = (float *)calloc((size_t)band_num * ICP_PAIR_ROWS * icp->lvl[0].w, sizeof(float));
+	if ((icp->band == NULL) || (icp->pair == NULL)) {
+		icpTerm(icp);
+		return -1;
+	}
+
+	if (path != NULL) {
+		icp->fp = fopen(path, "w");
+		if (icp->fp == NULL) {
+			TL_LGE("icp: cannot open %s for writing", path);
+			icpTerm(icp);
+			return -1;
+		}
+		fprintf(icp->fp, "# capture_s tx ty tz qx qy qz qw (camera to first camera, m)\n");
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release Odometry And Close The Pose File.
+//! \n
+//! \param[in]    icp       Odometry.
+//! \return       None.
+//******************************************************************************
+void icpTerm(icp_t *icp)
+{
+	for (int32_t l = 0; l < ICP_LEVELS; l++) {
+		for (int k = 0; k < 2; k++) {
+			free(icp->lvl[l].vtx[k]);
+			free(icp->lvl[l].nrm[k]);
+			icp->lvl[l].vtx[k] = NULL;
+			icp->lvl[l].nrm[k] = NULL;
+		}
+	}
+	free(icp->band);
+	free(icp->pair);
+	icp->band = NULL;
+	icp->pair = NULL;
+
+	if (icp->fp != NULL) {
+		fclose(icp->fp);
+		icp->fp = NULL;
+	}
+	icp->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Track The Camera With A New Frame.
+//! \details      Builds The Pyramid And Normals Of The Frame, Aligns It To The Previous One
+//! \n            Starting From The Previous Motion, And Chains The Result Onto The Pose. When
+//! \n            Alignment Fails The Pose Is Kept And Tracking Restarts From This Frame.
+//! \param[in]    icp       Odometry.
+//! \param[in]    xyz       Organized point cloud (w x h, x/y/z in mm, z <= 0 invalid).
+//! \param[in]    meta      Capture record of the frame, time stamp of the pose.
+//! \return       0         success, icp->pose and icp->delta are set
+//! \return       -1        disabled, first frame or no alignment
+//******************************************************************************
+int icpTrack(icp_t *icp, const int16_t *xyz, const frame_meta_t *meta)
+{
+	uint64_t t0 = getMonoNs();
+	icp_job_t job;
+	double rt[12];
+	double pose[12];
+	double pair_cnt = 0;
+	double valid = 0;
+	uint32_t iter = 0;
+	bool first = !icp->has_ref;
+	int ret = -1;
+
+	if (!icp->enable || (xyz == NULL)) {
+		return -1;
+	}
+
+	job.icp = icp;
+	job.xyz = xyz;
+	job.l = 0;
+	paraFor(icpConvJob, &job, icp->lvl[0].h, ICP_BAND_ROWS);
+	for (int32_t l = 1; l < ICP_LEVELS; l++) {
+		job.l = l;
+		paraFor(icpDownJob, &job, icp->lvl[l].h, ICP_BAND_ROWS);
+	}
+	for (int32_t l = 0; l < ICP_LEVELS; l++) {
+		job.l = l;
+		paraFor(icpNormalJob, &job, icp->lvl[l].h, ICP_BAND_ROWS);
+	}
+
+	if (icp->has_ref) {
+		const icp_level_t *lv = &icp->lvl[0];
+
+		//! \remark - Only The Points The Pairing Visits.
+		for (int32_t v = 0; v < lv->h; v += ICP_SRC_STEP) {
+			const float *n = lv->nrm[icp->cur] + (size_t)v * lv->w * 3;
+
+			for (int32_t u = 0; u < lv->w; u += ICP_SRC_STEP, n += 3 * ICP_SRC_STEP) {
+				valid += ((n[0] != 0.0f) || (n[1] != 0.0f) || (n[2] != 0.0f)) ? 1 : 0;
+			}
+		}
+
+		//! \remark - Constant Motion Guess After A Tracked Frame, Else Standing Still.
+		if (icp->tracked) {
+			memcpy(rt, icp->delta, sizeof(rt));
+		}
+		else {
+			icpIdentity(rt);
+		}
+
+		if ((icpAlign(icp, rt, &pair_cnt, &iter) == 0) && (pair_cnt >= ICP_PAIR_MIN * valid)) {
+			icpCompose(icp->pose, rt, pose);
+			pthread_mutex_lock(&icp->lock);
+			memcpy(icp->pose, pose, sizeof(pose));
+			pthread_mutex_unlock(&icp->lock);
+			memcpy(icp->delta, rt, sizeof(rt));
+			ret = 0;
+		}
+		else {
+			icpIdentity(icp->delta);
+		}
+	}
+	icp->tracked = (ret == 0);
+	icp->has_ref = true;
+	icp->cur ^= 1;
+
+	if (icp->fp != NULL) {
+		double q[4];
+
+		icpQuat(icp->pose, q);
+		fprintf(icp->fp, "%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n", (double)meta->cap_ns * 1e-9,
+				icp->pose[3], icp->pose[7], icp->pose[11], q[0], q[1], q[2], q[3]);
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&icp->lock);
+	icp->frames++;
+	icp->lost += ((ret == 0) || first) ? 0 : 1;
+	icp->iter_sum += iter;
+	icp->pair_sum += (valid > 0) ? (pair_cnt / valid) : 0.0;
+	icp->step_sum += 1000.0 * sqrt(icp->delta[3] * icp->delta[3] + icp->delta[7] * icp->delta[7] + icp->delta[11] * icp->delta[11]);
+	icp->ms_sum += ms;
+	if (ms > icp->ms_max) {
+		icp->ms_max = ms;
+	}
+	pthread_mutex_unlock(&icp->lock);
+
+	return ret;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Pose, Tracking Quality And Timing Since The Last Report.
+//! \n
+//! \param[in]    icp       Odometry.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void icpReport(icp_t *icp, const char *name)
+{
+	if (!icp->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&icp->lock);
+
+	if (icp->frames > 0) {
+		const double *m = icp->pose;
+		double c = (m[0] + m[5] + m[10] - 1.0) * 0.5;
+		double deg = acos((c > 1.0) ? 1.0 : ((c < -1.0) ? -1.0 : c)) * 180.0 / M_PI;
+
+		printf("icp %s: pose t=(%.0f, %.0f, %.0f) mm rot=%.1f deg step mean=%.1f mm pairs=%.0f%% iter=%.1f lost=%u time mean=%.2f ms max=%.2f ms\n",
+				name, m[3] * 1000.0, m[7] * 1000.0, m[11] * 1000.0, deg,
+				icp->step_sum / icp->frames, 100.0 * icp->pair_sum / icp->frames,
+				(double)icp->iter_sum / icp->frames, icp->lost, icp->ms_sum / icp->frames, icp->ms_max);
+	}
+
+	icp->frames = 0;
+	icp->lost = 0;
+	icp->iter_sum = 0;
+	icp->pair_sum = 0;
+	icp->step_sum = 0;
+	icp->ms_sum = 0;
+	icp->ms_max = 0;
+
+	pthread_mutex_unlock(&icp->lock);
+}
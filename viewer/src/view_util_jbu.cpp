@@ -0,0 +1,402 @@
+//******************************************************************************
+//! \file       view_util_jbu.cpp
+//! \brief      Joint Bilateral 2x Upsampling Of Depth, Guided By The Full Resolution IR.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_jbu.h"
+#include "view_util_para.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define JBU_ROW_GRAIN       (8)     //!< Depth Rows Per Band, 16 Output Rows.
+
+//! Job Context.
+typedef struct _jbu_job_t {
+	jbu_t *jbu;
+	const uint16_t *depth;  //!< (w / 2) x (h / 2) Depth In mm.
+	const uint16_t *ir;     //!< w x h IR.
+	uint16_t *out;          //!< w x h Depth In mm.
+} jbu_job_t;
+
+
+//******************************************************************************
+//! \brief        One Output Pixel Over The 3 x 3 Taps Around Its Nearest Depth Pixel.
+//! \details      Each Tap Weighs Its Spatial Weight Times The Range Weight Of The IR Difference
+//! \n            Between The Output Pixel And The Tap; Invalid Taps Weigh 0. Same Arithmetic As
+//! \n            The Vector Code, So Both Give The Same Depth.
+//! \param[in]    jbu       Upsampler.
+//! \param[in]    d         Depth rows above, at and below the nearest pixel.
+//! \param[in]    g         Guide rows likewise.
+//! \param[in]    col       Columns left of, at and right of the nearest pixel.
+//! \param[in]    ip        IR of the output pixel.
+//! \param[in]    ws        Spatial weights of the output phase.
+//! \return       Depth in mm, 0 = invalid.
+//******************************************************************************
+static inline uint16_t jbuPix(const jbu_t *jbu, const uint16_t *const d[3], const uint16_t *const g[3],
+		const int32_t col[3], uint32_t ip, const uint16_t *ws)
+{
+	uint32_t wsum = 0;
+	uint32_t dsum = 0;
+
+	for (int32_t j = 0; j < 3; j++) {
+		for (int32_t i = 0; i < 3; i++) {
+			uint32_t dv = d[j][col[i]];
+			uint32_t gv = g[j][col[i]];
+			uint32_t idx = ((ip > gv) ? (ip - gv) : (gv - ip)) >> jbu->shift;
+			uint32_t w = (jbu->lut[(idx < JBU_LUT_SIZE - 1) ? idx : (JBU_LUT_SIZE - 1)] * ws[j * 3 + i]) >> 8;
+
+			w = (dv != 0) ? w : 0;
+			wsum += w;
+			dsum += dv * w;
+		}
+	}
+
+	if (wsum < JBU_MIN_WT) {
+		return 0;
+	}
+	return (uint16_t)((float)dsum / (float)wsum + 0.5f);
+}
+
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+//******************************************************************************
+//! \brief        8 Outputs Of One Phase, Range Weights By A 64 Entry Table Lookup (AArch64 Only).
+//******************************************************************************
+static inline uint16x8_t jbuPhase8(const jbu_t *jbu, const uint8x16x4_t *tbl, const uint16x8_t d[JBU_TAPS],
+		const uint16x8_t g[JBU_TAPS], uint16x8_t ip, const uint16_t *ws)
+{
+	const int16x8_t sh = vdupq_n_s16((int16_t)-jbu->shift);
+	const uint16x8_t top = vdupq_n_u16(JBU_LUT_SIZE - 1);
+	uint16x8_t wsum = vdupq_n_u16(0);
+	uint32x4_t acc0 = vdupq_n_u32(0);
+	uint32x4_t acc1 = vdupq_n_u32(0);
+
+	for (int32_t k = 0; k < JBU_TAPS; k++) {
+		uint16x8_t idx = vminq_u16(vshlq_u16(vabdq_u16(ip, g[k]), sh), top);
+		uint16x8_t wr = vmovl_u8(vqtbl4_u8(*tbl, vmovn_u16(idx)));
+		uint16x8_t w = vandq_u16(vshrq_n_u16(vmulq_n_u16(wr, ws[k]), 8), vtstq_u16(d[k], d[k]));
+
+		wsum = vaddq_u16(wsum, w);
+		acc0 = vmlal_u16(acc0, vget_low_u16(d[k]), vget_low_u16(w));
+		acc1 = vmlal_u16(acc1, vget_high_u16(d[k]), vget_high_u16(w));
+	}
+
+	float32x4_t f0 = vdivq_f32(vcvtq_f32_u32(acc0), vcvtq_f32_u32(vmovl_u16(vget_low_u16(wsum))));
+	float32x4_t f1 = vdivq_f32(vcvtq_f32_u32(acc1), vcvtq_f32_u32(vmovl_u16(vget_high_u16(wsum))));
+	uint32x4_t r0 = vcvtq_u32_f32(vaddq_f32(f0, vdupq_n_f32(0.5f)));
+	uint32x4_t r1 = vcvtq_u32_f32(vaddq_f32(f1, vdupq_n_f32(0.5f)));
+
+	return vbicq_u16(vcombine_u16(vmovn_u32(r0), vmovn_u32(r1)), vcltq_u16(wsum, vdupq_n_u16(JBU_MIN_WT)));
+}
+#elif defined(__SSE2__)
+//******************************************************************************
+//! \brief        8 Outputs Of One Phase, The Range Weights Are Gathered From The Table Per Lane.
+//******************************************************************************
+static inline __m128i jbuPhase8(const jbu_t *jbu, const __m128i d[JBU_TAPS], const __m128i g[JBU_TAPS],
+		__m128i ip, const uint16_t *ws)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i top = _mm_set1_epi16(JBU_LUT_SIZE - 1);
+	const __m128i sh = _mm_cvtsi32_si128(jbu->shift);
+	const uint8_t *lut = jbu->lut;
+	__m128i wsum = zero;
+	__m128i acc0 = zero;
+	__m128i acc1 = zero;
+
+	for (int32_t k = 0; k < JBU_TAPS; k++) {
+		__m128i idx = _mm_srl_epi16(_mm_or_si128(_mm_subs_epu16(ip, g[k]), _mm_subs_epu16(g[k], ip)), sh);
+		idx = _mm_sub_epi16(idx, _mm_subs_epu16(idx, top));    // min(idx, top)
+		__m128i wr = _mm_setr_epi16(lut[_mm_extract_epi16(idx, 0)], lut[_mm_extract_epi16(idx, 1)],
+				lut[_mm_extract_epi16(idx, 2)], lut[_mm_extract_epi16(idx, 3)],
+				lut[_mm_extract_epi16(idx, 4)], lut[_mm_extract_epi16(idx, 5)],
+				lut[_mm_extract_epi16(idx, 6)], lut[_mm_extract_epi16(idx, 7)]);
+		__m128i w = _mm_srli_epi16(_mm_mullo_epi16(wr, _mm_set1_epi16((short)ws[k])), 8);
+		w = _mm_andnot_si128(_mm_cmpeq_epi16(d[k], zero), w);
+
+		__m128i lo = _mm_mullo_epi16(d[k], w);
+		__m128i hi = _mm_mulhi_epu16(d[k], w);
+		wsum = _mm_add_epi16(wsum, w);
+		acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(lo, hi));
+		acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(lo, hi));
+	}
+
+	__m128 f0 = _mm_div_ps(_mm_cvtepi32_ps(acc0), _mm_cvtepi32_ps(_mm_unpacklo_epi16(wsum, zero)));
+	__m128 f1 = _mm_div_ps(_mm_cvtepi32_ps(acc1), _mm_cvtepi32_ps(_mm_unpackhi_epi16(wsum, zero)));
+	__m128i r0 = _mm_cvttps_epi32(_mm_add_ps(f0, _mm_set1_ps(0.5f)));
+	__m128i r1 = _mm_cvttps_epi32(_mm_add_ps(f1, _mm_set1_ps(0.5f)));
+
+	//! \remark - Biased To Signed, So The Signed Pack Keeps Depths Above 32767.
+	const __m128i b32 = _mm_set1_epi32(0x8000);
+	__m128i res = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(r0, b32), _mm_sub_epi32(r1, b32)), _mm_set1_epi16((short)0x8000));
+
+	return _mm_andnot_si128(_mm_cmplt_epi16(wsum, _mm_set1_epi16(JBU_MIN_WT)), res);
+}
+#endif
+
+
+//******************************************************************************
+//! \brief        Reduce The IR To The Depth Grid By The Mean Of Each 2 x 2 Block (Pool Job Body).
+//! \n
+//! \param[in]    ctx       jbu_job_t.
+//! \param[in]    begin     First depth row.
+//! \param[in]    end       Depth row after the last one.
+//! \return       None.
+//******************************************************************************
+static void jbuGuideJob(void *ctx, int32_t begin, int32_t end)
+{
+	jbu_job_t *job = (jbu_job_t *)ctx;
+	jbu_t *jbu = job->jbu;
+	int32_t sw = jbu->w / 2;
+
+	for (int32_t v = begin; v < end; v++) {
+		const uint16_t *r0 = job->ir + (size_t)(2 * v) * jbu->w;
+		const uint16_t *r1 = r0 + jbu->w;
+		uint16_t *dst = jbu->guide + (size_t)v * sw;
+		int32_t u = 0;
+
+#if defined(__ARM_NEON)
+		for (; u + 8 <= sw; u += 8) {
+			uint16x8x2_t a = vld2q_u16(r0 + 2 * u);
+			uint16x8x2_t b = vld2q_u16(r1 + 2 * u);
+
+			vst1q_u16(dst + u, vrhaddq_u16(vrhaddq_u16(a.val[0], b.val[0]), vrhaddq_u16(a.val[1], b.val[1])));
+		}
+#elif defined(__SSE2__)
+		for (; u + 8 <= sw; u += 8) {
+			__m128i a0 = _mm_avg_epu16(_mm_loadu_si128((const __m128i *)(r0 + 2 * u)), _mm_loadu_si128((const __m128i *)(r1 + 2 * u)));
+			__m128i a1 = _mm_avg_epu16(_mm_loadu_si128((const __m128i *)(r0 + 2 * u + 8)), _mm_loadu_si128((const __m128i *)(r1 + 2 * u + 8)));
+
+			//! \remark - Sign Extended Halves Pack Back Bit Exact.
+			__m128i ev = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(a1, 16), 16));
+			__m128i od = _mm_packs_epi32(_mm_srai_epi32(a0, 16), _mm_srai_epi32(a1, 16));
+			_mm_storeu_si128((__m128i *)(dst + u), _mm_avg_epu16(ev, od));
+		}
+#endif
+
+		for (; u < sw; u++) {
+			uint32_t e = (r0[2 * u] + r1[2 * u] + 1) >> 1;
+			uint32_t o = (r0[2 * u + 1] + r1[2 * u + 1] + 1) >> 1;
+
+			dst[u] = (uint16_t)((e + o + 1) >> 1);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Upsample A Band Of Depth Rows (Pool Job Body).
+//! \details      Depth Row v Gives Output Rows 2v And 2v + 1. The 3 x 3 Taps Of 8 Neighbouring Depth
+//! \n            Pixels Are Loaded Once And Shared By Their 4 x 8 Outputs; The Border Columns Run Scalar.
+//! \param[in]    ctx       jbu_job_t.
+//! \param[in]    begin     First depth row.
+//! \param[in]    end       Depth row after the last one.
+//! \return       None.
+//******************************************************************************
+static void jbuJob(void *ctx, int32_t begin, int32_t end)
+{
+	jbu_job_t *job = (jbu_job_t *)ctx;
+	jbu_t *jbu = job->jbu;
+	int32_t w = jbu->w;
+	int32_t sw = w / 2;
+	int32_t sh = jbu->h / 2;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+	uint8x16x4_t tbl;
+	tbl.val[0] = vld1q_u8(jbu->lut);
+	tbl.val[1] = vld1q_u8(jbu->lut + 16);
+	tbl.val[2] = vld1q_u8(jbu->lut + 32);
+	tbl.val[3] = vld1q_u8(jbu->lut + 48);
+#endif
+
+	for (int32_t v = begin; v < end; v++) {
+		int32_t vu = (v > 0) ? (v - 1) : v;
+		int32_t vd = (v < sh - 1) ? (v + 1) : v;
+		const uint16_t *d[3] = { job->depth + (size_t)vu * sw, job->depth + (size_t)v * sw, job->depth + (size_t)vd * sw };
+		const uint16_t *g[3] = { jbu->guide + (size_t)vu * sw, jbu->guide + (size_t)v * sw, jbu->guide + (size_t)vd * sw };
+		const uint16_t *ir[2] = { job->ir + (size_t)(2 * v) * w, job->ir + (size_t)(2 * v + 1) * w };
+		uint16_t *out[2] = { job->out + (size_t)(2 * v) * w, job->out + (size_t)(2 * v + 1) * w };
+		int32_t u = 0;
+
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(__SSE2__)
+		//! \remark - Column 0 Has No Left Neighbour, The Vector Loop Starts At 1.
+		for (int32_t dy = 0; dy < 2; dy++) {
+			const int32_t col[3] = { 0, 0, (sw > 1) ? 1 : 0 };
+
+			out[dy][0] = jbuPix(jbu, d, g, col, ir[dy][0], jbu->ws[dy * 2]);
+			out[dy][1] = jbuPix(jbu, d, g, col, ir[dy][1], jbu->ws[dy * 2 + 1]);
+		}
+		u = 1;
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+		for (; u + 9 <= sw; u += 8) {
+			uint16x8_t dv[JBU_TAPS];
+			uint16x8_t gv[JBU_TAPS];
+
+			for (int32_t k = 0; k < JBU_TAPS; k++) {
+				dv[k] = vld1q_u16(d[k / 3] + u + (k % 3) - 1);
+				gv[k] = vld1q_u16(g[k / 3] + u + (k % 3) - 1);
+			}
+			for (int32_t dy = 0; dy < 2; dy++) {
+				uint16x8x2_t ip = vld2q_u16(ir[dy] + 2 * u);
+				uint16x8x2_t res;
+
+				res.val[0] = jbuPhase8(jbu, &tbl, dv, gv, ip.val[0], jbu->ws[dy * 2]);
+				res.val[1] = jbuPhase8(jbu, &tbl, dv, gv, ip.val[1], jbu->ws[dy * 2 + 1]);
+				vst2q_u16(out[dy] + 2 * u, res);
+			}
+		}
+#elif defined(__SSE2__)
+		for (; u + 9 <= sw; u += 8) {
+			__m128i dv[JBU_TAPS];
+			__m128i gv[JBU_TAPS];
+
+			for (int32_t k = 0; k < JBU_TAPS; k++) {
+				dv[k] = _mm_loadu_si128((const __m128i *)(d[k / 3] + u + (k % 3) - 1));
+				gv[k] = _mm_loadu_si128((const __m128i *)(g[k / 3] + u + (k % 3) - 1));
+			}
+			for (int32_t dy = 0; dy < 2; dy++) {
+				__m128i x0 = _mm_loadu_si128((const __m128i *)(ir[dy] + 2 * u));
+				__m128i x1 = _mm_loadu_si128((const __m128i *)(ir[dy] + 2 * u + 8));
+				__m128i ev = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(x0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(x1, 16), 16));
+				__m128i od = _mm_packs_epi32(_mm_srai_epi32(x0, 16), _mm_srai_epi32(x1, 16));
+				__m128i re = jbuPhase8(jbu, dv, gv, ev, jbu->ws[dy * 2]);
+				__m128i ro = jbuPhase8(jbu, dv, gv, od, jbu->ws[dy * 2 + 1]);
+
+				_mm_storeu_si128((__m128i *)(out[dy] + 2 * u), _mm_unpacklo_epi16(re, ro));
+				_mm_storeu_si128((__m128i *)(out[dy] + 2 * u + 8), _mm_unpackhi_epi16(re, ro));
+			}
+		}
+#endif
+
+		for (; u < sw; u++) {
+			const int32_t col[3] = { (u > 0) ? (u - 1) : u, u, (u < sw - 1) ? (u + 1) : u };
+
+			for (int32_t dy = 0; dy < 2; dy++) {
+				out[dy][2 * u] = jbuPix(jbu, d, g, col, ir[dy][2 * u], jbu->ws[dy * 2]);
+				out[dy][2 * u + 1] = jbuPix(jbu, d, g, col, ir[dy][2 * u + 1], jbu->ws[dy * 2 + 1]);
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Prepare An Upsampler And Precompute Its Weights.
+//! \details      Output Pixel 2u + dx Lies 1/4 Depth Pixel Left (dx = 0) Or Right (dx = 1) Of Depth
+//! \n            Pixel u, Likewise In y, So Each Of The 4 Phases Has Its Own Gaussian Tap Weights.
+//! \n            The Range Table Spans 3 Sigma Of IR Difference.
+//! \param[out]   jbu       Upsampler.
+//! \param[in]    w         Output (IR) width, even.
+//! \param[in]    h         Output (IR) height, even.
+//! \param[in]    sigma_ir  Range sigma in IR units, 0 = off, at most JBU_SIGMA_MAX.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int jbuInit(jbu_t *jbu, int32_t w, int32_t h, float sigma_ir)
+{
+	memset(jbu, 0, sizeof(*jbu));
+
+	if (sigma_ir <= 0) {
+		return 0;
+	}
+	if ((w < 4) || (h < 4) || ((w & 1) != 0) || ((h & 1) != 0) || !(sigma_ir <= JBU_SIGMA_MAX)) {
+		return -1;  //! Also NaN; Larger Sigmas Would Shift The Table Index Out Of Range.
+	}
+
+	jbu->w = w;
+	jbu->h = h;
+	jbu->guide = (uint16_t *)calloc((size_t)(w / 2) * (h / 2), sizeof(uint16_t));
+	if (jbu->guide == NULL) {
+		return -1;
+	}
+
+	for (int32_t p = 0; p < 4; p++) {
+		double ox = (p & 1) ? 0.25 : -0.25;
+		double oy = (p & 2) ? 0.25 : -0.25;
+		double nearest = exp(-(ox * ox + oy * oy) / (2.0 * JBU_SIGMA_S * JBU_SIGMA_S));
+
+		for (int32_t k = 0; k < JBU_TAPS; k++) {
+			double dx = (k % 3) - 1 - ox;
+			double dy = (k / 3) - 1 - oy;
+
+			jbu->ws[p][k] = (uint16_t)lround(255.0 * exp(-(dx * dx + dy * dy) / (2.0 * JBU_SIGMA_S * JBU_SIGMA_S)) / nearest);
+		}
+	}
+
+	while (((JBU_LUT_SIZE - 1) << jbu->shift) < 3.0f * sigma_ir) {
+		jbu->shift++;
+	}
+	for (int32_t i = 0; i < JBU_LUT_SIZE - 1; i++) {
+		double di = (double)(i << jbu->shift);
+
+		jbu->lut[i] = (uint8_t)lround(255.0 * exp(-di * di / (2.0 * sigma_ir * sigma_ir)));
+	}
+	jbu->lut[JBU_LUT_SIZE - 1] = 0;
+
+	jbu->enable = true;
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release An Upsampler.
+//! \n
+//! \param[in]    jbu       Upsampler.
+//! \return       None.
+//******************************************************************************
+void jbuTerm(jbu_t *jbu)
+{
+	free(jbu->guide);
+	jbu->guide = NULL;
+	jbu->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Upsample A Depth Image 2x Guided By The IR, Bands Of Rows Run On The Worker Pool.
+//! \n
+//! \param[in]    jbu       Upsampler.
+//! \param[in]    depth     (w / 2) x (h / 2) depth in mm, 0 = invalid.
+//! \param[in]    ir        w x h IR of the same frame.
+//! \param[out]   out       w x h depth in mm, 0 = invalid.
+//! \return       0         success
+//! \return       -1        off
+//******************************************************************************
+int jbuApply(jbu_t *jbu, const uint16_t *depth, const uint16_t *ir, uint16_t *out)
+{
+	jbu_job_t job;
+
+	if (!jbu->enable || (depth == NULL) || (ir == NULL) || (out == NULL)) {
+		return -1;
+	}
+
+	job.jbu = jbu;
+	job.depth = depth;
+	job.ir = ir;
+	job.out = out;
+	paraFor(jbuGuideJob, &job, jbu->h / 2, JBU_ROW_GRAIN);
+	paraFor(jbuJob, &job, jbu->h / 2, JBU_ROW_GRAIN);
+
+	return 0;
+}
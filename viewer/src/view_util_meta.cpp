@@ -0,0 +1,92 @@
+//******************************************************************************
+//! \file       view_util_meta.cpp
+//! \brief      Latency From Capture To A Consumer, Measured With The Frame's Capture Record.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+
+#include "view_util_meta.h"
+
+
+//******************************************************************************
+//! \brief        Prepare Latency Statistics.
+//! \n
+//! \param[out]   lat       Statistics.
+//! \return       None.
+//******************************************************************************
+void latencyInit(latency_t *lat)
+{
+	pthread_mutex_init(&lat->lock, NULL);
+	lat->cnt = 0;
+	lat->ms_sum = 0;
+	lat->ms_max = 0;
+	lat->gaps = 0;
+	lat->last_seq = META_SEQ_NONE;
+}
+
+
+//******************************************************************************
+//! \brief        Record One Frame Reaching The Consumer.
+//! \details      Frames Missing Between Two Sequence Numbers Were Replaced Or Dropped On The
+//! \n            Way, Those Lost By The Driver Are Counted Through drop_gap.
+//! \param[in]    lat       Statistics.
+//! \param[in]    meta      Capture record of the frame.
+//! \param[in]    ns        CLOCK_MONOTONIC time the consumer is done with it in nano sec.
+//! \return       None.
+//******************************************************************************
+void latencyAdd(latency_t *lat, const frame_meta_t *meta, uint64_t ns)
+{
+	double ms = (ns > meta->cap_ns) ? (double)(ns - meta->cap_ns) * 1e-6 : 0.0;
+
+	pthread_mutex_lock(&lat->lock);
+
+	//! \remark - Images Of Several Kinds Share One Sequence Number, Only A Newer One Counts The Gap.
+	if ((lat->last_seq == META_SEQ_NONE) || ((int32_t)(meta->seq - lat->last_seq) > 0)) {
+		if (lat->last_seq != META_SEQ_NONE) {
+			lat->gaps += meta->seq - lat->last_seq - 1;
+		}
+		lat->gaps += meta->drop_gap;
+		lat->last_seq = meta->seq;
+	}
+
+	lat->cnt++;
+	lat->ms_sum += ms;
+	if (ms > lat->ms_max) {
+		lat->ms_max = ms;
+	}
+
+	pthread_mutex_unlock(&lat->lock);
+}
+
+
+//******************************************************************************
+//! \brief        Print Latency Mean/Max And Missed Frames Since The Last Report.
+//! \n
+//! \param[in]    lat       Statistics.
+//! \param[in]    name      Name of the consumer.
+//! \return       None.
+//******************************************************************************
+void latencyReport(latency_t *lat, const char *name)
+{
+	pthread_mutex_lock(&lat->lock);
+
+	if (lat->cnt > 0) {
+		printf("latency %s: n=%u capture to done mean=%.2f ms max=%.2f ms missed=%u\n",
+				name, lat->cnt, lat->ms_sum / lat->cnt, lat->ms_max, lat->gaps);
+	}
+
+	//! \remark Keep last_seq So Gaps Across The Report Are Counted.
+	lat->cnt = 0;
+	lat->ms_sum = 0;
+	lat->ms_max = 0;
+	lat->gaps = 0;
+
+	pthread_mutex_unlock(&lat->lock);
+}
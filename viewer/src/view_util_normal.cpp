@@ -0,0 +1,371 @@
+//******************************************************************************
+//! \file       view_util_normal.cpp
+//! \brief      Normal Estimation On The Organized Point Cloud Using Integral Images.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "view_util_normal.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define NORMAL_CH           (4)     //!< Integral Channels: x, y, z, Valid Count.
+#define NORMAL_ROW_GRAIN    (16)    //!< Rows Per Pool Block.
+#define NORMAL_COL_GRAIN    (64)    //!< Columns Per Pool Block Of The Vertical Pass.
+#define NORMAL_MAX_H        (2048)  //!< Largest Supported Grid Height.
+
+//! Job Context.
+typedef struct _normal_job_t {
+	normal_est_t *est;
+	const int16_t *xyz;
+	int32_t valid[NORMAL_MAX_H / NORMAL_ROW_GRAIN];  //!< Normals Found Per Row Block.
+} normal_job_t;
+
+
+//******************************************************************************
+//! \brief        Horizontal Prefix Sums Of A Band Of Rows (Pool Job Body).
+//! \details      Sums Wrap Modulo 2^32; Differences Of Window Corners Are Still Exact
+//! \n            Because A Window Sum Itself Fits In 32 Bits (See NORMAL_RADIUS_MAX).
+//! \param[in]    ctx       normal_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void normalRowJob(void *ctx, int32_t begin, int32_t end)
+{
+	normal_job_t *job = (normal_job_t *)ctx;
+	int32_t w = job->est->w;
+	size_t stride = (size_t)(w + 1) * NORMAL_CH;
+
+	for (int32_t v = begin; v < end; v++) {
+		const int16_t *p = job->xyz + (size_t)v * w * 3;
+		uint32_t *dst = job->est->integ + (size_t)(v + 1) * stride;
+		uint32_t sx = 0;
+		uint32_t sy = 0;
+		uint32_t sz = 0;
+		uint32_t sc = 0;
+
+		dst[0] = dst[1] = dst[2] = dst[3] = 0;
+		dst += NORMAL_CH;
+
+		for (int32_t u = 0; u < w; u++, p += 3, dst += NORMAL_CH) {
+			if (p[2] > 0) {
+				sx += (uint32_t)(int32_t)p[0];
+				sy += (uint32_t)(int32_t)p[1];
+				sz += (uint32_t)(int32_t)p[2];
+				sc++;
+			}
+			dst[0] = sx;
+			dst[1] = sy;
+			dst[2] = sz;
+			dst[3] = sc;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Vertical Prefix Sums Of A Band Of Columns (Pool Job Body).
+//! \n
+//! \param[in]    ctx       normal_job_t.
+//! \param[in]    begin     First column (integral image column, times channels).
+//! \param[in]    end       Column after the last one.
+//! \return       None.
+//******************************************************************************
+static void normalColJob(void *ctx, int32_t begin, int32_t end)
+{
+	normal_job_t *job = (normal_job_t *)ctx;
+	size_t stride = (size_t)(job->est->w + 1) * NORMAL_CH;
+	uint32_t *row = job->est->integ + stride;
+
+	//! \remark - Row By Row Over A Narrow Band, So Both Rows Stay In Cache And The Loop Vectorizes.
+	for (int32_t v = 1; v < job->est->h; v++) {
+		uint32_t *cur = row + stride;
+		for (int32_t i = begin; i < end; i++) {
+			cur[i] += row[i];
+		}
+		row = cur;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Tangent Between Two Windows, Scaled By Both Valid Counts.
+//! \details      (sb * na - sa * nb) = na * nb * (mean b - mean a); The Scale Does Not Change
+//! \n            The Normal Direction, So No Division Is Needed. Exact In 64 Bits.
+//! \param[in]    sa        Sums x/y/z/count of window a.
+//! \param[in]    sb        Sums x/y/z/count of window b.
+//! \param[out]   t         Scaled tangent.
+//! \return       None.
+//******************************************************************************
+static inline void normalTangent(const int32_t sa[NORMAL_CH], const int32_t sb[NORMAL_CH], float t[3])
+{
+	for (int k = 0; k < 3; k++) {
+		t[k] = (float)((int64_t)sb[k] * sa[3] - (int64_t)sa[k] * sb[3]);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Round A Normal Component To int8 (lrintf() Is A Library Call Without -ffast-math).
+//! \n
+//! \param[in]    val       Component * 127.
+//! \return       Rounded Component.
+//******************************************************************************
+static inline int8_t normalQuant(float val)
+{
+	return (int8_t)(int32_t)(val + ((val >= 0.f) ? 0.5f : -0.5f));
+}
+
+
+//******************************************************************************
+//! \brief        Normals Of A Band Of Rows From The Average 3D Gradient (Pool Job Body).
+//! \details      The Mean Point Right Of The Pixel Minus The Mean Point Left Of It Gives
+//! \n            The Horizontal Tangent, Below Minus Above The Vertical One. Each Window
+//! \n            Sum Is Four Integral Image Corners, Whatever The Window Size.
+//! \param[in]    ctx       normal_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void normalPixelJob(void *ctx, int32_t begin, int32_t end)
+{
+	normal_job_t *job = (normal_job_t *)ctx;
+	normal_est_t *est = job->est;
+	int32_t w = est->w;
+	int32_t h = est->h;
+	int32_t r = est->radius;
+	size_t stride = (size_t)(w + 1) * NORMAL_CH;
+	int32_t min_cnt = (r * (2 * r + 1) + 1) / 2;  //!< Half Of A Side Window Must Be Valid.
+	float edge = (float)(NORMAL_DZ_RATIO * (r + 1));
+	int32_t valid = 0;
+
+	for (int32_t v = begin; v < end; v++) {
+		const int16_t *p = job->xyz + (size_t)v * w * 3;
+		int8_t *n = est->normal + (size_t)v * w * 3;
+		uint8_t *f = est->facing + (size_t)v * w;
+
+		memset(n, 0, (size_t)w * 3);
+		memset(f, 0, (size_t)w);
+
+		if ((v < r) || (v >= h - r)) {
+			continue;
+		}
+
+		//! \remark - Integral Rows At The Window Top, Center, Below Center And Bottom.
+		const uint32_t *i0 = est->integ + (size_t)(v - r) * stride;
+		const uint32_t *im = est->integ + (size_t)v * stride;
+		const uint32_t *ip = est->integ + (size_t)(v + 1) * stride;
+		const uint32_t *i1 = est->integ + (size_t)(v + r + 1) * stride;
+
+		for (int32_t u = r; u < w - r; u++) {
+			const int16_t *c = p + u * 3;
+			size_t ca = (size_t)(u - r) * NORMAL_CH;
+			size_t cu = (size_t)u * NORMAL_CH;
+			size_t cu1 = (size_t)(u + 1) * NORMAL_CH;
+			size_t cb = (size_t)(u + r + 1) * NORMAL_CH;
+			int32_t sl[NORMAL_CH];
+			int32_t sr[NORMAL_CH];
+			int32_t st[NORMAL_CH];
+			int32_t sb[NORMAL_CH];
+			float th[3];
+			float tv[3];
+
+			if (c[2] <= 0) {
+				continue;
+			}
+
+			for (int k = 0; k < NORMAL_CH; k++) {
+				sl[k] = (int32_t)(i1[cu + k] - i0[cu + k] - i1[ca + k] + i0[ca + k]);
+				sr[k] = (int32_t)(i1[cb + k] - i0[cb + k] - i1[cu1 + k] + i0[cu1 + k]);
+				st[k] = (int32_t)(im[cb + k] - i0[cb + k] - im[ca + k] + i0[ca + k]);
+				sb[k] = (int32_t)(i1[cb + k] - ip[cb + k] - i1[ca + k] + ip[ca + k]);
+			}
+
+			if ((sl[3] < min_cnt) || (sr[3] < min_cnt) || (st[3] < min_cnt) || (sb[3] < min_cnt)) {
+				continue;
+			}
+
+			normalTangent(sl, sr, th);
+			normalTangent(st, sb, tv);
+
+			//! \remark - A Large Depth Step Across The Window Is An Object Edge, Not A Surface.
+			float zl = edge * c[2];
+			if ((fabsf(th[2]) > zl * (float)(sl[3] * sr[3])) || (fabsf(tv[2]) > zl * (float)(st[3] * sb[3]))) {
+				continue;
+			}
+
+			float nx = th[1] * tv[2] - th[2] * tv[1];
+			float ny = th[2] * tv[0] - th[0] * tv[2];
+			float nz = th[0] * tv[1] - th[1] * tv[0];
+			float len2 = nx * nx + ny * ny + nz * nz;
+			float ray2 = (float)c[0] * c[0] + (float)c[1] * c[1] + (float)c[2] * c[2];
+
+			if (len2 <= 0.f) {
+				continue;
+			}
+
+			//! \remark - Orient Towards The Camera, i.e. Against The View Ray.
+			float inv = 1.f / sqrtf(len2);
+			float dot = (nx * c[0] + ny * c[1] + nz * c[2]) * inv;
+			if (dot > 0.f) {
+				inv = -inv;
+				dot = -dot;
+			}
+			float cosv = -dot / sqrtf(ray2);
+
+			n[u * 3 + 0] = normalQuant(127.f * nx * inv);
+			n[u * 3 + 1] = normalQuant(127.f * ny * inv);
+			n[u * 3 + 2] = normalQuant(127.f * nz * inv);
+			f[u] = (uint8_t)((cosv * 255.f < 1.f) ? 1 : (int32_t)(cosv * 255.f + 0.5f));
+			valid++;
+		}
+	}
+
+	job->valid[begin / NORMAL_ROW_GRAIN] = valid;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare An Estimator For A Point Cloud Grid.
+//! \n
+//! \param[out]   est       Estimator.
+//! \param[in]    w         Grid width.
+//! \param[in]    h         Grid height.
+//! \param[in]    radius    Window half size in pixels, 0 = disabled.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int normalInit(normal_est_t *est, int32_t w, int32_t h, int32_t radius)
+{
+	memset(est, 0, sizeof(*est));
+	pthread_mutex_init(&est->lock, NULL);
+
+	if ((w <= 0) || (h <= 0) || (h > NORMAL_MAX_H) || (radius < 0) || (radius > NORMAL_RADIUS_MAX)) {
+		return -1;
+	}
+
+	est->w = w;
+	est->h = h;
+	est->radius = radius;
+	est->enable = (radius > 0);
+
+	if (!est->enable) {
+		return 0;
+	}
+
+	est->integ = (uint32_t *)calloc((size_t)(w + 1) * (h + 1) * NORMAL_CH, sizeof(uint32_t));
+	est->normal = (int8_t *)calloc((size_t)w * h * 3, 1);
+	est->facing = (uint8_t *)calloc((size_t)w * h, 1);
+	if ((est->integ == NULL) || (est->normal == NULL) || (est->facing == NULL)) {
+		normalTerm(est);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release An Estimator.
+//! \n
+//! \param[in]    est       Estimator.
+//! \return       None.
+//******************************************************************************
+void normalTerm(normal_est_t *est)
+{
+	free(est->integ);
+	free(est->normal);
+	free(est->facing);
+	est->integ = NULL;
+	est->normal = NULL;
+	est->facing = NULL;
+	est->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Estimate The Normal Of Every Point Of A Frame.
+//! \n
+//! \param[in]    est       Estimator.
+//! \param[in]    xyz       Organized point cloud (w x h, x/y/z in mm, z <= 0 invalid).
+//! \return       0         success, est->normal and est->facing are set
+//! \return       -1        disabled
+//******************************************************************************
+int normalCompute(normal_est_t *est, const int16_t *xyz)
+{
+	uint64_t t0 = getMonoNs();
+	normal_job_t job;
+	int32_t valid = 0;
+
+	if (!est->enable || (xyz == NULL)) {
+		return -1;
+	}
+
+	job.est = est;
+	job.xyz = xyz;
+
+	//! \remark - Row 0 Of The Integral Image Stays 0 From calloc().
+	paraFor(normalRowJob, &job, est->h, NORMAL_ROW_GRAIN);
+	paraFor(normalColJob, &job, (est->w + 1) * NORMAL_CH, NORMAL_COL_GRAIN * NORMAL_CH);
+	paraFor(normalPixelJob, &job, est->h, NORMAL_ROW_GRAIN);
+
+	for (int32_t b = 0; b < (est->h + NORMAL_ROW_GRAIN - 1) / NORMAL_ROW_GRAIN; b++) {
+		valid += job.valid[b];
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&est->lock);
+	est->frames++;
+	est->valid_cnt = valid;
+	est->ms_sum += ms;
+	if (ms > est->ms_max) {
+		est->ms_max = ms;
+	}
+	pthread_mutex_unlock(&est->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Print Normal Coverage And Timing Since The Last Report.
+//! \n
+//! \param[in]    est       Estimator.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void normalReport(normal_est_t *est, const char *name)
+{
+	if (!est->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&est->lock);
+
+	if (est->frames > 0) {
+		printf("normal %s: radius=%d with normal=%.1f%% time mean=%.2f ms max=%.2f ms\n",
+				name, est->radius, 100.0 * est->valid_cnt / ((double)est->w * est->h),
+				est->ms_sum / est->frames, est->ms_max);
+	}
+
+	est->frames = 0;
+	est->ms_sum = 0;
+	est->ms_max = 0;
+
+	pthread_mutex_unlock(&est->lock);
+}
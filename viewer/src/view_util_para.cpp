@@ -0,0 +1,218 @@
+//******************************************************************************
+//! \file       view_util_para.cpp
+//! \brief      Worker Thread Pool, Splits A Job Into Blocks Of Items.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <pthread.h>
+
+#include <atomic>
+
+#include "view_util_para.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+//! Pool State.
+typedef struct _para_pool_t {
+	pthread_mutex_t job_lock;       //!< One Job At A Time, Capture Threads Of Several Devices Queue Here.
+	pthread_mutex_t lock;           //!< Guards The Fields Below.
+	pthread_cond_t cond_start;      //!< Signals A New Job (Or Exit) To The Workers.
+	pthread_cond_t cond_done;       //!< Signals The Last Worker Leaving The Job.
+	pthread_t thread[PARA_MAX_THREAD];
+	int worker_num;                 //!< Pool Threads, The Caller Works Too.
+	uint32_t gen;                   //!< Job Generation.
+	int busy;                       //!< Workers Still Inside The Job.
+	bool exit;
+
+	para_func_t func;
+	void *ctx;
+	int32_t num;
+	int32_t grain;
+	std::atomic<int32_t> next;      //!< Next Block Start.
+} para_pool_t;
+
+static para_pool_t g_para = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	{}, 0, 0, 0, false, NULL, NULL, 0, 1, {0}
+};
+static thread_local bool t_para_worker = false;  //!< Running Inside A Job, Nested Jobs Run Serially.
+
+
+//******************************************************************************
+//! \brief        Take Blocks Of The Current Job Until None Is Left.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void paraRun(void)
+{
+	for (;;) {
+		int32_t begin = g_para.next.fetch_add(g_para.grain, std::memory_order_relaxed);
+		if (begin >= g_para.num) {
+			break;
+		}
+		int32_t end = (begin + g_para.grain < g_para.num) ? (begin + g_para.grain) : g_para.num;
+		g_para.func(g_para.ctx, begin, end);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Pool Thread.
+//! \n
+//! \param[in]    data      Not used.
+//! \return       NULL.
+//******************************************************************************
+static void *paraWorker(void *data)
+{
+	uint32_t gen = 0;
+
+	(void)data;
+	t_para_worker = true;
+
+	pthread_mutex_lock(&g_para.lock);
+	for (;;) {
+		while ((g_para.gen == gen) && !g_para.exit) {
+			pthread_cond_wait(&g_para.cond_start, &g_para.lock);
+		}
+		if (g_para.exit) {
+			break;
+		}
+		gen = g_para.gen;
+		pthread_mutex_unlock(&g_para.lock);
+
+		paraRun();
+
+		pthread_mutex_lock(&g_para.lock);
+		if (--g_para.busy == 0) {
+			pthread_cond_signal(&g_para.cond_done);
+		}
+	}
+	pthread_mutex_unlock(&g_para.lock);
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Start The Pool.
+//! \n
+//! \param[in]    threads   Threads per job including the caller, 1 = no pool threads.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int paraInit(int threads)
+{
+	if (threads > PARA_MAX_THREAD) {
+		threads = PARA_MAX_THREAD;
+	}
+
+	pthread_mutex_lock(&g_para.job_lock);
+	g_para.exit = false;
+	for (int i = g_para.worker_num; i < threads - 1; i++) {
+		if (pthread_create(&g_para.thread[i], NULL, paraWorker, NULL) != 0) {
+			printf("para: pthread_create failed, %d threads\n", g_para.worker_num + 1);
+			pthread_mutex_unlock(&g_para.job_lock);
+			return -1;
+		}
+		g_para.worker_num++;
+	}
+	pthread_mutex_unlock(&g_para.job_lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Stop The Pool Threads.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+void paraTerm(void)
+{
+	pthread_mutex_lock(&g_para.job_lock);
+
+	pthread_mutex_lock(&g_para.lock);
+	g_para.exit = true;
+	pthread_cond_broadcast(&g_para.cond_start);
+	pthread_mutex_unlock(&g_para.lock);
+
+	for (int i = 0; i < g_para.worker_num; i++) {
+		pthread_join(g_para.thread[i], NULL);
+	}
+	g_para.worker_num = 0;
+
+	pthread_mutex_unlock(&g_para.job_lock);
+}
+
+
+//******************************************************************************
+//! \brief        Number Of Threads Working On One Job.
+//! \n
+//! \param[in]    None.
+//! \return       Threads including the caller.
+//******************************************************************************
+int paraThreads(void)
+{
+	return g_para.worker_num + 1;
+}
+
+
+//******************************************************************************
+//! \brief        Run func Over Items [0, num) In Blocks Of grain Items And Wait.
+//! \details      The Caller Takes Blocks Too. Jobs Of Several Callers Are Serialized,
+//! \n            A Job Started From Inside A Job Runs On The Calling Thread Only.
+//! \param[in]    func      Job body.
+//! \param[in]    ctx       Job context passed to func.
+//! \param[in]    num       Number of items.
+//! \param[in]    grain     Items per block.
+//! \return       None.
+//******************************************************************************
+void paraFor(para_func_t func, void *ctx, int32_t num, int32_t grain)
+{
+	if (grain < 1) {
+		grain = 1;
+	}
+
+	if ((g_para.worker_num == 0) || (num <= grain) || t_para_worker) {
+		for (int32_t begin = 0; begin < num; begin += grain) {
+			func(ctx, begin, (begin + grain < num) ? (begin + grain) : num);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&g_para.job_lock);
+
+	pthread_mutex_lock(&g_para.lock);
+	g_para.func = func;
+	g_para.ctx = ctx;
+	g_para.num = num;
+	g_para.grain = grain;
+	g_para.next.store(0, std::memory_order_relaxed);
+	g_para.busy = g_para.worker_num;
+	g_para.gen++;
+	pthread_cond_broadcast(&g_para.cond_start);
+	pthread_mutex_unlock(&g_para.lock);
+
+	t_para_worker = true;
+	paraRun();
+	t_para_worker = false;
+
+	pthread_mutex_lock(&g_para.lock);
+	while (g_para.busy > 0) {
+		pthread_cond_wait(&g_para.cond_done, &g_para.lock);
+	}
+	pthread_mutex_unlock(&g_para.lock);
+
+	pthread_mutex_unlock(&g_para.job_lock);
+}
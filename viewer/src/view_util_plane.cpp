@@ -0,0 +1,617 @@
+//******************************************************************************
+//! \file       view_util_plane.cpp
+//! \brief      RANSAC Plane Detection On The Organized Point Cloud.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_plane.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define PLANE_HYPO_GRAIN    (4)     //!< Hypotheses Per Pool Block.
+#define PLANE_ROW_GRAIN     (16)    //!< Rows Per Pool Block Of The Mask Pass.
+#define PLANE_MAX_H         (2048)  //!< Largest Supported Grid Height.
+
+//! Hypothesis Job.
+typedef struct _plane_hypo_job_t {
+	const plane_det_t *det;
+	uint32_t seed;
+	plane_t plane[PLANE_ITER / PLANE_HYPO_GRAIN];   //!< Best Plane Of Each Block.
+	int32_t score[PLANE_ITER / PLANE_HYPO_GRAIN];   //!< Its Support.
+} plane_hypo_job_t;
+
+//! Mask Job.
+typedef struct _plane_mask_job_t {
+	plane_det_t *det;
+	const int16_t *xyz;
+	plane_t plane;
+	int32_t inliers[PLANE_MAX_H / PLANE_ROW_GRAIN];
+	int32_t valid[PLANE_MAX_H / PLANE_ROW_GRAIN];
+} plane_mask_job_t;
+
+
+//******************************************************************************
+//! \brief        Small Fast Random Number Generator.
+//! \n
+//! \param[in,out] state    Generator state, never 0.
+//! \return       Random Number.
+//******************************************************************************
+static inline uint32_t planeRand(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+
+//******************************************************************************
+//! \brief        Take A Regular Grid Subsample Of The Valid Points For Scoring.
+//! \n
+//! \param[in]    det       Detector.
+//! \param[in]    xyz       Organized point cloud, x/y/z per point in mm.
+//! \return       None.
+//******************************************************************************
+static void planeSample(plane_det_t *det, const int16_t *xyz)
+{
+	int32_t step = 1;
+	int32_t cnt = 0;
+
+	while (((det->w + step - 1) / step) * ((det->h + step - 1) / step) > PLANE_SAMPLE_MAX) {
+		step++;
+	}
+
+	for (int32_t v = step / 2; v < det->h; v += step) {
+		const int16_t *p = xyz + ((size_t)v * det->w + step / 2) * 3;
+		for (int32_t u = step / 2; u < det->w; u += step, p += step * 3) {
+			if (p[2] > 0) {
+				det->sx[cnt] = p[0];
+				det->sy[cnt] = p[1];
+				det->sz[cnt] = p[2];
+				cnt++;
+			}
+		}
+	}
+
+	det->sample_cnt = cnt;
+}
+
+
+//******************************************************************************
+//! \brief        Count Subsample Points Within The Inlier Distance Of A Plane.
+//! \n
+//! \param[in]    det       Detector.
+//! \param[in]    pl        Plane.
+//! \return       Number Of Inliers.
+//******************************************************************************
+static int32_t planeScore(const plane_det_t *det, const plane_t *pl)
+{
+	const float *sx = det->sx;
+	const float *sy = det->sy;
+	const float *sz = det->sz;
+	int32_t n = det->sample_cnt;
+	int32_t i = 0;
+	int32_t cnt = 0;
+
+#if defined(__ARM_NEON)
+	float32x4_t nx = vdupq_n_f32(pl->nx);
+	float32x4_t ny = vdupq_n_f32(pl->ny);
+	float32x4_t nz = vdupq_n_f32(pl->nz);
+	float32x4_t d  = vdupq_n_f32(pl->d);
+	float32x4_t t  = vdupq_n_f32(det->thresh);
+	uint32x4_t acc = vdupq_n_u32(0);
+
+	for (; i + 4 <= n; i += 4) {
+		float32x4_t dist = vmlaq_f32(d, nx, vld1q_f32(sx + i));
+		dist = vmlaq_f32(dist, ny, vld1q_f32(sy + i));
+		dist = vmlaq_f32(dist, nz, vld1q_f32(sz + i));
+		acc = vsubq_u32(acc, vcltq_f32(vabsq_f32(dist), t));  //! All Ones = -1 Per Inlier.
+	}
+	cnt = (int32_t)(vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3));
+#elif defined(__SSE2__)
+	__m128 nx = _mm_set1_ps(pl->nx);
+	__m128 ny = _mm_set1_ps(pl->ny);
+	__m128 nz = _mm_set1_ps(pl->nz);
+	__m128 d  = _mm_set1_ps(pl->d);
+	__m128 t  = _mm_set1_ps(det->thresh);
+	__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128i acc = _mm_setzero_si128();
+	int32_t lane[4];
+
+	for (; i + 4 <= n; i += 4) {
+		__m128 dist = _mm_add_ps(d, _mm_mul_ps(nx, _mm_loadu_ps(sx + i)));
+		dist = _mm_add_ps(dist, _mm_mul_ps(ny, _mm_loadu_ps(sy + i)));
+		dist = _mm_add_ps(dist, _mm_mul_ps(nz, _mm_loadu_ps(sz + i)));
+		acc = _mm_sub_epi32(acc, _mm_castps_si128(_mm_cmplt_ps(_mm_and_ps(dist, abs_mask), t)));
+	}
+	_mm_storeu_si128((__m128i *)lane, acc);
+	cnt = lane[0] + lane[1] + lane[2] + lane[3];
+#endif
+
+	for (; i < n; i++) {
+		float dist = pl->nx * sx[i] + pl->ny * sy[i] + pl->nz * sz[i] + pl->d;
+		cnt += (fabsf(dist) < det->thresh) ? 1 : 0;
+	}
+
+	return cnt;
+}
+
+
+//******************************************************************************
+//! \brief        Plane Through Three Subsample Points.
+//! \n
+//! \param[in]    det       Detector.
+//! \param[in]    i0        Point index.
+//! \param[in]    i1        Point index.
+//! \param[in]    i2        Point index.
+//! \param[out]   pl        Plane.
+//! \return       false     points (nearly) on a line
+//******************************************************************************
+static bool planeFrom3(const plane_det_t *det, int32_t i0, int32_t i1, int32_t i2, plane_t *pl)
+{
+	float ax = det->sx[i1] - det->sx[i0];
+	float ay = det->sy[i1] - det->sy[i0];
+	float az = det->sz[i1] - det->sz[i0];
+	float bx = det->sx[i2] - det->sx[i0];
+	float by = det->sy[i2] - det->sy[i0];
+	float bz = det->sz[i2] - det->sz[i0];
+	float nx = ay * bz - az * by;
+	float ny = az * bx - ax * bz;
+	float nz = ax * by - ay * bx;
+	float len = sqrtf(nx * nx + ny * ny + nz * nz);
+
+	//! \remark - Reject Samples Whose Cross Product Is Tiny Against The Edge Lengths.
+	if (len <= 1e-2f * sqrtf((ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz))) {
+		return false;
+	}
+
+	pl->nx = nx / len;
+	pl->ny = ny / len;
+	pl->nz = nz / len;
+	pl->d = -(pl->nx * det->sx[i0] + pl->ny * det->sy[i0] + pl->nz * det->sz[i0]);
+
+	return true;
+}
+
+
+//******************************************************************************
+//! \brief        Score A Block Of Random Hypotheses (Pool Job Body).
+//! \n
+//! \param[in]    ctx       plane_hypo_job_t.
+//! \param[in]    begin     First hypothesis.
+//! \param[in]    end       Hypothesis after the last one.
+//! \return       None.
+//******************************************************************************
+static void planeHypoJob(void *ctx, int32_t begin, int32_t end)
+{
+	plane_hypo_job_t *job = (plane_hypo_job_t *)ctx;
+	const plane_det_t *det = job->det;
+	int32_t blk = begin / PLANE_HYPO_GRAIN;
+	uint32_t n = (uint32_t)det->sample_cnt;
+
+	job->score[blk] = 0;
+
+	for (int32_t k = begin; k < end; k++) {
+		//! \remark - Each Hypothesis Has Its Own Stream, Results Do Not Depend On The Thread Count.
+		uint32_t state = (job->seed ^ ((uint32_t)(k + 1) * 0x9E3779B1U)) | 1U;
+		plane_t pl;
+		int32_t i0 = (int32_t)(planeRand(&state) % n);
+		int32_t i1 = (int32_t)(planeRand(&state) % n);
+		int32_t i2 = (int32_t)(planeRand(&state) % n);
+
+		if ((i0 == i1) || (i1 == i2) || (i0 == i2) || !planeFrom3(det, i0, i1, i2, &pl)) {
+			continue;
+		}
+
+		int32_t score = planeScore(det, &pl);
+		if (score > job->score[blk]) {
+			job->score[blk] = score;
+			job->plane[blk] = pl;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Eigenvector Of The Smallest Eigenvalue Of A Symmetric 3x3 Matrix (Jacobi).
+//! \n
+//! \param[in]    m         Matrix, row major, destroyed.
+//! \param[out]   vec       Unit eigenvector.
+//! \return       None.
+//******************************************************************************
+static void planeMinEigen(double m[3][3], double vec[3])
+{
+	double v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	int best = 0;
+
+	for (int sweep = 0; sweep < 16; sweep++) {
+		double off = fabs(m[0][1]) + fabs(m[0][2]) + fabs(m[1][2]);
+		if (off < 1e-12 * (fabs(m[0][0]) + fabs(m[1][1]) + fabs(m[2][2]) + 1e-30)) {
+			break;
+		}
+
+		for (int p = 0; p < 2; p++) {
+			for (int q = p + 1; q < 3; q++) {
+				if (m[p][q] == 0.0) {
+					continue;
+				}
+				double theta = (m[q][q] - m[p][p]) / (2.0 * m[p][q]);
+				double t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+
+				for (int k = 0; k < 3; k++) {
+					double mkp = m[k][p];
+					double mkq = m[k][q];
+					m[k][p] = c * mkp - s * mkq;
+					m[k][q] = s * mkp + c * mkq;
+				}
+				for (int k = 0; k < 3; k++) {
+					double mpk = m[p][k];
+					double mqk = m[q][k];
+					m[p][k] = c * mpk - s * mqk;
+					m[q][k] = s * mpk + c * mqk;
+				}
+				for (int k = 0; k < 3; k++) {
+					double vkp = v[k][p];
+					double vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	for (int k = 1; k < 3; k++) {
+		if (m[k][k] < m[best][best]) {
+			best = k;
+		}
+	}
+	for (int k = 0; k < 3; k++) {
+		vec[k] = v[k][best];
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Least Squares Fit Of The Plane To Its Subsample Inliers.
+//! \n
+//! \param[in]    det       Detector.
+//! \param[in,out] pl       Plane, replaced by the fit.
+//! \return       None.
+//******************************************************************************
+static void planeRefine(const plane_det_t *det, plane_t *pl)
+{
+	double c[3] = { 0, 0, 0 };
+	double m[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+	double n[3];
+	int32_t cnt = 0;
+
+	for (int32_t i = 0; i < det->sample_cnt; i++) {
+		float dist = pl->nx * det->sx[i] + pl->ny * det->sy[i] + pl->nz * det->sz[i] + pl->d;
+		if (fabsf(dist) < det->thresh) {
+			c[0] += det->sx[i];
+			c[1] += det->sy[i];
+			c[2] += det->sz[i];
+			cnt++;
+		}
+	}
+	if (cnt < 3) {
+		return;
+	}
+	c[0] /= cnt;
+	c[1] /= cnt;
+	c[2] /= cnt;
+
+	//! \remark - Covariance About The Centroid, Its Smallest Axis Is The Normal.
+	for (int32_t i = 0; i < det->sample_cnt; i++) {
+		float dist = pl->nx * det->sx[i] + pl->ny * det->sy[i] + pl->nz * det->sz[i] + pl->d;
+		if (fabsf(dist) < det->thresh) {
+			double dx = det->sx[i] - c[0];
+			double dy = det->sy[i] - c[1];
+			double dz = det->sz[i] - c[2];
+			m[0][0] += dx * dx;
+			m[0][1] += dx * dy;
+			m[0][2] += dx * dz;
+			m[1][1] += dy * dy;
+			m[1][2] += dy * dz;
+			m[2][2] += dz * dz;
+		}
+	}
+	m[1][0] = m[0][1];
+	m[2][0] = m[0][2];
+	m[2][1] = m[1][2];
+
+	planeMinEigen(m, n);
+
+	pl->nx = (float)n[0];
+	pl->ny = (float)n[1];
+	pl->nz = (float)n[2];
+	pl->d = (float)-(n[0] * c[0] + n[1] * c[1] + n[2] * c[2]);
+}
+
+
+//******************************************************************************
+//! \brief        Mark The Plane Inliers Of A Band Of Rows (Pool Job Body).
+//! \n
+//! \param[in]    ctx       plane_mask_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void planeMaskJob(void *ctx, int32_t begin, int32_t end)
+{
+	plane_mask_job_t *job = (plane_mask_job_t *)ctx;
+	const plane_t *pl = &job->plane;
+	int32_t w = job->det->w;
+	float t = job->det->thresh;
+	int32_t inliers = 0;
+	int32_t valid = 0;
+
+	for (int32_t v = begin; v < end; v++) {
+		const int16_t *p = job->xyz + (size_t)v * w * 3;
+		uint8_t *m = job->det->mask + (size_t)v * w;
+		int32_t u = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+		float32x4_t nx = vdupq_n_f32(pl->nx);
+		float32x4_t ny = vdupq_n_f32(pl->ny);
+		float32x4_t nz = vdupq_n_f32(pl->nz);
+		float32x4_t d  = vdupq_n_f32(pl->d);
+		float32x4_t tt = vdupq_n_f32(t);
+		uint8x8_t one = vdup_n_u8(1);
+
+		//! \remark - 8 Points Per Step, vld3 Splits The Interleaved x/y/z.
+		for (; u + 8 <= w; u += 8, p += 24) {
+			int16x8x3_t s = vld3q_s16(p);
+			uint32x4_t in[2];
+			uint32x4_t ok[2];
+
+			for (int half = 0; half < 2; half++) {
+				int32x4_t ix = vmovl_s16(half ? vget_high_s16(s.val[0]) : vget_low_s16(s.val[0]));
+				int32x4_t iy = vmovl_s16(half ? vget_high_s16(s.val[1]) : vget_low_s16(s.val[1]));
+				int32x4_t iz = vmovl_s16(half ? vget_high_s16(s.val[2]) : vget_low_s16(s.val[2]));
+				float32x4_t dist = vmlaq_f32(d, nx, vcvtq_f32_s32(ix));
+				dist = vmlaq_f32(dist, ny, vcvtq_f32_s32(iy));
+				dist = vmlaq_f32(dist, nz, vcvtq_f32_s32(iz));
+				ok[half] = vcgtq_s32(iz, vdupq_n_s32(0));
+				in[half] = vandq_u32(ok[half], vcltq_f32(vabsq_f32(dist), tt));
+			}
+
+			uint8x8_t m_in = vand_u8(vmovn_u16(vcombine_u16(vmovn_u32(in[0]), vmovn_u32(in[1]))), one);
+			uint8x8_t m_ok = vand_u8(vmovn_u16(vcombine_u16(vmovn_u32(ok[0]), vmovn_u32(ok[1]))), one);
+			vst1_u8(m + u, m_in);
+			inliers += vaddv_u8(m_in);
+			valid += vaddv_u8(m_ok);
+		}
+#endif
+
+		for (; u < w; u++, p += 3) {
+			float dist = pl->nx * p[0] + pl->ny * p[1] + pl->nz * p[2] + pl->d;
+			bool ok = (p[2] > 0);
+			m[u] = (ok && (fabsf(dist) < t)) ? 1 : 0;
+			inliers += m[u];
+			valid += ok ? 1 : 0;
+		}
+	}
+
+	job->inliers[begin / PLANE_ROW_GRAIN] = inliers;
+	job->valid[begin / PLANE_ROW_GRAIN] = valid;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare A Detector For A Point Cloud Grid.
+//! \n
+//! \param[out]   det       Detector.
+//! \param[in]    w         Grid width.
+//! \param[in]    h         Grid height.
+//! \param[in]    thresh    Inlier distance in mm, 0 = disabled.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int planeInit(plane_det_t *det, int32_t w, int32_t h, float thresh)
+{
+	memset(det, 0, sizeof(*det));
+	pthread_mutex_init(&det->lock, NULL);
+
+	if ((w <= 0) || (h <= 0) || (h > PLANE_MAX_H)) {
+		return -1;
+	}
+
+	det->w = w;
+	det->h = h;
+	det->thresh = thresh;
+	det->enable = (thresh > 0);
+	det->seed = 0x2545F491U;
+
+	if (!det->enable) {
+		return 0;
+	}
+
+	det->mask = (uint8_t *)calloc((size_t)w * h, 1);
+	det->sx = (float *)malloc(sizeof(float) * PLANE_SAMPLE_MAX);
+	det->sy = (float *)malloc(sizeof(float) * PLANE_SAMPLE_MAX);
+	det->sz = (float *)malloc(sizeof(float) * PLANE_SAMPLE_MAX);
+	if ((det->mask == NULL) || (det->sx == NULL) || (det->sy == NULL) || (det->sz == NULL)) {
+		planeTerm(det);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release A Detector.
+//! \n
+//! \param[in]    det       Detector.
+//! \return       None.
+//******************************************************************************
+void planeTerm(plane_det_t *det)
+{
+	free(det->mask);
+	free(det->sx);
+	free(det->sy);
+	free(det->sz);
+	det->mask = NULL;
+	det->sx = NULL;
+	det->sy = NULL;
+	det->sz = NULL;
+	det->enable = false;
+	det->found = false;
+}
+
+
+//******************************************************************************
+//! \brief        Find The Dominant Plane Of A Frame And Mark Its Points.
+//! \details      The Plane Of The Previous Frame Is Scored First; While It Keeps Its Support
+//! \n            Fewer New Hypotheses Are Tried. The Best One Is Refitted To Its Inliers.
+//! \param[in]    det       Detector.
+//! \param[in]    xyz       Organized point cloud (w x h, x/y/z in mm, z <= 0 invalid).
+//! \return       0         plane found, det->plane and det->mask are set
+//! \return       -1        no plane
+//******************************************************************************
+int planeDetect(plane_det_t *det, const int16_t *xyz)
+{
+	uint64_t t0 = getMonoNs();
+	plane_hypo_job_t hypo;
+	plane_mask_job_t mask;
+	plane_t best = { 0.f, 0.f, 1.f, 0.f };
+	int32_t best_score = 0;
+	bool warm = false;
+	bool found = false;
+
+	if (!det->enable || (xyz == NULL)) {
+		return -1;
+	}
+
+	planeSample(det, xyz);
+	det->seed = det->seed * 1664525U + 1013904223U;
+
+	if (det->sample_cnt >= PLANE_SAMPLE_MIN) {
+		//! \remark - Warm Start: The Previous Plane Competes As An Extra Hypothesis.
+		if (det->found) {
+			best = det->plane;
+			best_score = planeScore(det, &best);
+			warm = (best_score >= PLANE_HOLD_RATIO * det->support);
+		}
+
+		int32_t iter = warm ? PLANE_ITER_WARM : PLANE_ITER;
+		hypo.det = det;
+		hypo.seed = det->seed;
+		paraFor(planeHypoJob, &hypo, iter, PLANE_HYPO_GRAIN);
+
+		for (int32_t b = 0; b < iter / PLANE_HYPO_GRAIN; b++) {
+			if (hypo.score[b] > best_score) {
+				best_score = hypo.score[b];
+				best = hypo.plane[b];
+			}
+		}
+
+		found = (best_score >= PLANE_MIN_RATIO * det->sample_cnt);
+	}
+
+	if (found) {
+		planeRefine(det, &best);
+		if (best.d < 0) {
+			best.nx = -best.nx;
+			best.ny = -best.ny;
+			best.nz = -best.nz;
+			best.d = -best.d;
+		}
+		det->plane = best;
+		det->support = planeScore(det, &best);
+
+		mask.det = det;
+		mask.xyz = xyz;
+		mask.plane = best;
+		paraFor(planeMaskJob, &mask, det->h, PLANE_ROW_GRAIN);
+
+		det->inliers = 0;
+		det->valid_cnt = 0;
+		for (int32_t b = 0; b < (det->h + PLANE_ROW_GRAIN - 1) / PLANE_ROW_GRAIN; b++) {
+			det->inliers += mask.inliers[b];
+			det->valid_cnt += mask.valid[b];
+		}
+	}
+	else
+	if (det->found) {
+		memset(det->mask, 0, (size_t)det->w * det->h);
+		det->inliers = 0;
+	}
+	det->found = found;
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&det->lock);
+	det->frames++;
+	det->found_cnt += found ? 1 : 0;
+	det->warm_cnt += warm ? 1 : 0;
+	det->last_plane = det->plane;
+	det->last_share = (det->valid_cnt > 0) ? (double)det->inliers / det->valid_cnt : 0.0;
+	det->ms_sum += ms;
+	if (ms > det->ms_max) {
+		det->ms_max = ms;
+	}
+	pthread_mutex_unlock(&det->lock);
+
+	return found ? 0 : -1;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Current Plane And Timing Since The Last Report.
+//! \n
+//! \param[in]    det       Detector.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void planeReport(plane_det_t *det, const char *name)
+{
+	if (!det->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&det->lock);
+
+	if (det->frames > 0) {
+		printf("plane %s: found %u/%u (warm %u) n=(%.3f,%.3f,%.3f) d=%.0f mm inliers=%.1f%% time mean=%.2f ms max=%.2f ms\n",
+				name, det->found_cnt, det->frames, det->warm_cnt,
+				det->last_plane.nx, det->last_plane.ny, det->last_plane.nz, det->last_plane.d,
+				100.0 * det->last_share,
+				det->ms_sum / det->frames, det->ms_max);
+	}
+
+	det->frames = 0;
+	det->found_cnt = 0;
+	det->warm_cnt = 0;
+	det->ms_sum = 0;
+	det->ms_max = 0;
+
+	pthread_mutex_unlock(&det->lock);
+}
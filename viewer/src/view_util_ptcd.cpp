@@ -12,32 +12,129 @@
 //******************************************************************************
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
 
 #include <opencv2/opencv.hpp>
 #include <cstring>
+#include <vector>
+
+#if defined(PTCD_OSMESA)
+#include <GL/osmesa.h>
+#endif
 
 #include "view_util_ptcd.h"
+#include "view_util_time.h"
+#include "view_util_trace.h"
 
 
 //******************************************************************************
 // Definitions
 //******************************************************************************
 #define SCALE_DEFAULT   (600)
-
+#define Z_INVALID       (INT16_MIN)  //!< z Of Points Not Drawn (No Depth Or Hidden), Drawn Points Have z > 0.
+#define SHADE_AMBIENT   (64)       //!< Brightness Of Points Facing Away From The Sensor, Of 255.
+#define GRAZING_FACING  (43)       //!< Facing Below This (About 80 Degrees) Is Hidden By The Grazing Filter.
+#define MESH_DZ_MIN     (30)       //!< Grid Neighbours Closer Than This In Depth (mm) Are Joined By Triangles...
+#define MESH_DZ_SHIFT   (5)        //!< ...Plus depth / 2^n, Both Times The Grid Step.
+#define LOD_LEVELS      (4)        //!< Point Strides 1, 2, 4 And 8 Of The Grid.
+#define TILE_SIZE       (16)       //!< Tile Side In Grid Points, A Multiple Of The Coarsest Stride.
+#define PLY_GEN_NONE    (0)        //!< Handover Count Of No Frame, Skipped When The Count Wraps.
+
+//! Point In mm, z Relative To g_depth_min. Packed, Handed To GL As GL_SHORT Triples.
 typedef struct _pt_3d_t {
-  float x;
-  float y;
-  float z;
+  int16_t x;
+  int16_t y;
+  int16_t z;
 } pt_3d_t;
 
 typedef struct _ptcd_3d_t
 {
-	double ns;  //!< Timestamp In Nano Sec.
+	frame_meta_t meta;  //!< Capture Record Of The Points.
+	uint32_t gen;       //!< Handover Count, Set Once The Frame Is Complete. Per Frame Caches Key On It.
 	int cnt;    //!< Data Count.
+	int w;      //!< Grid Width (Points Are Kept Organized, Row By Row).
+	int h;      //!< Grid Height.
+	int step;   //!< Grid Stride In Sensor Pixels.
+	bool lit;   //!< shade Is Valid.
+	bool gray;  //!< ir Is Valid, Points Are Colored By It.
+	int box_cnt;  //!< Valid Entries Of box.
+	ptcd_box_t box[MAX_PLY_BOX];  //!< Object Boxes, z Relative To g_depth_min Like pt.
 	pt_3d_t pt[MAX_PLY_SIZE];  //!< Array Of Point Cloud Data.
+	uint8_t shade[MAX_PLY_SIZE];  //!< Brightness Of Each Point (Sensor Headlight), Of 255.
+	uint8_t ir[MAX_PLY_SIZE];     //!< IR Brightness Of Each Point, Of 255.
 } ptcd_3d_t;
 
-ptcd_3d_t     g_ply;
+//! Frames Handed From update3dData() To The GL Thread: One Being Filled, One Ready, One Drawn.
+static ptcd_3d_t g_ply_buf[3];
+static int g_ply_fill = 0;          //!< Being Filled By update3dData() (Capture Thread Only).
+static int g_ply_ready = 1;         //!< Last Complete Frame, Guarded By g_ply_lock.
+static int g_ply_draw = 2;          //!< Being Drawn (GL Thread Only).
+static bool g_ply_fresh = false;    //!< g_ply_ready Is Not Drawn Yet, Guarded By g_ply_lock.
+static uint32_t g_ply_gen = PLY_GEN_NONE;  //!< Frames Handed Over, Guarded By g_ply_lock.
+static pthread_mutex_t g_ply_lock = PTHREAD_MUTEX_INITIALIZER;
+static ptcd_3d_t *g_ply = &g_ply_buf[2];    //!< Frame Being Drawn, Only Changed By plyAcquire().
+
+static uint8_t g_rgb[MAX_PLY_SIZE * 3];  //!< Colors Of g_ply->pt, Built Once Per Frame.
+static uint32_t g_rgb_gen = PLY_GEN_NONE;   //!< Frame (Handover Count) g_rgb Was Built For.
+
+//! Triangle Mesh Over The Organized Grid.
+typedef struct _mesh_t
+{
+	int w;              //!< Grid Size The Index Buffer Was Built For.
+	int h;
+	uint32_t *idx;      //!< Static Index Buffer, 2 Triangles Per Grid Cell, Built Once Per Grid Size.
+	uint32_t *draw;     //!< Triangles Of idx That Are Drawn For The Current Frame.
+	int draw_cnt;       //!< Indices In draw.
+	uint32_t gen;       //!< Frame (Handover Count) draw Was Built For.
+} mesh_t;
+
+static mesh_t g_mesh = { 0, 0, NULL, NULL, 0, PLY_GEN_NONE };
+
+//! Bounding Box Of One Tile Of The Grid (Same Units As g_ply->pt).
+typedef struct _tile_box_t
+{
+	int16_t min[3];
+	int16_t max[3];
+	bool empty;         //!< No Point Of The Tile Is Drawn.
+} tile_box_t;
+
+//! Zoom Dependent Level Of Detail Of The Points, Split Into Tiles For Culling.
+typedef struct _lod_t
+{
+	int w;              //!< Grid Size The Index Sets Were Built For.
+	int h;
+	int tile_cnt;       //!< Tiles Of TILE_SIZE x TILE_SIZE Points.
+	uint32_t *idx[LOD_LEVELS];  //!< Points Of Every 2^l-th Row And Column Tile By Tile, Built Once Per Grid Size.
+	int *off[LOD_LEVELS];       //!< First Entry Of Each Tile In idx, tile_cnt + 1 Entries.
+	int cnt[LOD_LEVELS];
+	uint32_t *vis[LOD_LEVELS];  //!< Points Of idx That Are Drawn, Compacted Once Per Frame And Level.
+	int *vis_off[LOD_LEVELS];   //!< First Entry Of Each Tile In vis.
+	uint32_t vis_gen[LOD_LEVELS];   //!< Frame (Handover Count) vis Was Built For.
+	tile_box_t *box;    //!< Bounding Box Of Each Tile, Updated Once Per Frame.
+	uint32_t gen;       //!< Frame (Handover Count) box, pitch And The Centroid Were Measured For.
+	bool valid;         //!< The Frame Has Points To Measure.
+	float pitch;        //!< Distance Between Grid Neighbours Per mm Of Depth.
+	float cx;           //!< Centroid Of The Points (Same Units As g_ply->pt).
+	float cy;
+	float cz;
+	int level;          //!< Level Drawn Last.
+} lod_t;
+
+static lod_t g_lod;  //!< Built On The First Draw.
+
+//! Culling Statistics Of The Point Cloud View.
+typedef struct _cull_stat_t
+{
+	pthread_mutex_t lock;
+	uint32_t frames;    //!< Draws Since The Last Report.
+	uint64_t tiles;     //!< Non-Empty Tiles Tested.
+	uint64_t tiles_out; //!< Of Which Outside The View.
+	uint64_t pts;       //!< Points Of The Tested Tiles At The Drawn Level.
+	uint64_t pts_out;   //!< Of Which Not Submitted.
+} cull_stat_t;
+
+static cull_stat_t g_cull = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, 0 };
 
 static float g_fov_y = 70;
 static float g_z_far = 9000;
@@ -79,6 +176,9 @@ static double g_rt[16];  //!< Transformation Matrix Of Rotation.
 static GLfloat g_dot_size = 1;  //!< Drawing Point Size.
 static int g_depth_min  = 0;    //!< Minimum Depth Range.
 static int g_refresh_ms = 30;   //!< Refresh Interval In Milliseconds.
+static jitter_t g_disp_jitter = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, 0, 0 };  //!< Interval Statistics Of cbDisplay().
+static latency_t g_disp_latency = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, META_SEQ_NONE };  //!< Capture To Screen.
+static uint32_t g_shown_seq = META_SEQ_NONE;  //!< Frame Shown By The Last Repaint.
 
 static bool g_disp_grid      = true;  //!< Flag To Indicate Display Grid Or Not.
 static bool g_disp_xyz_axis  = true;  //!< Flag To Indicate Display XYZ Axis Or Not.
@@ -86,6 +186,19 @@ static bool g_disp_guide     = true;  //!< Flag To Indicate Display Guideline Or
 static bool g_disp_depth_bar = true;  //!< Flag To Indicate Display Color Depth Bar Legend Or Not.
 static bool g_disp_depth     = true;  //!< Flag To Indicate Display Point Cloud Or Not.
 static bool g_disp_ske       = true;  //!< Flag To Indicate Display Skeleton Result Or Not.
+static bool g_disp_hide      = true;  //!< Flag To Indicate Apply The Hide Mask (e.g. Floor Plane) Or Not.
+static bool g_disp_lit       = true;  //!< Flag To Indicate Shade Points By Their Normal Or Not.
+static bool g_disp_grazing   = false; //!< Flag To Indicate Hide Points Seen At A Grazing Angle Or Not.
+static bool g_disp_ir        = false; //!< Flag To Indicate Color Points By Their IR Brightness Or By Depth.
+static bool g_disp_box       = true;  //!< Flag To Indicate Display Object Boxes Or Not.
+static bool g_disp_mesh      = false; //!< Flag To Indicate Draw The Point Cloud As A Triangle Mesh Or As Points.
+static bool g_disp_lod       = true;  //!< Flag To Indicate Thin Out Points That Overlap On Screen Or Not.
+static int  g_vp_w           = 640;   //!< Viewport Width In Pixels.
+static int  g_vp_h           = 480;   //!< Viewport Height In Pixels.
+static bool g_offscreen      = false; //!< Rendering Into An Off-Screen Buffer, No GLUT Window (No GLUT Fonts Either).
+static volatile bool g_snap_req = false;  //!< Write The Next Repaint To A PNG File.
+static const char *g_snap_prefix = "ptcd";  //!< Snapshots Are Written As <prefix>_NNNNNN.png.
+static int  g_snap_idx       = 0;     //!< Number Of The Next Snapshot.
 
 
 // Rotate Matrix
@@ -113,7 +226,10 @@ typedef struct _color_rgb_t
 	uint8_t b;
 } color_rgb_t;
 
-uint8_t g_rainbow_color_tbl[3][65536];
+static uint8_t g_color_tbl[2][3][65536];  //!< Rainbow Color Look Up Tables, One Drawn From, One Built.
+static int g_color_front = 0;           //!< Table Drawn From, Guarded By g_color_lock.
+static pthread_mutex_t g_color_lock = PTHREAD_MUTEX_INITIALIZER;   //!< Held While Points Are Colored.
+static pthread_mutex_t g_color_build = PTHREAD_MUTEX_INITIALIZER;  //!< One Table Build At A Time.
 uint32_t g_range_min = 0;
 uint32_t g_range_max = 0;
 uint32_t g_range = 0;
@@ -121,7 +237,7 @@ uint32_t g_range = 0;
 
 //******************************************************************************
 //! \brief        Utilities Function To Build A Rainbow Color Look Up Table.
-//! \n
+//! \details      Built Into The Table Not Drawn From, Then Swapped In, So Any Thread May Call It.
 //! \param[in]    min_val   Minimum Depth Value.
 //! \param[in]    max_val   Depth Value.
 //! \param[in]    range     Depth Range.
@@ -130,71 +246,81 @@ uint32_t g_range = 0;
 //******************************************************************************
 void makeColorTbl(uint32_t min_val, uint32_t max_val, uint32_t range)
 {
+	pthread_mutex_lock(&g_color_build);
+	uint8_t (*tbl)[65536] = g_color_tbl[1 - g_color_front];  //!< Not Read By The GL Thread.
+
 	g_range_min = min_val;
 	g_range_max = max_val;
 	g_range = range;
 	double rng_tmp = (double) g_range;
+	uint32_t end = (g_range_max < 65536) ? g_range_max : 65536;   //!< A Larger max_val Stops At The Table End.
 
 	//! \remark Decide Each Rainbow RGB Value Up To g_range_max.
-	for (uint32_t i = 0; i < g_range_max; i++)
+	for (uint32_t i = 0; i < end; i++)
 	{
 		short ii = ((double)(i-g_range_min) / (double)(g_range_max-g_range_min))*rng_tmp > rng_tmp+512 ? g_range+512 : (short)(((double)(i-g_range_min) / (double)(g_range_max-g_range_min))*rng_tmp) + 255;
 
 		if (ii < 0) {
-			g_rainbow_color_tbl[0][i] = 255;
-			g_rainbow_color_tbl[1][i] = 255;
-			g_rainbow_color_tbl[2][i] = 255;
+			tbl[0][i] = 255;
+			tbl[1][i] = 255;
+			tbl[2][i] = 255;
 		}
 		else
 		if (ii < 255) {
-			g_rainbow_color_tbl[0][i] = 255;
-			g_rainbow_color_tbl[1][i] = 255;
-			g_rainbow_color_tbl[2][i] = 255;
+			tbl[0][i] = 255;
+			tbl[1][i] = 255;
+			tbl[2][i] = 255;
 		}
 		else
 		if(ii < 511) {
-			g_rainbow_color_tbl[0][i] = (char)(   255);
-			g_rainbow_color_tbl[1][i] = (char)(ii-255);
-			g_rainbow_color_tbl[2][i] = (char)(     0);
+			tbl[0][i] = (char)(   255);
+			tbl[1][i] = (char)(ii-255);
+			tbl[2][i] = (char)(     0);
 		}
 		else
 		if(ii < 766) {
-			g_rainbow_color_tbl[0][i] = (char)(765-ii);
-			g_rainbow_color_tbl[1][i] = (char)(   255);
-			g_rainbow_color_tbl[2][i] = (char)(     0);
+			tbl[0][i] = (char)(765-ii);
+			tbl[1][i] = (char)(   255);
+			tbl[2][i] = (char)(     0);
 		}
 		else
 		if(ii < 1021) {
-			g_rainbow_color_tbl[0][i] = (char)(     0);
-			g_rainbow_color_tbl[1][i] = (char)(   255);
-			g_rainbow_color_tbl[2][i] = (char)(ii-765);
+			tbl[0][i] = (char)(     0);
+			tbl[1][i] = (char)(   255);
+			tbl[2][i] = (char)(ii-765);
 		}
 		else
 		if(ii < 1276) {
-			g_rainbow_color_tbl[0][i] = (char)(     0);
-			g_rainbow_color_tbl[1][i] = (char)(1275-i);
-			g_rainbow_color_tbl[2][i] = (char)(   255);
+			tbl[0][i] = (char)(     0);
+			tbl[1][i] = (char)(1275-i);
+			tbl[2][i] = (char)(   255);
 		}
 		else {
-			g_rainbow_color_tbl[0][i] = (char)(     0);
-			g_rainbow_color_tbl[1][i] = (char)(     0);
-			g_rainbow_color_tbl[2][i] = (char)(     0);
+			tbl[0][i] = (char)(     0);
+			tbl[1][i] = (char)(     0);
+			tbl[2][i] = (char)(     0);
 		}
 	}
 
 	//! \remark Set Pixel Below g_range_min As 255, i.e. White.
 	for (uint32_t i = 0; i < g_range_min; i++) {
-		g_rainbow_color_tbl[0][i] = 255;
-		g_rainbow_color_tbl[1][i] = 255;
-		g_rainbow_color_tbl[2][i] = 255;
+		tbl[0][i] = 255;
+		tbl[1][i] = 255;
+		tbl[2][i] = 255;
 	}
 
 	//! \remark Set Pixel Above g_range_max As 0, i.e. Black.
-	for (uint32_t i = g_range_max; i < 65536; i++) {
-		g_rainbow_color_tbl[0][i] = 0;
-		g_rainbow_color_tbl[1][i] = 0;
-		g_rainbow_color_tbl[2][i] = 0;
+	for (uint32_t i = end; i < 65536; i++) {
+		tbl[0][i] = 0;
+		tbl[1][i] = 0;
+		tbl[2][i] = 0;
 	}
+
+	//! \remark Hand The Table Over, Once No Point Is Colored From The Current One.
+	pthread_mutex_lock(&g_color_lock);
+	g_color_front = 1 - g_color_front;
+	pthread_mutex_unlock(&g_color_lock);
+	pthread_mutex_unlock(&g_color_build);
 }
 
 
@@ -328,6 +454,23 @@ void dispGrid(void)
 }
 
 
+//******************************************************************************
+//! \brief        Utilities Function To Display A String At The Current Raster Position.
+//! \details      GLUT Fonts Need glutInit(), So Text Is Left Out Of Off-Screen Renders.
+//! \param[in]    font      GLUT Bitmap Font.
+//! \param[in]    str       String.
+//! \return       None.
+//******************************************************************************
+static void dispText(void *font, const char *str)
+{
+	if (g_offscreen) {
+		return;
+	}
+
+	glutBitmapString(font, (const unsigned char *)str);
+}
+
+
 //******************************************************************************
 //! \brief        Utilities Function To Display XYZ Axis On Point Cloud View.
 //! \n
@@ -362,15 +505,15 @@ void dispXyzAxis(void)
 
 	glColor3d(1, 0, 0);  //! X-Axis Red Color Text.
 	glRasterPos3d(1.1, -0.025, 0);
-	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char *)"X-axis");
+	dispText(GLUT_BITMAP_HELVETICA_12, "X-axis");
 
 	glColor3d(0, 1, 0);  //! Y-Axis Green Color Text.
 	glRasterPos3d(-0.15, 1.1, 0);
-	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char *)"Y-axis");
+	dispText(GLUT_BITMAP_HELVETICA_12, "Y-axis");
 
 	glColor3d(0, 0, 1);  //! Z-Axis Blue Color Text.
 	glRasterPos3d(-0.15, 0, 1.1);
-	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char *)"Z-axis");
+	dispText(GLUT_BITMAP_HELVETICA_12, "Z-axis");
 }
 
 
@@ -391,6 +534,10 @@ void dispGuideText(void)
 							"F2/a = Toggle XYZ Axis Display\n"
 							"F3/g = Toggle Grid Display\n"
 							"F4/l = Toggle Color Depth Bar Legend Display\n"
+							"k    = Toggle Plane Hiding      o   = Toggle Object Boxes\n"
+							"m    = Toggle Mesh/Points        v   = Toggle Zoom Level Of Detail\n"
+							"n    = Toggle Lit Points        b   = Toggle Grazing Point Filter\n"
+							"i    = Toggle IR/Depth Colors\n"
 							"F7   = Dec Depth Range          F8  = Inc Depth Range\n"
 							"F9   = Dec Dot Size             F10 = Inc Dot Size\n"
 							"F11/Z/WheelUp = Zoom In         F12/z/WheelDown = Zoom Out\n"
@@ -398,11 +545,12 @@ void dispGuideText(void)
 							"Left/s   = Move Camera Left     Right/f    = Move Camera Right\n"
 							"Up/e     = Move Camera Up       Down/d     = Move Camera Down\n"
 							"LeftMouseHold = Rotate View\n"
+							"x    = Write Snapshot (PNG)\n"
 							"Home/c/RightMouse = Reset View\n";
 
 	glColor3f(1.f, 1.f, 1.f);  //! Specify White Color Text.
 	glRasterPos3d(0, -0.2, 0);
-	glutBitmapString(GLUT_BITMAP_8_BY_13, (const unsigned char *)help_str);  //! Display The String.
+	dispText(GLUT_BITMAP_8_BY_13, help_str);  //! Display The String.
 }
 
 
@@ -443,9 +591,531 @@ void dispDepthBar(void)
 	//! Display Legend Text.
 	glColor3f(1.f, 1.f, 1.f);
 	glRasterPos2d(BOX_X + BOX_W + 0.05, (float)-BOX_H / 2 );
-	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char *)"Near");
+	dispText(GLUT_BITMAP_HELVETICA_12, "Near");
 	glRasterPos2d(BOX_X + BOX_W + 0.05, (float)BOX_H / 2 );
-	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char *)"Far");
+	dispText(GLUT_BITMAP_HELVETICA_12, "Far");
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Get The Color Of A Point From The Color LUT.
+//! \n
+//! \param[in]    i         Point Index.
+//! \param[in]    tbl       Color LUT.
+//! \param[out]   rgb       Color.
+//! \return       None.
+//******************************************************************************
+static inline void ptColor(int i, const uint8_t (*tbl)[65536], uint8_t rgb[3])
+{
+	int depth = g_ply->pt[i].z + g_depth_min;
+
+	//! Decide The Point Color Base On Color LUT, Or Gray From The IR Image.
+	if (g_ply->gray) {
+		rgb[0] = g_ply->ir[i];
+		rgb[1] = g_ply->ir[i];
+		rgb[2] = g_ply->ir[i];
+	}
+	else {
+		rgb[0] = tbl[0][depth];
+		rgb[1] = tbl[1][depth];
+		rgb[2] = tbl[2][depth];
+	}
+	if (g_ply->lit) {
+		//! Darken By The Angle To The Sensor.
+		rgb[0] = (uint8_t)((rgb[0] * g_ply->shade[i]) >> 8);
+		rgb[1] = (uint8_t)((rgb[1] * g_ply->shade[i]) >> 8);
+		rgb[2] = (uint8_t)((rgb[2] * g_ply->shade[i]) >> 8);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Color The Drawn Points Of A New Frame.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void ptColors(void)
+{
+	if (g_rgb_gen == g_ply->gen) {
+		return;
+	}
+	g_rgb_gen = g_ply->gen;
+
+	pthread_mutex_lock(&g_color_lock);
+	const uint8_t (*tbl)[65536] = g_color_tbl[g_color_front];
+	for (int i = 0; i < g_ply->cnt; i++) {
+		if (g_ply->pt[i].z != Z_INVALID) {
+			ptColor(i, tbl, &g_rgb[i * 3]);
+		}
+	}
+	pthread_mutex_unlock(&g_color_lock);
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Build The Static Mesh Index Buffer For A Grid Size.
+//! \details      Cell (u, v) With Corners a=(u,v) b=(u+1,v) c=(u,v+1) d=(u+1,v+1) Holds The
+//! \n            Triangles a-c-b And b-c-d. Only Rebuilt When The Grid Size Changes.
+//! \param[in]    w         Grid Width.
+//! \param[in]    h         Grid Height.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int meshBuildIndex(int w, int h)
+{
+	size_t n = (size_t)(w - 1) * (h - 1) * 6;
+	uint32_t *p;
+
+	free(g_mesh.idx);
+	free(g_mesh.draw);
+	g_mesh.idx = (uint32_t *)malloc(n * sizeof(uint32_t));
+	g_mesh.draw = (uint32_t *)malloc(n * sizeof(uint32_t));
+	g_mesh.draw_cnt = 0;
+	g_mesh.gen = PLY_GEN_NONE;
+	if ((g_mesh.idx == NULL) || (g_mesh.draw == NULL)) {
+		g_mesh.w = 0;
+		g_mesh.h = 0;
+		return -1;
+	}
+
+	p = g_mesh.idx;
+	for (int v = 0; v < h - 1; v++) {
+		for (int u = 0; u < w - 1; u++) {
+			uint32_t a = (uint32_t)(v * w + u);
+			uint32_t b = a + 1;
+			uint32_t c = a + (uint32_t)w;
+			uint32_t d = c + 1;
+			*p++ = a;
+			*p++ = c;
+			*p++ = b;
+			*p++ = b;
+			*p++ = c;
+			*p++ = d;
+		}
+	}
+	g_mesh.w = w;
+	g_mesh.h = h;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Check Whether Three Grid Points Form A Surface.
+//! \n
+//! \param[in]    z0        Depth Of The Points (Relative To g_depth_min).
+//! \param[in]    z1
+//! \param[in]    z2
+//! \return       true      all valid and no depth discontinuity between them
+//******************************************************************************
+static inline bool meshJoin(int z0, int z1, int z2)
+{
+	int lo = z0;
+	int hi = z0;
+
+	if ((z0 == Z_INVALID) || (z1 == Z_INVALID) || (z2 == Z_INVALID)) {
+		return false;
+	}
+
+	lo = (z1 < lo) ? z1 : lo;
+	lo = (z2 < lo) ? z2 : lo;
+	hi = (z1 > hi) ? z1 : hi;
+	hi = (z2 > hi) ? z2 : hi;
+
+	return (hi - lo) <= (MESH_DZ_MIN + ((lo + g_depth_min) >> MESH_DZ_SHIFT)) * g_ply->step;
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Pick The Triangles Of The Current Frame.
+//! \details      Copies The Triangles Of The Static Index Buffer Whose Corners Are Valid And On
+//! \n            One Surface. Runs Once Per New Frame, Not Per Redraw.
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void meshUpdate(void)
+{
+	int w = g_ply->w;
+	int h = g_ply->h;
+	const uint32_t *q;
+	uint32_t *dst;
+
+	if ((w < 2) || (h < 2)) {
+		g_mesh.draw_cnt = 0;
+		return;
+	}
+
+	if ((w != g_mesh.w) || (h != g_mesh.h)) {
+		if (meshBuildIndex(w, h) != 0) {
+			return;
+		}
+	}
+
+	if (g_mesh.gen == g_ply->gen) {
+		return;
+	}
+	g_mesh.gen = g_ply->gen;
+
+	//! Validity Pass Over The Cells.
+	q = g_mesh.idx;
+	dst = g_mesh.draw;
+	for (int v = 0; v < h - 1; v++) {
+		const pt_3d_t *r0 = &g_ply->pt[v * w];
+		const pt_3d_t *r1 = r0 + w;
+
+		for (int u = 0; u < w - 1; u++, q += 6) {
+			int za = r0[u].z;
+			int zb = r0[u + 1].z;
+			int zc = r1[u].z;
+			int zd = r1[u + 1].z;
+
+			if (meshJoin(za, zc, zb)) {
+				dst[0] = q[0];
+				dst[1] = q[1];
+				dst[2] = q[2];
+				dst += 3;
+			}
+			if (meshJoin(zb, zc, zd)) {
+				dst[0] = q[3];
+				dst[1] = q[4];
+				dst[2] = q[5];
+				dst += 3;
+			}
+		}
+	}
+	g_mesh.draw_cnt = (int)(dst - g_mesh.draw);
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Display Depth Points As A Triangle Mesh On Point Cloud View.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+void dispDepthMesh(void)
+{
+	meshUpdate();
+	if (g_mesh.draw_cnt == 0) {
+		return;
+	}
+	ptColors();
+
+	//! Placement p / g_wheel + offset Is Done By GL.
+	glPushMatrix();
+	glTranslatef(g_offset_x, g_offset_y, g_offset_z);
+	glScalef(1.f / g_wheel, 1.f / g_wheel, 1.f / g_wheel);
+
+	//! One Indexed Draw Call For The Whole Mesh.
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_SHORT, sizeof(pt_3d_t), g_ply->pt);
+	glColorPointer(3, GL_UNSIGNED_BYTE, 0, g_rgb);
+	glDrawElements(GL_TRIANGLES, g_mesh.draw_cnt, GL_UNSIGNED_INT, g_mesh.draw);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glPopMatrix();
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Build The Point Index Sets Of All Levels For A Grid Size.
+//! \n
+//! \param[in]    w         Grid Width.
+//! \param[in]    h         Grid Height.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int lodBuildIndex(int w, int h)
+{
+	int tw = (w + TILE_SIZE - 1) / TILE_SIZE;
+	int th = (h + TILE_SIZE - 1) / TILE_SIZE;
+	int l;
+
+	g_lod.w = 0;
+	g_lod.h = 0;
+	g_lod.tile_cnt = tw * th;
+	free(g_lod.box);
+	g_lod.box = (tile_box_t *)malloc(sizeof(tile_box_t) * (size_t)g_lod.tile_cnt);
+	if (g_lod.box == NULL) {
+		return -1;
+	}
+
+	for (l = 0; l < LOD_LEVELS; l++) {
+		int s = 1 << l;
+		size_t n = (size_t)((w + s - 1) / s) * ((h + s - 1) / s);
+		uint32_t *p;
+
+		free(g_lod.idx[l]);
+		free(g_lod.off[l]);
+		free(g_lod.vis[l]);
+		free(g_lod.vis_off[l]);
+		g_lod.idx[l] = (uint32_t *)malloc(sizeof(uint32_t) * n);
+		g_lod.off[l] = (int *)malloc(sizeof(int) * (size_t)(g_lod.tile_cnt + 1));
+		g_lod.vis[l] = (uint32_t *)malloc(sizeof(uint32_t) * n);
+		g_lod.vis_off[l] = (int *)malloc(sizeof(int) * (size_t)(g_lod.tile_cnt + 1));
+		g_lod.vis_gen[l] = PLY_GEN_NONE;
+		if ((g_lod.idx[l] == NULL) || (g_lod.off[l] == NULL) || (g_lod.vis[l] == NULL) || (g_lod.vis_off[l] == NULL)) {
+			return -1;
+		}
+
+		//! Tiles Start On Multiples Of Every Stride, So Each Level Keeps The Global 2^l Grid.
+		p = g_lod.idx[l];
+		for (int t = 0; t < g_lod.tile_cnt; t++) {
+			int u0 = (t % tw) * TILE_SIZE;
+			int v0 = (t / tw) * TILE_SIZE;
+			int u1 = (u0 + TILE_SIZE < w) ? (u0 + TILE_SIZE) : w;
+			int v1 = (v0 + TILE_SIZE < h) ? (v0 + TILE_SIZE) : h;
+
+			g_lod.off[l][t] = (int)(p - g_lod.idx[l]);
+			for (int v = v0; v < v1; v += s) {
+				for (int u = u0; u < u1; u += s) {
+					*p++ = (uint32_t)(v * w + u);
+				}
+			}
+		}
+		g_lod.cnt[l] = (int)(p - g_lod.idx[l]);
+		g_lod.off[l][g_lod.tile_cnt] = g_lod.cnt[l];
+	}
+	g_lod.w = w;
+	g_lod.h = h;
+	g_lod.gen = PLY_GEN_NONE;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Update The Bounding Box Of Each Tile For A New Frame.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void tileBounds(void)
+{
+	const uint32_t *idx = g_lod.idx[0];
+
+	for (int t = 0; t < g_lod.tile_cnt; t++) {
+		tile_box_t *box = &g_lod.box[t];
+
+		box->empty = true;
+		for (int k = g_lod.off[0][t]; k < g_lod.off[0][t + 1]; k++) {
+			const pt_3d_t *pt = &g_ply->pt[idx[k]];
+
+			if (pt->z == Z_INVALID) {
+				continue;
+			}
+			if (box->empty) {
+				box->min[0] = box->max[0] = pt->x;
+				box->min[1] = box->max[1] = pt->y;
+				box->min[2] = box->max[2] = pt->z;
+				box->empty = false;
+				continue;
+			}
+			box->min[0] = (pt->x < box->min[0]) ? pt->x : box->min[0];
+			box->max[0] = (pt->x > box->max[0]) ? pt->x : box->max[0];
+			box->min[1] = (pt->y < box->min[1]) ? pt->y : box->min[1];
+			box->max[1] = (pt->y > box->max[1]) ? pt->y : box->max[1];
+			box->min[2] = (pt->z < box->min[2]) ? pt->z : box->min[2];
+			box->max[2] = (pt->z > box->max[2]) ? pt->z : box->max[2];
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Get The View Frustum In The Coordinates Of g_ply->pt.
+//! \details      Planes Are Taken From The Rows Of Projection x Model-View (Gribb/Hartmann) And
+//! \n            Moved Through The Placement p / g_wheel + offset, So Boxes Are Tested As Cached.
+//! \param[out]   plane     6 Planes (a, b, c, d), Inside Where a*x + b*y + c*z + d >= 0.
+//! \return       None.
+//******************************************************************************
+static void viewFrustum(double plane[6][4])
+{
+	GLdouble p[16];
+	GLdouble m[16];
+	double c[16];
+
+	glGetDoublev(GL_PROJECTION_MATRIX, p);
+	glGetDoublev(GL_MODELVIEW_MATRIX, m);
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			c[col * 4 + row] = p[row] * m[col * 4] + p[4 + row] * m[col * 4 + 1]
+							+ p[8 + row] * m[col * 4 + 2] + p[12 + row] * m[col * 4 + 3];
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		int row = i / 2;
+		double sign = (i & 1) ? -1.0 : 1.0;
+		double a = c[3] + sign * c[row];
+		double b = c[7] + sign * c[4 + row];
+		double z = c[11] + sign * c[8 + row];
+		double d = c[15] + sign * c[12 + row];
+
+		plane[i][0] = a / g_wheel;
+		plane[i][1] = b / g_wheel;
+		plane[i][2] = z / g_wheel;
+		plane[i][3] = a * g_offset_x + b * g_offset_y + z * g_offset_z + d;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Check Whether A Tile May Be On Screen.
+//! \n
+//! \param[in]    box       Tile Bounding Box.
+//! \param[in]    plane     View Frustum From viewFrustum().
+//! \return       false     the whole box is outside one of the planes
+//******************************************************************************
+static inline bool tileVisible(const tile_box_t *box, const double plane[6][4])
+{
+	for (int i = 0; i < 6; i++) {
+		//! Corner Furthest Along The Plane Normal.
+		double x = (plane[i][0] >= 0) ? box->max[0] : box->min[0];
+		double y = (plane[i][1] >= 0) ? box->max[1] : box->min[1];
+		double z = (plane[i][2] >= 0) ? box->max[2] : box->min[2];
+
+		if (plane[i][0] * x + plane[i][1] * y + plane[i][2] * z + plane[i][3] < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Measure The Centroid And Point Spacing Of The Frame.
+//! \details      Uses The Coarsest Index Set Only, About 1/64 Of The Points.
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void lodMeasure(void)
+{
+	const uint32_t *idx = g_lod.idx[LOD_LEVELS - 1];
+	double sx = 0;
+	double sy = 0;
+	double sz = 0;
+	double sp = 0;
+	int n = 0;
+	int np = 0;
+
+	for (int k = 0; k < g_lod.cnt[LOD_LEVELS - 1]; k++) {
+		uint32_t i = idx[k];
+		const pt_3d_t *pt = &g_ply->pt[i];
+
+		if (pt->z == Z_INVALID) {
+			continue;
+		}
+		sx += pt->x;
+		sy += pt->y;
+		sz += pt->z;
+		n++;
+
+		//! Right Neighbour On The Grid Gives The Spacing At This Depth.
+		if (((i + 1) % g_ply->w != 0) && (pt[1].z != Z_INVALID)) {
+			sp += (double)abs(pt[1].x - pt->x) / (pt->z + g_depth_min);
+			np++;
+		}
+	}
+
+	g_lod.valid = (n > 0) && (np > 0);
+	if (g_lod.valid) {
+		g_lod.cx = (float)(sx / n);
+		g_lod.cy = (float)(sy / n);
+		g_lod.cz = (float)(sz / n);
+		g_lod.pitch = (float)(sp / np);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Drop The Hidden Points From The Index Set Of A Level.
+//! \details      Runs Once Per Frame And Level, Tiles Stay In Order With Their Own Offsets.
+//! \param[in]    l         Level.
+//! \return       None.
+//******************************************************************************
+static void lodCompact(int l)
+{
+	const uint32_t *idx = g_lod.idx[l];
+	uint32_t *dst = g_lod.vis[l];
+
+	if (g_lod.vis_gen[l] == g_ply->gen) {
+		return;
+	}
+	g_lod.vis_gen[l] = g_ply->gen;
+
+	for (int t = 0; t < g_lod.tile_cnt; t++) {
+		g_lod.vis_off[l][t] = (int)(dst - g_lod.vis[l]);
+		for (int k = g_lod.off[l][t]; k < g_lod.off[l][t + 1]; k++) {
+			*dst = idx[k];
+			dst += (g_ply->pt[idx[k]].z != Z_INVALID) ? 1 : 0;
+		}
+	}
+	g_lod.vis_off[l][g_lod.tile_cnt] = (int)(dst - g_lod.vis[l]);
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Pick The Level Of Detail For The Current View.
+//! \details      Projects The Grid Spacing At The Centroid Of The Points With The Current Zoom
+//! \n            (g_wheel), Field Of View And Viewport Height, And Returns The Largest Stride
+//! \n            Whose Points Are Still No Further Apart On Screen Than The Dot Size.
+//! \param[in]    None.
+//! \return       Level, The Points Of Every 2^level-th Row And Column Are Drawn.
+//******************************************************************************
+static int lodLevel(void)
+{
+	GLdouble m[16];
+	double x;
+	double y;
+	double z;
+	double dist;
+	double px;
+	int l = 0;
+
+	if ((g_ply->w < 1) || (g_ply->h < 1)) {
+		return 0;
+	}
+
+	if ((g_ply->w != g_lod.w) || (g_ply->h != g_lod.h)) {
+		if (lodBuildIndex(g_ply->w, g_ply->h) != 0) {
+			return 0;
+		}
+	}
+
+	if (g_lod.gen != g_ply->gen) {
+		g_lod.gen = g_ply->gen;
+		lodMeasure();
+		tileBounds();
+	}
+
+	if (!g_disp_lod || !g_lod.valid) {
+		return 0;
+	}
+
+	//! Distance Of The Centroid Along The View Direction.
+	x = g_lod.cx / g_wheel + g_offset_x;
+	y = g_lod.cy / g_wheel + g_offset_y;
+	z = g_lod.cz / g_wheel + g_offset_z;
+	glGetDoublev(GL_MODELVIEW_MATRIX, m);
+	dist = -(m[2] * x + m[6] * y + m[10] * z + m[14]);
+	if (dist <= 0) {
+		return 0;
+	}
+
+	//! Screen Pixels Between Grid Neighbours.
+	px = (double)g_lod.pitch * (g_lod.cz + g_depth_min) / g_wheel
+		* (g_vp_h * 0.5) / (tan(g_fov_y * M_PI / 360.0) * dist);
+
+	while ((l + 1 < LOD_LEVELS) && (px * (2 << l) <= g_dot_size)) {
+		l++;
+	}
+
+	return l;
 }
 
 
@@ -457,46 +1127,130 @@ void dispDepthBar(void)
 //******************************************************************************
 void dispDepthPoints(void)
 {
-	int i;
-	GLfloat f_x;
-	GLfloat f_y;
-	GLfloat f_z;
-	uint8_t u_x;
-	uint8_t u_y;
-	uint8_t u_z;
-	int depth;
-
-	g_ns = g_ply.ns;  //! Indicate Current Point Cloud's Time Stamp.
+	int t;
+	int l;
+	int run = -1;
+	const uint32_t *vis;
+	const int *vis_off;
+	const int *off;
+	double plane[6][4];
+	uint32_t tiles = 0;
+	uint32_t tiles_out = 0;
+	uint32_t pts = 0;
+	uint32_t pts_out = 0;
+
+	g_ns = (double)g_ply->meta.cap_ns;  //! Indicate Current Point Cloud's Time Stamp.
 
 	if (g_disp_depth == false) {
 		return;
 	}
 
-	//! Always Setup Properties Before glBegin().
+	if (g_disp_mesh) {
+		dispDepthMesh();
+		return;
+	}
+
+	//! Points Of The Level Of Detail For The Current Zoom.
+	l = lodLevel();
+	if ((g_lod.w != g_ply->w) || (g_lod.h != g_ply->h)) {
+		return;  //! Index Sets Could Not Be Built.
+	}
+	g_lod.level = l;
+	ptColors();
+	lodCompact(l);
+	vis = g_lod.vis[l];
+	vis_off = g_lod.vis_off[l];
+	off = g_lod.off[l];
+	viewFrustum(plane);
+
 	glPointSize(g_dot_size);     //! Setup Properties For Point Size.
 	glDisable(GL_POINT_SMOOTH);  //! Setup Properties To Draw Square Points.
 
-	//! Draw The Point Cloud Data.
-	glBegin(GL_POINTS);
+	//! The Points Stay int16, Placement p / g_wheel + offset Is Done By GL.
+	glPushMatrix();
+	glTranslatef(g_offset_x, g_offset_y, g_offset_z);
+	glScalef(1.f / g_wheel, 1.f / g_wheel, 1.f / g_wheel);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_SHORT, sizeof(pt_3d_t), g_ply->pt);
+	glColorPointer(3, GL_UNSIGNED_BYTE, 0, g_rgb);
 
-	for (i = 0; i < g_ply.cnt; i++) {
-		f_x = (g_ply.pt[i].x);
-		f_y = (g_ply.pt[i].y);
-		f_z = (g_ply.pt[i].z);
+	//! Draw Runs Of Consecutive Visible Tiles, Skip Tiles Outside The View.
+	for (t = 0; t < g_lod.tile_cnt; t++) {
+		if (g_lod.box[t].empty) {
+			continue;  //! Nothing To Draw, Does Not End A Run.
+		}
+
+		tiles++;
+		pts += (uint32_t)(off[t + 1] - off[t]);
+		if (tileVisible(&g_lod.box[t], plane)) {
+			run = (run < 0) ? t : run;
+			continue;
+		}
+
+		tiles_out++;
+		pts_out += (uint32_t)(off[t + 1] - off[t]);
+		if (run >= 0) {
+			glDrawElements(GL_POINTS, vis_off[t] - vis_off[run], GL_UNSIGNED_INT, &vis[vis_off[run]]);
+			run = -1;
+		}
+	}
+	if (run >= 0) {
+		glDrawElements(GL_POINTS, vis_off[g_lod.tile_cnt] - vis_off[run], GL_UNSIGNED_INT, &vis[vis_off[run]]);
+	}
 
-		depth = (int)(f_z);  //! Convert To Integer, So That We Can Use It To Indexing.
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPopMatrix();
+
+	pthread_mutex_lock(&g_cull.lock);
+	g_cull.frames++;
+	g_cull.tiles += tiles;
+	g_cull.tiles_out += tiles_out;
+	g_cull.pts += pts;
+	g_cull.pts_out += pts_out;
+	pthread_mutex_unlock(&g_cull.lock);
+}
+
+
+//******************************************************************************
+//! \brief        Utilities Function To Display Object Boxes On Point Cloud View.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+void dispBoxes(void)
+{
+	//! Corner Pairs Of The 12 Edges, Bit 0/1/2 Selects max Of x/y/z.
+	static const uint8_t edge[12][2] = {
+		{0, 1}, {2, 3}, {4, 5}, {6, 7},
+		{0, 2}, {1, 3}, {4, 6}, {5, 7},
+		{0, 4}, {1, 5}, {2, 6}, {3, 7},
+	};
+
+	if ((g_disp_box == false) || (g_disp_depth == false) || (g_ply->box_cnt == 0)) {
+		return;
+	}
+
+	//! Always Setup Properties Before glBegin().
+	glLineWidth(1);
 
-		//! Decide The Point Color Base On Color LUT.
-		u_x = g_rainbow_color_tbl[0][depth + g_depth_min];
-		u_y = g_rainbow_color_tbl[1][depth + g_depth_min];
-		u_z = g_rainbow_color_tbl[2][depth + g_depth_min];
-		glColor3ub(u_x, u_y, u_z);
+	glBegin(GL_LINES);
 
-		//! Draw The Point One By One.
-		f_x = f_x / g_wheel + g_offset_x;
-		f_y = f_y / g_wheel + g_offset_y;
-		f_z = f_z / g_wheel + g_offset_z;
-		glVertex3f(f_x, f_y, f_z);
+	glColor3ub(255, 255, 255);
+	for (int i = 0; i < g_ply->box_cnt; i++) {
+		const ptcd_box_t *box = &g_ply->box[i];
+
+		for (int e = 0; e < 12; e++) {
+			for (int k = 0; k < 2; k++) {
+				int c = edge[e][k];
+				float f_x = (float)((c & 1) ? box->max[0] : box->min[0]);
+				float f_y = (float)((c & 2) ? box->max[1] : box->min[1]);
+				float f_z = (float)((c & 4) ? box->max[2] : box->min[2]);
+				glVertex3f(f_x / g_wheel + g_offset_x, f_y / g_wheel + g_offset_y, f_z / g_wheel + g_offset_z);
+			}
+		}
 	}
 
 	glEnd();
@@ -851,6 +1605,38 @@ void cbKeyboard(unsigned char key, int x, int y)
 			g_disp_depth = !g_disp_depth;
 			break;
 
+		case 'k':  //! k : Toggle Hiding Of The Detected Plane.
+			g_disp_hide = !g_disp_hide;
+			break;
+
+		case 'n':  //! n : Toggle Shading Of Points By Their Normal.
+			g_disp_lit = !g_disp_lit;
+			break;
+
+		case 'b':  //! b : Toggle Hiding Of Points Seen At A Grazing Angle.
+			g_disp_grazing = !g_disp_grazing;
+			break;
+
+		case 'i':  //! i : Toggle Coloring Of Points By IR Or By Depth.
+			g_disp_ir = !g_disp_ir;
+			break;
+
+		case 'o':  //! o : Toggle Object Boxes.
+			g_disp_box = !g_disp_box;
+			break;
+
+		case 'm':  //! m : Toggle Triangle Mesh Or Points.
+			g_disp_mesh = !g_disp_mesh;
+			break;
+
+		case 'v':  //! v : Toggle Zoom Level Of Detail.
+			g_disp_lod = !g_disp_lod;
+			break;
+
+		case 'x':  //! x : Write The Next Repaint To A PNG File.
+			g_snap_req = true;
+			break;
+
 		case 'w':  //! e : Move Camera Forward.
 			g_eye_z -= 0.1;
 			break;
@@ -909,6 +1695,8 @@ void cbReshape(GLsizei width, GLsizei height)
 	//! For Converting The Mouse Pointer Position To A Relative Position In The Window
 	g_sx = 1.0 / (double) width;
 	g_sy = 1.0 / (double) height;
+	g_vp_w = (width > 0) ? width : 1;
+	g_vp_h = (height > 0) ? height : 1;
 
 	//! Make The Entire Window A Viewport
 	glViewport(0, 0, width, height);
@@ -926,29 +1714,63 @@ void cbReshape(GLsizei width, GLsizei height)
 
 
 //******************************************************************************
-//! \brief        Callback Handler For Window-Repaint Event.
+//! \brief        Take The Last Frame Handed Over By update3dData() For Drawing.
+//! \details      Called By The GL Thread Before Drawing, g_ply Stays Unchanged While Drawing.
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       true      g_ply Is A New Frame
+//! \return       false     g_ply Is The Frame Drawn Before
+//******************************************************************************
+static bool plyAcquire(void)
+{
+	bool fresh;
+	int32_t tmp;
+
+	pthread_mutex_lock(&g_ply_lock);
+	fresh = g_ply_fresh;
+	if (fresh) {
+		tmp = g_ply_draw;
+		g_ply_draw = g_ply_ready;
+		g_ply_ready = tmp;
+		g_ply_fresh = false;
+	}
+	pthread_mutex_unlock(&g_ply_lock);
+
+	g_ply = &g_ply_buf[g_ply_draw];
+	return fresh;
+}
+
+
+//******************************************************************************
+//! \brief        Drop Frames Handed Over Before The View Started.
 //! \n
 //! \param[in]    None.
 //! \param[out]   None.
 //! \return       None.
 //******************************************************************************
-void cbDisplay(void)
+static void plyReset(void)
 {
-	//! \remark Check If glut Inited Before.
-	if (g_glut_inited == false) {
-		//! \remark Check If glutMainLoop() Is Runing, If Not, Destroy Windows And Abort.
-		if (g_glut_running == false) {
-			//! Destroy View Display.
-			if (g_gl_win_id >= 0) {
-				glutSetWindow(g_gl_win_id);
-				glutDestroyWindow(g_gl_win_id);
-				g_gl_win_id = -1;
-			}
-			return;
-		}
-		return;
+	pthread_mutex_lock(&g_ply_lock);
+	for (int i = 0; i < 3; i++) {
+		g_ply_buf[i].meta.seq = META_SEQ_NONE;
+		g_ply_buf[i].gen = PLY_GEN_NONE;
+		g_ply_buf[i].cnt = 0;
 	}
+	g_ply_fresh = false;
+	pthread_mutex_unlock(&g_ply_lock);
+}
 
+
+//******************************************************************************
+//! \brief        Draw The Whole Point Cloud View Into The Current GL Context.
+//! \details      Shared By The GLUT Window And The Off-Screen Renderer.
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+static void renderScene(void)
+{
+	TRACE_BEGIN(TRACE_RENDER);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //! Clear Color And Depth Buffers
 	//glMatrixMode(GL_MODELVIEW);  //! To Operate On Model-View Matrix
 	glLoadIdentity();   //! Reset The Model-View Matrix
@@ -979,8 +1801,91 @@ void cbDisplay(void)
 	//! Draw Depth Point Cloud
 	dispDepthPoints();
 
+	//! ----------------------------------------------------------------------
+	//! Draw Object Boxes
+	dispBoxes();
+
+	TRACE_END(TRACE_RENDER);
+}
+
+
+//******************************************************************************
+//! \brief        Write An RGBA Image Read Back From GL To <prefix>_NNNNNN.png.
+//! \n
+//! \param[in]    rgba      Pixels, Bottom Row First (GL Order).
+//! \param[in]    w         Width.
+//! \param[in]    h         Height.
+//! \param[out]   None.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int snapWrite(const uint8_t *rgba, int w, int h)
+{
+	char path[512];
+	cv::Mat bgr;
+
+	snprintf(path, sizeof(path), "%s_%06d.png", g_snap_prefix, g_snap_idx++);
+
+	cv::cvtColor(cv::Mat(h, w, CV_8UC4, (void *)rgba), bgr, cv::COLOR_RGBA2BGR);
+	cv::flip(bgr, bgr, 0);
+	if (!cv::imwrite(path, bgr)) {
+		printf("snapshot: cannot write %s\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Callback Handler For Window-Repaint Event.
+//! \n
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+void cbDisplay(void)
+{
+	//! \remark Check If glut Inited Before.
+	if (g_glut_inited == false) {
+		//! \remark Check If glutMainLoop() Is Runing, If Not, Destroy Windows And Abort.
+		if (g_glut_running == false) {
+			//! Destroy View Display.
+			if (g_gl_win_id >= 0) {
+				glutSetWindow(g_gl_win_id);
+				glutDestroyWindow(g_gl_win_id);
+				g_gl_win_id = -1;
+			}
+			return;
+		}
+		return;
+	}
+
+	(void) plyAcquire();
+	frame_meta_t meta = g_ply->meta;
+	renderScene();
+
+	//! Read Back Before The Swap, The Back Buffer Is Undefined Afterwards.
+	if (g_snap_req) {
+		g_snap_req = false;
+		std::vector<uint8_t> rgba((size_t)g_vp_w * g_vp_h * 4);
+		glReadPixels(0, 0, g_vp_w, g_vp_h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		(void) snapWrite(rgba.data(), g_vp_w, g_vp_h);
+	}
+
+	TRACE_BEGIN(TRACE_DISPLAY);
 	glFlush();
 	glutSwapBuffers();  //! Swap The Front And Back Frame Buffers (Double Buffering)
+	TRACE_END(TRACE_DISPLAY);
+
+	uint64_t now = getMonoNs();
+	jitterTick(&g_disp_jitter, now);
+
+	//! A Frame Counts Once, On The First Repaint That Shows It.
+	if ((meta.seq != META_SEQ_NONE) && (meta.seq != g_shown_seq)) {
+		g_shown_seq = meta.seq;
+		latencyAdd(&g_disp_latency, &meta, now);
+	}
 }
 
 
@@ -1003,18 +1908,30 @@ void cbRefreshTimer(int value) {
 
 
 //******************************************************************************
-//! \brief        Update Point Cloud Data Into Global Array "g_ply".
+//! \brief        Update Point Cloud Data Into The Next Frame Buffer And Hand It Over To The GL Thread.
 //! \n
-//! \param[in]    ts_ns     Time Stamps In Nano Sec.
-//! \param[in]    ply_dat   Pointer To Point Cloud Data.
-//! \param[in]    ply_cnt   Point Cloud Data Count.
+//! \param[in]    frame     Point Cloud Frame (Organized Grid, Stride And Optional Hide Mask).
 //! \param[out]   None.
 //! \return       None.
 //******************************************************************************
-void update3dData(double ts_ns, int16_t *ply_dat, int32_t ply_cnt)
+void update3dData(const ptcd_frame_t *frame)
 {
 	int32_t i;
-	int16_t *ptr_dat = ply_dat;
+	int32_t u;
+	int32_t v;
+	int32_t ply_w = frame->w;
+	int32_t ply_h = frame->h;
+	int32_t step = frame->step;
+	ptcd_3d_t *ply;
+	int32_t tmp;
+	const int16_t *ptr_dat;
+	const uint8_t *ptr_hide;
+	const uint8_t *ptr_facing;
+	const uint8_t *ptr_gray;
+	const uint8_t *hide = g_disp_hide ? frame->hide : NULL;
+	const uint8_t *facing = (g_disp_lit || g_disp_grazing) ? frame->facing : NULL;
+	const uint8_t *gray = g_disp_ir ? frame->gray : NULL;
+	uint8_t min_facing = g_disp_grazing ? GRAZING_FACING : 0;
 	int16_t x;
 	int16_t y;
 	int16_t z;
@@ -1029,24 +1946,119 @@ void update3dData(double ts_ns, int16_t *ply_dat, int32_t ply_cnt)
 		return;
 	}
 
-	g_ply.ns = ts_ns;  //! Save The Time Stamps.
-	g_ply.cnt = ply_cnt;  //! Save The Data Count.
+	if (step < 1) {
+		step = 1;
+	}
 
-	//! \remark Iterate Through All The Point Cloud Data.
-	for (i = 0; i < g_ply.cnt; i++) {
-		x = *ptr_dat++;
-		y = *ptr_dat++;
-		z = *ptr_dat++;
+	ply = &g_ply_buf[g_ply_fill];  //! Only This Thread Touches The Buffer Being Filled.
+	ply->meta = frame->meta;  //! Save The Capture Record.
+	ply->w = (ply_w + step - 1) / step;  //! Save The Decimated Grid Size.
+	ply->h = (ply_h + step - 1) / step;
+	ply->step = step;
+	ply->cnt = ply->w * ply->h;  //! Save The Data Count.
+	ply->lit = g_disp_lit && (facing != NULL);
+	ply->gray = (gray != NULL);
+
+	//! \remark Save The Object Boxes, z Shifted Like The Points.
+	ply->box_cnt = (frame->box != NULL) ? ((frame->box_cnt < MAX_PLY_BOX) ? frame->box_cnt : MAX_PLY_BOX) : 0;
+	for (i = 0; i < ply->box_cnt; i++) {
+		ply->box[i] = frame->box[i];
+		ply->box[i].min[2] = (int16_t)(ply->box[i].min[2] - g_depth_min);
+		ply->box[i].max[2] = (int16_t)(ply->box[i].max[2] - g_depth_min);
+	}
 
-		g_ply.pt[i].x = (float) x;
-		g_ply.pt[i].y = (float) y;
-		if ( (float) z > (float) g_depth_min ) {
-			g_ply.pt[i].z = (float)(z - g_depth_min);
-		}
-		else {
-			g_ply.pt[i].z = (float)(0xFFFF);
+	//! \remark Iterate Through The Point Cloud Data, Every step-th Row And Column.
+	i = 0;
+	for (v = 0; v < ply_h; v += step) {
+		ptr_dat = frame->xyz + (size_t)v * ply_w * 3;
+		ptr_hide = (hide != NULL) ? (hide + (size_t)v * ply_w) : NULL;
+		ptr_facing = (facing != NULL) ? (facing + (size_t)v * ply_w) : NULL;
+		ptr_gray = (gray != NULL) ? (gray + (size_t)v * ply_w) : NULL;
+		for (u = 0; u < ply_w; u += step) {
+			x = ptr_dat[0];
+			y = ptr_dat[1];
+			z = ptr_dat[2];
+			ptr_dat += step * 3;
+
+			ply->pt[i].x = x;
+			ply->pt[i].y = y;
+			if (ptr_facing != NULL) {
+				ply->shade[i] = (uint8_t)(SHADE_AMBIENT + (((255 - SHADE_AMBIENT) * ptr_facing[u]) >> 8));
+			}
+			if (ptr_gray != NULL) {
+				ply->ir[i] = ptr_gray[u];
+			}
+
+			if ((ptr_hide != NULL) && (ptr_hide[u] != 0)) {
+				ply->pt[i].z = Z_INVALID;
+			}
+			else
+			if ((ptr_facing != NULL) && (ptr_facing[u] < min_facing)) {
+				ply->pt[i].z = Z_INVALID;  //! Grazing Angle Or No Normal (Edges, Flying Pixels).
+			}
+			else
+			if (z > g_depth_min) {
+				ply->pt[i].z = (int16_t)(z - g_depth_min);
+			}
+			else {
+				ply->pt[i].z = Z_INVALID;
+			}
+			i++;
 		}
 	}
+
+	//! \remark Hand The Complete Frame Over, The GL Thread Never Sees One Being Filled.
+	pthread_mutex_lock(&g_ply_lock);
+	tmp = g_ply_ready;
+	g_ply_ready = g_ply_fill;
+	g_ply_fill = tmp;
+	if (++g_ply_gen == PLY_GEN_NONE) {
+		g_ply_gen++;
+	}
+	g_ply_buf[g_ply_ready].gen = g_ply_gen;
+	g_ply_fresh = true;
+	pthread_mutex_unlock(&g_ply_lock);
+}
+
+
+//******************************************************************************
+//! \brief        Set The Refresh Interval Of The Point Cloud View.
+//! \n
+//! \param[in]    ms        Refresh Interval In Milliseconds.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+void setPtCloudRefresh(int ms)
+{
+	g_refresh_ms = (ms > 0) ? ms : 1;
+}
+
+
+//******************************************************************************
+//! \brief        Set Up The GL State And The View Of A New Context.
+//! \n
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+static void glSetup(void)
+{
+	//glClearColor(1.0, 1.0, 1.0, 1.0);     //! Background Color Change (White)
+	//glClearColor(0.0, 0.0, 0.0, 0.0);     //! Background Color Change (Black)
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);   //! Set Background Color To Black And Opaque
+
+	glClearDepth(1.0f);         //! Set Background Depth To Farthest
+	glEnable(GL_DEPTH_TEST);    //! Enable Depth Testing For Z-Culling
+	glDepthFunc(GL_LEQUAL);     //! Set The Type Of Depth-Test
+	glShadeModel(GL_SMOOTH);    //! Enable Smooth Shading
+	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);  //! Nice Perspective Corrections
+	//glOrtho(-1, 1, -1, 1, 2, 4);
+
+	//! Initialization Rotation Setting.
+	resetRotate();
+
+	//! Initialization Of Rotation Matrix.
+	qRot(g_rt, g_cq);
 }
 
 
@@ -1065,6 +2077,7 @@ int mainPtCloudView(float fov_y, float z_far, const char *title)
 
 	g_fov_y = fov_y;
 	g_z_far = z_far;
+	plyReset();
 
 	glutInit(&argc, (char **)argv);
 	g_glut_inited = true;
@@ -1086,22 +2099,7 @@ int mainPtCloudView(float fov_y, float z_far, const char *title)
 	glutKeyboardFunc(cbKeyboard);       //! Register Key Press Callback Function.
 	glutSpecialFunc(cbSpecialKey);      //! Register Special Key Press Callback Function.
 
-	//glClearColor(1.0, 1.0, 1.0, 1.0);     //! Background Color Change (White)
-	//glClearColor(0.0, 0.0, 0.0, 0.0);     //! Background Color Change (Black)
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);   //! Set Background Color To Black And Opaque
-
-	glClearDepth(1.0f);         //! Set Background Depth To Farthest
-	glEnable(GL_DEPTH_TEST);    //! Enable Depth Testing For Z-Culling
-	glDepthFunc(GL_LEQUAL);     //! Set The Type Of Depth-Test
-	glShadeModel(GL_SMOOTH);    //! Enable Smooth Shading
-	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);  //! Nice Perspective Corrections
-	//glOrtho(-1, 1, -1, 1, 2, 4);
-
-	//! Initialization Rotation Setting.
-	resetRotate();
-
-	//! Initialization Of Rotation Matrix.
-	qRot(g_rt, g_cq);
+	glSetup();
 
 	//! Trigger First Timer Call Immediately
 	glutTimerFunc(0, cbRefreshTimer, 0);
@@ -1116,6 +2114,102 @@ int mainPtCloudView(float fov_y, float z_far, const char *title)
 }
 
 
+//******************************************************************************
+//! \brief        Point Cloud View Rendered Off-Screen, Each New Frame Written As A PNG File.
+//! \details      Uses OSMesa (Mesa Software Rasterizer), No Display Server Is Needed. Runs On
+//! \n            The Calling Thread Until frames Are Written Or mainPtCloudViewExit() Is Called.
+//! \param[in]    fov_y     Field Of View.
+//! \param[in]    z_far     Depth Limit.
+//! \param[in]    w         Image Width.
+//! \param[in]    h         Image Height.
+//! \param[in]    frames    Frames To Write, 0 = Until mainPtCloudViewExit().
+//! \param[out]   None.
+//! \return       0         success
+//! \return       -1        failed or not built with PTCD_OSMESA
+//******************************************************************************
+int mainPtCloudViewOffscreen(float fov_y, float z_far, int w, int h, int frames)
+{
+#if defined(PTCD_OSMESA)
+	OSMesaContext ctx;
+	std::vector<uint8_t> buf((size_t)w * h * 4);
+	int n = 0;
+
+	ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+	if (ctx == NULL) {
+		printf("OSMesaCreateContextExt failed\n");
+		return -1;
+	}
+	if (!OSMesaMakeCurrent(ctx, buf.data(), GL_UNSIGNED_BYTE, w, h)) {
+		printf("OSMesaMakeCurrent failed\n");
+		OSMesaDestroyContext(ctx);
+		return -1;
+	}
+
+	g_fov_y = fov_y;
+	g_z_far = z_far;
+	g_offscreen = true;
+	g_gl_win_id = -1;
+
+	glMatrixMode(GL_MODELVIEW);
+	glSetup();
+	cbReshape(w, h);
+
+	//! Let update3dData() Accept Frames.
+	plyReset();
+	g_glut_inited = true;
+	g_glut_running = true;
+
+	//! Each Frame Is Drawn Once, Only After update3dData() Handed All Of It Over.
+	while (g_glut_running && ((frames == 0) || (n < frames))) {
+		if (!plyAcquire()) {
+			usleep(g_refresh_ms * 1000);
+			continue;
+		}
+		frame_meta_t meta = g_ply->meta;
+
+		renderScene();
+
+		TRACE_BEGIN(TRACE_DISPLAY);
+		glFinish();
+		(void) snapWrite(buf.data(), w, h);
+		TRACE_END(TRACE_DISPLAY);
+
+		uint64_t now = getMonoNs();
+		jitterTick(&g_disp_jitter, now);
+		latencyAdd(&g_disp_latency, &meta, now);
+		n++;
+	}
+
+	g_glut_inited = false;
+	g_glut_running = false;
+	OSMesaDestroyContext(ctx);
+
+	return 0;
+#else
+	(void)fov_y;
+	(void)z_far;
+	(void)w;
+	(void)h;
+	(void)frames;
+	printf("off-screen rendering needs a build with -DPTCD_OSMESA=ON\n");
+	return -1;
+#endif
+}
+
+
+//******************************************************************************
+//! \brief        Set The File Name Prefix Of Snapshots.
+//! \n
+//! \param[in]    prefix    Snapshots Are Written As <prefix>_NNNNNN.png.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+void setPtCloudSnapshot(const char *prefix)
+{
+	g_snap_prefix = prefix;
+}
+
+
 //******************************************************************************
 //! \brief        Point Cloud View Main Function To Trigger glutLeaveMainLoop().
 //! \n
@@ -1133,6 +2227,63 @@ void mainPtCloudViewExit(void)
 		g_glut_running = false;
 
 		//! Exit glutMainLoop(), i.e. Enter glutLeaveMainLoop().
-		glutLeaveMainLoop();
+		if (!g_offscreen) {
+			glutLeaveMainLoop();
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Get Frame Interval Statistics Of The Point Cloud View.
+//! \n
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       Statistics Updated On Every Repaint.
+//******************************************************************************
+jitter_t *getPtCloudJitter(void)
+{
+	return &g_disp_jitter;
+}
+
+
+//******************************************************************************
+//! \brief        Get Capture To Screen Latency Statistics Of The Point Cloud View.
+//! \n
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       Statistics Updated On Every Repaint Showing A New Frame.
+//******************************************************************************
+latency_t *getPtCloudLatency(void)
+{
+	return &g_disp_latency;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Share Of Tiles And Points Culled Since The Last Report.
+//! \n
+//! \param[in]    None.
+//! \param[out]   None.
+//! \return       None.
+//******************************************************************************
+void reportPtCloudCull(void)
+{
+	pthread_mutex_lock(&g_cull.lock);
+
+	if ((g_cull.frames > 0) && (g_cull.tiles > 0)) {
+		printf("cull 3d view: tiles=%.0f/frame culled=%.1f%% points culled=%.1f%% lod=%d\n",
+				(double)g_cull.tiles / g_cull.frames,
+				100.0 * g_cull.tiles_out / g_cull.tiles,
+				(g_cull.pts > 0) ? (100.0 * g_cull.pts_out / g_cull.pts) : 0.0,
+				1 << g_lod.level);
 	}
+
+	g_cull.frames = 0;
+	g_cull.tiles = 0;
+	g_cull.tiles_out = 0;
+	g_cull.pts = 0;
+	g_cull.pts_out = 0;
+
+	pthread_mutex_unlock(&g_cull.lock);
 }
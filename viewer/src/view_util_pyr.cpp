@@ -0,0 +1,214 @@
+//******************************************************************************
+//! \file       view_util_pyr.cpp
+//! \brief      Depth Pyramid By The Nearest Valid Depth Of Each 2 x 2 Block.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_pyr.h"
+#include "view_util_align.h"
+#include "view_util_para.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define PYR_ROW_GRAIN       (16)    //!< Rows Per Pool Block.
+
+//! Job Context.
+typedef struct _pyr_job_t {
+	depth_pyr_t *pyr;
+	int32_t l;              //!< Level To Fill.
+} pyr_job_t;
+
+
+//******************************************************************************
+//! \brief        Halve A Level Into The Next One (Pool Job Body).
+//! \details      Each Pixel Is The Nearest Valid Depth Of Its 2 x 2 Block, So Holes Do Not Eat
+//! \n            Into Surfaces And Edges Are Not Blended Into Flying Points. Subtracting 1
+//! \n            Wraps Invalid 0 To 65535, Which Loses Every Unsigned Minimum.
+//! \param[in]    ctx       pyr_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void pyrDownJob(void *ctx, int32_t begin, int32_t end)
+{
+	pyr_job_t *job = (pyr_job_t *)ctx;
+	depth_pyr_t *pyr = job->pyr;
+	int32_t sw = pyr->w[job->l - 1];
+	int32_t dw = pyr->w[job->l];
+
+	for (int32_t v = begin; v < end; v++) {
+		const uint16_t *r0 = pyr->depth[job->l - 1] + (size_t)(2 * v) * sw;
+		const uint16_t *r1 = r0 + sw;
+		uint16_t *dst = pyr->buf[job->l] + (size_t)v * dw;
+		int32_t u = 0;
+
+#if defined(__ARM_NEON)
+		const uint16x8_t one = vdupq_n_u16(1);
+
+		for (; u + 8 <= dw; u += 8) {
+			uint16x8_t m0 = vminq_u16(vsubq_u16(vld1q_u16(r0 + 2 * u), one), vsubq_u16(vld1q_u16(r1 + 2 * u), one));
+			uint16x8_t m1 = vminq_u16(vsubq_u16(vld1q_u16(r0 + 2 * u + 8), one), vsubq_u16(vld1q_u16(r1 + 2 * u + 8), one));
+			uint16x8x2_t p = vuzpq_u16(m0, m1);
+
+			vst1q_u16(dst + u, vaddq_u16(vminq_u16(p.val[0], p.val[1]), one));
+		}
+#elif defined(__SSE2__)
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i lo = _mm_set1_epi32(0xFFFF);
+		const __m128i bias = _mm_set1_epi16((short)0x8000);
+
+		for (; u + 8 <= dw; u += 8) {
+			__m128i a0 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(r0 + 2 * u)), one);
+			__m128i a1 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(r0 + 2 * u + 8)), one);
+			__m128i b0 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(r1 + 2 * u)), one);
+			__m128i b1 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(r1 + 2 * u + 8)), one);
+			__m128i m0 = _mm_sub_epi16(a0, _mm_subs_epu16(a0, b0));    // min(a0, b0)
+			__m128i m1 = _mm_sub_epi16(a1, _mm_subs_epu16(a1, b1));
+			__m128i e0 = _mm_and_si128(m0, lo);
+			__m128i e1 = _mm_and_si128(m1, lo);
+			__m128i h0 = _mm_sub_epi16(e0, _mm_subs_epu16(e0, _mm_srli_epi32(m0, 16)));
+			__m128i h1 = _mm_sub_epi16(e1, _mm_subs_epu16(e1, _mm_srli_epi32(m1, 16)));
+
+			//! \remark - Biased To Signed And Sign Extended, So The Signed Pack Keeps Every Value.
+			h0 = _mm_srai_epi32(_mm_slli_epi32(_mm_xor_si128(_mm_add_epi16(h0, one), bias), 16), 16);
+			h1 = _mm_srai_epi32(_mm_slli_epi32(_mm_xor_si128(_mm_add_epi16(h1, one), bias), 16), 16);
+			_mm_storeu_si128((__m128i *)(dst + u), _mm_xor_si128(_mm_packs_epi32(h0, h1), bias));
+		}
+#endif
+
+		for (; u < dw; u++) {
+			uint16_t a = (uint16_t)(r0[2 * u] - 1);
+			uint16_t b = (uint16_t)(r0[2 * u + 1] - 1);
+			uint16_t c = (uint16_t)(r1[2 * u] - 1);
+			uint16_t d = (uint16_t)(r1[2 * u + 1] - 1);
+
+			a = (a < b) ? a : b;
+			c = (c < d) ? c : d;
+			dst[u] = (uint16_t)(((a < c) ? a : c) + 1);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Prepare The Buffers Of A Pyramid.
+//! \n
+//! \param[out]   pyr       Pyramid.
+//! \param[in]    w         Depth image width.
+//! \param[in]    h         Depth image height.
+//! \param[in]    cam       Intrinsics of the depth image.
+//! \param[in]    levels    Levels including the input (1..PYR_LEVELS), 1 = no pyramid.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int pyrInit(depth_pyr_t *pyr, int32_t w, int32_t h, const cam_intr_t *cam, int32_t levels)
+{
+	memset(pyr, 0, sizeof(*pyr));
+
+	if ((w <= 0) || (h <= 0) || (cam == NULL) || (levels < 1) || (levels > PYR_LEVELS)) {
+		return -1;
+	}
+
+	pyr->levels = levels;
+	for (int32_t l = 0; l < levels; l++) {
+		pyr->w[l] = w >> l;
+		pyr->h[l] = h >> l;
+		pyr->cam[l] = camScale(cam, l);
+		if (l == 0) {
+			continue;
+		}
+
+		pyr->buf[l] = (uint16_t *)calloc((size_t)pyr->w[l] * pyr->h[l], sizeof(uint16_t));
+		pyr->xyz[l] = (int16_t *)calloc((size_t)pyr->w[l] * pyr->h[l] * 3, sizeof(int16_t));
+		if ((pyr->buf[l] == NULL) || (pyr->xyz[l] == NULL)) {
+			pyrTerm(pyr);
+			return -1;
+		}
+		pyr->depth[l] = pyr->buf[l];
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release The Buffers Of A Pyramid.
+//! \n
+//! \param[in]    pyr       Pyramid.
+//! \return       None.
+//******************************************************************************
+void pyrTerm(depth_pyr_t *pyr)
+{
+	for (int32_t l = 0; l < PYR_LEVELS; l++) {
+		free(pyr->buf[l]);
+		free(pyr->xyz[l]);
+		pyr->buf[l] = NULL;
+		pyr->xyz[l] = NULL;
+		pyr->depth[l] = NULL;
+	}
+	pyr->levels = 0;
+}
+
+
+//******************************************************************************
+//! \brief        Build All Levels From A Depth Image.
+//! \n            Each Level Runs On The Worker Pool, The Input Is Referenced, Not Copied.
+//! \param[in]    pyr       Pyramid.
+//! \param[in]    depth     Depth image in mm, 0 = invalid; must stay valid while the levels are used.
+//! \return       0         success
+//! \return       -1        no pyramid
+//******************************************************************************
+int pyrBuild(depth_pyr_t *pyr, const uint16_t *depth)
+{
+	pyr_job_t job;
+
+	if ((pyr->levels < 1) || (depth == NULL)) {
+		return -1;
+	}
+
+	pyr->depth[0] = depth;
+	job.pyr = pyr;
+	for (int32_t l = 1; l < pyr->levels; l++) {
+		job.l = l;
+		paraFor(pyrDownJob, &job, pyr->h[l], PYR_ROW_GRAIN);
+	}
+
+	return (pyr->levels > 1) ? 0 : -1;
+}
+
+
+//******************************************************************************
+//! \brief        Convert A Level To An Organized Point Cloud.
+//! \n            Pinhole Model Of The Level; Level 0 Is Converted By The ToF Library Instead.
+//! \param[in]    pyr       Pyramid, built.
+//! \param[in]    level     Level, 1..levels - 1.
+//! \return       w[level] x h[level] points x/y/z in mm (z = 0 = invalid), NULL = no such level.
+//******************************************************************************
+const int16_t *pyrConvert(depth_pyr_t *pyr, int32_t level)
+{
+	if ((level < 1) || (level >= pyr->levels)) {
+		return NULL;
+	}
+
+	alignConvert(pyr->depth[level], pyr->w[level], pyr->h[level], &pyr->cam[level], pyr->xyz[level]);
+
+	return pyr->xyz[level];
+}
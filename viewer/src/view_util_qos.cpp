@@ -0,0 +1,130 @@
+//******************************************************************************
+//! \file       view_util_qos.cpp
+//! \brief      Adaptive Quality Controller.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <string.h>
+
+#include "tl_log.h"
+#include "view_util_qos.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+static const qos_setting_t g_qos_setting[QOS_LEVEL_NUM] = {
+	{ 1, true,  30, "full" },
+	{ 2, true,  30, "decimate x2" },
+	{ 2, false, 30, "decimate x2, no ir/bg" },
+	{ 4, false, 60, "decimate x4, no ir/bg, half render rate" },
+};
+
+
+//******************************************************************************
+//! \brief        Initialize The Controller At Full Quality.
+//! \n
+//! \param[out]   qos       Controller.
+//! \param[in]    budget_ms Frame budget in milliseconds.
+//! \param[in]    enable    false = never degrade.
+//! \return       None.
+//******************************************************************************
+void qosInit(qos_t *qos, double budget_ms, bool enable)
+{
+	memset(qos, 0, sizeof(*qos));
+	qos->enable = enable;
+	qos->budget_ms = budget_ms;
+	qos->level = QOS_LEVEL_FULL;
+}
+
+
+//******************************************************************************
+//! \brief        Feed One Processed Frame And Step The Quality Level If Needed.
+//! \details      Degrades After QOS_DEGRADE_FRAMES Consecutive Frames Over Budget, Dropped
+//! \n            Or Queued Up; Restores One Level After QOS_RESTORE_FRAMES Quiet Frames.
+//! \param[in]    qos           Controller.
+//! \param[in]    proc_ms       Processing time of this frame.
+//! \param[in]    drops         Frames dropped since the previous call.
+//! \param[in]    queue_depth   Frames waiting in the deepest downstream queue.
+//! \return       true          The level changed.
+//******************************************************************************
+bool qosUpdate(qos_t *qos, double proc_ms, uint32_t drops, int queue_depth)
+{
+	int level = qos->level;
+	bool over;
+	bool under;
+
+	qos->load += QOS_LOAD_ALPHA * (proc_ms / qos->budget_ms - qos->load);
+	qos->drops += drops;
+	qos->queue_depth = queue_depth;
+
+	if (!qos->enable) {
+		return false;
+	}
+
+	over = (qos->load > QOS_LOAD_HIGH) || (drops > 0) || (queue_depth > QOS_QUEUE_HIGH);
+	under = (qos->load < QOS_LOAD_LOW) && (drops == 0) && (queue_depth == 0);
+
+	qos->over_cnt = over ? (qos->over_cnt + 1) : 0;
+	qos->under_cnt = under ? (qos->under_cnt + 1) : 0;
+
+	if ((qos->over_cnt >= QOS_DEGRADE_FRAMES) && (level < QOS_LEVEL_NUM - 1)) {
+		level++;
+	}
+	else
+	if ((qos->under_cnt >= QOS_RESTORE_FRAMES) && (level > QOS_LEVEL_FULL)) {
+		level--;
+	}
+
+	if (level == qos->level) {
+		return false;
+	}
+
+	TL_LGI("qos: level %d (%s) -> %d (%s), load=%.2f drops=%u queue=%d",
+			qos->level, g_qos_setting[qos->level].name, level, g_qos_setting[level].name,
+			qos->load, drops, queue_depth);
+
+	qos->level = level;
+	qos->over_cnt = 0;
+	qos->under_cnt = 0;
+	qos->transitions++;
+
+	return true;
+}
+
+
+//******************************************************************************
+//! \brief        Get The Settings Of The Current Level.
+//! \n
+//! \param[in]    qos       Controller.
+//! \return       Settings.
+//******************************************************************************
+const qos_setting_t *qosSetting(const qos_t *qos)
+{
+	return &g_qos_setting[qos->level];
+}
+
+
+//******************************************************************************
+//! \brief        Print The Current Level, Load And Drops Since The Last Report.
+//! \n
+//! \param[in]    qos       Controller.
+//! \param[in]    name      Name of the controlled pipeline.
+//! \return       None.
+//******************************************************************************
+void qosReport(qos_t *qos, const char *name)
+{
+	uint32_t drops = qos->drops;
+
+	printf("qos %s: level=%d (%s) load=%.2f drops=%u queue=%d transitions=%u\n",
+			name, qos->level, g_qos_setting[qos->level].name, qos->load,
+			drops - qos->drops_rep, qos->queue_depth, qos->transitions);
+	qos->drops_rep = drops;
+}
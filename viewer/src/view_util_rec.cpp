@@ -0,0 +1,306 @@
+//******************************************************************************
+//! \file       view_util_rec.cpp
+//! \brief      Video Recording On A Background Thread Fed Through A Bounded Queue.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "tl_log.h"
+#include "view_util_rec.h"
+#include "view_util_time.h"
+#include "view_util_trace.h"
+
+
+//******************************************************************************
+//! \brief        Encode One Frame, Opening The File On The First One.
+//! \details      16 Bit Images Are Scaled To 8 Bit The Way imshow() Shows Them.
+//! \param[in]    rec       Recorder.
+//! \param[in]    img       Frame.
+//! \param[in]    meta      Capture record of the frame, written to the time stamp file.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int recEncode(rec_t *rec, const cv::Mat &img, const frame_meta_t *meta)
+{
+	cv::Mat img8;
+	const cv::Mat *out = &img;
+
+	if (img.depth() == CV_16U) {
+		img.convertTo(img8, CV_8U, 1.0 / 256);
+		out = &img8;
+	}
+
+	if (rec->writer == NULL) {
+		const char *ext = strrchr(rec->path, '.');
+		int fourcc = ((ext != NULL) && (strcasecmp(ext, ".avi") == 0)) ?
+				cv::VideoWriter::fourcc('M', 'J', 'P', 'G') : cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+
+		rec->writer = new cv::VideoWriter(rec->path, fourcc, rec->fps, out->size(), out->channels() == 3);
+		if (!rec->writer->isOpened()) {
+			TL_LGE("%s: cannot open %s for writing", rec->name, rec->path);
+			return -1;
+		}
+		TL_LGI("%s: recording %dx%d at %.1f fps to %s", rec->name, out->cols, out->rows, rec->fps, rec->path);
+	}
+
+	rec->writer->write(*out);
+
+	//! \remark - The Video Only Knows A Fixed Rate, The Real Capture Times Go Next To It.
+	if (rec->stamp != NULL) {
+		fprintf(rec->stamp, "%u,%llu,%u,%d,%u\n", meta->seq, (unsigned long long)meta->cap_ns,
+				meta->mode_idx, meta->temp, meta->drop_gap);
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Encoder Thread, Takes Frames From The Queue Until recTerm().
+//! \n
+//! \param[in]    data      Recorder.
+//! \return       NULL
+//******************************************************************************
+static void *recThread(void *data)
+{
+	rec_t *rec = (rec_t *)data;
+
+	if (g_trace_enable) {
+		traceSetThreadName(rec->name);
+	}
+
+	for (;;) {
+		cv::Mat *img;
+		frame_meta_t meta;
+		uint64_t t0;
+		double ms;
+		int ret;
+
+		pthread_mutex_lock(&rec->lock);
+		while ((rec->head == rec->tail) && !rec->exit) {
+			pthread_cond_wait(&rec->cond, &rec->lock);
+		}
+		if (rec->head == rec->tail) {
+			pthread_mutex_unlock(&rec->lock);
+			break;
+		}
+		img = &rec->slot[rec->head % REC_QUEUE_LEN];
+		meta = rec->meta[rec->head % REC_QUEUE_LEN];
+		pthread_mutex_unlock(&rec->lock);
+
+		//! \remark - The Slot Belongs To This Thread Until head Moves On.
+		t0 = getMonoNs();
+		TRACE_BEGIN(TRACE_ENCODE);
+		ret = rec->failed ? -1 : recEncode(rec, *img, &meta);
+		TRACE_END(TRACE_ENCODE);
+		ms = (double)(getMonoNs() - t0) * 1e-6;
+		if (ret == 0) {
+			latencyAdd(&rec->latency, &meta, getMonoNs());
+		}
+
+		pthread_mutex_lock(&rec->lock);
+		rec->head++;
+		if (ret == 0) {
+			rec->written++;
+			rec->written_total++;
+			rec->ms_sum += ms;
+			if (ms > rec->ms_max) {
+				rec->ms_max = ms;
+			}
+		}
+		else {
+			rec->failed = true;
+		}
+		pthread_mutex_unlock(&rec->lock);
+	}
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare A Recorder And Start Its Encoder Thread.
+//! \n
+//! \param[out]   rec       Recorder.
+//! \param[in]    path      Output file, NULL = disabled.
+//! \param[in]    fps       Frame rate stored in the file.
+//! \param[in]    name      Name of the encoder thread in logs and reports.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int recInit(rec_t *rec, const char *path, double fps, const char *name)
+{
+	memset(rec, 0, sizeof(*rec));
+	pthread_mutex_init(&rec->lock, NULL);
+	pthread_cond_init(&rec->cond, NULL);
+	snprintf(rec->name, sizeof(rec->name), "%s", name);
+	latencyInit(&rec->latency);
+
+	if (path == NULL) {
+		return 0;
+	}
+
+	snprintf(rec->path, sizeof(rec->path), "%s", path);
+
+	char stamp_path[sizeof(rec->path) + 8];
+	snprintf(stamp_path, sizeof(stamp_path), "%s.csv", path);
+	rec->stamp = fopen(stamp_path, "w");
+	if (rec->stamp == NULL) {
+		TL_LGW("%s: cannot open %s, no time stamps are recorded", name, stamp_path);
+	}
+	else {
+		fprintf(rec->stamp, "seq,capture_ns,mode_idx,temp,drop_gap\n");
+	}
+
+	rec->fps = (fps > 0) ? fps : 30;
+	rec->report_ns = getMonoNs();
+	rec->slot = new cv::Mat[REC_QUEUE_LEN];
+
+	if (pthread_create(&rec->thread, NULL, recThread, rec) != 0) {
+		recTerm(rec);
+		return -1;
+	}
+	rec->thread_created = true;
+	rec->enable = true;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Encode The Queued Frames, Stop The Encoder Thread And Close The File.
+//! \n
+//! \param[in]    rec       Recorder.
+//! \return       None.
+//******************************************************************************
+void recTerm(rec_t *rec)
+{
+	rec->enable = false;
+
+	if (rec->thread_created) {
+		pthread_mutex_lock(&rec->lock);
+		rec->exit = true;
+		pthread_cond_signal(&rec->cond);
+		pthread_mutex_unlock(&rec->lock);
+
+		pthread_join(rec->thread, NULL);
+		rec->thread_created = false;
+
+		printf("%s: %u frames written, %u dropped (%s)\n", rec->name, rec->written_total, rec->dropped_total, rec->path);
+	}
+
+	if (rec->stamp != NULL) {
+		fclose(rec->stamp);
+		rec->stamp = NULL;
+	}
+
+	delete rec->writer;
+	delete[] rec->slot;
+	rec->writer = NULL;
+	rec->slot = NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Queue A Frame For Encoding Without Waiting For The Encoder.
+//! \n            When The Queue Is Full The Frame Is Counted And Dropped.
+//! \param[in]    rec       Recorder.
+//! \param[in]    img       Frame, copied.
+//! \param[in]    meta      Capture record of the frame, copied.
+//! \return       None.
+//******************************************************************************
+void recPush(rec_t *rec, const cv::Mat &img, const frame_meta_t *meta)
+{
+	uint32_t idx;
+
+	if (!rec->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&rec->lock);
+	if (rec->failed || (rec->tail - rec->head >= REC_QUEUE_LEN)) {
+		rec->dropped++;
+		rec->dropped_total++;
+		pthread_mutex_unlock(&rec->lock);
+		return;
+	}
+	idx = rec->tail % REC_QUEUE_LEN;
+	pthread_mutex_unlock(&rec->lock);
+
+	//! \remark - Copy Outside The Lock, The Slot Is Not Visible To The Encoder Before tail Moves On.
+	img.copyTo(rec->slot[idx]);
+	rec->meta[idx] = *meta;
+
+	pthread_mutex_lock(&rec->lock);
+	rec->tail++;
+	pthread_cond_signal(&rec->cond);
+	pthread_mutex_unlock(&rec->lock);
+}
+
+
+//******************************************************************************
+//! \brief        Frames Waiting For The Encoder.
+//! \n
+//! \param[in]    rec       Recorder.
+//! \return       Queued frames, 0 when disabled.
+//******************************************************************************
+int recQueued(rec_t *rec)
+{
+	int n;
+
+	if (!rec->enable) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&rec->lock);
+	n = (int)(rec->tail - rec->head);
+	pthread_mutex_unlock(&rec->lock);
+
+	return n;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Encoder Frame Rate And Dropped Frames Since The Last Report.
+//! \n
+//! \param[in]    rec       Recorder.
+//! \return       None.
+//******************************************************************************
+void recReport(rec_t *rec)
+{
+	uint64_t now = getMonoNs();
+
+	if (!rec->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&rec->lock);
+
+	double sec = (double)(now - rec->report_ns) * 1e-9;
+	printf("%s: %.1f fps dropped=%u queued=%u encode mean=%.2f ms max=%.2f ms%s\n",
+			rec->name, (sec > 0) ? (rec->written / sec) : 0.0, rec->dropped, rec->tail - rec->head,
+			(rec->written > 0) ? (rec->ms_sum / rec->written) : 0.0, rec->ms_max,
+			rec->failed ? " (failed)" : "");
+
+	rec->report_ns = now;
+	rec->written = 0;
+	rec->dropped = 0;
+	rec->ms_sum = 0;
+	rec->ms_max = 0;
+
+	pthread_mutex_unlock(&rec->lock);
+
+	latencyReport(&rec->latency, rec->name);
+}
@@ -0,0 +1,284 @@
+//******************************************************************************
+//! \file       view_util_sched.cpp
+//! \brief      Thread Scheduling Utilities Function.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "view_util_sched.h"
+
+
+//******************************************************************************
+//! \brief        Parse A Core List Such As "4-7" Or "0,2,4-5".
+//! \n
+//! \param[in]    str       Core list.
+//! \param[out]   cpus      Core set.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int schedParseCpus(const char *str, cpu_set_t *cpus)
+{
+	const char *p = str;
+	char *end;
+
+	CPU_ZERO(cpus);
+
+	while (*p != '\0') {
+		long first = strtol(p, &end, 10);
+		long last = first;
+
+		if ((end == p) || (first < 0) || (first >= CPU_SETSIZE)) {
+			return -1;
+		}
+		p = end;
+
+		if (*p == '-') {
+			p++;
+			last = strtol(p, &end, 10);
+			if ((end == p) || (last < first) || (last >= CPU_SETSIZE)) {
+				return -1;
+			}
+			p = end;
+		}
+
+		for (long c = first; c <= last; c++) {
+			CPU_SET(c, cpus);
+		}
+
+		if (*p == ',') {
+			p++;
+		}
+		else
+		if (*p != '\0') {
+			return -1;
+		}
+	}
+
+	return (CPU_COUNT(cpus) > 0) ? 0 : -1;
+}
+
+
+//******************************************************************************
+//! \brief        Parse A Scheduling Setting "policy[:priority[:cpus]]".
+//! \n            e.g. "fifo:80:4-7", "other:0:0-3", "fifo:50".
+//! \param[in]    spec      Setting string.
+//! \param[out]   cfg       Parsed setting.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int schedParse(const char *spec, sched_cfg_t *cfg)
+{
+	char buf[128];
+	char *policy;
+	char *prio;
+	char *cpus;
+
+	memset(cfg, 0, sizeof(*cfg));
+
+	if ((spec == NULL) || (strlen(spec) >= sizeof(buf))) {
+		return -1;
+	}
+	strcpy(buf, spec);
+
+	policy = buf;
+	prio = strchr(policy, ':');
+	if (prio != NULL) {
+		*prio++ = '\0';
+	}
+	cpus = (prio != NULL) ? strchr(prio, ':') : NULL;
+	if (cpus != NULL) {
+		*cpus++ = '\0';
+	}
+
+	if (strcmp(policy, "fifo") == 0) {
+		cfg->policy = SCHED_FIFO;
+	}
+	else
+	if (strcmp(policy, "other") == 0) {
+		cfg->policy = SCHED_OTHER;
+	}
+	else {
+		printf("Unknown scheduling policy \"%s\" (fifo or other)\n", policy);
+		return -1;
+	}
+
+	cfg->priority = ((prio != NULL) && (*prio != '\0')) ? atoi(prio) : ((cfg->policy == SCHED_FIFO) ? 50 : 0);
+	if ((cfg->priority < sched_get_priority_min(cfg->policy)) ||
+		(cfg->priority > sched_get_priority_max(cfg->policy))) {
+		printf("Priority %d out of range for \"%s\" (%d..%d)\n", cfg->priority, policy,
+				sched_get_priority_min(cfg->policy), sched_get_priority_max(cfg->policy));
+		return -1;
+	}
+
+	if ((cpus != NULL) && (*cpus != '\0')) {
+		if (schedParseCpus(cpus, &cfg->cpus) != 0) {
+			printf("Invalid core list \"%s\"\n", cpus);
+			return -1;
+		}
+		cfg->cpus_valid = true;
+	}
+
+	cfg->valid = true;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Apply A Scheduling Setting To A Running Thread.
+//! \n
+//! \param[in]    thread    Thread handle.
+//! \param[in]    cfg       Scheduling setting.
+//! \param[in]    name      Thread name for messages.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int schedApply(pthread_t thread, const sched_cfg_t *cfg, const char *name)
+{
+	struct sched_param param;
+	int ret;
+	int result = 0;
+
+	if ((cfg == NULL) || !cfg->valid) {
+		return 0;
+	}
+
+	if (cfg->cpus_valid) {
+		ret = pthread_setaffinity_np(thread, sizeof(cfg->cpus), &cfg->cpus);
+		if (ret != 0) {
+			printf("[%s] pthread_setaffinity_np failed (%s)\n", name, strerror(ret));
+			result = -1;
+		}
+	}
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = cfg->priority;
+	ret = pthread_setschedparam(thread, cfg->policy, &param);
+	if (ret != 0) {
+		//! \remark SCHED_FIFO Needs Root Or CAP_SYS_NICE.
+		printf("[%s] pthread_setschedparam failed (%s)\n", name, strerror(ret));
+		result = -1;
+	}
+
+	return result;
+}
+
+
+//******************************************************************************
+//! \brief        Print The Actual Policy, Priority And Cores Of A Thread.
+//! \n
+//! \param[in]    thread    Thread handle.
+//! \param[in]    name      Thread name.
+//! \return       None.
+//******************************************************************************
+void schedPrint(pthread_t thread, const char *name)
+{
+	struct sched_param param;
+	cpu_set_t cpus;
+	int policy;
+
+	if (pthread_getschedparam(thread, &policy, &param) != 0) {
+		return;
+	}
+
+	printf("[%s] policy=%s priority=%d cpus=", name,
+			(policy == SCHED_FIFO) ? "fifo" : (policy == SCHED_RR) ? "rr" : "other", param.sched_priority);
+
+	if (pthread_getaffinity_np(thread, sizeof(cpus), &cpus) == 0) {
+		const char *sep = "";
+		for (int c = 0; c < CPU_SETSIZE; c++) {
+			if (CPU_ISSET(c, &cpus)) {
+				printf("%s%d", sep, c);
+				sep = ",";
+			}
+		}
+	}
+	printf("\n");
+}
+
+
+//******************************************************************************
+//! \brief        Initialize Frame Interval Statistics.
+//! \n
+//! \param[out]   jit       Statistics.
+//! \return       None.
+//******************************************************************************
+void jitterInit(jitter_t *jit)
+{
+	pthread_mutex_init(&jit->lock, NULL);
+	jit->last_ns = 0;
+	jit->cnt = 0;
+	jit->mean = 0;
+	jit->m2 = 0;
+	jit->min = 0;
+	jit->max = 0;
+}
+
+
+//******************************************************************************
+//! \brief        Record One Frame, Accumulating The Interval From The Previous One.
+//! \n
+//! \param[in]    jit       Statistics.
+//! \param[in]    ns        CLOCK_MONOTONIC Time Stamp Of The Frame In Nano Sec.
+//! \return       None.
+//******************************************************************************
+void jitterTick(jitter_t *jit, uint64_t ns)
+{
+	pthread_mutex_lock(&jit->lock);
+
+	if (jit->last_ns != 0) {
+		double ms = (double)(ns - jit->last_ns) * 1e-6;
+		double delta = ms - jit->mean;
+
+		jit->cnt++;
+		jit->mean += delta / jit->cnt;
+		jit->m2 += delta * (ms - jit->mean);
+
+		if ((jit->cnt == 1) || (ms < jit->min)) {
+			jit->min = ms;
+		}
+		if ((jit->cnt == 1) || (ms > jit->max)) {
+			jit->max = ms;
+		}
+	}
+	jit->last_ns = ns;
+
+	pthread_mutex_unlock(&jit->lock);
+}
+
+
+//******************************************************************************
+//! \brief        Print Frame Interval Mean/Stddev/Min/Max Since The Last Report And Restart.
+//! \n
+//! \param[in]    jit       Statistics.
+//! \param[in]    name      Name of the measured stream.
+//! \return       None.
+//******************************************************************************
+void jitterReport(jitter_t *jit, const char *name)
+{
+	pthread_mutex_lock(&jit->lock);
+
+	if (jit->cnt > 1) {
+		printf("jitter %s: n=%u interval mean=%.3f ms stddev=%.3f ms min=%.3f ms max=%.3f ms\n",
+				name, jit->cnt, jit->mean, sqrt(jit->m2 / (jit->cnt - 1)), jit->min, jit->max);
+	}
+
+	//! \remark Keep last_ns So The Next Window Starts With A Valid Interval.
+	jit->cnt = 0;
+	jit->mean = 0;
+	jit->m2 = 0;
+	jit->min = 0;
+	jit->max = 0;
+
+	pthread_mutex_unlock(&jit->lock);
+}
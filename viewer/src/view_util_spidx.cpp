@@ -0,0 +1,625 @@
+//******************************************************************************
+//! \file       view_util_spidx.cpp
+//! \brief      Hashed Voxel Grid Over The Point Cloud, Built By A Parallel Counting Sort.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "view_util_spidx.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define SPIDX_ROW_GRAIN     (16)    //!< Grid Rows Per Pool Block.
+#define SPIDX_SCAN_GRAIN    (16384) //!< Buckets Per Block Of The Prefix Sum.
+#define SPIDX_QUERY_GRAIN   (4096)  //!< Queries Per Pool Block.
+#define SPIDX_RANGE_MAX     (4)     //!< Queries Reach At Most This Many Cells Out, Larger Radii Are Clamped.
+#define SPIDX_OFF_MAX       ((2 * SPIDX_RANGE_MAX + 1) * (2 * SPIDX_RANGE_MAX + 1) * (2 * SPIDX_RANGE_MAX + 1))
+#define SPIDX_BUCKET_MIN    (1024)
+
+//! Job Context.
+typedef struct _spidx_job_t {
+	const spidx_t *idx;
+	spidx_t *out;           //!< Index Being Built.
+	const int16_t *xyz;     //!< Grid Or Query Points.
+	float radius;           //!< Query Radius In mm.
+	int32_t *nn;            //!< Nearest Point Per Query.
+	float *dist;            //!< Its Distance.
+	uint16_t *cnt;          //!< Neighbours Per Query.
+	uint32_t cap;           //!< Counting Stops Here.
+} spidx_job_t;
+
+
+//******************************************************************************
+//! \brief        Bucket Of A Cell.
+//! \n
+//! \param[in]    ix        Cell x.
+//! \param[in]    iy        Cell y.
+//! \param[in]    iz        Cell z.
+//! \param[in]    mask      Buckets - 1.
+//! \return       Bucket.
+//******************************************************************************
+static inline uint32_t spidxHash(int32_t ix, int32_t iy, int32_t iz, uint32_t mask)
+{
+	return (((uint32_t)ix * 73856093U) ^ ((uint32_t)iy * 19349663U) ^ ((uint32_t)iz * 83492791U)) & mask;
+}
+
+
+//******************************************************************************
+//! \brief        Cell Of A Coordinate.
+//! \n
+//! \param[in]    v         Coordinate in mm.
+//! \param[in]    inv       1 / cell.
+//! \return       Cell index.
+//******************************************************************************
+static inline int32_t spidxCell(float v, float inv)
+{
+	return (int32_t)floorf(v * inv);
+}
+
+
+//******************************************************************************
+//! \brief        Bucket Each Point And Count The Buckets (Pool Job Body).
+//! \n
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxKeyJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_job_t *job = (spidx_job_t *)ctx;
+	spidx_t *idx = job->out;
+	float inv = idx->inv_cell;
+
+	for (int32_t i = begin * idx->w; i < end * idx->w; i++) {
+		const int16_t *p = job->xyz + (size_t)i * 3;
+
+		if (p[2] <= 0) {
+			idx->key[i] = SPIDX_NONE;
+			continue;
+		}
+
+		uint32_t b = spidxHash(spidxCell(p[0], inv), spidxCell(p[1], inv), spidxCell(p[2], inv), idx->mask);
+		idx->key[i] = b;
+		__atomic_fetch_add(&idx->start[b], 1U, __ATOMIC_RELAXED);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Inclusive Prefix Sum Within A Block Of Buckets (Pool Job Body).
+//! \n
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First bucket, a multiple of SPIDX_SCAN_GRAIN.
+//! \param[in]    end       Bucket after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxScanJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_t *idx = ((spidx_job_t *)ctx)->out;
+	uint32_t sum = 0;
+
+	for (int32_t b = begin; b < end; b++) {
+		sum += idx->start[b];
+		idx->start[b] = sum;
+	}
+	idx->scan[begin / SPIDX_SCAN_GRAIN] = sum;
+}
+
+
+//******************************************************************************
+//! \brief        Add The Total Of The Preceding Blocks (Pool Job Body).
+//! \n
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First bucket, a multiple of SPIDX_SCAN_GRAIN.
+//! \param[in]    end       Bucket after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxOffsetJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_t *idx = ((spidx_job_t *)ctx)->out;
+	uint32_t off = idx->scan[begin / SPIDX_SCAN_GRAIN];
+
+	for (int32_t b = begin; b < end; b++) {
+		idx->start[b] += off;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Place Each Point In Its Bucket (Pool Job Body).
+//! \details      start[b] Holds The End Of Bucket b And Is Counted Down, So Afterwards It Holds
+//! \n            Its Beginning. The Order Within A Bucket Depends On The Threads.
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxScatterJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_job_t *job = (spidx_job_t *)ctx;
+	spidx_t *idx = job->out;
+
+	for (int32_t i = begin * idx->w; i < end * idx->w; i++) {
+		uint32_t b = idx->key[i];
+
+		if (b == SPIDX_NONE) {
+			continue;
+		}
+
+		uint32_t pos = __atomic_sub_fetch(&idx->start[b], 1U, __ATOMIC_RELAXED);
+		const int16_t *p = job->xyz + (size_t)i * 3;
+		spidx_pt_t *d = &idx->pt[pos];
+		d->x = p[0];
+		d->y = p[1];
+		d->z = p[2];
+		d->pad = 0;
+		d->idx = i;
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Cell Offsets Of A Query, Its Own Cell First.
+//! \n
+//! \param[in]    r         Cells out in each direction.
+//! \param[out]   off       (2r + 1)^3 offsets x/y/z.
+//! \return       Offsets.
+//******************************************************************************
+static int32_t spidxOffsets(int32_t r, int8_t off[][3])
+{
+	int32_t n = 1;
+
+	off[0][0] = 0;
+	off[0][1] = 0;
+	off[0][2] = 0;
+	for (int32_t dz = -r; dz <= r; dz++) {
+		for (int32_t dy = -r; dy <= r; dy++) {
+			for (int32_t dx = -r; dx <= r; dx++) {
+				if ((dx == 0) && (dy == 0) && (dz == 0)) {
+					continue;
+				}
+				off[n][0] = (int8_t)dx;
+				off[n][1] = (int8_t)dy;
+				off[n][2] = (int8_t)dz;
+				n++;
+			}
+		}
+	}
+
+	return n;
+}
+
+
+//******************************************************************************
+//! \brief        Squared Distance From A Point To A Cell.
+//! \n
+//! \param[in]    q         Point x/y/z in mm.
+//! \param[in]    c         Cell x/y/z.
+//! \param[in]    cell      Cell side in mm.
+//! \return       0 when the point is inside.
+//******************************************************************************
+static inline float spidxBoxDist2(const int16_t *q, const int32_t *c, float cell)
+{
+	float d2 = 0;
+
+	for (int32_t a = 0; a < 3; a++) {
+		float lo = (float)c[a] * cell;
+		float v = (float)q[a];
+		float e = (v < lo) ? (lo - v) : ((v > lo + cell) ? (v - lo - cell) : 0.0f);
+		d2 += e * e;
+	}
+
+	return d2;
+}
+
+
+//******************************************************************************
+//! \brief        Nearest Indexed Point Of Each Query (Pool Job Body).
+//! \n            Cells Farther Than The Best Point So Far Are Skipped.
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First query.
+//! \param[in]    end       Query after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxNearestJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_job_t *job = (spidx_job_t *)ctx;
+	const spidx_t *idx = job->idx;
+	float inv = idx->inv_cell;
+	int32_t r = (int32_t)ceilf(job->radius * inv);
+	int8_t off[SPIDX_OFF_MAX][3];
+
+	if (r > SPIDX_RANGE_MAX) {
+		r = SPIDX_RANGE_MAX;
+	}
+	int32_t noff = spidxOffsets(r, off);
+
+	for (int32_t i = begin; i < end; i++) {
+		const int16_t *q = job->xyz + (size_t)i * 3;
+		float best = job->radius * job->radius;
+		int32_t found = -1;
+
+		if (q[2] > 0) {
+			int32_t ix = spidxCell(q[0], inv);
+			int32_t iy = spidxCell(q[1], inv);
+			int32_t iz = spidxCell(q[2], inv);
+
+			//! \remark - Buckets Shared By Several Cells Are Scanned Twice, Harmless For A Minimum.
+			for (int32_t k = 0; k < noff; k++) {
+				int32_t c[3] = { ix + off[k][0], iy + off[k][1], iz + off[k][2] };
+
+				if (spidxBoxDist2(q, c, idx->cell) > best) {
+					continue;
+				}
+
+				uint32_t b = spidxHash(c[0], c[1], c[2], idx->mask);
+				for (uint32_t j = idx->start[b]; j < idx->start[b + 1]; j++) {
+					const spidx_pt_t *s = &idx->pt[j];
+					float ex = (float)(s->x - q[0]);
+					float ey = (float)(s->y - q[1]);
+					float ez = (float)(s->z - q[2]);
+					float d2 = ex * ex + ey * ey + ez * ez;
+
+					if (d2 <= best) {
+						best = d2;
+						found = s->idx;
+					}
+				}
+			}
+		}
+
+		job->nn[i] = found;
+		if (job->dist != NULL) {
+			job->dist[i] = (found >= 0) ? sqrtf(best) : -1.0f;
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Indexed Points Within The Radius Of Each Query (Pool Job Body).
+//! \details      Points Are Only Taken From Their Own Cell, So Colliding Buckets Count Once.
+//! \n            Counting Stops At job->cap, The Own Cell Is Searched First.
+//! \param[in]    ctx       spidx_job_t.
+//! \param[in]    begin     First query.
+//! \param[in]    end       Query after the last one.
+//! \return       None.
+//******************************************************************************
+static void spidxCountJob(void *ctx, int32_t begin, int32_t end)
+{
+	spidx_job_t *job = (spidx_job_t *)ctx;
+	const spidx_t *idx = job->idx;
+	float inv = idx->inv_cell;
+	float r2 = job->radius * job->radius;
+	int32_t r = (int32_t)ceilf(job->radius * inv);
+	int8_t off[SPIDX_OFF_MAX][3];
+
+	if (r > SPIDX_RANGE_MAX) {
+		r = SPIDX_RANGE_MAX;
+	}
+	int32_t noff = spidxOffsets(r, off);
+
+	for (int32_t i = begin; i < end; i++) {
+		const int16_t *q = job->xyz + (size_t)i * 3;
+		uint32_t n = 0;
+
+		if (q[2] > 0) {
+			int32_t ix = spidxCell(q[0], inv);
+			int32_t iy = spidxCell(q[1], inv);
+			int32_t iz = spidxCell(q[2], inv);
+
+			for (int32_t k = 0; (k < noff) && (n < job->cap); k++) {
+				int32_t c[3] = { ix + off[k][0], iy + off[k][1], iz + off[k][2] };
+
+				if (spidxBoxDist2(q, c, idx->cell) > r2) {
+					continue;
+				}
+
+				uint32_t b = spidxHash(c[0], c[1], c[2], idx->mask);
+				for (uint32_t j = idx->start[b]; (j < idx->start[b + 1]) && (n < job->cap); j++) {
+					const spidx_pt_t *s = &idx->pt[j];
+					float ex = (float)(s->x - q[0]);
+					float ey = (float)(s->y - q[1]);
+					float ez = (float)(s->z - q[2]);
+
+					if ((ex * ex + ey * ey + ez * ez <= r2) &&
+						(spidxCell(s->x, inv) == c[0]) &&
+						(spidxCell(s->y, inv) == c[1]) &&
+						(spidxCell(s->z, inv) == c[2])) {
+						n++;
+					}
+				}
+			}
+		}
+
+		job->cnt[i] = (uint16_t)((n > job->cap) ? job->cap : n);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Run Radius Counts On The Worker Pool.
+//! \n
+//! \param[in]    idx       Index.
+//! \param[in]    q         n points x/y/z in mm.
+//! \param[in]    n         Points.
+//! \param[in]    radius    Radius in mm.
+//! \param[in]    cap       Counts saturate here.
+//! \param[out]   cnt       Points per query.
+//! \return       None.
+//******************************************************************************
+static void spidxCount(const spidx_t *idx, const int16_t *q, int32_t n, float radius, uint32_t cap, uint16_t *cnt)
+{
+	spidx_job_t job;
+
+	memset(&job, 0, sizeof(job));
+	job.idx = idx;
+	job.xyz = q;
+	job.radius = radius;
+	job.cap = cap;
+	job.cnt = cnt;
+
+	paraFor(spidxCountJob, &job, n, SPIDX_QUERY_GRAIN);
+}
+
+
+//******************************************************************************
+//! \brief        Prepare An Index For A Point Cloud Grid.
+//! \n
+//! \param[out]   idx       Index.
+//! \param[in]    w         Grid width.
+//! \param[in]    h         Grid height.
+//! \param[in]    cell      Voxel side and outlier test radius in mm, 0 = disabled.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int spidxInit(spidx_t *idx, int32_t w, int32_t h, float cell)
+{
+	uint32_t buckets = SPIDX_BUCKET_MIN;
+
+	memset(idx, 0, sizeof(*idx));
+	pthread_mutex_init(&idx->lock, NULL);
+
+	if ((w <= 0) || (h <= 0) || (cell < 0)) {
+		return -1;
+	}
+
+	idx->w = w;
+	idx->h = h;
+	idx->enable = (cell > 0);
+
+	if (!idx->enable) {
+		return 0;
+	}
+
+	//! \remark - At Least One Bucket Per Point, Keeps Buckets Short.
+	while (buckets < (uint32_t)(w * h)) {
+		buckets <<= 1;
+	}
+	idx->cell = cell;
+	idx->inv_cell = 1.0f / cell;
+	idx->mask = buckets - 1;
+	idx->start = (uint32_t *)calloc((size_t)buckets + 1, sizeof(uint32_t));
+	idx->scan = (uint32_t *)calloc((buckets + SPIDX_SCAN_GRAIN - 1) / SPIDX_SCAN_GRAIN, sizeof(uint32_t));
+	idx->key = (uint32_t *)calloc((size_t)w * h, sizeof(uint32_t));
+	idx->pt = (spidx_pt_t *)calloc((size_t)w * h, sizeof(spidx_pt_t));
+	idx->nb = (uint16_t *)calloc((size_t)w * h, sizeof(uint16_t));
+	idx->outlier = (uint8_t *)calloc((size_t)w * h, 1);
+	if ((idx->start == NULL) || (idx->scan == NULL) || (idx->key == NULL) || (idx->pt == NULL) ||
+		(idx->nb == NULL) || (idx->outlier == NULL)) {
+		spidxTerm(idx);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release An Index.
+//! \n
+//! \param[in]    idx       Index.
+//! \return       None.
+//******************************************************************************
+void spidxTerm(spidx_t *idx)
+{
+	free(idx->start);
+	free(idx->scan);
+	free(idx->key);
+	free(idx->pt);
+	free(idx->nb);
+	free(idx->outlier);
+	idx->start = NULL;
+	idx->scan = NULL;
+	idx->key = NULL;
+	idx->pt = NULL;
+	idx->nb = NULL;
+	idx->outlier = NULL;
+	idx->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Index The Points Of A Frame.
+//! \details      Counting Sort By Bucket, Linear In The Points: 1. Bucket Every Point And Count
+//! \n            (Atomic). 2. Prefix Sum In Blocks, Then The Block Offsets. 3. Scatter. Each
+//! \n            Step Runs On The Worker Pool.
+//! \param[in]    idx       Index.
+//! \param[in]    xyz       Organized point cloud (w x h, x/y/z in mm, z <= 0 invalid).
+//! \return       0         success
+//! \return       -1        disabled
+//******************************************************************************
+int spidxBuild(spidx_t *idx, const int16_t *xyz)
+{
+	uint64_t t0 = getMonoNs();
+	spidx_job_t job;
+	int32_t buckets = (int32_t)idx->mask + 1;
+	int32_t blocks = (buckets + SPIDX_SCAN_GRAIN - 1) / SPIDX_SCAN_GRAIN;
+	uint32_t off = 0;
+
+	if (!idx->enable || (xyz == NULL)) {
+		return -1;
+	}
+
+	memset(&job, 0, sizeof(job));
+	job.idx = idx;
+	job.out = idx;
+	job.xyz = xyz;
+
+	memset(idx->start, 0, sizeof(uint32_t) * ((size_t)buckets + 1));
+	paraFor(spidxKeyJob, &job, idx->h, SPIDX_ROW_GRAIN);
+
+	paraFor(spidxScanJob, &job, buckets, SPIDX_SCAN_GRAIN);
+	for (int32_t k = 0; k < blocks; k++) {
+		uint32_t sum = idx->scan[k];
+		idx->scan[k] = off;
+		off += sum;
+	}
+	paraFor(spidxOffsetJob, &job, buckets, SPIDX_SCAN_GRAIN);
+	idx->start[buckets] = off;
+	idx->cnt = (int32_t)off;
+
+	paraFor(spidxScatterJob, &job, idx->h, SPIDX_ROW_GRAIN);
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&idx->lock);
+	idx->frames++;
+	idx->points += off;
+	idx->build_ms_sum += ms;
+	if (ms > idx->build_ms_max) {
+		idx->build_ms_max = ms;
+	}
+	pthread_mutex_unlock(&idx->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Nearest Indexed Point Of A Batch Of Points, In Parallel.
+//! \n            An Indexed Point Finds Itself At Distance 0.
+//! \param[in]    idx       Index.
+//! \param[in]    q         n points x/y/z in mm, z <= 0 is not searched.
+//! \param[in]    n         Points.
+//! \param[in]    max_dist  Search radius in mm, at most SPIDX_RANGE_MAX cells.
+//! \param[out]   nn        Grid index of the nearest point per query, -1 = none within max_dist.
+//! \param[out]   dist      Its distance in mm (-1 = none), or NULL.
+//! \return       None.
+//******************************************************************************
+void spidxNearest(const spidx_t *idx, const int16_t *q, int32_t n, float max_dist, int32_t *nn, float *dist)
+{
+	spidx_job_t job;
+
+	memset(&job, 0, sizeof(job));
+	job.idx = idx;
+	job.xyz = q;
+	job.radius = max_dist;
+	job.nn = nn;
+	job.dist = dist;
+
+	paraFor(spidxNearestJob, &job, n, SPIDX_QUERY_GRAIN);
+}
+
+
+//******************************************************************************
+//! \brief        Count The Indexed Points Within A Radius Of A Batch Of Points, In Parallel.
+//! \n            An Indexed Point Counts Itself.
+//! \param[in]    idx       Index.
+//! \param[in]    q         n points x/y/z in mm, z <= 0 counts 0.
+//! \param[in]    n         Points.
+//! \param[in]    radius    Radius in mm, at most SPIDX_RANGE_MAX cells.
+//! \param[out]   cnt       Points per query, saturated at 65535.
+//! \return       None.
+//******************************************************************************
+void spidxRadiusCount(const spidx_t *idx, const int16_t *q, int32_t n, float radius, uint16_t *cnt)
+{
+	spidxCount(idx, q, n, radius, 65535, cnt);
+}
+
+
+//******************************************************************************
+//! \brief        Mark Isolated Points Of The Indexed Frame.
+//! \n            One Radius Query Per Grid Point With A Radius Of One Cell, Stopping Once It Is Not.
+//! \param[in]    idx       Index, built from xyz.
+//! \param[in]    xyz       Organized point cloud the index was built from.
+//! \return       0         success, idx->nb and idx->outlier are set
+//! \return       -1        disabled
+//******************************************************************************
+int spidxOutliers(spidx_t *idx, const int16_t *xyz)
+{
+	uint64_t t0 = getMonoNs();
+	int32_t n = idx->w * idx->h;
+	uint64_t outliers = 0;
+
+	if (!idx->enable || (xyz == NULL)) {
+		return -1;
+	}
+
+	spidxCount(idx, xyz, n, idx->cell, SPIDX_MIN_NB + 1, idx->nb);
+
+	for (int32_t i = 0; i < n; i++) {
+		//! \remark - nb Includes The Point Itself, 0 = No Depth.
+		uint8_t o = ((idx->nb[i] > 0) && (idx->nb[i] <= SPIDX_MIN_NB)) ? 1 : 0;
+		idx->outlier[i] = o;
+		outliers += o;
+	}
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&idx->lock);
+	idx->queries += (uint64_t)idx->cnt;
+	idx->outliers += outliers;
+	idx->query_ms_sum += ms;
+	pthread_mutex_unlock(&idx->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Print Build And Query Throughput Since The Last Report.
+//! \n
+//! \param[in]    idx       Index.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void spidxReport(spidx_t *idx, const char *name)
+{
+	if (!idx->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&idx->lock);
+
+	if (idx->frames > 0) {
+		printf("index %s: points=%.0f build mean=%.2f ms max=%.2f ms (%.1f Mpt/s) outlier query %.1f Mq/s outliers=%.2f%%\n",
+				name, (double)idx->points / idx->frames, idx->build_ms_sum / idx->frames, idx->build_ms_max,
+				(idx->build_ms_sum > 0) ? (idx->points / idx->build_ms_sum * 1e-3) : 0.0,
+				(idx->query_ms_sum > 0) ? (idx->queries / idx->query_ms_sum * 1e-3) : 0.0,
+				(idx->queries > 0) ? (100.0 * idx->outliers / idx->queries) : 0.0);
+	}
+
+	idx->frames = 0;
+	idx->points = 0;
+	idx->queries = 0;
+	idx->outliers = 0;
+	idx->build_ms_sum = 0;
+	idx->build_ms_max = 0;
+	idx->query_ms_sum = 0;
+
+	pthread_mutex_unlock(&idx->lock);
+}
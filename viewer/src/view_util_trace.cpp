@@ -0,0 +1,328 @@
+//******************************************************************************
+//! \file       view_util_trace.cpp
+//! \brief      Per-Thread Binary Trace Ring, Exported As Chrome Trace JSON.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "view_util_trace.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define TRACE_MAX_THREAD    (32)    //!< Maximum Number Of Traced Threads.
+#define TRACE_CALIB_CNT     (100000)
+#define TRACE_CALIB_NS      (20000000)  //!< Time Used To Measure The Counter Frequency.
+
+//! One Event, 16 Bytes.
+typedef struct _trace_ev_t {
+	uint64_t tick;      //!< Raw Counter Value, Converted To Nano Sec. When Dumped.
+	uint32_t stage;     //!< trace_stage_e.
+	uint32_t phase;     //!< 'B' Or 'E'.
+} trace_ev_t;
+
+//! Ring Of One Thread, Only That Thread Writes It.
+typedef struct _trace_ring_t {
+	std::atomic<uint32_t> head;     //!< Number Of Events Written, Published With Release.
+	int tid;                        //!< Thread Number In The Trace.
+	char name[32];                  //!< Thread Name.
+	trace_ev_t ev[TRACE_RING_SIZE];
+} trace_ring_t;
+
+static const char *g_trace_stage_name[TRACE_STAGE_NUM] = {
+	"capture",
+	"process",
+	"bgsub",
+	"plane",
+	"normal",
+	"blob",
+	"render",
+	"display",
+	"encode",
+	"icp",
+	"index",
+	"fuse",
+	"pyramid",
+	"align",
+};
+
+volatile bool g_trace_enable = false;
+
+static char g_trace_path[256];
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;  //!< Guards Ring Registration And Dump.
+static trace_ring_t *g_trace_ring[TRACE_MAX_THREAD];
+static int g_trace_ring_cnt = 0;
+static thread_local trace_ring_t *t_ring = NULL;
+static uint64_t g_trace_tick0;      //!< Counter Value At g_trace_ns0.
+static uint64_t g_trace_ns0;        //!< CLOCK_MONOTONIC Time At g_trace_tick0.
+static double g_trace_ns_per_tick = 1.0;
+
+
+//******************************************************************************
+//! \brief        Read The Free-Running Counter Without A System Call.
+//! \n            CLOCK_MONOTONIC Costs About As Much As The Whole Event Budget On Some Kernels.
+//! \param[in]    None.
+//! \return       Counter Value.
+//******************************************************************************
+static inline uint64_t traceTick(void)
+{
+#if defined(__aarch64__)
+	uint64_t val;
+	__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (val));
+	return val;
+#elif defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return getMonoNs();
+#endif
+}
+
+
+//******************************************************************************
+//! \brief        Relate The Counter To CLOCK_MONOTONIC.
+//! \n
+//! \param[in]    None.
+//! \return       None.
+//******************************************************************************
+static void traceCalibrate(void)
+{
+	g_trace_tick0 = traceTick();
+	g_trace_ns0 = getMonoNs();
+
+#if defined(__aarch64__)
+	uint64_t freq;
+	__asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (freq));
+	g_trace_ns_per_tick = 1e9 / (double)freq;
+#elif defined(__x86_64__) || defined(__i386__)
+	uint64_t tick;
+	uint64_t ns;
+	do {
+		tick = traceTick();
+		ns = getMonoNs();
+	} while (ns - g_trace_ns0 < TRACE_CALIB_NS);
+	g_trace_ns_per_tick = (double)(ns - g_trace_ns0) / (double)(tick - g_trace_tick0);
+#endif
+}
+
+
+//******************************************************************************
+//! \brief        Get The Ring Of The Calling Thread, Registering It On First Use.
+//! \n
+//! \param[in]    None.
+//! \return       Ring, NULL If Too Many Threads.
+//******************************************************************************
+static trace_ring_t *traceGetRing(void)
+{
+	trace_ring_t *ring;
+
+	if (t_ring != NULL) {
+		return t_ring;
+	}
+
+	pthread_mutex_lock(&g_trace_lock);
+	if (g_trace_ring_cnt < TRACE_MAX_THREAD) {
+		ring = new trace_ring_t;
+		ring->head.store(0, std::memory_order_relaxed);
+		ring->tid = g_trace_ring_cnt + 1;
+		snprintf(ring->name, sizeof(ring->name), "thread %d", ring->tid);
+		g_trace_ring[g_trace_ring_cnt++] = ring;
+		t_ring = ring;
+	}
+	pthread_mutex_unlock(&g_trace_lock);
+
+	return t_ring;
+}
+
+
+//******************************************************************************
+//! \brief        Append One Event To A Ring.
+//! \n
+//! \param[in]    ring      Ring of the calling thread.
+//! \param[in]    stage     Stage.
+//! \param[in]    phase     'B' = begin, 'E' = end.
+//! \return       None.
+//******************************************************************************
+static inline void tracePush(trace_ring_t *ring, int stage, char phase)
+{
+	uint32_t head = ring->head.load(std::memory_order_relaxed);
+	trace_ev_t *ev = &ring->ev[head & (TRACE_RING_SIZE - 1)];
+
+	ev->tick = traceTick();
+	ev->stage = (uint32_t)stage;
+	ev->phase = (uint32_t)phase;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+
+//******************************************************************************
+//! \brief        Enable Tracing, The Trace Is Written To path On traceDump().
+//! \n
+//! \param[in]    path      Output file of the Chrome trace JSON.
+//! \return       None.
+//******************************************************************************
+void traceInit(const char *path)
+{
+	trace_ring_t *ring;
+	uint64_t t0;
+	uint64_t t1;
+
+	snprintf(g_trace_path, sizeof(g_trace_path), "%s", path);
+	traceCalibrate();
+
+	//! \remark Measure The Cost Per Event On A Scratch Ring.
+	ring = new trace_ring_t;
+	ring->head.store(0, std::memory_order_relaxed);
+	t0 = getMonoNs();
+	for (int i = 0; i < TRACE_CALIB_CNT; i++) {
+		tracePush(ring, TRACE_PROCESS, (i & 1) ? 'E' : 'B');
+	}
+	t1 = getMonoNs();
+	delete ring;
+
+	printf("trace: enabled, %.1f ns per event, %d events per thread, output %s\n",
+			(double)(t1 - t0) / TRACE_CALIB_CNT, TRACE_RING_SIZE, g_trace_path);
+
+	g_trace_enable = true;
+}
+
+
+//******************************************************************************
+//! \brief        Name The Calling Thread In The Trace.
+//! \n
+//! \param[in]    name      Thread name.
+//! \return       None.
+//******************************************************************************
+void traceSetThreadName(const char *name)
+{
+	trace_ring_t *ring = traceGetRing();
+
+	if (ring != NULL) {
+		pthread_mutex_lock(&g_trace_lock);
+		snprintf(ring->name, sizeof(ring->name), "%s", name);
+		pthread_mutex_unlock(&g_trace_lock);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Record An Event On The Calling Thread (Use TRACE_BEGIN/TRACE_END).
+//! \n
+//! \param[in]    stage     Stage.
+//! \param[in]    phase     'B' = begin, 'E' = end.
+//! \return       None.
+//******************************************************************************
+void traceEvent(int stage, char phase)
+{
+	trace_ring_t *ring = (t_ring != NULL) ? t_ring : traceGetRing();
+
+	if (ring != NULL) {
+		tracePush(ring, stage, phase);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Write The Last Events Of Every Thread As Chrome Trace JSON.
+//! \details      Rings Keep Recording While Dumping, The Oldest Events Of A Busy Thread
+//! \n            May Be Overwritten During The Dump; Unmatched Begin/End Are Dropped.
+//! \param[in]    None.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int traceDump(void)
+{
+	FILE *fp;
+	const char *sep = "";
+	uint64_t base = UINT64_MAX;
+	double base_ns;
+	uint32_t total = 0;
+
+	if (g_trace_path[0] == '\0') {
+		return -1;
+	}
+
+	fp = fopen(g_trace_path, "w");
+	if (fp == NULL) {
+		printf("trace: cannot open %s\n", g_trace_path);
+		return -1;
+	}
+
+	pthread_mutex_lock(&g_trace_lock);
+
+	//! \remark Time Stamps Are Relative To The Oldest Event Still In A Ring.
+	for (int t = 0; t < g_trace_ring_cnt; t++) {
+		trace_ring_t *ring = g_trace_ring[t];
+		uint32_t head = ring->head.load(std::memory_order_acquire);
+		uint32_t first = (head > TRACE_RING_SIZE) ? (head - TRACE_RING_SIZE) : 0;
+		if ((head > first) && (ring->ev[first & (TRACE_RING_SIZE - 1)].tick < base)) {
+			base = ring->ev[first & (TRACE_RING_SIZE - 1)].tick;
+		}
+	}
+
+	//! \remark Trace Time 0 Is The Oldest Event, Given As CLOCK_MONOTONIC In The Metadata.
+	base_ns = (double)g_trace_ns0 + ((double)base - (double)g_trace_tick0) * g_trace_ns_per_tick;
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"monotonic_ns_at_0\":\"%.0f\"},\"traceEvents\":[\n", base_ns);
+
+	for (int t = 0; t < g_trace_ring_cnt; t++) {
+		trace_ring_t *ring = g_trace_ring[t];
+		uint32_t head = ring->head.load(std::memory_order_acquire);
+		uint32_t first = (head > TRACE_RING_SIZE) ? (head - TRACE_RING_SIZE) : 0;
+		int depth = 0;
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				sep, ring->tid, ring->name);
+		sep = ",\n";
+
+		for (uint32_t i = first; i < head; i++) {
+			const trace_ev_t *ev = &ring->ev[i & (TRACE_RING_SIZE - 1)];
+
+			if ((ev->stage >= TRACE_STAGE_NUM) || (ev->tick < base)) {
+				continue;
+			}
+
+			//! \remark An End Whose Begin Was Overwritten Would Break The Timeline.
+			if (ev->phase == 'B') {
+				depth++;
+			}
+			else
+			if (depth > 0) {
+				depth--;
+			}
+			else {
+				continue;
+			}
+
+			fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+					sep, g_trace_stage_name[ev->stage], (char)ev->phase,
+					(double)(ev->tick - base) * g_trace_ns_per_tick * 1e-3, ring->tid);
+			total++;
+		}
+	}
+
+	pthread_mutex_unlock(&g_trace_lock);
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	printf("trace: %u events written to %s\n", total, g_trace_path);
+
+	return 0;
+}
@@ -0,0 +1,871 @@
+//******************************************************************************
+//! \file       view_util_tsdf.cpp
+//! \brief      TSDF Fusion Into A Sparse Voxel Block Hash, With Raycasting For Display.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "view_util_tsdf.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+#include "view_util_trace.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define TSDF_ROW_GRAIN      (8)     //!< Image Rows Per Pool Block.
+#define TSDF_RAY_BAND       (32)    //!< Rows Cast Between Chances For tsdfIntegrate() To Write The Volume.
+#define TSDF_BLOCK_GRAIN    (8)     //!< Voxel Blocks Per Pool Block.
+#define TSDF_ALLOC_STEP     (2)     //!< Every 2nd Pixel In x And y Allocates Blocks, They Are Much Larger.
+#define TSDF_TRUNC_VOX      (4)     //!< Truncation Distance In Voxels.
+#define TSDF_WEIGHT_MAX     (64)    //!< Running Average Over About This Many Frames, So The Scene Can Change.
+#define TSDF_PROBE_MAX      (64)    //!< Hash Entries Tried Before A Block Is Dropped.
+#define TSDF_KEY_BIAS       (1 << 20)   //!< Block Coordinates Are Packed As 21 Bit Unsigned.
+#define TSDF_KEY_MASK       (0x1FFFFFU)
+#define TSDF_SDF_SCALE      (32767.0f)
+#define TSDF_RAY_NEAR       (100.0f)    //!< Raycast Range In mm Along The Optical Axis.
+#define TSDF_RAY_FAR        (8000.0f)
+#define TSDF_FREE_LOW       (16)    //!< A Full Pool Recycles When Fewer Than max_blocks / n Blocks Are Free...
+#define TSDF_FREE_HIGH      (8)     //!< ...Until max_blocks / n Are Free.
+
+//! Job Context.
+typedef struct _tsdf_job_t {
+	tsdf_t *tsdf;
+	const uint16_t *depth;  //!< Depth Image Being Integrated, Or Of The Raycast.
+	const float *pose;      //!< Camera To World Of The Raycast.
+	int16_t *out;           //!< Raycast Result.
+	int32_t row0;           //!< First Row Of The Raycast Band.
+	int32_t step;           //!< Raycast Grid Stride.
+	uint32_t drop;          //!< Blocks Not Found Nor Inserted Within TSDF_PROBE_MAX Entries.
+} tsdf_job_t;
+
+
+//******************************************************************************
+//! \brief        Hash Table Key Of A Block.
+//! \n
+//! \param[in]    bx        Block x.
+//! \param[in]    by        Block y.
+//! \param[in]    bz        Block z.
+//! \return       Key, never 0.
+//******************************************************************************
+static inline uint64_t tsdfKey(int32_t bx, int32_t by, int32_t bz)
+{
+	return (1ULL << 63) |
+			((uint64_t)((uint32_t)(bx + TSDF_KEY_BIAS) & TSDF_KEY_MASK) << 42) |
+			((uint64_t)((uint32_t)(by + TSDF_KEY_BIAS) & TSDF_KEY_MASK) << 21) |
+			(uint64_t)((uint32_t)(bz + TSDF_KEY_BIAS) & TSDF_KEY_MASK);
+}
+
+
+//******************************************************************************
+//! \brief        First Hash Table Entry Of A Block.
+//! \n
+//! \param[in]    bx        Block x.
+//! \param[in]    by        Block y.
+//! \param[in]    bz        Block z.
+//! \param[in]    mask      Entries - 1.
+//! \return       Entry.
+//******************************************************************************
+static inline uint32_t tsdfHash(int32_t bx, int32_t by, int32_t bz, uint32_t mask)
+{
+	return (((uint32_t)bx * 73856093U) ^ ((uint32_t)by * 19349663U) ^ ((uint32_t)bz * 83492791U)) & mask;
+}
+
+
+//******************************************************************************
+//! \brief        Mark A Block As Seen By The Current Frame, Inserting It If It Is New.
+//! \details      Lock Free: The Key Is Claimed With A Compare-And-Swap, And The Thread That
+//! \n            Moves The Stamp To The Current Frame Appends The Entry To The Visible List.
+//! \param[in]    job       tsdf_job_t.
+//! \param[in]    bx        Block x.
+//! \param[in]    by        Block y.
+//! \param[in]    bz        Block z.
+//! \return       None.
+//******************************************************************************
+static void tsdfTouch(tsdf_job_t *job, int32_t bx, int32_t by, int32_t bz)
+{
+	tsdf_t *tsdf = job->tsdf;
+	uint64_t key = tsdfKey(bx, by, bz);
+	uint32_t e = tsdfHash(bx, by, bz, tsdf->mask);
+
+	for (int32_t k = 0; k < TSDF_PROBE_MAX; k++, e = (e + 1) & tsdf->mask) {
+		tsdf_entry_t *ent = &tsdf->table[e];
+		uint64_t cur = __atomic_load_n(&ent->key, __ATOMIC_ACQUIRE);
+
+		if (cur == 0) {
+			uint64_t expect = 0;
+
+			cur = __atomic_compare_exchange_n(&ent->key, &expect, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ? key : expect;
+		}
+		if (cur != key) {
+			continue;
+		}
+
+		uint32_t old = __atomic_load_n(&ent->stamp, __ATOMIC_RELAXED);
+		if ((old != tsdf->frame) &&
+			__atomic_compare_exchange_n(&ent->stamp, &old, tsdf->frame, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			tsdf->visible[__atomic_fetch_add(&tsdf->vis_cnt, 1U, __ATOMIC_RELAXED)] = e;
+		}
+		return;
+	}
+
+	__atomic_fetch_add(&job->drop, 1U, __ATOMIC_RELAXED);
+}
+
+
+//******************************************************************************
+//! \brief        Pool Slot Of A Block.
+//! \n
+//! \param[in]    tsdf      Volume.
+//! \param[in]    bx        Block x.
+//! \param[in]    by        Block y.
+//! \param[in]    bz        Block z.
+//! \return       Slot, -1 = not allocated.
+//******************************************************************************
+static int32_t tsdfFind(const tsdf_t *tsdf, int32_t bx, int32_t by, int32_t bz)
+{
+	uint64_t key = tsdfKey(bx, by, bz);
+	uint32_t e = tsdfHash(bx, by, bz, tsdf->mask);
+
+	for (int32_t k = 0; k < TSDF_PROBE_MAX; k++, e = (e + 1) & tsdf->mask) {
+		const tsdf_entry_t *ent = &tsdf->table[e];
+
+		if (ent->key == key) {
+			return ent->slot;
+		}
+		if (ent->key == 0) {
+			break;
+		}
+	}
+
+	return -1;
+}
+
+
+//******************************************************************************
+//! \brief        Free The Least Recently Seen Blocks Of A Full Pool.
+//! \details      Runs Before A Frame Is Integrated, So No Entry Is In The Visible List. Blocks
+//! \n            Seen By The Previous Frame Are Kept. The Table Is Rebuilt Without The Freed
+//! \n            Blocks And Without Entries That Never Got One, Which Keeps Probe Chains Intact.
+//! \param[in]    tsdf      Volume.
+//! \return       None.
+//******************************************************************************
+static void tsdfRecycle(tsdf_t *tsdf)
+{
+	int32_t need = tsdf->max_blocks / TSDF_FREE_HIGH - tsdf->free_cnt;
+	int32_t n = 0;
+	int32_t older = 0;
+	uint32_t thr;
+
+	if ((tsdf->used < tsdf->max_blocks) || (tsdf->free_cnt >= tsdf->max_blocks / TSDF_FREE_LOW)) {
+		return;
+	}
+
+	//! \remark - Stamps Of The Blocks Not Seen By The Previous Frame, The need-th Oldest Is The Threshold.
+	for (uint32_t e = 0; e <= tsdf->mask; e++) {
+		const tsdf_entry_t *ent = &tsdf->table[e];
+		if ((ent->key != 0) && (ent->slot >= 0) && (ent->stamp != tsdf->frame)) {
+			tsdf->age[n++] = ent->stamp;
+		}
+	}
+	if (n == 0) {
+		tsdf->saturated++;
+		return;
+	}
+	if (need > n) {
+		need = n;
+	}
+	std::nth_element(tsdf->age, tsdf->age + need - 1, tsdf->age + n);
+	thr = tsdf->age[need - 1];
+	for (int32_t k = 0; k < n; k++) {
+		older += (tsdf->age[k] < thr) ? 1 : 0;
+	}
+
+	//! \remark - Blocks Stamped Before thr Go, Then Those Stamped thr Until need Are Free.
+	int32_t same = need - older;
+	for (uint32_t e = 0; e <= tsdf->mask; e++) {
+		tsdf->spare[e].key = 0;
+		tsdf->spare[e].slot = -1;
+		tsdf->spare[e].stamp = 0;
+	}
+	for (uint32_t e = 0; e <= tsdf->mask; e++) {
+		const tsdf_entry_t *ent = &tsdf->table[e];
+		bool keep;
+
+		if (ent->key == 0) {
+			continue;
+		}
+		if (ent->slot < 0) {
+			keep = (ent->stamp == tsdf->frame);
+		}
+		else
+		if ((ent->stamp == tsdf->frame) || (ent->stamp > thr)) {
+			keep = true;
+		}
+		else
+		if (ent->stamp < thr) {
+			keep = false;
+		}
+		else {
+			keep = (same <= 0);
+			same--;
+		}
+
+		if (keep) {
+			int32_t bx = (int32_t)((ent->key >> 42) & TSDF_KEY_MASK) - TSDF_KEY_BIAS;
+			int32_t by = (int32_t)((ent->key >> 21) & TSDF_KEY_MASK) - TSDF_KEY_BIAS;
+			int32_t bz = (int32_t)(ent->key & TSDF_KEY_MASK) - TSDF_KEY_BIAS;
+			uint32_t d = tsdfHash(bx, by, bz, tsdf->mask);
+			int32_t k;
+
+			for (k = 0; (k < TSDF_PROBE_MAX) && (tsdf->spare[d].key != 0); k++) {
+				d = (d + 1) & tsdf->mask;
+			}
+			if (k < TSDF_PROBE_MAX) {
+				tsdf->spare[d] = *ent;
+				continue;
+			}
+		}
+		if (ent->slot >= 0) {
+			tsdf->free_slot[tsdf->free_cnt++] = ent->slot;
+		}
+	}
+
+	tsdf_entry_t *t = tsdf->table;
+	tsdf->table = tsdf->spare;
+	tsdf->spare = t;
+}
+
+
+//******************************************************************************
+//! \brief        Touch The Blocks Within The Truncation Band Of Each Depth Pixel (Pool Job Body).
+//! \n
+//! \param[in]    ctx       tsdf_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void tsdfAllocJob(void *ctx, int32_t begin, int32_t end)
+{
+	tsdf_job_t *job = (tsdf_job_t *)ctx;
+	const tsdf_t *tsdf = job->tsdf;
+	const cam_intr_t *cam = &tsdf->cam;
+	const float *m = tsdf->pose;
+	float inv_block = 1.0f / (tsdf->voxel * TSDF_BLOCK);
+	int32_t n = (int32_t)ceilf(4.0f * tsdf->trunc * inv_block);  //!< Samples Half A Block Apart.
+
+	for (int32_t v = begin; v < end; v++) {
+		if ((v % TSDF_ALLOC_STEP) != 0) {
+			continue;
+		}
+		const uint16_t *row = job->depth + (size_t)v * tsdf->w;
+		float ry = ((float)v - cam->cy) / cam->fy;
+
+		for (int32_t u = 0; u < tsdf->w; u += TSDF_ALLOC_STEP) {
+			float d = (float)row[u];
+			float rx = ((float)u - cam->cx) / cam->fx;
+			int32_t last[3] = { 0, 0, 0 };
+
+			if (row[u] == 0) {
+				continue;
+			}
+
+			for (int32_t k = 0; k <= n; k++) {
+				float z = d - tsdf->trunc + (2.0f * tsdf->trunc * k) / n;
+				float px = rx * z;
+				float py = ry * z;
+				int32_t b[3];
+
+				if (z <= 0) {
+					continue;
+				}
+				b[0] = (int32_t)floorf((m[0] * px + m[1] * py + m[2] * z + m[3]) * inv_block);
+				b[1] = (int32_t)floorf((m[4] * px + m[5] * py + m[6] * z + m[7]) * inv_block);
+				b[2] = (int32_t)floorf((m[8] * px + m[9] * py + m[10] * z + m[11]) * inv_block);
+
+				//! \remark - Successive Samples Mostly Stay In One Block.
+				if ((k > 0) && (b[0] == last[0]) && (b[1] == last[1]) && (b[2] == last[2])) {
+					continue;
+				}
+				tsdfTouch(job, b[0], b[1], b[2]);
+				last[0] = b[0];
+				last[1] = b[1];
+				last[2] = b[2];
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Fuse The Depth Image Into The Visible Blocks (Pool Job Body).
+//! \details      Each Voxel Is Projected Into The Image, Its Distance To The Measured Surface
+//! \n            Along The Optical Axis Is Truncated And Averaged In. Each Block Belongs To One
+//! \n            Job, So No Voxel Is Written By Two Threads.
+//! \param[in]    ctx       tsdf_job_t.
+//! \param[in]    begin     First entry of the visible list.
+//! \param[in]    end       Entry after the last one.
+//! \return       None.
+//******************************************************************************
+static void tsdfIntegrateJob(void *ctx, int32_t begin, int32_t end)
+{
+	tsdf_job_t *job = (tsdf_job_t *)ctx;
+	const tsdf_t *tsdf = job->tsdf;
+	const cam_intr_t *cam = &tsdf->cam;
+	const float *m = tsdf->pose;
+	float vs = tsdf->voxel;
+	float inv_trunc = 1.0f / tsdf->trunc;
+
+	//! \remark - World To Camera Is R^T (p - t); A Voxel Step Along World x/y/z Is A Column Of R^T.
+	float ax[3] = { m[0] * vs, m[1] * vs, m[2] * vs };
+	float ay[3] = { m[4] * vs, m[5] * vs, m[6] * vs };
+	float az[3] = { m[8] * vs, m[9] * vs, m[10] * vs };
+
+	for (int32_t i = begin; i < end; i++) {
+		const tsdf_entry_t *ent = &tsdf->table[tsdf->visible[i]];
+		tsdf_vox_t *vox;
+
+		if (ent->slot < 0) {
+			continue;
+		}
+		vox = tsdf->pool + (size_t)ent->slot * TSDF_BLOCK_VOX;
+
+		//! \remark - Center Of The First Voxel, Relative To The Camera.
+		float o[3];
+		o[0] = ((float)((int32_t)((ent->key >> 42) & TSDF_KEY_MASK) - TSDF_KEY_BIAS) * TSDF_BLOCK + 0.5f) * vs - m[3];
+		o[1] = ((float)((int32_t)((ent->key >> 21) & TSDF_KEY_MASK) - TSDF_KEY_BIAS) * TSDF_BLOCK + 0.5f) * vs - m[7];
+		o[2] = ((float)((int32_t)(ent->key & TSDF_KEY_MASK) - TSDF_KEY_BIAS) * TSDF_BLOCK + 0.5f) * vs - m[11];
+		float base[3] = {
+			m[0] * o[0] + m[4] * o[1] + m[8] * o[2],
+			m[1] * o[0] + m[5] * o[1] + m[9] * o[2],
+			m[2] * o[0] + m[6] * o[1] + m[10] * o[2],
+		};
+
+		for (int32_t z = 0; z < TSDF_BLOCK; z++) {
+			for (int32_t y = 0; y < TSDF_BLOCK; y++) {
+				float p[3];
+				p[0] = base[0] + ay[0] * y + az[0] * z;
+				p[1] = base[1] + ay[1] * y + az[1] * z;
+				p[2] = base[2] + ay[2] * y + az[2] * z;
+
+				for (int32_t x = 0; x < TSDF_BLOCK; x++, vox++, p[0] += ax[0], p[1] += ax[1], p[2] += ax[2]) {
+					if (p[2] <= 0) {
+						continue;
+					}
+
+					float inv = 1.0f / p[2];
+					float fu = cam->fx * p[0] * inv + cam->cx + 0.5f;
+					float fv = cam->fy * p[1] * inv + cam->cy + 0.5f;
+					if ((fu < 0) || (fv < 0) || (fu >= tsdf->w) || (fv >= tsdf->h)) {
+						continue;
+					}
+
+					uint16_t d = job->depth[(size_t)(int32_t)fv * tsdf->w + (int32_t)fu];
+					float sdf = (float)d - p[2];
+					if ((d == 0) || (sdf < -tsdf->trunc)) {
+						continue;
+					}
+
+					float f = (sdf > tsdf->trunc) ? 1.0f : (sdf * inv_trunc);
+					float wt = (float)vox->w;
+					vox->sdf = (int16_t)(((float)vox->sdf * wt + f * TSDF_SDF_SCALE) / (wt + 1.0f));
+					vox->w = (vox->w < TSDF_WEIGHT_MAX) ? (uint16_t)(vox->w + 1) : (uint16_t)TSDF_WEIGHT_MAX;
+				}
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Find The Surface Along One Ray.
+//! \details      Steps Half A Block Through Unallocated Space And By The Stored Distance Near
+//! \n            The Surface, Which Lies Where The Distance Changes From Positive To Negative.
+//! \param[in]    tsdf      Volume.
+//! \param[in]    m         Camera to world of the ray origin.
+//! \param[in]    dir       Ray direction in world coordinates, z = 1 in camera coordinates.
+//! \param[in]    t         Start depth in mm along the optical axis.
+//! \param[in]    t_end     End depth.
+//! \param[out]   hit       Depth of the surface.
+//! \return       true      found
+//******************************************************************************
+static bool tsdfMarch(const tsdf_t *tsdf, const float *m, const float dir[3], float t, float t_end, float *hit)
+{
+	float vs = tsdf->voxel;
+	float inv_vox = 1.0f / vs;
+	float block = vs * TSDF_BLOCK;
+	float t_prev = 0;
+	float f_prev = 0;
+	bool has_prev = false;
+	int32_t cache[3] = { 0, 0, 0 };
+	int32_t slot = -1;
+	bool cached = false;
+
+	while (t < t_end) {
+		int32_t g[3];
+		int32_t b[3];
+		g[0] = (int32_t)floorf((m[3] + dir[0] * t) * inv_vox);
+		g[1] = (int32_t)floorf((m[7] + dir[1] * t) * inv_vox);
+		g[2] = (int32_t)floorf((m[11] + dir[2] * t) * inv_vox);
+
+		//! \remark - Arithmetic Shift, Floor Division By TSDF_BLOCK Also For Negative Voxels.
+		b[0] = g[0] >> TSDF_BLOCK_SHIFT;
+		b[1] = g[1] >> TSDF_BLOCK_SHIFT;
+		b[2] = g[2] >> TSDF_BLOCK_SHIFT;
+		if (!cached || (b[0] != cache[0]) || (b[1] != cache[1]) || (b[2] != cache[2])) {
+			slot = tsdfFind(tsdf, b[0], b[1], b[2]);
+			cache[0] = b[0];
+			cache[1] = b[1];
+			cache[2] = b[2];
+			cached = true;
+		}
+		if (slot < 0) {
+			has_prev = false;
+			t += block * 0.5f;
+			continue;
+		}
+
+		const tsdf_vox_t *vox = tsdf->pool + (size_t)slot * TSDF_BLOCK_VOX +
+				((g[2] & (TSDF_BLOCK - 1)) * TSDF_BLOCK + (g[1] & (TSDF_BLOCK - 1))) * TSDF_BLOCK + (g[0] & (TSDF_BLOCK - 1));
+		if (vox->w == 0) {
+			has_prev = false;
+			t += vs;
+			continue;
+		}
+
+		float f = (float)vox->sdf * (1.0f / TSDF_SDF_SCALE);
+		if (has_prev && (f_prev > 0) && (f <= 0)) {
+			*hit = t_prev + (t - t_prev) * f_prev / (f_prev - f);
+			return true;
+		}
+
+		has_prev = true;
+		t_prev = t;
+		f_prev = f;
+		t += ((f > 0) && (f * tsdf->trunc * 0.8f > vs)) ? (f * tsdf->trunc * 0.8f) : vs;
+	}
+
+	return false;
+}
+
+
+//******************************************************************************
+//! \brief        Cast The Ray Of Each Pixel (Pool Job Body).
+//! \n            A Ray First Searches Around The Measured Depth, Then From Near To Far.
+//! \param[in]    ctx       tsdf_job_t.
+//! \param[in]    begin     First row, relative to the band.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void tsdfRayJob(void *ctx, int32_t begin, int32_t end)
+{
+	tsdf_job_t *job = (tsdf_job_t *)ctx;
+	const tsdf_t *tsdf = job->tsdf;
+	const cam_intr_t *cam = &tsdf->cam;
+	const float *m = job->pose;
+
+	for (int32_t v = job->row0 + begin; v < job->row0 + end; v++) {
+		int16_t *out = job->out + (size_t)v * tsdf->w * 3;
+		float ry = ((float)v - cam->cy) / cam->fy;
+
+		for (int32_t u = 0; u < tsdf->w; u++, out += 3) {
+			out[0] = 0;
+			out[1] = 0;
+			out[2] = 0;
+			if (((v % job->step) != 0) || ((u % job->step) != 0)) {
+				continue;
+			}
+
+			float rx = ((float)u - cam->cx) / cam->fx;
+			float dir[3] = {
+				m[0] * rx + m[1] * ry + m[2],
+				m[4] * rx + m[5] * ry + m[6],
+				m[8] * rx + m[9] * ry + m[10],
+			};
+			float d = (job->depth != NULL) ? (float)job->depth[(size_t)v * tsdf->w + u] : 0.0f;
+			float th;
+			bool found = false;
+
+			if (d > 0) {
+				float t0 = d - 2.0f * tsdf->trunc;
+				found = tsdfMarch(tsdf, m, dir, (t0 < TSDF_RAY_NEAR) ? TSDF_RAY_NEAR : t0, d + 2.0f * tsdf->trunc, &th);
+			}
+			if (!found) {
+				found = tsdfMarch(tsdf, m, dir, TSDF_RAY_NEAR, TSDF_RAY_FAR, &th);
+			}
+			if (found) {
+				out[0] = (int16_t)(rx * th);
+				out[1] = (int16_t)(ry * th);
+				out[2] = (int16_t)th;
+			}
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Raycast Thread, Casts The Requests Of tsdfRaycast() Until tsdfTerm().
+//! \details      The Volume Is Read Band By Band; tsdfIntegrate() Waits For One Band At Most,
+//! \n            And No Band Starts While It Writes.
+//! \param[in]    data      Volume.
+//! \return       NULL
+//******************************************************************************
+static void *tsdfRayThread(void *data)
+{
+	tsdf_t *tsdf = (tsdf_t *)data;
+	tsdf_job_t job;
+
+	if (g_trace_enable) {
+		traceSetThreadName("tsdf ray");
+	}
+
+	for (;;) {
+		pthread_mutex_lock(&tsdf->ray_lock);
+		while (!tsdf->ray_busy && !tsdf->exit) {
+			pthread_cond_wait(&tsdf->ray_cond, &tsdf->ray_lock);
+		}
+		bool stop = tsdf->exit;
+		pthread_mutex_unlock(&tsdf->ray_lock);
+		if (stop) {
+			break;
+		}
+
+		//! \remark - The Request Belongs To This Thread Until ray_busy Is Cleared.
+		uint64_t t0 = getMonoNs();
+		TRACE_BEGIN(TRACE_FUSE);
+		memset(&job, 0, sizeof(job));
+		job.tsdf = tsdf;
+		job.depth = tsdf->ray_hint ? tsdf->ray_depth : NULL;
+		job.pose = tsdf->ray_pose;
+		job.out = tsdf->ray_work;
+		job.step = tsdf->ray_step;
+		for (job.row0 = 0; job.row0 < tsdf->h; job.row0 += TSDF_RAY_BAND) {
+			pthread_mutex_lock(&tsdf->ray_lock);
+			while (tsdf->fusing && !tsdf->exit) {
+				pthread_cond_wait(&tsdf->ray_cond, &tsdf->ray_lock);
+			}
+			tsdf->casting = true;
+			pthread_mutex_unlock(&tsdf->ray_lock);
+
+			paraFor(tsdfRayJob, &job, (tsdf->h - job.row0 < TSDF_RAY_BAND) ? (tsdf->h - job.row0) : TSDF_RAY_BAND, TSDF_ROW_GRAIN);
+
+			pthread_mutex_lock(&tsdf->ray_lock);
+			tsdf->casting = false;
+			pthread_cond_broadcast(&tsdf->ray_cond);
+			pthread_mutex_unlock(&tsdf->ray_lock);
+		}
+		TRACE_END(TRACE_FUSE);
+		double ms = (double)(getMonoNs() - t0) * 1e-6;
+
+		pthread_mutex_lock(&tsdf->ray_lock);
+		int16_t *t = tsdf->ray_done;
+		tsdf->ray_done = tsdf->ray_work;
+		tsdf->ray_work = t;
+		tsdf->ray_fresh = true;
+		tsdf->ray_busy = false;
+		pthread_mutex_unlock(&tsdf->ray_lock);
+
+		pthread_mutex_lock(&tsdf->lock);
+		tsdf->rays++;
+		tsdf->ray_ms_sum += ms;
+		pthread_mutex_unlock(&tsdf->lock);
+	}
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Prepare A Volume Within A Memory Budget.
+//! \details      The Voxel Pool, Hash Table And Visible List Are Sized From mem_mb Once; Pool
+//! \n            Pages Are Only Backed By Memory When Blocks Are First Used. Starts The Raycast Thread.
+//! \param[out]   tsdf      Volume.
+//! \param[in]    w         Depth image width.
+//! \param[in]    h         Depth image height.
+//! \param[in]    cam       Intrinsics of the depth image.
+//! \param[in]    voxel     Voxel side in mm, 0 = disabled.
+//! \param[in]    mem_mb    Memory budget in MB.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int tsdfInit(tsdf_t *tsdf, int32_t w, int32_t h, const cam_intr_t *cam, float voxel, int32_t mem_mb)
+{
+	size_t per_block = sizeof(tsdf_vox_t) * TSDF_BLOCK_VOX + 4 * (sizeof(tsdf_entry_t) + sizeof(uint32_t));
+	uint32_t entries = 1;
+
+	memset(tsdf, 0, sizeof(*tsdf));
+	pthread_mutex_init(&tsdf->lock, NULL);
+	pthread_mutex_init(&tsdf->ray_lock, NULL);
+	pthread_cond_init(&tsdf->ray_cond, NULL);
+
+	if ((w <= 0) || (h <= 0) || (cam == NULL) || (voxel < 0) || (mem_mb <= 0)) {
+		return -1;
+	}
+
+	tsdf->w = w;
+	tsdf->h = h;
+	tsdf->cam = *cam;
+	tsdf->enable = (voxel > 0);
+
+	if (!tsdf->enable) {
+		return 0;
+	}
+
+	//! \remark - The Table Has 2 To 4 Entries Per Block, Which Keeps Probe Chains Short.
+	tsdf->voxel = voxel;
+	tsdf->trunc = voxel * TSDF_TRUNC_VOX;
+	tsdf->max_blocks = (int32_t)(((size_t)mem_mb << 20) / per_block);
+	while (entries < 2U * (uint32_t)tsdf->max_blocks) {
+		entries <<= 1;
+	}
+	tsdf->mask = entries - 1;
+	tsdf->frame = 0;
+	tsdf->table = (tsdf_entry_t *)calloc(entries, sizeof(tsdf_entry_t));
+	tsdf->spare = (tsdf_entry_t *)calloc(entries, sizeof(tsdf_entry_t));
+	tsdf->free_slot = (int32_t *)calloc((size_t)tsdf->max_blocks, sizeof(int32_t));
+	tsdf->age = (uint32_t *)calloc((size_t)tsdf->max_blocks, sizeof(uint32_t));
+	tsdf->visible = (uint32_t *)calloc(entries, sizeof(uint32_t));
+	tsdf->pool = (tsdf_vox_t *)calloc((size_t)tsdf->max_blocks * TSDF_BLOCK_VOX, sizeof(tsdf_vox_t));
+	tsdf->ray = (int16_t *)calloc((size_t)w * h * 3, sizeof(int16_t));
+	tsdf->ray_done = (int16_t *)calloc((size_t)w * h * 3, sizeof(int16_t));
+	tsdf->ray_work = (int16_t *)calloc((size_t)w * h * 3, sizeof(int16_t));
+	tsdf->ray_depth = (uint16_t *)calloc((size_t)w * h, sizeof(uint16_t));
+	if ((tsdf->table == NULL) || (tsdf->spare == NULL) || (tsdf->free_slot == NULL) || (tsdf->age == NULL) ||
+		(tsdf->visible == NULL) || (tsdf->pool == NULL) || (tsdf->ray == NULL) ||
+		(tsdf->ray_done == NULL) || (tsdf->ray_work == NULL) || (tsdf->ray_depth == NULL)) {
+		tsdfTerm(tsdf);
+		return -1;
+	}
+	for (uint32_t e = 0; e < entries; e++) {
+		tsdf->table[e].slot = -1;
+	}
+	for (int32_t k = 0; k < 12; k++) {
+		tsdf->pose[k] = ((k % 5) == 0) ? 1.0f : 0.0f;
+	}
+
+	if (pthread_create(&tsdf->thread, NULL, tsdfRayThread, tsdf) != 0) {
+		tsdfTerm(tsdf);
+		return -1;
+	}
+	tsdf->thread_created = true;
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Stop The Raycast Thread And Release A Volume.
+//! \n
+//! \param[in]    tsdf      Volume.
+//! \return       None.
+//******************************************************************************
+void tsdfTerm(tsdf_t *tsdf)
+{
+	if (tsdf->thread_created) {
+		pthread_mutex_lock(&tsdf->ray_lock);
+		tsdf->exit = true;
+		pthread_cond_broadcast(&tsdf->ray_cond);
+		pthread_mutex_unlock(&tsdf->ray_lock);
+
+		pthread_join(tsdf->thread, NULL);
+		tsdf->thread_created = false;
+	}
+
+	free(tsdf->table);
+	free(tsdf->spare);
+	free(tsdf->free_slot);
+	free(tsdf->age);
+	free(tsdf->visible);
+	free(tsdf->pool);
+	free(tsdf->ray);
+	free(tsdf->ray_done);
+	free(tsdf->ray_work);
+	free(tsdf->ray_depth);
+	tsdf->table = NULL;
+	tsdf->spare = NULL;
+	tsdf->free_slot = NULL;
+	tsdf->age = NULL;
+	tsdf->visible = NULL;
+	tsdf->pool = NULL;
+	tsdf->ray = NULL;
+	tsdf->ray_done = NULL;
+	tsdf->ray_work = NULL;
+	tsdf->ray_depth = NULL;
+	tsdf->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Fuse A Depth Image Into The Volume.
+//! \details      0. Recycle The Least Recently Seen Blocks When The Pool Runs Out.
+//! \n            1. Touch The Blocks Around The Measured Surface (Parallel, Lock Free).
+//! \n            2. Give New Blocks A Pool Slot, Recycled Ones First.
+//! \n            3. Integrate The Touched Blocks (Parallel Over Blocks).
+//! \param[in]    tsdf      Volume.
+//! \param[in]    depth     Depth image in mm, 0 = invalid.
+//! \param[in]    pose      Camera to world, 3x4 row major, t in m (e.g. from ICP), NULL = fixed camera.
+//! \return       0         success
+//! \return       -1        disabled
+//******************************************************************************
+int tsdfIntegrate(tsdf_t *tsdf, const uint16_t *depth, const double *pose)
+{
+	uint64_t t0 = getMonoNs();
+	tsdf_job_t job;
+	uint32_t recycled = 0;
+
+	if (!tsdf->enable || (depth == NULL)) {
+		return -1;
+	}
+
+	for (int32_t k = 0; (pose != NULL) && (k < 12); k++) {
+		tsdf->pose[k] = (float)(((k % 4) == 3) ? (pose[k] * 1000.0) : pose[k]);
+	}
+
+	memset(&job, 0, sizeof(job));
+	job.tsdf = tsdf;
+	job.depth = depth;
+
+	//! \remark - Wait For The Band Being Cast, No Further One Starts Until The Volume Is Written.
+	pthread_mutex_lock(&tsdf->ray_lock);
+	tsdf->fusing = true;
+	while (tsdf->casting) {
+		pthread_cond_wait(&tsdf->ray_cond, &tsdf->ray_lock);
+	}
+	pthread_mutex_unlock(&tsdf->ray_lock);
+
+	tsdfRecycle(tsdf);
+
+	tsdf->frame++;
+	tsdf->vis_cnt = 0;
+	paraFor(tsdfAllocJob, &job, tsdf->h, TSDF_ROW_GRAIN);
+
+	for (uint32_t i = 0; i < tsdf->vis_cnt; i++) {
+		tsdf_entry_t *ent = &tsdf->table[tsdf->visible[i]];
+
+		if (ent->slot >= 0) {
+			continue;
+		}
+		if (tsdf->free_cnt > 0) {
+			ent->slot = tsdf->free_slot[--tsdf->free_cnt];
+			memset(tsdf->pool + (size_t)ent->slot * TSDF_BLOCK_VOX, 0, sizeof(tsdf_vox_t) * TSDF_BLOCK_VOX);
+			recycled++;
+			continue;
+		}
+		if (tsdf->used >= tsdf->max_blocks) {
+			job.drop++;
+			continue;
+		}
+		ent->slot = tsdf->used++;
+	}
+
+	paraFor(tsdfIntegrateJob, &job, (int32_t)tsdf->vis_cnt, TSDF_BLOCK_GRAIN);
+
+	pthread_mutex_lock(&tsdf->ray_lock);
+	tsdf->fusing = false;
+	pthread_cond_broadcast(&tsdf->ray_cond);
+	pthread_mutex_unlock(&tsdf->ray_lock);
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&tsdf->lock);
+	tsdf->frames++;
+	tsdf->vis_sum += tsdf->vis_cnt;
+	tsdf->dropped += job.drop;
+	tsdf->recycled += recycled;
+	tsdf->int_ms_sum += ms;
+	if (ms > tsdf->int_ms_max) {
+		tsdf->int_ms_max = ms;
+	}
+	pthread_mutex_unlock(&tsdf->lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Take The Last Finished Raycast And Request One From The Pose Of The Last Integrated Frame.
+//! \details      Does Not Wait: The Raycast Thread Casts In The Background, So tsdf->ray Lags
+//! \n            The Volume By The Raycast Time. A Request While One Is Being Cast Is Skipped.
+//! \param[in]    tsdf      Volume, the last finished raycast is tsdf->ray.
+//! \param[in]    depth     Depth image of that frame, where rays start searching (copied), or NULL.
+//! \param[in]    step      Only every step-th pixel in x and y is cast, the others get none.
+//! \return       0         success
+//! \return       -1        disabled
+//******************************************************************************
+int tsdfRaycast(tsdf_t *tsdf, const uint16_t *depth, int32_t step)
+{
+	if (!tsdf->enable) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&tsdf->ray_lock);
+	if (tsdf->ray_fresh) {
+		int16_t *t = tsdf->ray;
+		tsdf->ray = tsdf->ray_done;
+		tsdf->ray_done = t;
+		tsdf->ray_fresh = false;
+	}
+	if (!tsdf->ray_busy) {
+		memcpy(tsdf->ray_pose, tsdf->pose, sizeof(tsdf->ray_pose));
+		tsdf->ray_hint = (depth != NULL);
+		if (depth != NULL) {
+			memcpy(tsdf->ray_depth, depth, sizeof(uint16_t) * tsdf->w * tsdf->h);
+		}
+		tsdf->ray_step = (step < 1) ? 1 : step;
+		tsdf->ray_busy = true;
+		pthread_cond_broadcast(&tsdf->ray_cond);
+	}
+	pthread_mutex_unlock(&tsdf->ray_lock);
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Print Volume Use And Timing Since The Last Report.
+//! \n
+//! \param[in]    tsdf      Volume.
+//! \param[in]    name      Name of the device.
+//! \return       None.
+//******************************************************************************
+void tsdfReport(tsdf_t *tsdf, const char *name)
+{
+	if (!tsdf->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&tsdf->lock);
+
+	if (tsdf->frames > 0) {
+		printf("tsdf %s: blocks=%d/%d (%.0f of %.0f MB) visible=%.0f integrate mean=%.2f ms max=%.2f ms raycasts=%u mean=%.2f ms "
+				"dropped=%u recycled=%u saturated=%u\n",
+				name, tsdf->used - tsdf->free_cnt, tsdf->max_blocks,
+				(double)(tsdf->used - tsdf->free_cnt) * sizeof(tsdf_vox_t) * TSDF_BLOCK_VOX / (1 << 20),
+				(double)tsdf->max_blocks * sizeof(tsdf_vox_t) * TSDF_BLOCK_VOX / (1 << 20),
+				(double)tsdf->vis_sum / tsdf->frames, tsdf->int_ms_sum / tsdf->frames, tsdf->int_ms_max,
+				tsdf->rays, (tsdf->rays > 0) ? (tsdf->ray_ms_sum / tsdf->rays) : 0.0, tsdf->dropped, tsdf->recycled, tsdf->saturated);
+	}
+
+	tsdf->frames = 0;
+	tsdf->vis_sum = 0;
+	tsdf->dropped = 0;
+	tsdf->recycled = 0;
+	tsdf->saturated = 0;
+	tsdf->int_ms_sum = 0;
+	tsdf->int_ms_max = 0;
+	tsdf->rays = 0;
+	tsdf->ray_ms_sum = 0;
+
+	pthread_mutex_unlock(&tsdf->lock);
+}
@@ -0,0 +1,301 @@
+//******************************************************************************
+//! \file       view_util_undist.cpp
+//! \brief      Radial Lens Undistortion By A Fixed Point Bilinear Remap Table.
+//! \license	This source code has been released under 3-clause BSD license.
+//		It includes OpenCV, OpenGL and FreeGLUT libraries. 
+//		Refer to "Readme-License.txt" for details.
+//******************************************************************************
+
+
+//******************************************************************************
+// Include Headers
+//******************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "view_util_undist.h"
+#include "view_util_para.h"
+#include "view_util_time.h"
+
+
+//******************************************************************************
+// Definitions
+//******************************************************************************
+#define UNDIST_ROW_GRAIN    (16)    //!< Rows Per Pool Block.
+#define UNDIST_FRAC_BITS    (7)     //!< Sub Pixel Position Of The Source In 1/128 Pixel.
+#define UNDIST_FRAC_ONE     (1 << UNDIST_FRAC_BITS)
+
+//! Job Context.
+typedef struct _undist_job_t {
+	undist_t *ud;
+	const uint16_t *src;    //!< Distorted Image.
+} undist_job_t;
+
+
+//******************************************************************************
+//! \brief        Remap Rows (Pool Job Body).
+//! \details      The Four Source Pixels Of 8 Outputs Are Gathered Into Lanes, Then Weighted
+//! \n            With 32 Bit Products And Rounded Back To 16 Bits In Vector Registers.
+//! \param[in]    ctx       undist_job_t.
+//! \param[in]    begin     First row.
+//! \param[in]    end       Row after the last one.
+//! \return       None.
+//******************************************************************************
+static void undistJob(void *ctx, int32_t begin, int32_t end)
+{
+	undist_job_t *job = (undist_job_t *)ctx;
+	undist_t *ud = job->ud;
+	const uint16_t *src = job->src;
+	int32_t w = ud->w;
+	size_t n = (size_t)w * ud->h;
+
+	for (int32_t v = begin; v < end; v++) {
+		size_t i0 = (size_t)v * w;
+		const uint32_t *ofs = ud->ofs + i0;
+		const uint16_t *w00 = ud->wt + i0;
+		const uint16_t *w01 = w00 + n;
+		const uint16_t *w10 = w01 + n;
+		const uint16_t *w11 = w10 + n;
+		uint16_t *dst = ud->out + i0;
+		int32_t u = 0;
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+		for (; u + 8 <= w; u += 8) {
+			const uint16_t *s0 = src + ofs[u];
+			const uint16_t *s1 = src + ofs[u + 1];
+			const uint16_t *s2 = src + ofs[u + 2];
+			const uint16_t *s3 = src + ofs[u + 3];
+			const uint16_t *s4 = src + ofs[u + 4];
+			const uint16_t *s5 = src + ofs[u + 5];
+			const uint16_t *s6 = src + ofs[u + 6];
+			const uint16_t *s7 = src + ofs[u + 7];
+
+#if defined(__ARM_NEON)
+			const uint16_t g00[8] = { s0[0], s1[0], s2[0], s3[0], s4[0], s5[0], s6[0], s7[0] };
+			const uint16_t g01[8] = { s0[1], s1[1], s2[1], s3[1], s4[1], s5[1], s6[1], s7[1] };
+			const uint16_t g10[8] = { s0[w], s1[w], s2[w], s3[w], s4[w], s5[w], s6[w], s7[w] };
+			const uint16_t g11[8] = { s0[w + 1], s1[w + 1], s2[w + 1], s3[w + 1], s4[w + 1], s5[w + 1], s6[w + 1], s7[w + 1] };
+			uint16x8_t a = vld1q_u16(g00);
+			uint16x8_t b = vld1q_u16(g01);
+			uint16x8_t c = vld1q_u16(g10);
+			uint16x8_t d = vld1q_u16(g11);
+			uint16x8_t wa = vld1q_u16(w00 + u);
+			uint16x8_t wb = vld1q_u16(w01 + u);
+			uint16x8_t wc = vld1q_u16(w10 + u);
+			uint16x8_t wd = vld1q_u16(w11 + u);
+			uint32x4_t lo = vmull_u16(vget_low_u16(a), vget_low_u16(wa));
+			uint32x4_t hi = vmull_u16(vget_high_u16(a), vget_high_u16(wa));
+
+			lo = vmlal_u16(lo, vget_low_u16(b), vget_low_u16(wb));
+			hi = vmlal_u16(hi, vget_high_u16(b), vget_high_u16(wb));
+			lo = vmlal_u16(lo, vget_low_u16(c), vget_low_u16(wc));
+			hi = vmlal_u16(hi, vget_high_u16(c), vget_high_u16(wc));
+			lo = vmlal_u16(lo, vget_low_u16(d), vget_low_u16(wd));
+			hi = vmlal_u16(hi, vget_high_u16(d), vget_high_u16(wd));
+			vst1q_u16(dst + u, vcombine_u16(vqrshrn_n_u32(lo, UNDIST_WT_BITS), vqrshrn_n_u32(hi, UNDIST_WT_BITS)));
+#else
+			__m128i pv[4];
+			const uint16_t *wv[4] = { w00 + u, w01 + u, w10 + u, w11 + u };
+			__m128i lo = _mm_set1_epi32(1 << (UNDIST_WT_BITS - 1));
+			__m128i hi = lo;
+
+			pv[0] = _mm_setr_epi16(s0[0], s1[0], s2[0], s3[0], s4[0], s5[0], s6[0], s7[0]);
+			pv[1] = _mm_setr_epi16(s0[1], s1[1], s2[1], s3[1], s4[1], s5[1], s6[1], s7[1]);
+			pv[2] = _mm_setr_epi16(s0[w], s1[w], s2[w], s3[w], s4[w], s5[w], s6[w], s7[w]);
+			pv[3] = _mm_setr_epi16(s0[w + 1], s1[w + 1], s2[w + 1], s3[w + 1], s4[w + 1], s5[w + 1], s6[w + 1], s7[w + 1]);
+
+			//! \remark - mullo/mulhi Give The Low/High Halves Of The 16 x 16 Bit Products.
+			for (int32_t k = 0; k < 4; k++) {
+				__m128i q = _mm_loadu_si128((const __m128i *)wv[k]);
+				__m128i pl = _mm_mullo_epi16(pv[k], q);
+				__m128i ph = _mm_mulhi_epu16(pv[k], q);
+
+				lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(pl, ph));
+				hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(pl, ph));
+			}
+
+			//! \remark - Biased So The Signed Pack Keeps 0..65535.
+			const __m128i bias32 = _mm_set1_epi32(32768);
+			lo = _mm_sub_epi32(_mm_srli_epi32(lo, UNDIST_WT_BITS), bias32);
+			hi = _mm_sub_epi32(_mm_srli_epi32(hi, UNDIST_WT_BITS), bias32);
+			_mm_storeu_si128((__m128i *)(dst + u), _mm_xor_si128(_mm_packs_epi32(lo, hi), _mm_set1_epi16((short)0x8000)));
+#endif
+		}
+#endif
+
+		for (; u < w; u++) {
+			const uint16_t *s = src + ofs[u];
+			uint32_t acc = (uint32_t)s[0] * w00[u] + (uint32_t)s[1] * w01[u] +
+							(uint32_t)s[w] * w10[u] + (uint32_t)s[w + 1] * w11[u];
+
+			dst[u] = (uint16_t)((acc + (1U << (UNDIST_WT_BITS - 1))) >> UNDIST_WT_BITS);
+		}
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Build The Remap Table Of An Image Size.
+//! \details      For Each Output Pixel The Distorted Source Is
+//! \n            x_d = x (1 + k1 r^2 + k2 r^4 + k3 r^6 + k4 r^8), In Coordinates Normalized By
+//! \n            The Focal Length. Sources Outside The Image Get Zero Weights (Black).
+//! \param[out]   ud        Remap.
+//! \param[in]    w         Image width.
+//! \param[in]    h         Image height.
+//! \param[in]    cam       Intrinsics of the image.
+//! \param[in]    prm       k1..k4 in fixed point with UNDIST_PRM_FRAC fraction bits.
+//! \param[in]    enable    Remap when the lens has distortion.
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+int undistInit(undist_t *ud, int32_t w, int32_t h, const cam_intr_t *cam, const int64_t prm[4], bool enable)
+{
+	double k[4];
+	size_t n = (size_t)w * h;
+
+	memset(ud, 0, sizeof(*ud));
+	pthread_mutex_init(&ud->lock, NULL);
+
+	if ((w < 2) || (h < 2) || (cam == NULL) || (prm == NULL)) {
+		return -1;
+	}
+
+	ud->w = w;
+	ud->h = h;
+	for (int32_t i = 0; i < 4; i++) {
+		k[i] = (double)prm[i] / (double)(1LL << UNDIST_PRM_FRAC);
+	}
+
+	//! \remark - Without Coefficients The Table Would Be An Identity, The Image Is Used As Is.
+	ud->enable = enable && ((prm[0] != 0) || (prm[1] != 0) || (prm[2] != 0) || (prm[3] != 0));
+	if (!ud->enable) {
+		return 0;
+	}
+
+	ud->ofs = (uint32_t *)calloc(n, sizeof(uint32_t));
+	ud->wt = (uint16_t *)calloc(n * 4, sizeof(uint16_t));
+	ud->out = (uint16_t *)calloc(n, sizeof(uint16_t));
+	if ((ud->ofs == NULL) || (ud->wt == NULL) || (ud->out == NULL)) {
+		undistTerm(ud);
+		return -1;
+	}
+
+	for (int32_t v = 0; v < h; v++) {
+		for (int32_t u = 0; u < w; u++) {
+			size_t i = (size_t)v * w + u;
+			double x = (u - cam->cx) / cam->fx;
+			double y = (v - cam->cy) / cam->fy;
+			double r2 = x * x + y * y;
+			double s = 1.0 + r2 * (k[0] + r2 * (k[1] + r2 * (k[2] + r2 * k[3])));
+			double sx = cam->cx + cam->fx * x * s;
+			double sy = cam->cy + cam->fy * y * s;
+
+			if ((sx < 0) || (sy < 0) || (sx > w - 1) || (sy > h - 1)) {
+				continue;
+			}
+
+			//! \remark - The Last Row/Column Is Reached With A Full Weight On The Right/Bottom Pixel.
+			int32_t x0 = (int32_t)sx;
+			int32_t y0 = (int32_t)sy;
+			x0 = (x0 > w - 2) ? (w - 2) : x0;
+			y0 = (y0 > h - 2) ? (h - 2) : y0;
+			uint32_t fx = (uint32_t)lround((sx - x0) * UNDIST_FRAC_ONE);
+			uint32_t fy = (uint32_t)lround((sy - y0) * UNDIST_FRAC_ONE);
+
+			ud->ofs[i] = (uint32_t)(y0 * w + x0);
+			ud->wt[i] = (uint16_t)((UNDIST_FRAC_ONE - fx) * (UNDIST_FRAC_ONE - fy));
+			ud->wt[n + i] = (uint16_t)(fx * (UNDIST_FRAC_ONE - fy));
+			ud->wt[2 * n + i] = (uint16_t)((UNDIST_FRAC_ONE - fx) * fy);
+			ud->wt[3 * n + i] = (uint16_t)(fx * fy);
+		}
+	}
+
+	return 0;
+}
+
+
+//******************************************************************************
+//! \brief        Release A Remap Table.
+//! \n
+//! \param[in]    ud        Remap.
+//! \return       None.
+//******************************************************************************
+void undistTerm(undist_t *ud)
+{
+	free(ud->ofs);
+	free(ud->wt);
+	free(ud->out);
+	ud->ofs = NULL;
+	ud->wt = NULL;
+	ud->out = NULL;
+	ud->enable = false;
+}
+
+
+//******************************************************************************
+//! \brief        Undistort An Image, Rows Run On The Worker Pool.
+//! \n
+//! \param[in]    ud        Remap.
+//! \param[in]    src       w x h image.
+//! \return       Undistorted image (ud->out), or src when disabled.
+//******************************************************************************
+const uint16_t *undistApply(undist_t *ud, const uint16_t *src)
+{
+	uint64_t t0 = getMonoNs();
+	undist_job_t job;
+
+	if (!ud->enable || (src == NULL)) {
+		return src;
+	}
+
+	job.ud = ud;
+	job.src = src;
+	paraFor(undistJob, &job, ud->h, UNDIST_ROW_GRAIN);
+
+	double ms = (double)(getMonoNs() - t0) * 1e-6;
+	pthread_mutex_lock(&ud->lock);
+	ud->frames++;
+	ud->ms_sum += ms;
+	if (ms > ud->ms_max) {
+		ud->ms_max = ms;
+	}
+	pthread_mutex_unlock(&ud->lock);
+
+	return ud->out;
+}
+
+
+//******************************************************************************
+//! \brief        Print Remap Timing Since The Last Report.
+//! \n
+//! \param[in]    ud        Remap.
+//! \param[in]    name      Name of the device and image.
+//! \return       None.
+//******************************************************************************
+void undistReport(undist_t *ud, const char *name)
+{
+	if (!ud->enable) {
+		return;
+	}
+
+	pthread_mutex_lock(&ud->lock);
+
+	if (ud->frames > 0) {
+		printf("undist %s: %dx%d images=%u mean=%.2f ms max=%.2f ms\n",
+				name, ud->w, ud->h, ud->frames, ud->ms_sum / ud->frames, ud->ms_max);
+	}
+
+	ud->frames = 0;
+	ud->ms_sum = 0;
+	ud->ms_max = 0;
+
+	pthread_mutex_unlock(&ud->lock);
+}
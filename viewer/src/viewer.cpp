@@ -18,9 +18,12 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
 
 #include <cstring>
-#include <chrono>
+#include <atomic>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -30,6 +33,25 @@
 #include "tl_log.h"
 #include "tl_api_enh.h"
 #include "view_util_ptcd.h"
+#include "view_util_sched.h"
+#include "view_util_para.h"
+#include "view_util_bgsub.h"
+#include "view_util_plane.h"
+#include "view_util_normal.h"
+#include "view_util_blob.h"
+#include "view_util_icp.h"
+#include "view_util_spidx.h"
+#include "view_util_tsdf.h"
+#include "view_util_pyr.h"
+#include "view_util_undist.h"
+#include "view_util_align.h"
+#include "view_util_hist.h"
+#include "view_util_rec.h"
+#include "view_util_dash.h"
+#include "view_util_meta.h"
+#include "view_util_qos.h"
+#include "view_util_trace.h"
+#include "view_util_time.h"
 
 
 //******************************************************************************
@@ -37,14 +59,11 @@
 //******************************************************************************
 #define VIEWER_VERSION						(0x0001)
 
-#define OPENCV_WINDOW_NAME_DPTH				"Color Depth Image"
-#define OPENCV_WINDOW_NAME_IR				"IR image"
-#define OPENCV_WINDOW_NAME_BG				"BG image"
-#define OPENCV_TRACKBAR_NAME_GAMMA_CORR_IR	"IR Gamma Correction (slider/10)"
-#define OPENCV_TRACKBAR_NAME_GAMMA_CORR_BG	"BG Gamma Correction (slider/10)"
-
 #define OPENGL_WINDOW_NAME_PTCD				"Point Cloud View"
 
+#define APL_MAX_DEV							(4)		// Maximum Number Of ToF Modules Streaming At Once
+#define APL_STAT_INTERVAL_SEC				(5)		// Interval Of Frame Rate Report
+
 // Image Size
 typedef struct {
 	size_t	depth;	// depth image
@@ -52,8 +71,9 @@ typedef struct {
 	size_t	bg;		// bg image
 } apl_img_size;
 
-// Application Paramters
+// Device Context (One Per TL_Handle, Each With Its Own Capture Thread And Pipeline)
 typedef struct {
+	int					idx;			// device index
 	TL_Handle			*handle;		// camera handle
 	TL_ModeInfoGroup	mode_info_grp;	// Each ranging mode info
 	TL_DeviceInfo		device_info;	// Device info
@@ -64,12 +84,66 @@ typedef struct {
 	TL_Resolution		resolution;		// resolution of images
 	apl_img_size		img_size;		// image size
 	int16_t				*points_cloud;	// data pointer of PointCloud
+	bool				started;		// streaming started
+	bool				thread_created;	// capture thread created
+	pthread_t			threadview;		// View Thread (Capture And Process Of This Device)
+	sched_cfg_t			sched;			// scheduling policy, priority and cores of the view thread
+	jitter_t			jitter;			// interval statistics of received images
+	qos_t				qos;			// adaptive quality controller
+	uint32_t			drop_cnt;		// TL_NOTIFY_NO_BUFFER since the previous image
+	std::atomic<uint32_t> frame_cnt;	// number of received images
+	uint32_t			seq;			// sequence number of the next image
+	latency_t			latency;		// capture to end of processing of each image
+	bgsub_t				bgsub;			// background depth model, only foreground points are converted
+	plane_det_t			plane;			// dominant plane (floor/wall) of the point cloud
+	normal_est_t		normal;			// surface normals of the point cloud
+	blob_ext_t			blob;			// connected objects of the depth image with their 3D boxes
+	icp_t				icp;			// frame to frame odometry of the point cloud
+	spidx_t				spidx;			// hashed voxel grid of the point cloud
+	tsdf_t				tsdf;			// fused volume of successive depth images
+	depth_pyr_t			pyr;			// reduced resolutions of the depth image
+	undist_t			undist_ir;		// lens undistortion of the IR image
+	undist_t			undist_bg;		// lens undistortion of the BG image
+	align_t				align;			// depth and IR on the grid of the larger plane, all steps run on it
+	int					(*align_fn)(align_t *, TL_Image *);	// resampling of the image kind
+	volatile int		cancel_ret;		// result of TL_cancel from the signal handler
+	volatile bool		canceled;		// TL_cancel was called
+} apl_dev;
+
+// Application Paramters
+typedef struct {
+	int					dev_num;		// number of devices to stream
+	int					disp_idx;		// device shown in the OpenCV and OpenGL windows
+	apl_dev				dev[APL_MAX_DEV];	// device contexts
+	sched_cfg_t			sched_gl;		// scheduling policy, priority and cores of the 3D view thread
+	bool				qos_enable;		// degrade the displayed device's quality under load
+	depth_hist_t		hist;			// depth histogram of the displayed device, sets the color range
+	const char			*bg_path;		// background model file, NULL = no background subtraction
+	float				plane_thresh;	// plane detection inlier distance in mm, 0 = off
+	int					normal_radius;	// normal estimation window radius in pixels, 0 = off
+	int					blob_min;		// smallest reported object in pixels, 0 = no blob extraction
+	const char			*icp_path;		// pose file of the ICP odometry, "-" = no file, NULL = off
+	float				spidx_cell;		// voxel side and outlier radius of the spatial index in mm, 0 = off
+	float				tsdf_voxel;		// voxel side of the TSDF volume in mm, 0 = off
+	int					tsdf_mb;		// memory budget of each TSDF volume in MB
+	int					pyr_level;		// depth pyramid level of the 3D view and the histogram, 0 = full
+	TL_E_IMAGE_KIND		image_kind;		// kind of output images of every device
+	float				jbu_sigma;		// IR range sigma of the guided depth upsampling, 0 = edge aware
+	bool				undist_enable;	// remove the lens distortion from the IR and BG images
+	int					para_threads;	// threads per parallel job (worker pool + caller)
+	char				snap_prefix[256];	// file name prefix of 3D view snapshots
+	bool				offscreen;		// render the 3D view off-screen, no windows
+	int					snap_frames;	// frames written off-screen, 0 = until exit
+	const char			*rec_path;		// video file of the displayed images, NULL = no recording
+	rec_t				rec_depth;		// recorder of the color depth image
+	rec_t				rec_ir;			// recorder of the IR image
+	dash_t				dash;			// window tiling the depth, IR and BG images of the displayed device
 } apl_prm;
 
 static apl_prm gPrm;					// application parameters
 volatile bool bExit = false;			// false = Run Program, true = Exit Program.
+volatile bool bTraceDump = false;		// true = Write The Trace On The Next Report (SIGUSR1).
 
-pthread_t threadview;					// View Thread (Handle Depth View, IR View)
 pthread_t threadview3d;					// 3D View Thread (Handle 3D Point Cloud View)
 
 
@@ -77,8 +151,8 @@ pthread_t threadview3d;					// 3D View Thread (Handle 3D Point Cloud View)
 // Functions
 //******************************************************************************
 void apl_print_error(TL_E_RESULT ret, char *function, unsigned int line);
-void apl_callback(TL_Handle *handle, uint32_t notify, TL_Image data);
-void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso, TL_Image *stData);
+void apl_callback(apl_dev *dev, uint32_t notify, TL_Image data, uint64_t cap_ns);
+void apl_show_img(apl_dev *dev, TL_Image *stData, const frame_meta_t *meta);
 void *menu_thread(void *);
 void *view_thread(void *);
 void *view_3d_thread(void *);
@@ -99,15 +173,99 @@ void apl_init_color_tbl(uint32_t min_val, uint32_t max_val, uint32_t range)
 }
 
 
+//******************************************************************************
+//! \brief        Pinhole Intrinsics Of An Image Plane From The Lens And FOV Info
+//! \details      The Focal Length Is focal_length / pixel_pitch, Both Given For The Sensor Output;
+//! \n            QVGA Planes Scale Them Down. Without Lens Info The Horizontal FOV Is Used.
+//! \param[in]    dev           device context
+//! \param[in]    w             width of the image plane
+//! \param[in]    h             height of the image plane
+//! \param[out]   cam           intrinsics
+//! \return       None
+//******************************************************************************
+static void apl_cam_intr(const apl_dev *dev, int w, int h, cam_intr_t *cam)
+{
+	const TL_LensPrm *lens = &dev->lens_info;
+	float sx = (lens->sns_h > 0) ? ((float)w / lens->sns_h) : 1.0f;
+	float sy = (lens->sns_v > 0) ? ((float)h / lens->sns_v) : 1.0f;
+	float f;
+
+	if ((lens->pixel_pitch > 0) && (dev->fov.focal_length > 0)) {
+		//! \remark - focal_length Is mm x 100, pixel_pitch Is um x 100.
+		f = dev->fov.focal_length * 1000.0f / lens->pixel_pitch;
+	}
+	else {
+		f = (lens->sns_h > 0 ? lens->sns_h : w) * 0.5f / tanf(dev->fov.angle_h * (float)M_PI / 36000.0f);
+	}
+
+	cam->fx = f * sx;
+	cam->fy = f * sy;
+	cam->cx = (lens->sns_h > 0) ? ((lens->center_h + 0.5f) * sx - 0.5f) : ((w - 1) * 0.5f);
+	cam->cy = (lens->sns_v > 0) ? ((lens->center_v + 0.5f) * sy - 0.5f) : ((h - 1) * 0.5f);
+}
+
+
+//******************************************************************************
+//! \brief        Planes Of An Image Kind That Are Upsampled 2x Onto The Grid
+//! \details      Mixed Kinds Pair A VGA Plane With A QVGA One: VGA Depth With QVGA IR Upsamples The IR
+//! \n            (Bilinear), VGA IR With QVGA Depth Upsamples The Depth (Edge Aware). The Other Kinds
+//! \n            Have Both Planes Of One Size.
+//******************************************************************************
+template <TL_E_IMAGE_KIND K>
+struct apl_kind {
+	static const bool depth_up = false;
+	static const bool ir_up = false;
+};
+
+template <>
+struct apl_kind<TL_E_IMAGE_KIND_VGA_DEPTH_QVGA_IR_BG> {
+	static const bool depth_up = false;
+	static const bool ir_up = true;
+};
+
+template <>
+struct apl_kind<TL_E_IMAGE_KIND_VGA_IR_QVGA_DEPTH> {
+	static const bool depth_up = true;
+	static const bool ir_up = false;
+};
+
+
+//******************************************************************************
+//! \brief        Bring The Depth And IR Of An Image Onto The Grid, Kernels Fixed By The Image Kind
+//! \n
+//! \param[in]    al            alignment of the device
+//! \param[in]    stData        image data
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+template <TL_E_IMAGE_KIND K>
+static int apl_align(align_t *al, TL_Image *stData)
+{
+	return alignApply<apl_kind<K>::depth_up, apl_kind<K>::ir_up>(al,
+			(const uint16_t *)stData->depth, (const uint16_t *)stData->ir);
+}
+
+//! Alignment Of Each Image Kind, Picked Once By apl_init().
+static int (*const apl_align_tbl[TL_E_IMAGE_KIND_MAX])(align_t *, TL_Image *) = {
+	apl_align<TL_E_IMAGE_KIND_VGA_DEPTH_QVGA_IR_BG>,
+	apl_align<TL_E_IMAGE_KIND_QVGA_DEPTH_IR_BG>,
+	apl_align<TL_E_IMAGE_KIND_VGA_DEPTH_IR>,
+	apl_align<TL_E_IMAGE_KIND_VGA_IR_QVGA_DEPTH>,
+	apl_align<TL_E_IMAGE_KIND_VGA_IR_BG>,
+};
+
+
 //******************************************************************************
 //! \brief        Initialization of libccdtof.so Library
 //! \details
-//! \param[in]    None
+//! \param[in]    dev           device context
+//! \param[in]    mode          ranging mode
+//! \param[in]    image_kind    kind of output images
 //! \param[out]   None
 //! \return       0         success
 //! \return       -1        failed
 //******************************************************************************
-static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
+static int apl_init(apl_dev *dev, TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 {
 	TL_E_RESULT ret;
 	TL_Param    tlprm;
@@ -115,55 +273,56 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 	memset(&tlprm, 0, sizeof(tlprm));
 
 	// Default Image Kind
-	gPrm.image_kind = image_kind;
+	dev->image_kind = image_kind;
 	tlprm.image_kind = image_kind;
 
 	// Default Mode
-	gPrm.mode = mode;
+	dev->mode = mode;
 
 	// Initialize libccdtof.so Library
-	gPrm.handle = NULL;
-	ret = TL_init(&gPrm.handle, &tlprm);
+	dev->handle = NULL;
+	ret = TL_init(&dev->handle, &tlprm);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_init", __LINE__);
 		return -1;
 	}
 
 	// Set Depth Mode (Ranging Mode)
-	ret = TL_setProperty(gPrm.handle, TL_CMD_MODE, (void*)&gPrm.mode);
+	ret = TL_setProperty(dev->handle, TL_CMD_MODE, (void*)&dev->mode);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_setProperty TL_CMD_MODE", __LINE__);
 		return -1;
 	}
 
 	// Get Resolution Of Output Images
-	ret = TL_getProperty(gPrm.handle, TL_CMD_RESOLUTION, (void*)&gPrm.resolution);
+	ret = TL_getProperty(dev->handle, TL_CMD_RESOLUTION, (void*)&dev->resolution);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_getProperty TL_CMD_RESOLUTION", __LINE__);
 		return -1;
 	}
 	else {
+		printf("Device %d\n", dev->idx);
 		printf("Resolution of output images:\n");
 		printf("depth : width=%d, height=%d, stride=%d, bit_per_pixel=%d \n",
-			gPrm.resolution.depth.width,
-			gPrm.resolution.depth.height,
-			gPrm.resolution.depth.stride,
-			gPrm.resolution.depth.bit_per_pixel);
+			dev->resolution.depth.width,
+			dev->resolution.depth.height,
+			dev->resolution.depth.stride,
+			dev->resolution.depth.bit_per_pixel);
 		printf("ir    : width=%d, height=%d, stride=%d, bit_per_pixel=%d \n",
-			gPrm.resolution.ir.width,
-			gPrm.resolution.ir.height,
-			gPrm.resolution.ir.stride,
-			gPrm.resolution.ir.bit_per_pixel);
+			dev->resolution.ir.width,
+			dev->resolution.ir.height,
+			dev->resolution.ir.stride,
+			dev->resolution.ir.bit_per_pixel);
 		printf("bg    : width=%d, height=%d, stride=%d, bit_per_pixel=%d \n",
-			gPrm.resolution.bg.width,
-			gPrm.resolution.bg.height,
-			gPrm.resolution.bg.stride,
-			gPrm.resolution.bg.bit_per_pixel);
+			dev->resolution.bg.width,
+			dev->resolution.bg.height,
+			dev->resolution.bg.stride,
+			dev->resolution.bg.bit_per_pixel);
 		printf("\n");
 	}
 
 	// Get Mode Information
-	ret = TL_getProperty(gPrm.handle, TL_CMD_MODE_INFO, (void*)&gPrm.mode_info_grp);
+	ret = TL_getProperty(dev->handle, TL_CMD_MODE_INFO, (void*)&dev->mode_info_grp);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_getProperty TL_CMD_MODE_INFO", __LINE__);
 		return -1;
@@ -171,22 +330,22 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 	else {
 		printf("Mode Info:\n");
 		printf("mode0 : enable=%d, range_near=%d, range_far=%d, depth_unit=%d, fps=%d\n",
-				gPrm.mode_info_grp.mode[0].enable,
-				gPrm.mode_info_grp.mode[0].range_near,
-				gPrm.mode_info_grp.mode[0].range_far,
-				gPrm.mode_info_grp.mode[0].depth_unit,
-				gPrm.mode_info_grp.mode[0].fps);
+				dev->mode_info_grp.mode[0].enable,
+				dev->mode_info_grp.mode[0].range_near,
+				dev->mode_info_grp.mode[0].range_far,
+				dev->mode_info_grp.mode[0].depth_unit,
+				dev->mode_info_grp.mode[0].fps);
 		printf("mode1 : enable=%d, range_near=%d, range_far=%d, depth_unit=%d, fps=%d\n",
-				gPrm.mode_info_grp.mode[1].enable,
-				gPrm.mode_info_grp.mode[1].range_near,
-				gPrm.mode_info_grp.mode[1].range_far,
-				gPrm.mode_info_grp.mode[1].depth_unit,
-				gPrm.mode_info_grp.mode[1].fps);
+				dev->mode_info_grp.mode[1].enable,
+				dev->mode_info_grp.mode[1].range_near,
+				dev->mode_info_grp.mode[1].range_far,
+				dev->mode_info_grp.mode[1].depth_unit,
+				dev->mode_info_grp.mode[1].fps);
 		printf("\n");
 	}
 
 	// Get Fov Information
-	ret = TL_getProperty(gPrm.handle, TL_CMD_FOV, (void*)&gPrm.fov);
+	ret = TL_getProperty(dev->handle, TL_CMD_FOV, (void*)&dev->fov);
 	if(ret != TL_E_SUCCESS){
 		apl_print_error(ret, (char *)"TL_getProperty TL_CMD_FOV", __LINE__);
 		return -1;
@@ -194,14 +353,14 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 	else {
 		printf("Fov Info:\n");
 		printf("focal_length=%d, angle_h=%d, angle_v=%d\n",
-				gPrm.fov.focal_length,
-				gPrm.fov.angle_h,
-				gPrm.fov.angle_v);
+				dev->fov.focal_length,
+				dev->fov.angle_h,
+				dev->fov.angle_v);
 		printf("\n");
 	}
 
 	// Get Mode Information
-	ret = TL_getProperty(gPrm.handle, TL_CMD_DEVICE_INFO, (void*)&gPrm.device_info);
+	ret = TL_getProperty(dev->handle, TL_CMD_DEVICE_INFO, (void*)&dev->device_info);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_getProperty TL_CMD_DEVICE_INFO", __LINE__);
 		return -1;
@@ -209,28 +368,34 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 	else {
 		printf("Hardware Info:\n");
 		printf("%s %s %s %s \n",
-			gPrm.device_info.mod_name,
-			gPrm.device_info.afe_name,
-			gPrm.device_info.sns_name,
-			gPrm.device_info.lns_name);
+			dev->device_info.mod_name,
+			dev->device_info.afe_name,
+			dev->device_info.sns_name,
+			dev->device_info.lns_name);
 		printf("mod_type:0x%x 0x%x afe_ptn_id:0x%x sno_l:0x%x\n",
-			gPrm.device_info.mod_type1,
-			gPrm.device_info.mod_type2,
-			gPrm.device_info.afe_ptn_id,
-			gPrm.device_info.sno_l);
+			dev->device_info.mod_type1,
+			dev->device_info.mod_type2,
+			dev->device_info.afe_ptn_id,
+			dev->device_info.sno_l);
 		printf("map_ver:0x%x sno_u:0x%x ajust_date:0x%x ajust_no:0x%x\n",
-			gPrm.device_info.map_ver,
-			gPrm.device_info.sno_u,
-			gPrm.device_info.ajust_date,
-			gPrm.device_info.ajust_no);
+			dev->device_info.map_ver,
+			dev->device_info.sno_u,
+			dev->device_info.ajust_date,
+			dev->device_info.ajust_no);
 		printf("\n");
 	}
 
-	//! \remark - Decide The Range For Depth Base On Range Mode.
-	apl_init_color_tbl(gPrm.mode_info_grp.mode[mode].range_near, gPrm.mode_info_grp.mode[mode].range_far, 1000);
+	//! \remark - Frame Budget Of The Quality Controller Is The Frame Interval Of The Ranging Mode.
+	uint16_t fps = dev->mode_info_grp.mode[mode].fps;
+	qosInit(&dev->qos, 1000.0 / ((fps > 0) ? fps : 30), gPrm.qos_enable && (dev->idx == gPrm.disp_idx));
+
+	//! \remark - Decide The Range For Depth Base On Range Mode (The Color LUT Follows The Displayed Device).
+	if (dev->idx == gPrm.disp_idx) {
+		apl_init_color_tbl(dev->mode_info_grp.mode[mode].range_near, dev->mode_info_grp.mode[mode].range_far, 1000);
+	}
 
 	// Get device information, Execute TL_getProperty (TL_CMD_LENS_INFO)
-	ret = TL_getProperty(gPrm.handle, TL_CMD_LENS_INFO, (void*)&gPrm.lens_info);
+	ret = TL_getProperty(dev->handle, TL_CMD_LENS_INFO, (void*)&dev->lens_info);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_getProperty TL_CMD_LENS_INFO", __LINE__);
 		return -1;
@@ -238,43 +403,129 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 	else {
 		printf("Lens Info:\n");
 		printf("sns_h=%d, sns_v=%d, center_h=%d, center_v=%d pixel_pitch=%d\n",
-			gPrm.lens_info.sns_h,
-			gPrm.lens_info.sns_v,
-			gPrm.lens_info.center_h,
-			gPrm.lens_info.center_v,
-			gPrm.lens_info.pixel_pitch);
+			dev->lens_info.sns_h,
+			dev->lens_info.sns_v,
+			dev->lens_info.center_h,
+			dev->lens_info.center_v,
+			dev->lens_info.pixel_pitch);
 		printf("planer_prm: ");
 		for (int i = 0; i < 4; i++) {
-			printf("%ld ", gPrm.lens_info.planer_prm[i]);
+			printf("%ld ", dev->lens_info.planer_prm[i]);
 		}
 		printf("\n");
 
 		printf("distortion_prm: ");
 		for (int i = 0; i < 4; i++) {
-			printf("%ld ", gPrm.lens_info.distortion_prm[i]);
+			printf("%ld ", dev->lens_info.distortion_prm[i]);
 		}
 		printf("\n");
 	}
 
-	ret = tl_enh_init(gPrm.handle, &tlprm);
+	ret = tl_enh_init(dev->handle, &tlprm);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"tl_enh_init() failed", __LINE__);
 		return -1;
 	}
 
-	gPrm.points_cloud = (int16_t*) malloc(gPrm.resolution.depth.width * gPrm.resolution.depth.height * sizeof(int16_t) * 3);
-	if (gPrm.points_cloud == NULL) {
+	//! \remark - Every Point Cloud Step Runs On The Grid, The Size Of The Larger Of Depth And IR.
+	if (alignInit(&dev->align, dev->resolution.depth.width, dev->resolution.depth.height,
+			dev->resolution.ir.width, dev->resolution.ir.height, gPrm.jbu_sigma) != 0) {
+		printf("Alignment buffer allocate error\n");
+		return -1;
+	}
+	dev->align_fn = apl_align_tbl[image_kind];
+	int grid_w = dev->align.w;
+	int grid_h = dev->align.h;
+
+	dev->points_cloud = (int16_t*) malloc(grid_w * grid_h * sizeof(int16_t) * 3);
+	if (dev->points_cloud == NULL) {
 		printf("Point clound buffer allocate error\n");
 		return -1;
 	}
 
+	//! \remark - Several Devices Keep Their Models Apart As file.0, file.1, ...
+	char bg_path[BGSUB_PATH_LEN];
+	if ((gPrm.bg_path != NULL) && (gPrm.dev_num > 1)) {
+		std::snprintf(bg_path, sizeof(bg_path), "%s.%d", gPrm.bg_path, dev->idx);
+	}
+	else
+	if (gPrm.bg_path != NULL) {
+		std::snprintf(bg_path, sizeof(bg_path), "%s", gPrm.bg_path);
+	}
+	if (bgsubInit(&dev->bgsub, grid_w, grid_h,
+			(uint32_t)dev->mode, (gPrm.bg_path != NULL) ? bg_path : NULL) != 0) {
+		printf("Background model buffer allocate error\n");
+		return -1;
+	}
+
+	if (planeInit(&dev->plane, grid_w, grid_h, gPrm.plane_thresh) != 0) {
+		printf("Plane detection buffer allocate error\n");
+		return -1;
+	}
+
+	if (normalInit(&dev->normal, grid_w, grid_h, gPrm.normal_radius) != 0) {
+		printf("Normal estimation buffer allocate error\n");
+		return -1;
+	}
+
+	if (blobInit(&dev->blob, grid_w, grid_h, gPrm.blob_min) != 0) {
+		printf("Blob extraction buffer allocate error\n");
+		return -1;
+	}
+
+	cam_intr_t cam;
+	char icp_path[256];
+	apl_cam_intr(dev, grid_w, grid_h, &cam);
+	if ((gPrm.icp_path != NULL) && (gPrm.dev_num > 1)) {
+		std::snprintf(icp_path, sizeof(icp_path), "%s.%d", gPrm.icp_path, dev->idx);
+	}
+	else
+	if (gPrm.icp_path != NULL) {
+		std::snprintf(icp_path, sizeof(icp_path), "%s", gPrm.icp_path);
+	}
+	if (icpInit(&dev->icp, grid_w, grid_h, &cam, (gPrm.icp_path != NULL),
+			((gPrm.icp_path != NULL) && (strcmp(gPrm.icp_path, "-") != 0)) ? icp_path : NULL) != 0) {
+		printf("ICP odometry buffer allocate error\n");
+		return -1;
+	}
+
+	if (spidxInit(&dev->spidx, grid_w, grid_h, gPrm.spidx_cell) != 0) {
+		printf("Spatial index buffer allocate error\n");
+		return -1;
+	}
+
+	if (tsdfInit(&dev->tsdf, grid_w, grid_h, &cam, gPrm.tsdf_voxel, gPrm.tsdf_mb) != 0) {
+		printf("TSDF volume allocate error\n");
+		return -1;
+	}
+
+	if (pyrInit(&dev->pyr, grid_w, grid_h, &cam, gPrm.pyr_level + 1) != 0) {
+		printf("Depth pyramid buffer allocate error\n");
+		return -1;
+	}
+
+	//! \remark - The Remap Tables Are Built Once Here, Per Image Size (Kinds Without IR/BG Have None).
+	cam_intr_t cam_ir;
+	cam_intr_t cam_bg;
+	apl_cam_intr(dev, dev->resolution.ir.width, dev->resolution.ir.height, &cam_ir);
+	apl_cam_intr(dev, dev->resolution.bg.width, dev->resolution.bg.height, &cam_bg);
+	if (((dev->resolution.ir.width > 0) &&
+		 (undistInit(&dev->undist_ir, dev->resolution.ir.width, dev->resolution.ir.height, &cam_ir,
+					dev->lens_info.distortion_prm, gPrm.undist_enable) != 0)) ||
+		((dev->resolution.bg.width > 0) &&
+		 (undistInit(&dev->undist_bg, dev->resolution.bg.width, dev->resolution.bg.height, &cam_bg,
+					dev->lens_info.distortion_prm, gPrm.undist_enable) != 0))) {
+		printf("Undistortion table allocate error\n");
+		return -1;
+	}
+
 	return ret;
 }
 
 
 //******************************************************************************
 //! \brief        Termination of libccdtof Library
-//! \details
+//! \details       tl_enh_term() Has No Handle Argument, So It Is Called Once After All Devices Are Closed.
 //! \param[in]    None
 //! \param[out]   None
 //! \return       0         success
@@ -283,11 +534,36 @@ static int apl_init(TL_E_MODE mode, TL_E_IMAGE_KIND image_kind)
 static int apl_term(void)
 {
 	TL_E_RESULT ret;
+	int result = 0;
 
-	ret = TL_term(&gPrm.handle);
-	if (ret != TL_E_SUCCESS) {
-		apl_print_error(ret, (char *)"TL_term", __LINE__);
-		return -1;
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		apl_dev *dev = &gPrm.dev[i];
+
+		if (dev->handle != NULL) {
+			ret = TL_term(&dev->handle);
+			if (ret != TL_E_SUCCESS) {
+				apl_print_error(ret, (char *)"TL_term", __LINE__);
+				result = -1;
+			}
+		}
+
+		if (dev->points_cloud != NULL) {
+			free(dev->points_cloud);
+			dev->points_cloud = NULL;
+		}
+
+		(void) bgsubSave(&dev->bgsub);
+		bgsubTerm(&dev->bgsub);
+		planeTerm(&dev->plane);
+		normalTerm(&dev->normal);
+		blobTerm(&dev->blob);
+		icpTerm(&dev->icp);
+		spidxTerm(&dev->spidx);
+		tsdfTerm(&dev->tsdf);
+		pyrTerm(&dev->pyr);
+		undistTerm(&dev->undist_ir);
+		undistTerm(&dev->undist_bg);
+		alignTerm(&dev->align);
 	}
 
 	ret = tl_enh_term();
@@ -296,27 +572,64 @@ static int apl_term(void)
 		return -1;
 	}
 
-	return 0;
+	return result;
+}
+
+
+//******************************************************************************
+//! \brief        Start Recording The Images Of The Displayed Device
+//! \details      "clip.mp4" Is Recorded As clip_depth.mp4 And clip_ir.mp4.
+//! \param[in]    None
+//! \param[out]   None
+//! \return       0         success
+//! \return       -1        failed
+//******************************************************************************
+static int apl_rec_init(void)
+{
+	apl_dev *dev = &gPrm.dev[gPrm.disp_idx];
+	double fps = dev->mode_info_grp.mode[dev->mode].fps;
+	const char *ext;
+	char path[256];
+	int ret = 0;
+
+	if (gPrm.rec_path == NULL) {
+		(void) recInit(&gPrm.rec_depth, NULL, fps, "rec depth");
+		(void) recInit(&gPrm.rec_ir, NULL, fps, "rec ir");
+		return 0;
+	}
+
+	ext = strrchr(gPrm.rec_path, '.');
+	if ((ext == NULL) || (strchr(ext, '/') != NULL)) {
+		ext = gPrm.rec_path + strlen(gPrm.rec_path);
+	}
+
+	std::snprintf(path, sizeof(path), "%.*s_depth%s", (int)(ext - gPrm.rec_path), gPrm.rec_path, (*ext != '\0') ? ext : ".mp4");
+	ret |= recInit(&gPrm.rec_depth, path, fps, "rec depth");
+	std::snprintf(path, sizeof(path), "%.*s_ir%s", (int)(ext - gPrm.rec_path), gPrm.rec_path, (*ext != '\0') ? ext : ".mp4");
+	ret |= recInit(&gPrm.rec_ir, path, fps, "rec ir");
+
+	return (ret != 0) ? -1 : 0;
 }
 
 
 //******************************************************************************
 //! \brief        Start Transferring
 //! \details
-//! \param[in]    None
+//! \param[in]    dev       device context
 //! \param[out]   None
 //! \return       0         success
 //! \return       -1        failed
 //******************************************************************************
-static int apl_start(void)
+static int apl_start(apl_dev *dev)
 {
 	TL_E_RESULT ret;
 
-	ret = TL_start(gPrm.handle);
+	ret = TL_start(dev->handle);
 	if (ret != TL_E_SUCCESS) {
 		apl_print_error(ret, (char *)"TL_start", __LINE__);
 		return -1;
 	}
+	dev->started = true;
 
 	return 0;
 }
@@ -325,23 +638,28 @@ static int apl_start(void)
 //******************************************************************************
 //! \brief        Capturing Of Images
 //! \details
-//! \param[in]    None
+//! \param[in]    dev       device context
 //! \param[out]   None
 //! \return       0         success
 //! \return       -1        failed
 //******************************************************************************
-static int apl_capture(void)
+static int apl_capture(apl_dev *dev)
 {
 	TL_E_RESULT ret;
 	uint32_t notify = 0U;
 	TL_Image data;
+	uint64_t cap_ns;
 
 	memset(&data, 0, sizeof(data));
 
-	ret = TL_capture(gPrm.handle, &notify, &(data));
+	TRACE_BEGIN(TRACE_CAPTURE);
+	ret = TL_capture(dev->handle, &notify, &(data));
+	//! \remark - TL_Image Carries No Time Stamp, The Closest One Is The Return Of TL_capture().
+	cap_ns = getMonoNs();
+	TRACE_END(TRACE_CAPTURE);
 
 	if (ret == TL_E_SUCCESS) {
-		apl_callback(gPrm.handle, notify, data);
+		apl_callback(dev, notify, data, cap_ns);
 	}
 	else {
 		apl_print_error(ret, (char *)"TL_capture", __LINE__);
@@ -353,7 +671,8 @@ static int apl_capture(void)
 
 //******************************************************************************
 //! \brief        Cancelation Of Capture
-//! \details
+//! \details      Called From The Signal Handler, So Results Are Only Stored And
+//! \n            Reported Later By apl_print_cancel().
 //! \param[in]    None
 //! \param[out]   None
 //! \return       0         success
@@ -362,16 +681,46 @@ static int apl_capture(void)
 static int apl_cancel(void)
 {
 	TL_E_RESULT ret;
+	int result = 0;
 
-	ret = TL_cancel(gPrm.handle);
-	if (ret == TL_E_SUCCESS) {
-		printf("TL_cancel success\n");
-	}
-	else {
-		printf("TL_cancel fail\n");
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		if (gPrm.dev[i].handle == NULL) {
+			continue;
+		}
+
+		ret = TL_cancel(gPrm.dev[i].handle);
+		gPrm.dev[i].cancel_ret = (int)ret;
+		gPrm.dev[i].canceled = true;
+		if (ret != TL_E_SUCCESS) {
+			result = ret;
+		}
 	}
 
-	return ret;
+	return result;
+}
+
+
+//******************************************************************************
+//! \brief        Report The Results Of apl_cancel()
+//! \details
+//! \param[in]    None
+//! \param[out]   None
+//! \return       None
+//******************************************************************************
+static void apl_print_cancel(void)
+{
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		if (!gPrm.dev[i].canceled) {
+			continue;
+		}
+
+		if (gPrm.dev[i].cancel_ret == TL_E_SUCCESS) {
+			TL_LGI("TL_cancel success (device %d)", i);
+		}
+		else {
+			TL_LGE("TL_cancel fail (device %d)", i);
+		}
+	}
 }
 
 
@@ -386,20 +735,30 @@ static int apl_cancel(void)
 static int apl_stop(void)
 {
 	TL_E_RESULT ret;
+	int result = 0;
 
-	ret = TL_stop(gPrm.handle);
-	if (ret != TL_E_SUCCESS) {
-		apl_print_error(ret, (char *)"TL_stop", __LINE__);
-		return -1;
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		apl_dev *dev = &gPrm.dev[i];
+
+		if (!dev->started) {
+			continue;
+		}
+
+		ret = TL_stop(dev->handle);
+		if (ret != TL_E_SUCCESS) {
+			apl_print_error(ret, (char *)"TL_stop", __LINE__);
+			result = -1;
+		}
+		dev->started = false;
 	}
 
-	return 0;
+	return result;
 }
 
 
 //******************************************************************************
 //! \brief        Print Error From libccdtof.so Library
-//! \details
+//! \details      Goes Through The Asynchronous Log, Repeated Errors Are Rate Limited.
 //! \param[in]    ret           return value from tof library
 //! \param[in]    function	    function of error happend
 //! \param[in]    line          line of error happend
@@ -412,31 +771,31 @@ void apl_print_error(TL_E_RESULT ret, char *function, unsigned int line)
 		case TL_E_SUCCESS:
 			break;
 		case TL_E_ERR_PARAM:
-			printf("[%s L.%d] TL_E_ERR_PARAM\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_PARAM", function, (int)line);
 			break;
 		case TL_E_ERR_SYSTEM:
-			printf("[%s L.%d] TL_E_ERR_SYSTEM\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_SYSTEM", function, (int)line);
 			break;
 		case TL_E_ERR_STATE:
-			printf("[%s L.%d] TL_E_ERR_STATE\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_STATE", function, (int)line);
 			break;
 		case TL_E_ERR_TIMEOUT:
-			printf("[%s L.%d] TL_E_ERR_TIMEOUT\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_TIMEOUT", function, (int)line);
 			break;
 		case TL_E_ERR_EMPTY:
-			printf("[%s L.%d] TL_E_ERR_EMPTY\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_EMPTY", function, (int)line);
 			break;
 		case TL_E_ERR_NOT_SUPPORT:
-			printf("[%s L.%d] TL_E_ERR_NOT_SUPPORT\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_NOT_SUPPORT", function, (int)line);
 			break;
 		case TL_E_ERR_CANCELED:
-			printf("[%s L.%d] TL_E_ERR_CANCELED\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_CANCELED", function, (int)line);
 			break;
 		case TL_E_ERR_OTHER:
-			printf("[%s L.%d] TL_E_ERR_OTHER\n", function, (int)line);
+			TL_LGE("[%s L.%d] TL_E_ERR_OTHER", function, (int)line);
 			break;
 		default:
-			printf("[%s L.%d] unknow error(%d)\n", function, (int)line, (int)ret);
+			TL_LGE("[%s L.%d] unknow error(%d)", function, (int)line, (int)ret);
 			break;
 	}
 }
@@ -473,27 +832,27 @@ void apl_calc_data_size(TL_ImageFormat *format, uint16_t bpp, size_t *size)
 //******************************************************************************
 //! \brief        Calculate Images Size
 //! \details
-//! \param[in]    None
+//! \param[in]    dev       device context
 //! \param[out]   None
 //! \return       None
 //******************************************************************************
-void apl_images_size(void)
+void apl_images_size(apl_dev *dev)
 {
-	switch (gPrm.image_kind) {
+	switch (dev->image_kind) {
 		case TL_E_IMAGE_KIND_VGA_DEPTH_QVGA_IR_BG:
 		case TL_E_IMAGE_KIND_QVGA_DEPTH_IR_BG:
-			apl_calc_img_size(&gPrm.resolution.depth, &gPrm.img_size.depth);
-			apl_calc_img_size(&gPrm.resolution.ir,    &gPrm.img_size.ir);
-			apl_calc_img_size(&gPrm.resolution.bg,    &gPrm.img_size.bg);
+			apl_calc_img_size(&dev->resolution.depth, &dev->img_size.depth);
+			apl_calc_img_size(&dev->resolution.ir,    &dev->img_size.ir);
+			apl_calc_img_size(&dev->resolution.bg,    &dev->img_size.bg);
 			break;
 		case TL_E_IMAGE_KIND_VGA_DEPTH_IR:
 		case TL_E_IMAGE_KIND_VGA_IR_QVGA_DEPTH:
-			apl_calc_img_size(&gPrm.resolution.depth, &gPrm.img_size.depth);
-			apl_calc_img_size(&gPrm.resolution.ir,    &gPrm.img_size.ir);
+			apl_calc_img_size(&dev->resolution.depth, &dev->img_size.depth);
+			apl_calc_img_size(&dev->resolution.ir,    &dev->img_size.ir);
 			break;
 		case TL_E_IMAGE_KIND_VGA_IR_BG:
-			apl_calc_img_size(&gPrm.resolution.ir, &gPrm.img_size.ir);
-			apl_calc_img_size(&gPrm.resolution.bg, &gPrm.img_size.bg);
+			apl_calc_img_size(&dev->resolution.ir, &dev->img_size.ir);
+			apl_calc_img_size(&dev->resolution.bg, &dev->img_size.bg);
 			break;
 		default:
 			break;
@@ -504,39 +863,63 @@ void apl_images_size(void)
 //******************************************************************************
 //! \brief        Handle Image Once Obtain From libccdtof.so
 //! \details
-//! \param[in]    handle    camera handle
+//! \param[in]    dev       device context
 //! \param[in]    notify    contents of the notification
 //! \param[in]    data      Transfer data
+//! \param[in]    cap_ns    CLOCK_MONOTONIC time the data was received
 //! \param[out]   None
 //! \return       0         success
 //! \return       -1        failed
 //******************************************************************************
-void apl_callback(TL_Handle *handle, uint32_t notify, TL_Image data)
+void apl_callback(apl_dev *dev, uint32_t notify, TL_Image data, uint64_t cap_ns)
 {
 	// Error Happened
 	if ((notify & (uint32_t)TL_NOTIFY_NO_BUFFER)  != 0U) {
-		printf("recv:TL_NOTIFY_NO_BUFFER\n");
+		TL_LGW("recv:TL_NOTIFY_NO_BUFFER (device %d)", dev->idx);
+		dev->drop_cnt++;
 	}
 
 	if ((notify & (uint32_t)TL_NOTIFY_DISCONNECT) != 0U) {
-		printf("recv:TL_NOTIFY_DISCONNECT\n");
+		TL_LGE("recv:TL_NOTIFY_DISCONNECT (device %d)", dev->idx);
 	}
 
 	if ((notify & (uint32_t)TL_NOTIFY_DEVICE_ERR) != 0U) {
-		printf("recv:TL_NOTIFY_DEVICE_ERR\n");
+		TL_LGE("recv:TL_NOTIFY_DEVICE_ERR (device %d)", dev->idx);
 	}
 
 	if ((notify & (uint32_t)TL_NOTIFY_SYSTEM_ERR) != 0U) {
-		printf("recv:TL_NOTIFY_SYSTEM_ERR\n");
+		TL_LGE("recv:TL_NOTIFY_SYSTEM_ERR (device %d)", dev->idx);
 	}
 
 	if ((notify & (uint32_t)TL_NOTIFY_STOPPED)    != 0U) {
-		printf("recv:TL_NOTIFY_STOPPED\n");
+		TL_LGI("recv:TL_NOTIFY_STOPPED (device %d)", dev->idx);
 	}
 
 	// recieved image data
 	if ((notify & (uint32_t)TL_NOTIFY_IMAGE) != 0U) {
-		apl_show_img(gPrm.mode, gPrm.image_kind, gPrm.resolution, &data);
+		uint64_t t0 = getMonoNs();
+		frame_meta_t meta;
+
+		//! \remark - The Capture Record Travels With The Image To Every Consumer.
+		meta.seq = dev->seq++;
+		meta.cap_ns = cap_ns;
+		meta.mode_idx = data.mode_idx;
+		meta.temp = data.temp;
+		meta.drop_gap = dev->drop_cnt;
+
+		jitterTick(&dev->jitter, cap_ns);
+		apl_show_img(dev, &data, &meta);
+		dev->frame_cnt++;
+		latencyAdd(&dev->latency, &meta, getMonoNs());
+
+		//! \remark - Feed The Quality Controller, Its Level Takes Effect From The Next Image.
+		//! \remark - The Encoder Queues Back Up When It Falls Behind, The Dashboard Keeps Only The Latest Image.
+		int q_depth = recQueued(&gPrm.rec_depth);
+		int q_ir = recQueued(&gPrm.rec_ir);
+		if (qosUpdate(&dev->qos, (double)(getMonoNs() - t0) * 1e-6, dev->drop_cnt, (q_depth > q_ir) ? q_depth : q_ir)) {
+			setPtCloudRefresh(qosSetting(&dev->qos)->refresh_ms);
+		}
+		dev->drop_cnt = 0;
 	}
 }
 
@@ -553,10 +936,25 @@ void apl_signal_handler(int signal)
 	(void)signal;
 	bExit = true;
 
+	//! \remark - No Output Here, It Could Block Or Deadlock Inside stdio; main Reports The Result.
 	apl_cancel();
 }
 
 
+//******************************************************************************
+//! \brief        Signal Handler Function To Request A Trace Dump
+//! \details
+//! \param[in]    signal    signal number
+//! \param[out]   None
+//! \return       None
+//******************************************************************************
+void apl_signal_trace_handler(int signal)
+{
+	(void)signal;
+	bTraceDump = true;
+}
+
+
 //******************************************************************************
 //! \brief        Get Ranging Mode From User
 //! \details
@@ -654,18 +1052,96 @@ cv::Mat apl_dpth_to_color_by_opencv(cv::Mat img, uint32_t min_val, uint32_t max_
 }
 
 
+//******************************************************************************
+//! \brief        Convert Depth To 3D And Run The Point Cloud Analysis Steps
+//! \details
+//! \param[in]    dev           Device context.
+//! \param[in]    stData        Image data.
+//! \param[in]    meta          Capture record of the image.
+//! \param[out]   None.
+//! \return       Depth image that was converted (the foreground once the background is learned).
+//******************************************************************************
+static const uint16_t *apl_process_cloud(apl_dev *dev, TL_Image *stData, const frame_meta_t *meta)
+{
+	//! \remark - Depth And IR On One Grid, The Smaller Plane Of A Mixed Kind Is Upsampled.
+	TRACE_BEGIN(TRACE_ALIGN);
+	(void) dev->align_fn(&dev->align, stData);
+	TRACE_END(TRACE_ALIGN);
+	const uint16_t *depth = dev->align.depth;
+
+	//! \remark - Drop The Learned Static Scene, Background Pixels Get No Depth.
+	TRACE_BEGIN(TRACE_BGSUB);
+	(void) bgsubUpdate(&dev->bgsub, depth);
+	TRACE_END(TRACE_BGSUB);
+	if (bgsubReady(&dev->bgsub)) {
+		depth = dev->bgsub.fg_depth;
+	}
+
+	//! \remark - Coarser Copies Of The Depth For The Steps That Do Not Need Full Resolution.
+	TRACE_BEGIN(TRACE_PYRAMID);
+	(void) pyrBuild(&dev->pyr, depth);
+	TRACE_END(TRACE_PYRAMID);
+
+	//! \remark - Convert Depth To 3D, The ToF Library Only Knows The Depth Image Size.
+	if (dev->align.w == dev->resolution.depth.width) {
+		tl_enh_convert_camera_coord(dev->handle, (uint16_t *)depth, &dev->points_cloud);
+	}
+	else {
+		alignConvert(depth, dev->align.w, dev->align.h, &dev->pyr.cam[0], dev->points_cloud);
+	}
+
+	//! \remark - Find The Floor/Wall Plane, Its Points Can Be Hidden In The 3D View.
+	TRACE_BEGIN(TRACE_PLANE);
+	(void) planeDetect(&dev->plane, dev->points_cloud);
+	TRACE_END(TRACE_PLANE);
+
+	//! \remark - Surface Normals, For Shading And The Grazing Angle Filter.
+	TRACE_BEGIN(TRACE_NORMAL);
+	(void) normalCompute(&dev->normal, dev->points_cloud);
+	TRACE_END(TRACE_NORMAL);
+
+	//! \remark - Objects: Connected Regions Of Continuous Depth, Off The Plane.
+	TRACE_BEGIN(TRACE_BLOB);
+	(void) blobExtract(&dev->blob, depth, dev->plane.found ? dev->plane.mask : NULL, dev->points_cloud);
+	TRACE_END(TRACE_BLOB);
+
+	//! \remark - Motion Of The Camera Since The Previous Frame.
+	TRACE_BEGIN(TRACE_ICP);
+	(void) icpTrack(&dev->icp, dev->points_cloud, meta);
+	TRACE_END(TRACE_ICP);
+
+	//! \remark - Spatial Index Of The Points, Isolated Points Are Counted As Outliers.
+	TRACE_BEGIN(TRACE_INDEX);
+	if (spidxBuild(&dev->spidx, dev->points_cloud) == 0) {
+		(void) spidxOutliers(&dev->spidx, dev->points_cloud);
+	}
+	TRACE_END(TRACE_INDEX);
+
+	//! \remark - Fuse The Whole Depth Image Into The Volume, At The ICP Pose When Tracking.
+	TRACE_BEGIN(TRACE_FUSE);
+	(void) tsdfIntegrate(&dev->tsdf, dev->align.depth, dev->icp.enable ? dev->icp.pose : NULL);
+	TRACE_END(TRACE_FUSE);
+
+	return depth;
+}
+
+
 //******************************************************************************
 //! \brief        Display Image In Opencv Windows
+//! \details       Every Device Runs The Point Cloud Conversion, Only The Displayed Device Draws Windows.
 //! \n
-//! \param[in]    img_kind      Image data.
-//! \param[in]    reso          Depth Image Format.
+//! \param[in]    dev           Device context.
 //! \param[in]    stData        Image data.
-//! \param[in]    temperature   Temperature.
+//! \param[in]    meta          Capture record of the image.
 //! \param[out]   None.
 //! \return       None
 //******************************************************************************
-void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso, TL_Image *stData)
+void apl_show_img(apl_dev *dev, TL_Image *stData, const frame_meta_t *meta)
 {
+	TL_E_IMAGE_KIND img_kind = dev->image_kind;
+	TL_Resolution reso = dev->resolution;
+	bool disp = (dev->idx == gPrm.disp_idx);
+	const qos_setting_t *qos = qosSetting(&dev->qos);
 	bool show_depth = false;
 	bool show_ir = false;
 	bool show_bg = false;
@@ -675,8 +1151,8 @@ void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso,
 	uint8_t *p_data;
 	uint16_t range_min;
 	uint16_t range_max;
-	static int32_t gamma_corr_ir = 22;  //!< Default Gamma Value Is 2.2 (For OpenCV TrackBar Used).
-	static int32_t gamma_corr_bg = 22;  //!< Default Gamma Value Is 2.2 (For OpenCV TrackBar Used).
+	int32_t gamma_corr_ir = gPrm.dash.gamma[DASH_IR];  //!< Gamma x 10, From The Window's Trackbar.
+	int32_t gamma_corr_bg = gPrm.dash.gamma[DASH_BG];
 	int32_t temperature;
 	char str[256];
 
@@ -705,52 +1181,127 @@ void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso,
 			break;
 	}
 
+	//! \remark - The Quality Controller May Drop The IR/BG Windows Under Load (IR Stays If It Is The Only Image).
+	if (!qos->show_ir_bg) {
+		show_ir = show_ir && !show_depth;
+		show_bg = false;
+	}
+
+	if (!disp) {
+		//! \remark - Devices Not On Screen Only Run The Processing Pipeline.
+		if (show_depth && show_ptcd) {
+			TRACE_BEGIN(TRACE_PROCESS);
+			apl_process_cloud(dev, stData, meta);
+			TRACE_END(TRACE_PROCESS);
+		}
+		return;
+	}
+
 	if (show_depth) {
 		// --------------------------------------------------
 		//! \remark - Process Depth Image
 		//! \remark - Obtain Height, Width, Pointer To Data From Toflib-Output Message.
+		TRACE_BEGIN(TRACE_PROCESS);
 		h = reso.depth.height;
 		w = reso.depth.width;
 		p_data = (uint8_t *)stData->depth;
 
+		const uint16_t *depth = (const uint16_t *)p_data;
+		if (show_ptcd) {
+			//! \remark - Convert Depth To 3D And Analyse It.
+			depth = apl_process_cloud(dev, stData, meta);
+		}
+
+		//! \remark - Let The Color Range Follow The Depth Distribution, The Table Is Only Rebuilt When It Moves.
+		int32_t lvl = gPrm.pyr_level;
+		const uint16_t *hist_depth = (show_ptcd && (lvl > 0)) ? dev->pyr.depth[lvl] : depth;
+		int32_t hist_n = (show_ptcd && (lvl > 0)) ? (dev->pyr.w[lvl] * dev->pyr.h[lvl]) :
+						 show_ptcd ? (dev->align.w * dev->align.h) : (int32_t)(w * h);
+		if (histUpdate(&gPrm.hist, hist_depth, hist_n)) {
+			apl_init_color_tbl(gPrm.hist.lo, gPrm.hist.hi, 1000);
+		}
+
 		if (show_ptcd) {
-			//! \remark - Convert Depth To 3D.
-			tl_enh_convert_camera_coord(gPrm.handle, (uint16_t *)(stData->depth), &gPrm.points_cloud);
 
 			//! \remark - Update Point Cloud Data.
-			int32_t ptCdCnt = gPrm.resolution.depth.width * gPrm.resolution.depth.height;
-			uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-			update3dData(ns, gPrm.points_cloud, ptCdCnt);
+			ptcd_frame_t frame;
+			frame.meta = *meta;
+			frame.xyz = dev->points_cloud;
+			frame.w = dev->align.w;
+			frame.h = dev->align.h;
+			frame.step = qos->decimation;
+			frame.hide = dev->plane.found ? dev->plane.mask : NULL;
+			frame.facing = dev->normal.enable ? dev->normal.facing : NULL;
+			frame.gray = dev->align.gray;
+			ptcd_box_t box[MAX_PLY_BOX];
+			frame.box = box;
+			frame.box_cnt = 0;
+			if ((lvl > 0) && !dev->tsdf.enable) {
+				//! \remark - Points Of The Pyramid Level, The Stride Shrinks With It; Per Point Masks Are Full Size.
+				TRACE_BEGIN(TRACE_PYRAMID);
+				frame.xyz = pyrConvert(&dev->pyr, lvl);
+				TRACE_END(TRACE_PYRAMID);
+				frame.w = dev->pyr.w[lvl];
+				frame.h = dev->pyr.h[lvl];
+				frame.step = ((qos->decimation >> lvl) > 1) ? (qos->decimation >> lvl) : 1;
+				frame.hide = NULL;
+				frame.facing = NULL;
+				frame.gray = NULL;
+			}
+			if (dev->tsdf.enable) {
+				//! \remark - Show The Fused Surface Instead, From The Last Raycast Finished In The Background (A Recent
+				//! \remark - Frame's Pose); Per Point Masks Do Not Apply, The IR Of This Frame Still Colors What It Sees.
+				TRACE_BEGIN(TRACE_FUSE);
+				(void) tsdfRaycast(&dev->tsdf, dev->align.depth, qos->decimation);
+				TRACE_END(TRACE_FUSE);
+				frame.xyz = dev->tsdf.ray;
+				frame.hide = NULL;
+				frame.facing = NULL;
+			}
+			for (int32_t k = 0; dev->blob.enable && (k < dev->blob.blob_cnt) && (k < MAX_PLY_BOX); k++) {
+				memcpy(box[k].min, dev->blob.blob[k].min, sizeof(box[k].min));
+				memcpy(box[k].max, dev->blob.blob[k].max, sizeof(box[k].max));
+				frame.box_cnt++;
+			}
+			update3dData(&frame);
 		}
 
 		//! \remark - Create Cv Matrix, 16 Bits.
 		cv::Mat mat_depth_raw(h, w, CV_16UC1, p_data);
 
-		//! \remark - Decide The Range For Depth Base On Range Mode.
-		range_min = gPrm.mode_info_grp.mode[gPrm.mode].range_near;
-		range_max = gPrm.mode_info_grp.mode[gPrm.mode].range_far;
+		//! \remark - Decide The Range For Depth Base On Range Mode, Or On The Histogram.
+		range_min = dev->mode_info_grp.mode[dev->mode].range_near;
+		range_max = dev->mode_info_grp.mode[dev->mode].range_far;
+		if (gPrm.hist.valid) {
+			range_min = (uint16_t)gPrm.hist.lo;
+			range_max = (uint16_t)((gPrm.hist.hi > 65535) ? 65535 : gPrm.hist.hi);
+		}
 
 		//! \remark - Depth To Color Conversion, Using OpenCV API.
 		cv::Mat mat_depth_color_by_opencv;
 		mat_depth_color_by_opencv = apl_dpth_to_color_by_opencv(mat_depth_raw, range_min, range_max);
 
 		//! \remark - Add Temperature Text.
-		temperature = stData->temp;
+		temperature = meta->temp;
 		std::snprintf(str, sizeof(str), "temperature=%d.%d C", temperature/100, temperature%100);
 		cv::putText(mat_depth_color_by_opencv, std::string(str), cv::Point(10, 20), cv::FONT_HERSHEY_COMPLEX_SMALL, 0.6, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+		TRACE_END(TRACE_PROCESS);
 
-		//! \remark - Display It.
-		cv::imshow(OPENCV_WINDOW_NAME_DPTH, mat_depth_color_by_opencv);
-		cv::waitKey(1);	// Draw The Screen And Wait For 1 Millisecond.
+		//! \remark - Hand A Copy To The Encoder Thread, Dropped If It Lags.
+		recPush(&gPrm.rec_depth, mat_depth_color_by_opencv, meta);
+
+		//! \remark - Display It, The Window Is Repainted By Its Own Thread.
+		dashPost(&gPrm.dash, DASH_DEPTH, mat_depth_color_by_opencv, meta);
 	}
 
 	if (show_ir) {
 		// --------------------------------------------------
 		//! \remark - Proecess IR Image
 		//! \remark - Obtain Height, Width, Pointer To Data From Toflib-Output Message.
+		TRACE_BEGIN(TRACE_PROCESS);
 		h = reso.ir.height;
 		w = reso.ir.width;
-		p_data = (uint8_t *)stData->ir;
+		p_data = (uint8_t *)undistApply(&dev->undist_ir, (const uint16_t *)stData->ir);
 
 		//! \remark - Create Cv Matrix, 16 Bits.
 		cv::Mat mat_ir(h, w, CV_16UC1, p_data);
@@ -767,23 +1318,26 @@ void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso,
 		mat_ir_pow.convertTo(mat_ir, CV_16UC1);
 
 		//! \remark - Add Temperature Text.
-		temperature = stData->temp;
+		temperature = meta->temp;
 		std::snprintf(str, sizeof(str), "temperature=%d.%d C", temperature/100, temperature%100);
 		cv::putText(mat_ir, std::string(str), cv::Point(10, 20), cv::FONT_HERSHEY_COMPLEX_SMALL, 0.6, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
 
+		TRACE_END(TRACE_PROCESS);
+
+		recPush(&gPrm.rec_ir, mat_ir, meta);
+
 		//! \remark - Display It.
-		cv::createTrackbar(OPENCV_TRACKBAR_NAME_GAMMA_CORR_IR, OPENCV_WINDOW_NAME_IR, &gamma_corr_ir, 30);
-		cv::imshow(OPENCV_WINDOW_NAME_IR, mat_ir);
-		cv::waitKey(1);	// Draw The Screen And Wait For 1 Millisecond.
+		dashPost(&gPrm.dash, DASH_IR, mat_ir, meta);
 	}
 
 	if (show_bg) {
 		// --------------------------------------------------
 		//! \remark - Proecess BG Image
 		//! \remark - Obtain Height, Width, Pointer To Data From Toflib-Output Message.
+		TRACE_BEGIN(TRACE_PROCESS);
 		h = reso.bg.height;
 		w = reso.bg.width;
-		p_data = (uint8_t *)stData->bg;
+		p_data = (uint8_t *)undistApply(&dev->undist_bg, (const uint16_t *)stData->bg);
 
 		//! \remark - Create Cv Matrix, 16 Bits.
 		cv::Mat mat_bg(h, w, CV_16UC1, p_data);
@@ -799,10 +1353,10 @@ void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso,
 		//! \remark - Convert Back To 16Bits.
 		mat_bg_pow.convertTo(mat_bg, CV_16UC1);
 
+		TRACE_END(TRACE_PROCESS);
+
 		//! \remark - Display It.
-		cv::createTrackbar(OPENCV_TRACKBAR_NAME_GAMMA_CORR_BG, OPENCV_WINDOW_NAME_BG, &gamma_corr_bg, 30);
-		cv::imshow(OPENCV_WINDOW_NAME_BG, mat_bg);
-		cv::waitKey(1);	// Draw The Screen And Wait For 1 Millisecond.
+		dashPost(&gPrm.dash, DASH_BG, mat_bg, meta);
 	}
 }
 
@@ -810,17 +1364,29 @@ void apl_show_img(TL_E_MODE mode, TL_E_IMAGE_KIND img_kind, TL_Resolution reso,
 //******************************************************************************
 //! \brief        Thread to handle image capture and view
 //! \n
-//! \param[in]    data         Data.
+//! \param[in]    data         Device context.
 //! \return       void pointer
 //******************************************************************************
 void *view_thread(void *data)
 {
+	apl_dev *dev = (apl_dev *)data;
+	char name[32];
+
+	if (g_trace_enable) {
+		std::snprintf(name, sizeof(name), "capture dev%d", dev->idx);
+		traceSetThreadName(name);
+	}
+
 	while (!bExit) {
-		apl_capture();
+		apl_capture(dev);
 	}
 
 	//apl_cancel();
-	mainPtCloudViewExit();
+	if (dev->idx == gPrm.disp_idx) {
+		mainPtCloudViewExit();
+	}
+
+	return NULL;
 }
 
 
@@ -832,9 +1398,176 @@ void *view_thread(void *data)
 //******************************************************************************
 void *view_3d_thread(void *data)
 {
+	if (g_trace_enable) {
+		traceSetThreadName("3d view");
+	}
+
+	//! \remark - Off-Screen, The Program Ends Once The Frame Sequence Is Written.
+	if (gPrm.offscreen) {
+		if (mainPtCloudViewOffscreen(30, 9000, 640, 480, gPrm.snap_frames) != 0) {
+			printf("off-screen rendering failed\n");
+		}
+		bExit = true;
+		apl_cancel();
+		return NULL;
+	}
+
 	while (!bExit) {
 		mainPtCloudView(30, 9000, OPENGL_WINDOW_NAME_PTCD);
 	}
+
+	return NULL;
+}
+
+
+//******************************************************************************
+//! \brief        Print Frame Rate Of Each Device And The Aggregate Frame Rate
+//! \n
+//! \param[in]    sec          Seconds since the last report.
+//! \return       None
+//******************************************************************************
+static void apl_print_fps(double sec)
+{
+	static uint32_t last_cnt[APL_MAX_DEV];
+	double total = 0;
+
+	printf("fps:");
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		uint32_t cnt = gPrm.dev[i].frame_cnt;
+		double fps = (double)(cnt - last_cnt[i]) / sec;
+
+		last_cnt[i] = cnt;
+		total += fps;
+		printf(" dev%d=%.1f", i, fps);
+	}
+	printf(" total=%.1f (%d device%s)\n", total, gPrm.dev_num, (gPrm.dev_num > 1) ? "s" : "");
+}
+
+
+//******************************************************************************
+//! \brief        Print Frame Interval Jitter And Latency Of Each Device And Of The 3D View
+//! \n
+//! \param[in]    None
+//! \return       None
+//******************************************************************************
+static void apl_print_jitter(void)
+{
+	char name[32];
+
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		std::snprintf(name, sizeof(name), "capture dev%d", i);
+		jitterReport(&gPrm.dev[i].jitter, name);
+		std::snprintf(name, sizeof(name), "process dev%d", i);
+		latencyReport(&gPrm.dev[i].latency, name);
+	}
+	jitterReport(getPtCloudJitter(), "3d view");
+	latencyReport(getPtCloudLatency(), "3d view");
+	reportPtCloudCull();
+}
+
+
+//******************************************************************************
+//! \brief        Print Quality Level And Color Range Of The Displayed Device
+//! \n
+//! \param[in]    None
+//! \return       None
+//******************************************************************************
+static void apl_print_qos(void)
+{
+	char name[32];
+
+	std::snprintf(name, sizeof(name), "dev%d", gPrm.disp_idx);
+	qosReport(&gPrm.dev[gPrm.disp_idx].qos, name);
+	histReport(&gPrm.hist, name);
+	dashReport(&gPrm.dash);
+	recReport(&gPrm.rec_depth);
+	recReport(&gPrm.rec_ir);
+}
+
+
+//******************************************************************************
+//! \brief        Print The Point Cloud Analysis Results And Timing Of Each Device
+//! \n
+//! \param[in]    None
+//! \return       None
+//******************************************************************************
+static void apl_print_analysis(void)
+{
+	char name[32];
+
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		std::snprintf(name, sizeof(name), "dev%d", i);
+		bgsubReport(&gPrm.dev[i].bgsub, name);
+		planeReport(&gPrm.dev[i].plane, name);
+		normalReport(&gPrm.dev[i].normal, name);
+		blobReport(&gPrm.dev[i].blob, name);
+		icpReport(&gPrm.dev[i].icp, name);
+		spidxReport(&gPrm.dev[i].spidx, name);
+		tsdfReport(&gPrm.dev[i].tsdf, name);
+		alignReport(&gPrm.dev[i].align, name);
+		std::snprintf(name, sizeof(name), "dev%d ir", i);
+		undistReport(&gPrm.dev[i].undist_ir, name);
+		std::snprintf(name, sizeof(name), "dev%d bg", i);
+		undistReport(&gPrm.dev[i].undist_bg, name);
+	}
+}
+
+
+//******************************************************************************
+//! \brief        Print Command Line Usage
+//! \n
+//! \param[in]    prog         Program name.
+//! \return       None
+//******************************************************************************
+static void apl_usage(const char *prog)
+{
+	printf("Usage: %s [-n devices] [-d display_device] [-c sched]... [-g sched] [-q 0|1] [-t trace.json] [-v level]\n"
+			"          [-a lo:hi] [-b bg_model] [-p plane_mm] [-r normal_radius] [-o blob_min] [-j threads]\n"
+			"          [-x prefix[:frames]] [-e video] [-i poses] [-s radius_mm] [-f voxel_mm[:MB]] [-l level] [-u 0|1]\n"
+			"          [-k kind] [-y sigma_ir]\n", prog);
+	printf("  -n devices          number of ToF modules to stream at once (1..%d, default 1)\n", APL_MAX_DEV);
+	printf("  -d display_device   index of the device shown in the windows (default 0)\n");
+	printf("  -c sched            scheduling of a capture thread, given once per device in order,\n");
+	printf("                      the last one applies to the remaining devices\n");
+	printf("  -g sched            scheduling of the 3D view thread\n");
+	printf("  sched = policy[:priority[:cpus]], policy = fifo|other, e.g. fifo:80:4-7, other:0:0,1\n");
+	printf("  -q 0|1              adaptive quality: degrade the display under load (default 1)\n");
+	printf("  -t trace.json       record capture/process/render/display stages, written as Chrome\n");
+	printf("                      trace JSON on exit and on SIGUSR1\n");
+	printf("  -v level            log level, 0=error 1=warning 2=info 3=debug (default 2)\n");
+	printf("  -a lo:hi            color range from these depth percentiles of the displayed device\n");
+	printf("                      (default 1:99), 0 = fixed range of the ranging mode\n");
+	printf("  -b bg_model         learn the static background depth and show only foreground points,\n");
+	printf("                      the model is loaded from and saved to this file (file.N per device)\n");
+	printf("  -p plane_mm         detect the dominant plane (floor/wall) every frame with this inlier\n");
+	printf("                      distance in mm and hide it in the 3D view ('k' toggles), 0 = off\n");
+	printf("  -r normal_radius    estimate surface normals over a window of this radius (1..%d pixels)\n", NORMAL_RADIUS_MAX);
+	printf("                      for shaded points ('n') and the grazing angle filter ('b'), 0 = off\n");
+	printf("  -o blob_min         extract connected objects of at least blob_min pixels with their 3D\n");
+	printf("                      boxes and centroids, boxes are drawn in the 3D view ('o'), 0 = off\n");
+	printf("  -j threads          threads per parallel job (default: number of cores, max %d)\n", PARA_MAX_THREAD);
+	printf("  -x prefix[:frames]  3D view snapshots ('x' key) are written as prefix_NNNNNN.png (default ptcd),\n");
+	printf("                      with :frames the 3D view is rendered off-screen without any window and\n");
+	printf("                      each new frame is written, the viewer exits after frames (0 = ctrl+c)\n");
+	printf("  -e video            record the depth and IR images of the displayed device on background\n");
+	printf("                      threads, e.g. clip.mp4 gives clip_depth.mp4 and clip_ir.mp4 (.avi = MJPEG)\n");
+	printf("  -i poses            ICP odometry: track the camera from frame to frame and write the pose\n");
+	printf("                      of every frame to this file (TUM format, poses.N per device), - = no file\n");
+	printf("  -s radius_mm        index the points of every frame in a hashed voxel grid of this cell size\n");
+	printf("                      and count points with fewer than %d neighbours within it, 0 = off\n", SPIDX_MIN_NB);
+	printf("  -f voxel_mm[:MB]    fuse every depth image into a TSDF volume of this voxel size, using at\n");
+	printf("                      most MB per device (default %d), and show its surface in the 3D view\n", TSDF_MEM_MB);
+	printf("  -l level            depth pyramid level (1/2^level resolution, 0..%d) of the 3D view and\n", PYR_LEVELS - 1);
+	printf("                      the color range histogram, 0 = full resolution (default)\n");
+	printf("  -u 0|1              remove the lens distortion from the IR and BG images (default 0,\n");
+	printf("                      the distortion_prm format is not verified yet)\n");
+	printf("  -k kind             image kind (default %d): 0 = VGA depth, QVGA IR/BG  1 = QVGA depth/IR/BG\n",
+			TL_E_IMAGE_KIND_VGA_DEPTH_IR);
+	printf("                      2 = VGA depth/IR  3 = VGA IR, QVGA depth  4 = VGA IR/BG (no depth);\n");
+	printf("                      the smaller plane is upsampled 2x, 'i' colors the 3D view by IR\n");
+	printf("  -y sigma_ir         kind 3: upsample the depth guided by the VGA IR (joint bilateral) with\n");
+	printf("                      this IR range sigma (default %.0f, at most %.0f), 0 = edge aware upsampling\n",
+			JBU_SIGMA_IR, JBU_SIGMA_MAX);
 }
 
 
@@ -848,6 +1581,11 @@ void *view_3d_thread(void *data)
 int main(int argc, char *argv[])
 {
 	int ret = 0;
+	int opt;
+	int sched_num = 0;
+	int log_level = TL_LOG_INFO;
+	float hist_lo = 1;
+	float hist_hi = 99;
 	TL_E_MODE mode;
 	TL_E_IMAGE_KIND image_kind;
 
@@ -855,69 +1593,289 @@ int main(int argc, char *argv[])
 	printf("----------------------------------------\n");
 	printf("Viewer [ver%04x]\n", (int)VIEWER_VERSION);
 
-	memset(&gPrm, 0, sizeof(gPrm));
+	gPrm.dev_num = 1;
+	gPrm.disp_idx = 0;
+	gPrm.qos_enable = true;
+	gPrm.tsdf_mb = TSDF_MEM_MB;
+	gPrm.undist_enable = false;
+	gPrm.image_kind = TL_E_IMAGE_KIND_VGA_DEPTH_IR;
+	gPrm.jbu_sigma = JBU_SIGMA_IR;
+	for (int i = 0; i < APL_MAX_DEV; i++) {
+		gPrm.dev[i].idx = i;
+		jitterInit(&gPrm.dev[i].jitter);
+		latencyInit(&gPrm.dev[i].latency);
+	}
+
+	while ((opt = getopt(argc, argv, "n:d:c:g:q:t:v:a:b:p:r:o:j:x:e:i:s:f:l:u:k:y:h")) != -1) {
+		switch (opt) {
+			case 'n':
+				gPrm.dev_num = atoi(optarg);
+				break;
+			case 'd':
+				gPrm.disp_idx = atoi(optarg);
+				break;
+			case 'c':
+				if ((sched_num >= APL_MAX_DEV) || (schedParse(optarg, &gPrm.dev[sched_num].sched) != 0)) {
+					apl_usage(argv[0]);
+					exit(-1);
+				}
+				sched_num++;
+				break;
+			case 'g':
+				if (schedParse(optarg, &gPrm.sched_gl) != 0) {
+					apl_usage(argv[0]);
+					exit(-1);
+				}
+				break;
+			case 'q':
+				gPrm.qos_enable = (atoi(optarg) != 0);
+				break;
+			case 't':
+				traceInit(optarg);
+				break;
+			case 'v':
+				log_level = atoi(optarg);
+				break;
+			case 'a':
+				hist_lo = 0;
+				hist_hi = 0;
+				if ((sscanf(optarg, "%f:%f", &hist_lo, &hist_hi) != 2) && (atof(optarg) != 0)) {
+					apl_usage(argv[0]);
+					exit(-1);
+				}
+				break;
+			case 'b':
+				gPrm.bg_path = optarg;
+				break;
+			case 'p':
+				gPrm.plane_thresh = (float)atof(optarg);
+				break;
+			case 'r':
+				gPrm.normal_radius = atoi(optarg);
+				break;
+			case 'o':
+				gPrm.blob_min = atoi(optarg);
+				break;
+			case 'j':
+				gPrm.para_threads = atoi(optarg);
+				break;
+			case 'x':
+			{
+				char *sep;
+
+				std::snprintf(gPrm.snap_prefix, sizeof(gPrm.snap_prefix), "%s", optarg);
+				sep = strrchr(gPrm.snap_prefix, ':');
+				if (sep != NULL) {
+					*sep = '\0';
+					gPrm.offscreen = true;
+					gPrm.snap_frames = atoi(sep + 1);
+				}
+				setPtCloudSnapshot(gPrm.snap_prefix);
+				break;
+			}
+			case 'e':
+				gPrm.rec_path = optarg;
+				break;
+			case 'i':
+				gPrm.icp_path = optarg;
+				break;
+			case 's':
+				gPrm.spidx_cell = (float)atof(optarg);
+				break;
+			case 'u':
+				gPrm.undist_enable = (atoi(optarg) != 0);
+				break;
+			case 'l':
+				gPrm.pyr_level = atoi(optarg);
+				break;
+			case 'k':
+				gPrm.image_kind = (TL_E_IMAGE_KIND)atoi(optarg);
+				break;
+			case 'y':
+				gPrm.jbu_sigma = (float)atof(optarg);
+				break;
+			case 'f':
+				if (sscanf(optarg, "%f:%d", &gPrm.tsdf_voxel, &gPrm.tsdf_mb) < 1) {
+					apl_usage(argv[0]);
+					exit(-1);
+				}
+				break;
+			default:
+				apl_usage(argv[0]);
+				exit(-1);
+		}
+	}
+
+	if ((gPrm.dev_num < 1) || (gPrm.dev_num > APL_MAX_DEV) ||
+		(gPrm.disp_idx < 0) || (gPrm.disp_idx >= gPrm.dev_num) ||
+		(log_level < TL_LOG_ERR) || (log_level > TL_LOG_DBG) ||
+		(gPrm.plane_thresh < 0) || (gPrm.para_threads < 0) || (gPrm.blob_min < 0) || (gPrm.snap_frames < 0) ||
+		(gPrm.spidx_cell < 0) || (gPrm.tsdf_voxel < 0) || (gPrm.tsdf_mb <= 0) ||
+		(gPrm.pyr_level < 0) || (gPrm.pyr_level >= PYR_LEVELS) ||
+		(gPrm.image_kind < TL_E_IMAGE_KIND_VGA_DEPTH_QVGA_IR_BG) || (gPrm.image_kind >= TL_E_IMAGE_KIND_MAX) ||
+		(gPrm.jbu_sigma < 0) || !(gPrm.jbu_sigma <= JBU_SIGMA_MAX) ||
+		(gPrm.normal_radius < 0) || (gPrm.normal_radius > NORMAL_RADIUS_MAX)) {
+		apl_usage(argv[0]);
+		exit(-1);
+	}
+
+	//! \remark - Capture Threads Only Enqueue Log Messages, A Background Thread Writes Them.
+	tl_log_init(log_level);
+
+	if (histInit(&gPrm.hist, hist_lo, hist_hi) != 0) {
+		apl_usage(argv[0]);
+		exit(-1);
+	}
+
+	if (gPrm.para_threads == 0) {
+		gPrm.para_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	(void) paraInit(gPrm.para_threads);
+
+	//! \remark - Without -c, Several Capture Threads Are Spread Round-Robin Over The Cores.
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		sched_cfg_t *cfg = &gPrm.dev[i].sched;
+
+		if (sched_num > 0) {
+			if (i >= sched_num) {
+				*cfg = gPrm.dev[sched_num - 1].sched;
+			}
+		}
+		else
+		if ((gPrm.dev_num > 1) && (ncpu > 1)) {
+			cfg->valid = true;
+			cfg->policy = SCHED_OTHER;
+			cfg->priority = 0;
+			cfg->cpus_valid = true;
+			CPU_ZERO(&cfg->cpus);
+			CPU_SET(i % ncpu, &cfg->cpus);
+		}
+	}
 
 	signal(SIGINT, apl_signal_handler);
+	signal(SIGUSR1, apl_signal_trace_handler);
 
 	// Get user input selection
 	if (apl_get_user_selection(&mode) != 0) {
 		printf ("getUserSelection failed\n");
 	}
-	image_kind = TL_E_IMAGE_KIND_VGA_DEPTH_IR;
+	image_kind = gPrm.image_kind;
 
 
-	if ((ret = apl_init(mode, image_kind)) < 0) {
-		printf("apl_init failed\n");
-		exit(-1);
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		if ((ret = apl_init(&gPrm.dev[i], mode, image_kind)) < 0) {
+			printf("apl_init failed (device %d)\n", i);
+			(void) apl_term();
+			exit(-1);
+		}
+
+		apl_images_size(&gPrm.dev[i]);
 	}
 
-	apl_images_size();
+	if (apl_rec_init() != 0) {
+		printf("apl_rec_init failed\n");
+	}
 
-	if (apl_start() < 0) {
-		printf ("apl_start failed\n");
-		(void) apl_term();
-		exit(-1);
+	//! \remark - The 2D Images Are Shown By A UI Thread, Capture Threads Only Post Them.
+	if (dashInit(&gPrm.dash, gPrm.offscreen ? 0 : DASH_REFRESH_MS) != 0) {
+		printf("dashInit failed\n");
 	}
 
-	// Create Threads
-	if (pthread_create(&threadview, NULL, view_thread, NULL) != 0) {
-		printf("pthread_create failed\n");
-		exit(-1);
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		if (apl_start(&gPrm.dev[i]) < 0) {
+			printf ("apl_start failed (device %d)\n", i);
+			(void) apl_stop();
+			(void) apl_term();
+			exit(-1);
+		}
+	}
+
+	// Create Threads, One Capture Thread Per Device
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		apl_dev *dev = &gPrm.dev[i];
+		char name[32];
+
+		if (pthread_create(&dev->threadview, NULL, view_thread, (void *)dev) != 0) {
+			printf("pthread_create failed\n");
+			exit(-1);
+		}
+		dev->thread_created = true;
+
+		std::snprintf(name, sizeof(name), "capture dev%d", i);
+		(void) schedApply(dev->threadview, &dev->sched, name);
+		schedPrint(dev->threadview, name);
 	}
 
 	if (pthread_create(&threadview3d, NULL, view_3d_thread, NULL) != 0) {
 		printf("pthread_create failed\n");
 		exit(-1);
 	}
+	(void) schedApply(threadview3d, &gPrm.sched_gl, "3d view");
+	schedPrint(threadview3d, "3d view");
 
 	printf("\n");
 	printf("Press [ctrl + c] to quit. \n");
 
-	// Spin Here
+	// Spin Here, Report Frame Rate Periodically
+	struct timespec ts_last;
+	struct timespec ts_now;
+	clock_gettime(CLOCK_MONOTONIC, &ts_last);
 	while (!bExit) {
-		sleep(100);
+		sleep(APL_STAT_INTERVAL_SEC);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		double sec = (double)(ts_now.tv_sec - ts_last.tv_sec) + (double)(ts_now.tv_nsec - ts_last.tv_nsec) * 1e-9;
+		ts_last = ts_now;
+		if (!bExit && (sec > 0)) {
+			apl_print_fps(sec);
+			apl_print_jitter();
+			apl_print_qos();
+			apl_print_analysis();
+		}
+
+		if (bTraceDump) {
+			bTraceDump = false;
+			(void) traceDump();
+		}
 	}
 
+	apl_print_cancel();
+
 	if (apl_stop() < 0) {
 		printf("app exit abnormal\n");
 		(void) apl_term();
 		exit(-1);
 	}
 
+	// Wait Threads Terminate
+	for (int i = 0; i < gPrm.dev_num; i++) {
+		if (gPrm.dev[i].thread_created) {
+			pthread_join(gPrm.dev[i].threadview, NULL);
+		}
+	}
+
+	if (g_trace_enable) {
+		(void) traceDump();
+	}
+
 	if (apl_term() < 0) {
 		printf("apl_term abnormal\n");
 		exit(-1);
 	}
 
-	// Wait Threads Terminate
-	if (threadview) {
-		pthread_join(threadview, NULL);
-	}
+	paraTerm();
+	histTerm(&gPrm.hist);
+	recTerm(&gPrm.rec_depth);
+	recTerm(&gPrm.rec_ir);
+	dashTerm(&gPrm.dash);
 
 	if (threadview3d) {
 		pthread_join(threadview3d, NULL);
 	}
 
+	tl_log_term();
+
 	printf("viewer exited\n\n");
 	printf("----------------------------------------\n");
 